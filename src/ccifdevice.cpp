@@ -15,18 +15,12 @@
 
 #include "dnmdefs.h"
 #include "dnmerrs.h"
+#include "dnmhist.h"
+#include "dnmprobe.h"
+#include "dnmos.h"
 #include "ccifintf.h"
 #include "ccifdevice.h"
 
-#if defined(OS_LINUX)
-#include <unistd.h>
-#define msleep(ms) ( usleep(ms*1000) )
-#elif defined(OS_WIN32)
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#define msleep(ms) ( Sleep(ms) )
-#endif
-
 #if defined(OS_LINUX)
 #include "cif_user.h"
 #elif defined(OS_WIN32)
@@ -34,23 +28,7 @@
 #endif
 #include "rcs_user.h"
 #include "dnm_user.h"
-
-/** Device 0 mask */
-#define DEV_0       0x01
-/** Device 1 mask */
-#define DEV_1       0x02
-/** Device 2 mask */
-#define DEV_2       0x04
-/** Device 3 mask */
-#define DEV_3       0x08
-/** Device 4 mask */
-#define DEV_4       0x10
-/** Device 5 mask */
-#define DEV_5       0x20
-/** Device 6 mask */
-#define DEV_6       0x40
-/** Device 7 mask */
-#define DEV_7       0x80
+#include "cifrec.h"
 
 /**
  * @brief Translate DNetMod connection types to CIF connection types.
@@ -70,7 +48,11 @@ char CCIFDevice::strClassName[] = "CCIFDevice";
  * Initializes members accordingly.
  */
 CCIFDevice::CCIFDevice() : CDevice() {
+    ulTypeMask = TYPE_MASK;
     usInputOffset = usOutputOffset = 0;
+    ulIOGen = 0;
+    ResetTimeouts();
+    ClearFault();
 }
 
 /**
@@ -92,7 +74,202 @@ CCIFDevice::CCIFDevice(
     unsigned short usEPR,
     CInterface     *pIntf)
 : CDevice(ucMID, ucCCS, ucPCS, ucCT, usEPR, pIntf) {
+    ulTypeMask = TYPE_MASK;
     usInputOffset = usOutputOffset = 0;
+    ulIOGen = 0;
+    ResetTimeouts();
+    ClearFault();
+}
+
+/**
+ * @brief Returns device to the cycle
+ *
+ * Clears the isolation flag and the failure counter. Called automatically
+ * when a probe finds the device connected and on allocation of the device.
+ */
+void CCIFDevice::ClearFault(void) {
+    ulFailCnt = 0;
+    bFaulted = false;
+    ulProbeIntv = DNETMOD_PROBE_MIN_MS;
+    ulNextProbe = 0;
+    ulFaultConn = 0;
+    InvalidateIOHandles();
+    ReportFault(false);
+    if ( bActive )
+        DnmMetricsDevState(static_cast<CCIFInterface *>(pInterface)->GetBoardNum(), ucMacID, DNM_DEVST_CONNECTED);
+}
+
+/**
+ * @brief Isolates device from the cycle
+ *
+ * Schedules the first probe after #DNETMOD_PROBE_MIN_MS.
+ */
+void CCIFDevice::SetFaulted(void) {
+    if ( !bFaulted ) {
+        bFaulted = true;
+        ulProbeIntv = DNETMOD_PROBE_MIN_MS;
+        ulNextProbe = DnmTimeMs() + ulProbeIntv;
+        ulFaultConn = static_cast<CCIFInterface *>(pInterface)->GetDevReconnects(ucMacID);
+        InvalidateIOHandles();
+        ReportFault(true);
+        DnmMetricsDevState(static_cast<CCIFInterface *>(pInterface)->GetBoardNum(), ucMacID, DNM_DEVST_FAULTED);
+    }
+}
+
+/**
+ * @brief Accounts the result of a driver call in device's health
+ *
+ * A driver timeout isolates the device immediately, while other errors
+ * isolate it after #DNETMOD_FAULT_THRESHOLD consecutive failures.
+ * @param sStatus Status returned by the driver.
+ */
+void CCIFDevice::RecordResult(short sStatus) {
+    if ( sStatus >= 0 && sStatus < DRV_RCS_ERROR_OFFSET ) {
+        ulFailCnt = 0;
+        return;
+    }
+
+    bool bTimeout = sStatus == DRV_DEV_EXCHANGE_TIMEOUT ||
+                    sStatus == DRV_DEV_PUT_TIMEOUT      ||
+                    sStatus == DRV_DEV_GET_TIMEOUT;
+
+    ulFailCnt++;
+    if ( bTimeout )
+        DnmMetricsAdd(DNM_MET_TIMEOUTS, static_cast<CCIFInterface *>(pInterface)->GetBoardNum(), 1);
+    if ( bTimeout || ulFailCnt >= DNETMOD_FAULT_THRESHOLD )
+        SetFaulted();
+}
+
+/**
+ * @brief Converts status of a driver call to error
+ *
+ * Accounts the result in device's health (see CCIFDevice::RecordResult)
+ * unless the call was a try which would block.
+ * @param pCIFIntf Interface of the device.
+ * @param sStatus Status returned by the driver.
+ * @param ulTimeout Timeout passed to the call.
+ * @param ucErr Error from the message, if any.
+ * @param strFunc Name of the driver function.
+ * @return Error from \ref SetError function.
+ */
+int CCIFDevice::CallResult(
+    CCIFInterface *pCIFIntf,
+    short         sStatus,
+    unsigned long ulTimeout,
+    unsigned char ucErr,
+    const char    *strFunc)
+{
+    if ( CCIFInterface::WouldBlock(sStatus, ulTimeout) )
+        return SetError(ERR_WOULDBLOCK, ucMacID, strFunc);
+
+    RecordResult(sStatus);
+    return SetError(ERR_CIF, sStatus, ucErr, pCIFIntf->GetBoardNum(), ucMacID);
+}
+
+/**
+ * @brief Checks whether an operation may be executed on the device
+ *
+ * For isolated devices the function probes the device when the probe
+ * interval has elapsed. The probe reads the task state of the board (no
+ * mailbox round trip) and checks whether I/O connection to the device is
+ * established. If not the probe interval is doubled up to
+ * #DNETMOD_PROBE_MAX_MS. When the interface supervisor runs (see
+ * CCIFInterface::StartSupervisor) its view of the connection state is used
+ * first. A device it sees disconnected is isolated without querying the
+ * board, and an isolated device returns to the cycle once the supervisor
+ * has reconnected it. Until then it is probed as without the supervisor,
+ * because the supervisor does not see a device which failed while staying
+ * connected.
+ * @param pCIFIntf Interface of the device.
+ * @return True if the operation may be executed, false if the device is
+ * isolated.
+ */
+bool CCIFDevice::CheckHealth(CCIFInterface *pCIFIntf) {
+    if ( pCIFIntf->IsSupervised() ) {
+        if ( !pCIFIntf->IsDevConnected(ucMacID) ) {
+            if ( !bFaulted )
+                SetFaulted();
+            return false;
+        }
+        if ( bFaulted && pCIFIntf->GetDevReconnects(ucMacID) != ulFaultConn ) {
+            ClearFault();
+            return true;
+        }
+    }
+
+    if ( !bFaulted )
+        return true;
+
+    unsigned long ulNow = DnmTimeMs();
+
+    if ( !DnmTimeReached(ulNow, ulNextProbe) )
+        return false;
+
+    DNM_DIAGNOSTICS DevDiag;
+    short sStatus = 0;
+
+    DNM_DRV_CALL(sStatus, DNM_HOP_TASKSTATE, pCIFIntf->GetBoardNum(), ucMacID, DevGetTaskState(pCIFIntf->GetBoardNum(), 2, sizeof(DevDiag), &DevDiag));
+
+    if ( sStatus == DRV_NO_ERROR && (DevDiag.bDNM_state & OPERATE) &&
+         (CCIFInterface::DiagMask(DevDiag.abDv_state + 8) & (static_cast<DNM_UINT64>(1) << ucMacID)) ) {
+        ClearFault();
+        return true;
+    }
+
+    ulProbeIntv *= 2;
+    if ( ulProbeIntv > DNETMOD_PROBE_MAX_MS )
+        ulProbeIntv = DNETMOD_PROBE_MAX_MS;
+    ulNextProbe = ulNow + ulProbeIntv;
+
+    return false;
+}
+
+/**
+ * @brief Exchanges I/O data with the device without validation
+ *
+ * Common part of CCIFDevice::ExchangeIOData and CCIFIOHandle.
+ * @param pCIFIntf Interface of the device.
+ * @param usBoard Board number of the interface.
+ * @param bInput Flag determining whether to receive (true) or send (false)
+ * data from/to device.
+ * @param usOffset Offset of device's data in the input or output area.
+ * @param ulBufSz Exchange buffer size.
+ * @param pvBuf Pointer to exchange buffer.
+ * @return Error from \ref SetError function.
+ */
+inline int CCIFDevice::TransferIOData(
+    CCIFInterface  *pCIFIntf,
+    unsigned short usBoard,
+    bool           bInput,
+    unsigned short usOffset,
+    unsigned long  ulBufSz,
+    void           *pvBuf)
+{
+    int           iErr      = 0;
+    short         sStatus   = 0;
+    unsigned long ulTimeout = bOwnTmo ? Timeouts.ulExchange : pCIFIntf->Timeouts.ulExchange;
+    DNM_PROBE_SCOPE(exchange, usBoard, ucMacID, bInput, ulBufSz, sStatus);
+
+    if ( bInput )
+        DNM_DRV_CALL(sStatus, DNM_HOP_EXCHANGE, usBoard, ucMacID, DevExchangeIO(usBoard, 0, 0, NULL, usOffset, static_cast<unsigned short>(ulBufSz), pvBuf, ulTimeout));
+    else {
+        // Keep output image of the interface up to date
+        if ( usOffset + ulBufSz <= sizeof(pCIFIntf->aucOutImage) ) {
+            DnmMutexLock(&pCIFIntf->BoardLock);
+            memcpy(pCIFIntf->aucOutImage + usOffset, pvBuf, ulBufSz);
+            DnmMutexUnlock(&pCIFIntf->BoardLock);
+        }
+        DNM_DRV_CALL(sStatus, DNM_HOP_EXCHANGE, usBoard, ucMacID, DevExchangeIO(usBoard, usOffset, static_cast<unsigned short>(ulBufSz), pvBuf,0,0,NULL,ulTimeout));
+    }
+    iErr = CallResult(pCIFIntf, sStatus, ulTimeout, 0, "DevExchangeIO");
+    if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+        return iErr;
+    DnmMetricsAdd(bInput ? DNM_MET_EXCH_IN : DNM_MET_EXCH_OUT, usBoard, 1);
+    DnmMetricsAdd(bInput ? DNM_MET_BYTES_IN : DNM_MET_BYTES_OUT, usBoard, ulBufSz);
+    if ( bInput )
+        MarkCycle();
+
+    return iErr;
 }
 
 /**
@@ -111,18 +288,16 @@ inline int CCIFDevice::ExchangeIOData(
     int iErr = 0;
 
     if ( ISPTRVALID(pInterface, CInterface)  ) {
-      if ( pInterface->IsA("CCIFInterface") ) {
+      if ( pInterface->Is<CCIFInterface>() ) {
         if ( pInterface->IsActive() ) {
           if ( bActive ) {
-            CCIFInterface *pCIFIntf = dynamic_cast<CCIFInterface *>(pInterface);
-            short sStatus = 0;
+            CCIFInterface *pCIFIntf = static_cast<CCIFInterface *>(pInterface);
 
-            if ( bInput )
-                sStatus = DevExchangeIO(pCIFIntf->GetBoardNum(), 0, 0, NULL, usInputOffset, static_cast<unsigned short>(ulBufSz), pvBuf, 500L);
-            else sStatus = DevExchangeIO(pCIFIntf->GetBoardNum(), usOutputOffset, static_cast<unsigned short>(ulBufSz), pvBuf,0,0,NULL,500L);
-            iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
-            if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
-                return iErr;
+            if ( !CheckHealth(pCIFIntf) )
+                return SetError(ERR_DEVFAULT, ucMacID);
+
+            iErr = TransferIOData(pCIFIntf, pCIFIntf->GetBoardNum(), bInput,
+                                  bInput ? usInputOffset : usOutputOffset, ulBufSz, pvBuf);
           }
           else iErr = SetError(ERR_NOALOC, ucMacID);
         }
@@ -140,11 +315,16 @@ inline int CCIFDevice::ExchangeIOData(
  * @return Error from \ref SetError function.
  */
 int CCIFDevice::Diagnostics(void) {
+    if ( !ISPTRVALID(pInterface, CInterface) || !pInterface->Is<CCIFInterface>() )
+        return SetError(ERR_INVITF, ucMacID, "CCIFInterface");
+
     short sStatus = 0;
     int iErr      = 0;
-    CCIFInterface           *pCIFIntf  = dynamic_cast<CCIFInterface *>(pInterface);
+    CCIFInterface           *pCIFIntf  = static_cast<CCIFInterface *>(pInterface);
     RCS_MESSAGETELEGRAM_10  MsgBuff;
+    const CIFTimeouts       &Tmo       = GetTimeouts();
     DNM_DEVICE_DIAG_CONFIRM *pDiagData = reinterpret_cast<DNM_DEVICE_DIAG_CONFIRM *>(MsgBuff.d);
+    DNM_PROBE_SCOPE(diagnostics, pCIFIntf->GetBoardNum(), ucMacID, 0, sizeof(DNM_DEVICE_DIAG_CONFIRM), sStatus);
 
     MsgBuff.rx = 3;  // DNM-Task
     MsgBuff.tx = 16; // User at HOST
@@ -154,19 +334,21 @@ int CCIFDevice::Diagnostics(void) {
     MsgBuff.device_adr = ucMacID;
 
     // Gather diagnostics data for the device
-    sStatus = DevPutMessage(pCIFIntf->GetBoardNum(), reinterpret_cast<MSG_STRUC *>(&MsgBuff), 500L);
-    iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
+    sStatus = pCIFIntf->PutMessage(&MsgBuff, Tmo.ulPut, ucMacID);
+    iErr = CallResult(pCIFIntf, sStatus, Tmo.ulPut, 0, "DevPutMessage");
     if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
         return iErr;
 
-    sStatus = DevGetMessage(pCIFIntf->GetBoardNum(), sizeof(MsgBuff), reinterpret_cast<MSG_STRUC *>(&MsgBuff), 1000L);
-    iErr = SetError(ERR_CIF, sStatus, MsgBuff.f, pCIFIntf->GetBoardNum(), ucMacID);
+    sStatus = pCIFIntf->GetMessage(sizeof(MsgBuff), &MsgBuff, Tmo.ulDiag, ucMacID);
+    iErr = CallResult(pCIFIntf, sStatus, Tmo.ulDiag, MsgBuff.f, "DevGetMessage");
     if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
         return iErr;
 
     // Analyze data
-    if ( pDiagData->tDiagData.bDevStatus1.bDvNoResponse )
+    if ( pDiagData->tDiagData.bDevStatus1.bDvNoResponse ) {
+        SetFaulted();
         iErr = SetError(ERR_CIF, DEV_NOT_RESPONDING, 0, pCIFIntf->GetBoardNum(), ucMacID);
+    }
     else if ( pDiagData->tDiagData.bDevStatus1.bPrmFault )
         iErr = SetError(ERR_CIF, DEV_ATTR_ACCESS_DENIED, 0, pCIFIntf->GetBoardNum(), ucMacID);
     else if ( pDiagData->tDiagData.bDevStatus1.bCfgFault )
@@ -207,16 +389,20 @@ bool CCIFDevice::IsA(const char *strCompareName) const {
  *
  * The function prepares an RCS message with a download request to set device
  * parameters and sends it to device. Then checks whether device is configured
- * and I/O connection is established to set the active flag.
+ * and I/O connection is established to set the active flag. I/O offsets of
+ * the device are reserved in the process image when the download succeeds.
  * @return Error from \ref SetError function.
  */
 int CCIFDevice::Allocate(unsigned char /*ucFlags*/) {
     int iErr = 0;
 
+    InvalidateIOHandles();
+
     if ( ISPTRVALID(pInterface, CInterface) ) {
-      if ( pInterface->IsA("CCIFInterface") ) {
+      if ( pInterface->Is<CCIFInterface>() ) {
         if ( pInterface->IsActive() ) {
-            CCIFInterface *pCIFIntf = dynamic_cast<CCIFInterface *>(pInterface);
+            CCIFInterface *pCIFIntf = static_cast<CCIFInterface *>(pInterface);
+            const CIFTimeouts &Tmo = GetTimeouts();
             short                        sStatus             = 0;
             RCS_MESSAGE                  MsgBuf;
             DNM_DOWNLOAD_REQUEST         *pDownloadReq       = 0;
@@ -229,6 +415,16 @@ int CCIFDevice::Allocate(unsigned char /*ucFlags*/) {
             DNM_EXPL_SET_ATTR_DATA       *pExplSetAttrData   = 0;
             DNM_UCMM_CONN_OBJ_CFG_DATA   *pUcmmConnObjCfgData= 0;
             DNM_UCMM_CONN_OBJ_ADD_TAB    *pUcmmConnObjAddTab = 0;
+            DNM_BUS_CONN                 BusConn;
+            unsigned short               usInOff             = 0;
+            unsigned short               usOutOff            = 0;
+            DNM_PROBE_SCOPE(allocate, pCIFIntf->GetBoardNum(), ucMacID, ucConnType, ucConsumedConnSize + ucProducedConnSize, sStatus);
+
+            // Reject device if bus would be overloaded
+            DnmDeviceToBusConn(this, &BusConn);
+            iErr = pCIFIntf->CheckBusLoad(ucMacID, BusConn);
+            if ( iErr != ERR_NOERR )
+                return iErr;
 
             // Message header
             MsgBuf.rx = 3;  // DNM-Task
@@ -268,7 +464,7 @@ int CCIFDevice::Allocate(unsigned char /*ucFlags*/) {
             pDevPrmHdr->bOctetString[0]      = 0;               // d[18]
             pDevPrmHdr->bOctetString[1]      = 0;               // d[19]
 
-            pPredMstslCfgData = reinterpret_cast<DNM_PRED_MSTSL_CFG_DATA *>(static_cast<unsigned char>(pDevPrmHdr->usDevParaLen) + pDevPrmHdr->usDevParaLen);
+            pPredMstslCfgData = reinterpret_cast<DNM_PRED_MSTSL_CFG_DATA *>(reinterpret_cast<unsigned char *>(pDevPrmHdr) + pDevPrmHdr->usDevParaLen);
 
             // Predefined Master-Slave Config Data
             pPredMstslCfgData->usPredMstslCfgDataLen = sizeof(pPredMstslCfgData->usPredMstslCfgDataLen);
@@ -308,17 +504,18 @@ int CCIFDevice::Allocate(unsigned char /*ucFlags*/) {
             pPredMstslAddTab->bInputCount  = 0;
             pPredMstslAddTab->bOutputCount = 0;
 
+            // Offsets are reserved only after a successful download, so a
+            // retried try puts the same request
+            DnmMutexLock(&pCIFIntf->AllocLock);
+            usInOff  = pCIFIntf->usInputOffset;
+            usOutOff = pCIFIntf->usOutputOffset;
             if ( ucConsumedConnSize ) {
-                pPredMstslAddTab->ausIOOffsets[pPredMstslAddTab->bInputCount] = pCIFIntf->usInputOffset;
-                usInputOffset = pCIFIntf->usInputOffset;
-                pCIFIntf->usInputOffset = pCIFIntf->usInputOffset + ucConsumedConnSize;
+                pPredMstslAddTab->ausIOOffsets[pPredMstslAddTab->bInputCount] = usInOff;
                 pPredMstslAddTab->bInputCount++;
                 pPredMstslAddTab->usAddTabLen += sizeof(unsigned short);
             }
             if ( ucProducedConnSize ) {
-                pPredMstslAddTab->ausIOOffsets[pPredMstslAddTab->bOutputCount + pPredMstslAddTab->bInputCount] = pCIFIntf->usOutputOffset;
-                usOutputOffset = pCIFIntf->usOutputOffset;
-                pCIFIntf->usOutputOffset = pCIFIntf->usOutputOffset + ucProducedConnSize;
+                pPredMstslAddTab->ausIOOffsets[pPredMstslAddTab->bOutputCount + pPredMstslAddTab->bInputCount] = usOutOff;
                 pPredMstslAddTab->bOutputCount++;
                 pPredMstslAddTab->usAddTabLen += sizeof(unsigned short);
             }
@@ -347,15 +544,33 @@ int CCIFDevice::Allocate(unsigned char /*ucFlags*/) {
             MsgBuf.ln = static_cast<unsigned char>(pDevPrmHdr->usDevParaLen) + sizeof(DNM_DOWNLOAD_REQUEST) - MAX_LEN_DATA_UNIT;
 
             /* Download data to DEVICE */
-            sStatus = DevPutMessage(pCIFIntf->GetBoardNum(), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 500L);
-            iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
-            if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+            sStatus = pCIFIntf->PutMessage(&MsgBuf, Tmo.ulPut, ucMacID);
+            iErr = CallResult(pCIFIntf, sStatus, Tmo.ulPut, 0, "DevPutMessage");
+            if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET ) {
+                DnmMutexUnlock(&pCIFIntf->AllocLock);
                 return iErr;
+            }
 
-            sStatus = DevGetMessage(pCIFIntf->GetBoardNum(), sizeof(MsgBuf), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 3000L);
-            iErr = SetError(ERR_CIF, sStatus, MsgBuf.f, pCIFIntf->GetBoardNum(), ucMacID);
-            if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+            sStatus = pCIFIntf->GetMessage(sizeof(MsgBuf), &MsgBuf, Tmo.ulGetLong, ucMacID);
+            iErr = CallResult(pCIFIntf, sStatus, Tmo.ulGetLong, MsgBuf.f, "DevGetMessage");
+            if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET ) {
+                DnmMutexUnlock(&pCIFIntf->AllocLock);
                 return iErr;
+            }
+
+            if ( !iErr ) {
+                usInputOffset  = usInOff;
+                usOutputOffset = usOutOff;
+                DnmMutexLock(&pCIFIntf->BoardLock);
+                pCIFIntf->usInputOffset  = usInOff + ucConsumedConnSize;
+                pCIFIntf->usOutputOffset = usOutOff + ucProducedConnSize;
+                if ( ucProducedConnSize ) {
+                    pCIFIntf->ausDevOutOffset[ucMacID] = usOutOff;
+                    pCIFIntf->aucDevOutSize[ucMacID]   = ucProducedConnSize;
+                }
+                DnmMutexUnlock(&pCIFIntf->BoardLock);
+            }
+            DnmMutexUnlock(&pCIFIntf->AllocLock);
 
             if ( !iErr )
                 iErr = pCIFIntf->Open();
@@ -368,51 +583,35 @@ int CCIFDevice::Allocate(unsigned char /*ucFlags*/) {
                to 1 millisecond so I use 100 ms. This here must be dummy but
                I don't find other way to do this.
                =============================================================*/
-            msleep(100); // sleep for 100 ms
+            DNM_TRACE_STMT("sleep", pCIFIntf->GetBoardNum(), ucMacID, DnmSleepMs(100)); // sleep for 100 ms
 
             // Device diagnostics
             DNM_DIAGNOSTICS DevDiag;
-            sStatus = DevGetTaskState(pCIFIntf->GetBoardNum(), 2, sizeof(DevDiag), &DevDiag);
+            DNM_DRV_CALL(sStatus, DNM_HOP_TASKSTATE, pCIFIntf->GetBoardNum(), ucMacID, DevGetTaskState(pCIFIntf->GetBoardNum(), 2, sizeof(DevDiag), &DevDiag));
             iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
             if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
                 return iErr;
 
             // Check if DEVICE is in operating state
             if ( DevDiag.bDNM_state & OPERATE ) {
-                unsigned char ucOffset = ucMacID / 8;
-                unsigned char ucMask = 0;
-
-                switch ( ucMacID % 8 ) {
-                    case 0: ucMask = DEV_0;
-                            break;
-                    case 1: ucMask = DEV_1;
-                            break;
-                    case 2: ucMask = DEV_2;
-                            break;
-                    case 3: ucMask = DEV_3;
-                            break;
-                    case 4: ucMask = DEV_4;
-                            break;
-                    case 5: ucMask = DEV_5;
-                            break;
-                    case 6: ucMask = DEV_6;
-                            break;
-                    case 7: ucMask = DEV_7;
-                            break;
-                }
+                DNM_UINT64 ullBit = static_cast<DNM_UINT64>(1) << ucMacID;
 
                 // Check if device is configured
-                if ( DevDiag.abDv_cfg[ucOffset] & ucMask ) {
+                if ( CCIFInterface::DiagMask(DevDiag.abDv_cfg) & ullBit ) {
                     // Check if DEVICE has established I/O connection to device
-                    if ( DevDiag.abDv_state[ucOffset + 8] & ucMask )
-                        bActive = true;
-                    else bActive = false;
+                    bActive = ( CCIFInterface::DiagMask(DevDiag.abDv_state + 8) & ullBit ) != 0;
                     // Check if there is new diagnostics data for device
-                    if ( DevDiag.abDv_diag[ucOffset] & ucMask )
+                    if ( CCIFInterface::DiagMask(DevDiag.abDv_diag) & ullBit )
                         iErr = Diagnostics();
                 }
             }
-            if ( !bActive && !iErr )
+            if ( bActive ) {
+                Register(usInputOffset, usOutputOffset);
+                ClearFault();
+                pCIFIntf->SetDevConnected(ucMacID, true);
+                pCIFIntf->SetBusConn(ucMacID, &BusConn);
+            }
+            else if ( !iErr )
                 iErr = SetError(ERR_UKNOW);
         }
         else iErr = SetError(ERR_INOPER, "Allocate");
@@ -427,54 +626,23 @@ int CCIFDevice::Allocate(unsigned char /*ucFlags*/) {
 /**
  * @brief Unallocates the CIF device.
  *
- * The function initializes slave status buffer, changes device I/O connection
- * status bit to 0 (off) and writes slave status buffer to the board.
+ * The function changes device I/O connection status bit to 0 (off) in the
+ * slave status area of the board.
  * @return Error from \ref SetError function.
  */
 int CCIFDevice::UnallocateDevice(void) {
     int iErr = 0;
 
     if ( ISPTRVALID(pInterface, CInterface)  ) {
-      if ( pInterface->IsA("CCIFInterface") ) {
+      if ( pInterface->Is<CCIFInterface>() ) {
         if ( pInterface->IsActive() ) {
-            CCIFInterface *pCIFIntf  = dynamic_cast<CCIFInterface *>(pInterface);
-            unsigned char ucSSBuf[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-            unsigned char *ucBytePtr = ucSSBuf + static_cast<unsigned char>(ucMacID/8);
-            short         sStatus    = 0;
-
-            // Initialize slave status buffer
-            sStatus = DevReadWriteDPMRaw(pCIFIntf->GetBoardNum(), PARAMETER_READ, 0x2F8, sizeof(ucSSBuf), ucSSBuf);
-            iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
-            if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
-                return iErr;
+            CCIFInterface *pCIFIntf = static_cast<CCIFInterface *>(pInterface);
 
-            // Change device I/O connection status bit to 0 (off)
-            switch ( ucMacID % 8 ) {
-                case 0: *ucBytePtr &= ~DEV_0;
-                        break;
-                case 1: *ucBytePtr &= ~DEV_1;
-                        break;
-                case 2: *ucBytePtr &= ~DEV_2;
-                        break;
-                case 3: *ucBytePtr &= ~DEV_3;
-                        break;
-                case 4: *ucBytePtr &= ~DEV_4;
-                        break;
-                case 5: *ucBytePtr &= ~DEV_5;
-                        break;
-                case 6: *ucBytePtr &= ~DEV_6;
-                        break;
-                case 7: *ucBytePtr &= ~DEV_7;
-                        break;
-            }
-
-            // Write slave status buffer to the board
-            sStatus = DevReadWriteDPMRaw(pCIFIntf->GetBoardNum(), PARAMETER_WRITE, 0x2F8, sizeof(ucSSBuf), ucSSBuf);
-            iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
-            if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+            iErr = pCIFIntf->DisableSlaves(static_cast<DNM_UINT64>(1) << ucMacID, ucMacID);
+            if ( iErr != ERR_NOERR )
                 return iErr;
 
-            bActive = false;
+            Unallocated();
         }
         else iErr = SetError(ERR_INOPER, "ReadIOData");
       }
@@ -485,6 +653,29 @@ int CCIFDevice::UnallocateDevice(void) {
     return iErr;
 }
 
+/**
+ * @brief Marks the CIF device unallocated
+ *
+ * Called after the device is deactivated in the slave status area of the
+ * board, either by UnallocateDevice or by CCIFInterface::UnallocateMany.
+ */
+void CCIFDevice::Unallocated(void) {
+    if ( ISPTRVALID(pInterface, CInterface) && pInterface->Is<CCIFInterface>() ) {
+        CCIFInterface *pCIFIntf = static_cast<CCIFInterface *>(pInterface);
+
+        pCIFIntf->SetDevConnected(ucMacID, false);
+        pCIFIntf->SetBusConn(ucMacID, 0);
+        // Stop merging queued output updates for the device
+        DnmMutexLock(&pCIFIntf->BoardLock);
+        pCIFIntf->aucDevOutSize[ucMacID] = 0;
+        DnmMutexUnlock(&pCIFIntf->BoardLock);
+    }
+    BreakCycle();
+    bActive = false;
+    Unregister();
+    InvalidateIOHandles();
+}
+
 /**
  * @brief Unalloates the CIF device.
  * @return Error from \ref SetError function.
@@ -537,11 +728,16 @@ int CCIFDevice::GetAttribute(
 
     if ( ISPTRVALID(pInterface, CInterface) ) {
       if ( pInterface->IsActive() ) {
-        if ( pInterface->IsA("CCIFInterface") ) {
+        if ( pInterface->Is<CCIFInterface>() ) {
           if ( bActive ) {
-            CCIFInterface *pCIFIntf = dynamic_cast<CCIFInterface *>(pInterface);
+            CCIFInterface *pCIFIntf = static_cast<CCIFInterface *>(pInterface);
+            const CIFTimeouts &Tmo = GetTimeouts();
             short sStatus = 0;
             RCS_MESSAGETELEGRAM_10 MsgBuf;
+            DNM_PROBE_SCOPE(get_attribute, pCIFIntf->GetBoardNum(), ucMacID, usClsId, usDataSz, sStatus);
+
+            if ( !CheckHealth(pCIFIntf) )
+                return SetError(ERR_DEVFAULT, ucMacID);
 
             MsgBuf.rx = 3;
             MsgBuf.tx = 16;
@@ -557,14 +753,13 @@ int CCIFDevice::GetAttribute(
             MsgBuf.data_type  = 0;
             MsgBuf.function   = TASK_TFC_READ;
 
-            sStatus = DevPutMessage(pCIFIntf->GetBoardNum(), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 500L);
-            iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
+            sStatus = pCIFIntf->PutMessage(&MsgBuf, Tmo.ulPut, ucMacID);
+            iErr = CallResult(pCIFIntf, sStatus, Tmo.ulPut, 0, "DevPutMessage");
             if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
                 return iErr;
 
-            sStatus = DevGetMessage(pCIFIntf->GetBoardNum(), sizeof(MsgBuf), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 3000L);
-
-            iErr = SetError(ERR_CIF, sStatus, MsgBuf.f, pCIFIntf->GetBoardNum(), ucMacID);
+            sStatus = pCIFIntf->GetMessage(sizeof(MsgBuf), &MsgBuf, Tmo.ulGetLong, ucMacID);
+            iErr = CallResult(pCIFIntf, sStatus, Tmo.ulGetLong, MsgBuf.f, "DevGetMessage");
             if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
                 return iErr;
             // Handle device errors
@@ -612,11 +807,16 @@ int CCIFDevice::SetAttribute(
 
     if ( ISPTRVALID(pInterface, CInterface) ) {
       if ( pInterface->IsActive() ) {
-        if ( pInterface->IsA("CCIFInterface") ) {
+        if ( pInterface->Is<CCIFInterface>() ) {
           if ( bActive ) {
-            CCIFInterface *pCIFIntf = dynamic_cast<CCIFInterface *>(pInterface);
+            CCIFInterface *pCIFIntf = static_cast<CCIFInterface *>(pInterface);
+            const CIFTimeouts &Tmo = GetTimeouts();
             short sStatus = 0;
             RCS_MESSAGETELEGRAM_10 MsgBuf;
+            DNM_PROBE_SCOPE(set_attribute, pCIFIntf->GetBoardNum(), ucMacID, usClsId, usDataSz, sStatus);
+
+            if ( !CheckHealth(pCIFIntf) )
+                return SetError(ERR_DEVFAULT, ucMacID);
 
             MsgBuf.rx = 3;
             MsgBuf.tx = 16;
@@ -634,12 +834,15 @@ int CCIFDevice::SetAttribute(
 
             memcpy(MsgBuf.d, pvData, usDataSz);
 
-            sStatus = DevPutMessage(pCIFIntf->GetBoardNum(), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 500L);
-            iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
+            sStatus = pCIFIntf->PutMessage(&MsgBuf, Tmo.ulPut, ucMacID);
+            iErr = CallResult(pCIFIntf, sStatus, Tmo.ulPut, 0, "DevPutMessage");
             if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
                 return iErr;
 
-            sStatus = DevGetMessage(pCIFIntf->GetBoardNum(), sizeof(MsgBuf), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 500L);
+            sStatus = pCIFIntf->GetMessage(sizeof(MsgBuf), &MsgBuf, Tmo.ulGet, ucMacID);
+            iErr = CallResult(pCIFIntf, sStatus, Tmo.ulGet, MsgBuf.f, "DevGetMessage");
+            if ( iErr == ERR_WOULDBLOCK )
+                return iErr;
             // Handle device errors
             if ( MsgBuf.f > DERR_OK && MsgBuf.f <= DERR_VENDSPEC )
                 iErr = SetError(ERR_EXPLCT, ucMacID, MsgBuf.f, MsgBuf.d[0]);
@@ -681,11 +884,16 @@ int CCIFDevice::ExecService(
 
     if ( ISPTRVALID(pInterface, CInterface) ) {
       if ( pInterface->IsActive() ) {
-        if ( pInterface->IsA("CCIFInterface") ) {
+        if ( pInterface->Is<CCIFInterface>() ) {
           if ( bActive ) {
-            CCIFInterface *pCIFIntf = dynamic_cast<CCIFInterface *>(pInterface);
+            CCIFInterface *pCIFIntf = static_cast<CCIFInterface *>(pInterface);
+            const CIFTimeouts &Tmo = GetTimeouts();
             short sStatus = 0;
             RCS_MESSAGETELEGRAM_10 MsgBuf;
+            DNM_PROBE_SCOPE(exec_service, pCIFIntf->GetBoardNum(), ucMacID, ucSrvCode, usDataSz, sStatus);
+
+            if ( !CheckHealth(pCIFIntf) )
+                return SetError(ERR_DEVFAULT, ucMacID);
 
             MsgBuf.rx = 3;
             MsgBuf.tx = 16;
@@ -702,12 +910,15 @@ int CCIFDevice::ExecService(
             MsgBuf.function   = ucSrvCode;
             memmove(MsgBuf.d, pvData, usDataSz);
 
-            sStatus = DevPutMessage(pCIFIntf->GetBoardNum(), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 500L);
-            iErr = SetError(ERR_CIF, sStatus, 0, pCIFIntf->GetBoardNum(), ucMacID);
+            sStatus = pCIFIntf->PutMessage(&MsgBuf, Tmo.ulPut, ucMacID);
+            iErr = CallResult(pCIFIntf, sStatus, Tmo.ulPut, 0, "DevPutMessage");
             if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
                 return iErr;
 
-            sStatus = DevGetMessage(pCIFIntf->GetBoardNum(), sizeof(MsgBuf), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 500L);
+            sStatus = pCIFIntf->GetMessage(sizeof(MsgBuf), &MsgBuf, Tmo.ulGet, ucMacID);
+            iErr = CallResult(pCIFIntf, sStatus, Tmo.ulGet, MsgBuf.f, "DevGetMessage");
+            if ( iErr == ERR_WOULDBLOCK )
+                return iErr;
             // Handle device errors
             if ( MsgBuf.f > DERR_OK && MsgBuf.f <= DERR_VENDSPEC )
                 iErr = SetError(ERR_EXPLCT, ucMacID, MsgBuf.f, MsgBuf.d[0]);
@@ -751,3 +962,129 @@ CCIFDevice::~CCIFDevice() {
         UnallocateDevice();
 }
 
+
+/**
+ * @brief Constructor
+ *
+ * The handle is not bound.
+ */
+CCIFIOHandle::CCIFIOHandle() {
+    Unbind();
+}
+
+/**
+ * @brief Retrieves current generation of the bound device and its interface
+ *
+ * Both generations only grow, so their sum changes whenever any of them
+ * changes.
+ * @return Generation.
+ */
+inline unsigned long CCIFIOHandle::CurrentGen(void) const {
+    return DnmAtomicLoad(&pDev->ulIOGen) + DnmAtomicLoad(&pCIFIntf->ulIOGen);
+}
+
+/**
+ * @brief Binds the handle to an allocated device
+ * @param pDevice The device. Must be allocated and not isolated and its
+ * interface must be an active CCIFInterface.
+ * @return Error from \ref SetError function. The handle is unbound on
+ * error.
+ */
+int CCIFIOHandle::Bind(CCIFDevice *pDevice) {
+    CInterface *pIntf = 0;
+
+    Unbind();
+    if ( !ISPTRVALID(pDevice, CCIFDevice) )
+        return SetError(ERR_INVPTR, 0, "pDevice", pDevice);
+
+    pIntf = pDevice->pInterface;
+    if ( !ISPTRVALID(pIntf, CInterface) )
+        return SetError(ERR_INVPTR, pDevice->GetMacID(), "pInterface", pIntf);
+    if ( !pIntf->Is<CCIFInterface>() )
+        return SetError(ERR_INVITF, pDevice->GetMacID(), "CCIFInterface");
+
+    pDev = pDevice;
+    pCIFIntf = static_cast<CCIFInterface *>(pIntf);
+    // Take the generation first, so changes made meanwhile are detected
+    ulGen = CurrentGen();
+    if ( !pCIFIntf->IsActive() ) {
+        Unbind();
+        return SetError(ERR_INOPER, "Bind");
+    }
+    if ( !pDev->IsActive() ) {
+        Unbind();
+        return SetError(ERR_NOALOC, pDevice->GetMacID());
+    }
+    if ( pDev->IsFaulted() ) {
+        Unbind();
+        return SetError(ERR_DEVFAULT, pDevice->GetMacID());
+    }
+    usBoard = pCIFIntf->GetBoardNum();
+    usInputOffset = pDev->usInputOffset;
+    usOutputOffset = pDev->usOutputOffset;
+    usInputSize = pDev->GetConsumedConnSize();
+    usOutputSize = pDev->GetProducedConnSize();
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Unbinds the handle
+ */
+void CCIFIOHandle::Unbind(void) {
+    pDev = 0;
+    pCIFIntf = 0;
+    usBoard = 0;
+    usInputOffset = usOutputOffset = 0;
+    usInputSize = usOutputSize = 0;
+    ulGen = 0;
+}
+
+/**
+ * @brief Exchanges I/O data when the generation changed
+ *
+ * Exchanges the data through the validated path of the device and binds
+ * the handle again on success.
+ * @param bInput Flag determining whether to receive (true) or send (false)
+ * data from/to device.
+ * @param pvBuf Pointer to exchange buffer.
+ * @return Error from \ref SetError function.
+ */
+int CCIFIOHandle::Exchange(bool bInput, void *pvBuf) {
+    CCIFDevice    *pDevice = pDev;
+    unsigned long ulSize   = bInput ? pDevice->GetConsumedConnSize() : pDevice->GetProducedConnSize();
+    int           iErr     = pDevice->ExchangeIOData(bInput, ulSize, pvBuf);
+
+    if ( iErr == ERR_NOERR )
+        Bind(pDevice);
+
+    return iErr;
+}
+
+/**
+ * @brief Reads input data of the device
+ * @param pvBuf Buffer of at least CCIFIOHandle::GetInputSize bytes.
+ * @return Error from \ref SetError function.
+ */
+int CCIFIOHandle::Read(void *pvBuf) {
+    if ( pDev == 0 )
+        return SetError(ERR_INVPTR, 0, "pDev", pDev);
+    if ( CurrentGen() != ulGen )
+        return Exchange(true, pvBuf);
+
+    return pDev->TransferIOData(pCIFIntf, usBoard, true, usInputOffset, usInputSize, pvBuf);
+}
+
+/**
+ * @brief Writes output data of the device
+ * @param pvBuf Buffer of at least CCIFIOHandle::GetOutputSize bytes.
+ * @return Error from \ref SetError function.
+ */
+int CCIFIOHandle::Write(void *pvBuf) {
+    if ( pDev == 0 )
+        return SetError(ERR_INVPTR, 0, "pDev", pDev);
+    if ( CurrentGen() != ulGen )
+        return Exchange(false, pvBuf);
+
+    return pDev->TransferIOData(pCIFIntf, usBoard, false, usOutputOffset, usOutputSize, pvBuf);
+}
@@ -21,6 +21,14 @@
 #endif
 
 #include "cdevice.h"
+#include "ccifintf.h"
+
+/** Consecutive failed driver calls after which a device is isolated */
+#define DNETMOD_FAULT_THRESHOLD 3
+/** Initial interval between probes of an isolated device in ms */
+#define DNETMOD_PROBE_MIN_MS    100
+/** Maximum interval between probes of an isolated device in ms */
+#define DNETMOD_PROBE_MAX_MS    10000
 
 /**
  * @brief Represents a device connected to a Hilscher CIF board.
@@ -34,19 +42,57 @@ class DNETMOD_API CCIFDevice : public CDevice {
 private:
     unsigned short usInputOffset;
     unsigned short usOutputOffset;
+    /* Health */
+    /** Consecutive failed driver calls */
+    unsigned long ulFailCnt;
+    /** Flag showing the device is isolated from the cycle */
+    bool bFaulted;
+    /** Current interval between probes in ms */
+    unsigned long ulProbeIntv;
+    /** Time of the next probe (see DnmTimeMs) */
+    unsigned long ulNextProbe;
+    /** Reconnections of the device seen by the supervisor when isolated */
+    unsigned long ulFaultConn;
+    /** Generation of I/O handles, changed when they are to be bound again */
+    volatile unsigned long ulIOGen;
+    /** Own timeouts of driver calls */
+    CIFTimeouts Timeouts;
+    /** Flag showing the device uses its own timeouts */
+    bool bOwnTmo;
 private:
     CCIFDevice(const CCIFDevice&);
     CCIFDevice& operator =(const CCIFDevice&);
 private:
     int ExchangeIOData(bool, unsigned long, void *);
+    int TransferIOData(CCIFInterface  *pCIFIntf,
+                       unsigned short usBoard,
+                       bool           bInput,
+                       unsigned short usOffset,
+                       unsigned long  ulBufSz,
+                       void           *pvBuf);
     int Diagnostics(void);
     int UnallocateDevice(void);
+    void Unallocated(void);
+    bool CheckHealth(CCIFInterface *pCIFIntf);
+    void RecordResult(short sStatus);
+    int CallResult(CCIFInterface *pCIFIntf,
+                   short         sStatus,
+                   unsigned long ulTimeout,
+                   unsigned char ucErr,
+                   const char    *strFunc);
+    void SetFaulted(void);
+    void InvalidateIOHandles(void);
 protected:
     /** Class's ID */
     static unsigned long ulClassID;
     /** Class's name */
     static char strClassName[];
+    friend class CCIFInterface;
+    friend class CCIFIOHandle;
 public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_CIFDEVICE | CDevice::TYPE_MASK };
+
     /* constructors */
     CCIFDevice();
     CCIFDevice(unsigned char  ucMID,
@@ -55,6 +101,14 @@ public:
                unsigned char  ucCT,
                unsigned short usEPR,
                CInterface     *pIntf);
+    /* health */
+    bool IsFaulted(void) const;
+    unsigned long GetFailCount(void) const;
+    void ClearFault(void);
+    /* timeouts */
+    const CIFTimeouts & GetTimeouts(void) const;
+    void SetTimeouts(const CIFTimeouts &Tmo);
+    void ResetTimeouts(void);
     /* overrides */
     virtual bool IsA(unsigned long ulCompareID) const;
     virtual bool IsA(const char *strCompareName) const;
@@ -83,5 +137,144 @@ public:
     virtual ~CCIFDevice();
 };
 
+/**
+ * @brief Checks whether device is isolated from the cycle
+ *
+ * A device is isolated after #DNETMOD_FAULT_THRESHOLD consecutive failed
+ * driver calls, after a driver timeout or when its diagnostics report no
+ * response. Operations on an isolated device fail immediately with
+ * <code>ERR_DEVFAULT</code> until a probe finds the device connected again.
+ * @return True if isolated, false otherwise.
+ */
+inline bool CCIFDevice::IsFaulted(void) const {
+    return bFaulted;
+}
+
+/**
+ * @brief Retrieves count of consecutive failed driver calls
+ * @return Count of failures since the last successful call.
+ */
+inline unsigned long CCIFDevice::GetFailCount(void) const {
+    return ulFailCnt;
+}
+
+/**
+ * @brief Retrieves timeouts of driver calls of the device
+ * @return Own timeouts of the device if set, otherwise the timeouts of its
+ * CIF interface.
+ */
+inline const CIFTimeouts & CCIFDevice::GetTimeouts(void) const {
+    if ( !bOwnTmo && pInterface != 0 && pInterface->Is<CCIFInterface>() )
+        return static_cast<const CCIFInterface *>(pInterface)->GetTimeouts();
+
+    return Timeouts;
+}
+
+/**
+ * @brief Sets own timeouts of driver calls of the device
+ *
+ * Overrides the timeouts of the interface (see CCIFInterface::SetTimeouts)
+ * for the operations of this device, e.g. zero timeouts to make them tries
+ * which return <code>ERR_WOULDBLOCK</code> at once. A try which would
+ * block does not count as a failure of the device. Takes effect with the
+ * next operation.
+ * @param Tmo Timeouts in ms.
+ */
+inline void CCIFDevice::SetTimeouts(const CIFTimeouts &Tmo) {
+    Timeouts = Tmo;
+    bOwnTmo = true;
+}
+
+/**
+ * @brief Makes the device use the timeouts of its interface again
+ */
+inline void CCIFDevice::ResetTimeouts(void) {
+    Timeouts = CCIFInterface::DefaultTimeouts();
+    bOwnTmo = false;
+}
+
+/**
+ * @brief Makes I/O handles of the device bind again
+ *
+ * See CCIFIOHandle.
+ */
+inline void CCIFDevice::InvalidateIOHandles(void) {
+    DnmAtomicAdd(&ulIOGen, 1);
+}
+
+/**
+ * @brief I/O handle bound to an allocated CIF device
+ *
+ * Bind validates the device and its interface once and caches the board
+ * number, the offsets and sizes of device's I/O data and the generation of
+ * the device and the interface. Read and Write then only compare the
+ * generation before exchanging the data. The generation changes when the
+ * interface is opened, closed or reset, when a device of the interface is
+ * allocated or unallocated or changes connection state and when the device
+ * is isolated or returns to the cycle. On a mismatch the operation goes the
+ * validated way of CCIFDevice::ReadIOData or CCIFDevice::WriteIOData and
+ * the handle is bound again if it succeeds, so a handle never uses stale
+ * offsets.
+ * @remark The device and its interface must outlive the handle.
+ */
+class DNETMOD_API CCIFIOHandle {
+private:
+    /** Bound device or NULL */
+    CCIFDevice *pDev;
+    /** Interface of the bound device */
+    CCIFInterface *pCIFIntf;
+    /** Board number */
+    unsigned short usBoard;
+    /** Offset of device's input data */
+    unsigned short usInputOffset;
+    /** Offset of device's output data */
+    unsigned short usOutputOffset;
+    /** Size of device's input data */
+    unsigned short usInputSize;
+    /** Size of device's output data */
+    unsigned short usOutputSize;
+    /** Generation of the device and the interface when bound */
+    unsigned long ulGen;
+private:
+    unsigned long CurrentGen(void) const;
+    int Exchange(bool bInput, void *pvBuf);
+public:
+    /* constructors */
+    CCIFIOHandle();
+    /* get */
+    CCIFDevice * GetDevice(void) const;
+    unsigned short GetInputSize(void) const;
+    unsigned short GetOutputSize(void) const;
+    /* main */
+    int Bind(CCIFDevice *pDevice);
+    void Unbind(void);
+    int Read(void *pvBuf);
+    int Write(void *pvBuf);
+};
+
+/**
+ * @brief Retrieves the bound device
+ * @return Pointer to the device or NULL if not bound.
+ */
+inline CCIFDevice * CCIFIOHandle::GetDevice(void) const {
+    return pDev;
+}
+
+/**
+ * @brief Retrieves size of device's input data
+ * @return Count of bytes read by CCIFIOHandle::Read.
+ */
+inline unsigned short CCIFIOHandle::GetInputSize(void) const {
+    return usInputSize;
+}
+
+/**
+ * @brief Retrieves size of device's output data
+ * @return Count of bytes written by CCIFIOHandle::Write.
+ */
+inline unsigned short CCIFIOHandle::GetOutputSize(void) const {
+    return usOutputSize;
+}
+
 #endif /* ccifdevice.h */
 
@@ -0,0 +1,107 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : ccifdrv.cpp               Type        : source            *
+ *  Description : CCIFDriver class implementation.                          *
+ ****************************************************************************/
+
+/**
+ * @file ccifdrv.cpp
+ * @brief CCIFDriver class implementation.
+ */
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmhist.h"
+#include "ccifdrv.h"
+
+#if defined(OS_LINUX)
+#include "cif_user.h"
+#elif defined(OS_WIN32)
+#include "cifuser.h"
+#endif
+#include "rcs_user.h"
+#include "cifrec.h"
+
+CCIFDriver CCIFDriver::Session;
+
+/**
+ * @brief Constructor
+ *
+ * Initializes members accordingly. The driver is not opened.
+ */
+CCIFDriver::CCIFDriver() {
+    DnmMutexInit(&Lock);
+    ulRefCnt = 0;
+}
+
+/**
+ * @brief Takes a reference to the driver connection
+ *
+ * Opens the driver if this is the first reference.
+ * @param usBrdNum Board number of the caller (for error messages).
+ * @param ucMacID MAC ID of the caller (for error messages).
+ * @return Error from \ref SetError function.
+ */
+int CCIFDriver::Acquire(unsigned short usBrdNum, unsigned char ucMacID) {
+    short sStatus = DRV_NO_ERROR;
+    int   iErr    = 0;
+
+    DnmMutexLock(&Lock);
+    if ( ulRefCnt == 0 ) {
+#if defined(OS_LINUX)
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBrdNum, ucMacID, DevOpenDriver());
+#elif defined(OS_WIN32)
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBrdNum, ucMacID, DevOpenDriver(0));
+#endif
+    }
+    iErr = SetError(ERR_CIF, sStatus, 0, usBrdNum, ucMacID);
+    if ( !(sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET) )
+        ulRefCnt++;
+    DnmMutexUnlock(&Lock);
+
+    return iErr;
+}
+
+/**
+ * @brief Releases a reference to the driver connection
+ *
+ * Closes the driver if this was the last reference.
+ * @param usBrdNum Board number of the caller (for error messages).
+ * @param ucMacID MAC ID of the caller (for error messages).
+ * @return Error from \ref SetError function.
+ */
+int CCIFDriver::Release(unsigned short usBrdNum, unsigned char ucMacID) {
+    short sStatus = DRV_NO_ERROR;
+    int   iErr    = 0;
+
+    DnmMutexLock(&Lock);
+    if ( ulRefCnt > 0 && --ulRefCnt == 0 ) {
+#if defined(OS_LINUX)
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBrdNum, ucMacID, DevCloseDriver());
+#elif defined(OS_WIN32)
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBrdNum, ucMacID, DevCloseDriver(0));
+#endif
+    }
+    iErr = SetError(ERR_CIF, sStatus, 0, usBrdNum, ucMacID);
+    DnmMutexUnlock(&Lock);
+
+    return iErr;
+}
+
+/**
+ * @brief Destructor
+ *
+ * Closes the driver if still referenced.
+ */
+CCIFDriver::~CCIFDriver() {
+    if ( ulRefCnt > 0 ) {
+#if defined(OS_LINUX)
+        DevCloseDriver();
+#elif defined(OS_WIN32)
+        DevCloseDriver(0);
+#endif
+    }
+    DnmMutexDestroy(&Lock);
+}
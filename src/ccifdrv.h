@@ -0,0 +1,65 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : ccifdrv.h                 Type        : header            *
+ *  Description : CCIFDriver class declaration.                             *
+ ****************************************************************************/
+
+/**
+ * @file ccifdrv.h
+ * @brief CCIFDriver class declaration.
+ */
+
+#ifndef CCIFDRV_H
+#define CCIFDRV_H 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File ccifdrv.h requires c++ compiler."
+#endif
+
+#include "dnmos.h"
+
+/**
+ * @brief Process wide session with the CIF device driver
+ *
+ * The driver connection is opened by the first interface which needs it and
+ * closed when the last interface releases it, so boards can be opened, reset
+ * and closed independently of each other. There is a single instance of the
+ * class (see CCIFDriver::Session).
+ * @remark Copy constructor and assignment operator not supported for this class.
+ */
+class DNETMOD_API CCIFDriver {
+private:
+    /** Serializes opening and closing of the driver */
+    DNM_MUTEX Lock;
+    /** Count of references to the driver connection */
+    unsigned long ulRefCnt;
+private:
+    CCIFDriver(const CCIFDriver&);
+    CCIFDriver& operator =(const CCIFDriver&);
+public:
+    /** The session */
+    static CCIFDriver Session;
+    /* constructors */
+    CCIFDriver();
+    /* get */
+    unsigned long GetRefCount(void) const;
+    /* main */
+    int Acquire(unsigned short usBrdNum, unsigned char ucMacID);
+    int Release(unsigned short usBrdNum, unsigned char ucMacID);
+    /* destructor */
+    ~CCIFDriver();
+};
+
+/**
+ * @brief Retrieves count of references to the driver connection
+ * @return Count of interfaces holding the connection.
+ */
+inline unsigned long CCIFDriver::GetRefCount(void) const {
+    return ulRefCnt;
+}
+
+#endif /* ccifdrv.h */
@@ -17,7 +17,11 @@
 
 #include "dnmdefs.h"
 #include "dnmerrs.h"
+#include "dnmhist.h"
+#include "dnmprobe.h"
+#include "ccifdrv.h"
 #include "ccifintf.h"
+#include "ccifdevice.h"
 
 #if defined(OS_LINUX)
 #include "cif_user.h"
@@ -40,6 +44,20 @@ typedef unsigned long       DWORD;
 #endif /* elif defined(OS_WIN32) */
 #include "rcs_user.h"
 #include "dnm_user.h"
+#include "cifrec.h"
+
+/* The handshake modes are passed to the board as bMode of DNM_INIT_PRM */
+#if DNETMOD_HS_DEVICE_BUFFERED != DNM_SET_MODE_BUFFERED_DEVICE_CONTROLLED
+#error "error: DNETMOD_HS_DEVICE_BUFFERED does not match dnm_user.h."
+#endif
+#if defined(DNM_SET_MODE_BUFFERED_HOST_CONTROLLED) && \
+    DNETMOD_HS_HOST_BUFFERED != DNM_SET_MODE_BUFFERED_HOST_CONTROLLED
+#error "error: DNETMOD_HS_HOST_BUFFERED does not match dnm_user.h."
+#endif
+#if defined(DNM_SET_MODE_UNCONTROLLED) && \
+    DNETMOD_HS_UNCONTROLLED != DNM_SET_MODE_UNCONTROLLED
+#error "error: DNETMOD_HS_UNCONTROLLED does not match dnm_user.h."
+#endif
 
 /** Flag communication error */
 #define F_COMERR    0x08
@@ -57,6 +75,19 @@ typedef unsigned long       DWORD;
     (br == DEVICENET_BAUD_500K) ? DNM_BAUD_500 :                \
     (br == DEVICENET_BAUD_500K) ? DNM_BAUD_250 : DNM_BAUD_125 )
 
+/**
+ * @brief Retrieves time elapsed since a mark and moves the mark to now
+ * @param ulMark Time mark from DnmTimeMs.
+ * @return Elapsed milliseconds.
+ */
+static inline unsigned long LapMs(unsigned long &ulMark) {
+    unsigned long ulNow = DnmTimeMs();
+    unsigned long ulLap = ulNow - ulMark;
+
+    ulMark = ulNow;
+    return ulLap;
+}
+
 unsigned long CCIFInterface::ulClassID = 402;
 char CCIFInterface::strClassName[] = "CCIFInterface";
 
@@ -66,9 +97,10 @@ char CCIFInterface::strClassName[] = "CCIFInterface";
  * Initializes members accordingly.
  */
 CCIFInterface::CCIFInterface() : CInterface() {
+    ulTypeMask = TYPE_MASK;
     usBoardNum = 0;
     bAutoClear = false; /* default */
-    usInputOffset = usOutputOffset = 0;
+    Initialize();
 }
 
 /**
@@ -88,10 +120,53 @@ CCIFInterface::CCIFInterface(
     unsigned char  ucBR,
     unsigned short usBrdNum)
 : CInterface(ucMID, ucCCS, ucPCS, ucBR) {
+    ulTypeMask = TYPE_MASK;
     usBoardNum = 0;
     SetBoardNum(usBrdNum);
     bAutoClear = DNM_ACLR_INACTIVE;
+    Initialize();
+}
+
+/**
+ * @brief Initializes members common for all constructors
+ */
+void CCIFInterface::Initialize(void) {
+    ucHsMode = DNETMOD_HS_DEVICE_BUFFERED;
+    Timeouts = DefaultTimeouts();
+    bMsgPending = false;
+    ucMsgOwner = 0;
+    usLastReqSz = 0;
     usInputOffset = usOutputOffset = 0;
+    ClearOutputImage();
+    for ( int i = 0; i < DNETMOD_MAX_IOQUEUES; i++ )
+        apQueues[i] = 0;
+
+    DnmMutexInit(&BoardLock);
+    DnmMutexInit(&DPMLock);
+    DnmMutexInit(&MsgLock);
+    DnmMutexInit(&AllocLock);
+    bSupRunning = false;
+    ulSupPeriod = 0;
+    pfnStateCB = 0;
+    pvStateCtx = 0;
+    ullDevWanted = 0;
+    ullDevConn = 0;
+    ullScanConn = 0;
+    memset(aulDownSince, 0, sizeof(aulDownSince));
+    memset(aulRetryAt, 0, sizeof(aulRetryAt));
+    memset(aulRetryIntv, 0, sizeof(aulRetryIntv));
+    memset(aRecStats, 0, sizeof(aRecStats));
+    for ( int i = 0; i < DEVICENET_MAX_DEVICES; i++ )
+        aulReconnects[i] = 0;
+
+    bDrvOpen = false;
+    memset(&Timing, 0, sizeof(Timing));
+    iOpenErr = ERR_NOERR;
+    strOpenErr[0] = 0;
+
+    ucBusLoadCeil = 0;
+    memset(aBusConns, 0, sizeof(aBusConns));
+    ulIOGen = 0;
 }
 
 /**
@@ -116,6 +191,745 @@ void CCIFInterface::SetAutoClear(bool bAutoClr) {
         bAutoClr ? bAutoClear = DNM_ACLR_ACTIVE : bAutoClear = DNM_ACLR_INACTIVE;
 }
 
+/**
+ * @brief Sets process data handshake mode
+ *
+ * Selects how DevExchangeIO synchronizes with the board, i.e. consistency
+ * of the exchanged data against latency of the exchange (see DNETMOD_HS_*).
+ * Use #DNETMOD_HS_DEVICE_BUFFERED (default) where devices need the data of
+ * one bus cycle, #DNETMOD_HS_HOST_BUFFERED for fast loops which need only
+ * a consistent image and #DNETMOD_HS_UNCONTROLLED for the lowest latency.
+ * The mode is written to the board on CCIFInterface::Open, so it could be
+ * changed only while the interface is closed. Unknown modes are ignored.
+ * @param ucMode One of DNETMOD_HS_* modes.
+ */
+void CCIFInterface::SetHandshakeMode(unsigned char ucMode) {
+    if ( !bActive && (ucMode == DNETMOD_HS_UNCONTROLLED ||
+                      ucMode == DNETMOD_HS_HOST_BUFFERED ||
+                      ucMode == DNETMOD_HS_DEVICE_BUFFERED) )
+        ucHsMode = ucMode;
+}
+
+/**
+ * @brief Sets timeouts of driver calls
+ *
+ * Applies to the calls of the interface and of its devices which have no
+ * timeouts of their own (see CCIFDevice::SetTimeouts). Could be changed at
+ * any time and takes effect with the next call. A zero timeout makes the
+ * call a try, which returns <code>ERR_WOULDBLOCK</code> at once if the
+ * board is not ready (e.g. the exchange handshake or the mailbox is busy).
+ * @param Tmo Timeouts in ms.
+ */
+void CCIFInterface::SetTimeouts(const CIFTimeouts &Tmo) {
+    Timeouts = Tmo;
+}
+
+/**
+ * @brief Retrieves default timeouts of driver calls
+ * @return Timeouts from DNETMOD_TMO_* defines.
+ */
+CIFTimeouts CCIFInterface::DefaultTimeouts(void) {
+    CIFTimeouts Tmo;
+
+    Tmo.ulExchange  = DNETMOD_TMO_EXCHANGE;
+    Tmo.ulPut       = DNETMOD_TMO_PUT;
+    Tmo.ulGet       = DNETMOD_TMO_GET;
+    Tmo.ulGetLong   = DNETMOD_TMO_GET_LONG;
+    Tmo.ulDiag      = DNETMOD_TMO_DIAG;
+    Tmo.ulHostState = DNETMOD_TMO_HOSTSTATE;
+    Tmo.ulReset     = DNETMOD_TMO_RESET;
+    Tmo.ulColdReset = DNETMOD_TMO_COLDRESET;
+
+    return Tmo;
+}
+
+/**
+ * @brief Checks whether a driver call failed only for not waiting
+ * @param sStatus Status returned by the driver.
+ * @param ulTimeout Timeout passed to the call.
+ * @return True if the call had zero timeout and the board was not ready.
+ */
+bool CCIFInterface::WouldBlock(short sStatus, unsigned long ulTimeout) {
+    return ulTimeout == 0 && (sStatus == DRV_DEV_EXCHANGE_TIMEOUT ||
+                              sStatus == DRV_DEV_PUT_TIMEOUT      ||
+                              sStatus == DRV_DEV_GET_TIMEOUT      ||
+                              sStatus == DRV_DEV_GET_NO_MESSAGE   ||
+                              sStatus == DRV_DEV_MAILBOX_FULL);
+}
+
+/**
+ * @brief Converts status of a driver call to error
+ * @param sStatus Status returned by the driver.
+ * @param ulTimeout Timeout passed to the call.
+ * @param ucErr Error from the message, if any.
+ * @param strFunc Name of the driver function.
+ * @return Error from \ref SetError function. <code>ERR_WOULDBLOCK</code> if
+ * the call was a try and the board was not ready.
+ */
+int CCIFInterface::CallResult(
+    short         sStatus,
+    unsigned long ulTimeout,
+    unsigned char ucErr,
+    const char    *strFunc)
+{
+    if ( WouldBlock(sStatus, ulTimeout) )
+        return SetError(ERR_WOULDBLOCK, ucMacID, strFunc);
+
+    return SetError(ERR_CIF, sStatus, ucErr, usBoardNum, ucMacID);
+}
+
+/**
+ * @brief Puts a request in the mailbox of the board
+ *
+ * The mailbox is shared by the interface and its devices, so it is locked
+ * from a successful put until the following CCIFInterface::GetMessage,
+ * which every caller must make from the same thread. If a former request
+ * was tried and its reply not taken (see CCIFInterface::GetMessage) and the
+ * same request is put again, it is not sent again and its reply is taken by
+ * the next CCIFInterface::GetMessage. So an operation tried with zero
+ * timeouts completes when repeated until it does not block. A try of
+ * another node would block until then. Otherwise the pending reply is taken
+ * and dropped first, so it is not mistaken for the reply of this request.
+ * A reply which did not come within the timeout is given up, unless this is
+ * a try.
+ * @param pvMsg Pointer to the message (RCS_MESSAGE).
+ * @param ulTimeout Timeout in ms.
+ * @param ucMac MAC ID for statistics.
+ * @return Status of the driver call.
+ */
+short CCIFInterface::PutMessage(
+    void          *pvMsg,
+    unsigned long ulTimeout,
+    unsigned char ucMac)
+{
+    short          sStatus = 0;
+    unsigned short usSize  = static_cast<unsigned short>(RCS_MESSAGEHEADER_LEN + static_cast<RCS_MESSAGE *>(pvMsg)->ln);
+
+    DnmMutexLock(&MsgLock);
+    if ( bMsgPending ) {
+        RCS_MESSAGE Stale;
+
+        if ( ucMac == ucMsgOwner && usSize == usLastReqSz && !memcmp(aucLastReq, pvMsg, usSize) )
+            return DRV_NO_ERROR;
+        // Do not take the reply tried by another node from under it
+        if ( ulTimeout == 0 && ucMac != ucMsgOwner ) {
+            DnmMutexUnlock(&MsgLock);
+            return DRV_DEV_MAILBOX_FULL;
+        }
+
+        DNM_DRV_CALL(sStatus, DNM_HOP_GETMSG, usBoardNum, ucMac, DevGetMessage(usBoardNum, sizeof(Stale), reinterpret_cast<MSG_STRUC *>(&Stale), ulTimeout));
+        if ( WouldBlock(sStatus, ulTimeout) ) {
+            DnmMutexUnlock(&MsgLock);
+            return sStatus;
+        }
+        bMsgPending = false;
+    }
+
+    DNM_DRV_CALL(sStatus, DNM_HOP_PUTMSG, usBoardNum, ucMac, DevPutMessage(usBoardNum, static_cast<MSG_STRUC *>(pvMsg), ulTimeout));
+    if ( sStatus >= 0 && sStatus < DRV_RCS_ERROR_OFFSET ) {
+        memcpy(aucLastReq, pvMsg, usSize);
+        usLastReqSz = usSize;
+        ucMsgOwner = ucMac;
+    }
+    else DnmMutexUnlock(&MsgLock);
+
+    return sStatus;
+}
+
+/**
+ * @brief Gets the reply from the mailbox of the board
+ *
+ * If the call is a try and the reply is not ready, the reply is marked as
+ * pending for the next CCIFInterface::PutMessage. Otherwise the reply is
+ * taken or given up. Unlocks the mailbox locked by the preceding
+ * successful CCIFInterface::PutMessage.
+ * @param usSize Size of the message buffer.
+ * @param pvMsg Pointer to the message buffer (RCS_MESSAGE).
+ * @param ulTimeout Timeout in ms.
+ * @param ucMac MAC ID for statistics.
+ * @return Status of the driver call.
+ */
+short CCIFInterface::GetMessage(
+    unsigned short usSize,
+    void           *pvMsg,
+    unsigned long  ulTimeout,
+    unsigned char  ucMac)
+{
+    short sStatus = 0;
+
+    DNM_DRV_CALL(sStatus, DNM_HOP_GETMSG, usBoardNum, ucMac, DevGetMessage(usBoardNum, usSize, static_cast<MSG_STRUC *>(pvMsg), ulTimeout));
+    bMsgPending = WouldBlock(sStatus, ulTimeout);
+    DnmMutexUnlock(&MsgLock);
+
+    return sStatus;
+}
+
+/**
+ * @brief Clears output image and device output map
+ */
+void CCIFInterface::ClearOutputImage(void) {
+    memset(aucOutImage, 0, sizeof(aucOutImage));
+    memset(ausDevOutOffset, 0, sizeof(ausDevOutOffset));
+    memset(aucDevOutSize, 0, sizeof(aucDevOutSize));
+}
+
+/**
+ * @brief Attaches an output update queue to the interface
+ *
+ * Once attached the queue is drained by CCIFInterface::ExchangeOutputs.
+ * Each producer thread should have its own queue.
+ * @param pQueue Pointer to the queue.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::AttachQueue(CIOQueue *pQueue) {
+    if ( !ISPTRVALID(pQueue, CIOQueue) || !pQueue->IsValid() ) {
+        char cBuf[20] = {0};
+        sprintf(cBuf, "%p", static_cast<void *>(pQueue));
+        return SetError(ERR_INVFPRM, "pQueue", cBuf, "AttachQueue");
+    }
+
+    for ( int i = 0; i < DNETMOD_MAX_IOQUEUES; i++ )
+        if ( DnmAtomicCasPtr(reinterpret_cast<void * volatile *>(&apQueues[i]), 0, pQueue) )
+            return SetError(ERR_NOERR);
+
+    return SetError(ERR_IOQFULL, "AttachQueue", DNETMOD_MAX_IOQUEUES);
+}
+
+/**
+ * @brief Detaches an output update queue from the interface
+ *
+ * Updates still waiting in the queue are discarded.
+ * @remarks Must not be called while CCIFInterface::ExchangeOutputs runs in
+ * another thread.
+ * @param pQueue Pointer to the queue.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::DetachQueue(CIOQueue *pQueue) {
+    for ( int i = 0; i < DNETMOD_MAX_IOQUEUES; i++ )
+        if ( DnmAtomicCasPtr(reinterpret_cast<void * volatile *>(&apQueues[i]), pQueue, 0) )
+            return SetError(ERR_NOERR);
+
+    char cBuf[20] = {0};
+    sprintf(cBuf, "%p", static_cast<void *>(pQueue));
+    return SetError(ERR_INVFPRM, "pQueue", cBuf, "DetachQueue");
+}
+
+/**
+ * @brief Merges an output update into the output image
+ *
+ * Updates for devices that are not allocated or which exceed the output size
+ * of the device are ignored.
+ * @param Upd Output update.
+ */
+inline void CCIFInterface::MergeUpdate(const IOUpdate &Upd) {
+    if ( Upd.ucMacID >= DEVICENET_MAX_DEVICES || Upd.ucSize > DNETMOD_IOQ_MAX_DATA )
+        return;
+    if ( Upd.ucOffset + Upd.ucSize > aucDevOutSize[Upd.ucMacID] )
+        return;
+
+    unsigned char *pucDst = aucOutImage + ausDevOutOffset[Upd.ucMacID] + Upd.ucOffset;
+
+    for ( unsigned char i = 0; i < Upd.ucSize; i++ )
+        pucDst[i] = static_cast<unsigned char>((pucDst[i] & ~Upd.abMask[i]) | (Upd.abData[i] & Upd.abMask[i]));
+}
+
+/**
+ * @brief Applies queued output updates and writes outputs to the board
+ *
+ * Drains all attached queues, merges the updates into the output image and
+ * writes the outputs of all allocated devices with a single exchange.
+ * Intended to be called once per cycle from the I/O thread. The image is
+ * locked only while the updates are merged and it is copied, so outputs
+ * written by CCIFDevice::WriteIOData from other threads are neither torn
+ * nor lost and the writers do not wait for the exchange. An output written
+ * during the exchange is sent again with the next one.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::ExchangeOutputs(void) {
+    short          sStatus   = 0;
+    unsigned long  ulTimeout = Timeouts.ulExchange;
+    unsigned short usSize    = 0;
+    IOUpdate       Upd;
+    unsigned char  aucImage[DNETMOD_CIF_IO_AREA_SZ];
+
+    if ( !bActive )
+        return SetError(ERR_INOPER, "ExchangeOutputs");
+
+    DnmMutexLock(&BoardLock);
+    for ( int i = 0; i < DNETMOD_MAX_IOQUEUES; i++ ) {
+        CIOQueue *pQueue = static_cast<CIOQueue *>(DnmAtomicLoadPtr(reinterpret_cast<void * const volatile *>(&apQueues[i])));
+
+        if ( pQueue != 0 )
+            while ( pQueue->Pop(Upd) )
+                MergeUpdate(Upd);
+    }
+
+    usSize = usOutputOffset;
+    memcpy(aucImage, aucOutImage, usSize);
+    DnmMutexUnlock(&BoardLock);
+
+    if ( usSize == 0 )
+        return SetError(ERR_NOERR);
+
+    DNM_DRV_CALL(sStatus, DNM_HOP_EXCHANGE, usBoardNum, ucMacID, DevExchangeIO(usBoardNum, 0, usSize, aucImage, 0, 0, NULL, ulTimeout));
+    if ( sStatus >= 0 && sStatus < DRV_RCS_ERROR_OFFSET ) {
+        DnmMetricsAdd(DNM_MET_EXCH_OUT, usBoardNum, 1);
+        DnmMetricsAdd(DNM_MET_BYTES_OUT, usBoardNum, usSize);
+    }
+    return CallResult(sStatus, ulTimeout, 0, "DevExchangeIO");
+}
+
+/**
+ * @brief Marks a device as allocated or unallocated for the supervisor
+ *
+ * Called by CCIFDevice after allocation (with the connection established)
+ * and after unallocation.
+ * @param ucMacID MAC ID of the device.
+ * @param bWanted True if device was allocated, false if unallocated.
+ */
+void CCIFInterface::SetDevConnected(unsigned char ucMacID, bool bWanted) {
+    DNM_UINT64 ullBit = static_cast<DNM_UINT64>(1) << ucMacID;
+
+    DnmMutexLock(&BoardLock);
+    if ( bWanted ) {
+        DnmAtomicUpdate64(&ullDevWanted, ullBit, 0);
+        DnmAtomicUpdate64(&ullDevConn, ullBit, 0);
+    }
+    else {
+        DnmAtomicUpdate64(&ullDevWanted, 0, ullBit);
+        DnmAtomicUpdate64(&ullDevConn, 0, ullBit);
+    }
+    aulRetryIntv[ucMacID] = DNETMOD_RECONNECT_MIN_MS;
+    InvalidateIOHandles();
+    DnmMutexUnlock(&BoardLock);
+    DnmMetricsDevState(usBoardNum, ucMacID, bWanted ? DNM_DEVST_CONNECTED : DNM_DEVST_NONE);
+}
+
+/**
+ * @brief Activates a device in the slave status area
+ *
+ * Makes the board attempt to establish the I/O connection to the device
+ * again, unless the device was unallocated meanwhile. Takes the DPM lock,
+ * not the board lock, so the I/O paths are not blocked by the DPM access.
+ * Does not call \ref SetError, so it could be used from the supervisor
+ * thread without touching the error message of the application.
+ * @param ucMacID MAC ID of the device.
+ * @return Status of the last driver call.
+ */
+short CCIFInterface::EnableSlave(unsigned char ucMacID) {
+    short         sStatus = 0;
+    unsigned char aucSlvStat[DEVICENET_MAX_DEVICES / 8];
+
+    DnmMutexLock(&DPMLock);
+    if ( ( DnmAtomicLoad64(&ullDevWanted) & (static_cast<DNM_UINT64>(1) << ucMacID) ) == 0 ) {
+        DnmMutexUnlock(&DPMLock);
+        return DRV_NO_ERROR;
+    }
+
+    DNM_DRV_CALL(sStatus, DNM_HOP_DPMRAW, usBoardNum, ucMacID, DevReadWriteDPMRaw(usBoardNum, PARAMETER_READ, 0x2F8, sizeof(aucSlvStat), aucSlvStat));
+    if ( sStatus >= 0 && sStatus < DRV_RCS_ERROR_OFFSET ) {
+        DiagBits(DiagMask(aucSlvStat) | (static_cast<DNM_UINT64>(1) << ucMacID), aucSlvStat);
+        DNM_DRV_CALL(sStatus, DNM_HOP_DPMRAW, usBoardNum, ucMacID, DevReadWriteDPMRaw(usBoardNum, PARAMETER_WRITE, 0x2F8, sizeof(aucSlvStat), aucSlvStat));
+    }
+    DnmMutexUnlock(&DPMLock);
+
+    return sStatus;
+}
+
+/**
+ * @brief Deactivates devices in the slave status area
+ *
+ * Reads the slave status area once, clears the bits of all the devices and
+ * writes it back. Takes the DPM lock and on success marks the devices as
+ * not allocated for the supervisor before releasing it, so the supervisor
+ * does not activate them again.
+ * @param ullMask Devices to deactivate (bit per MAC ID).
+ * @param ucErrMac MAC ID reported in the error message.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::DisableSlaves(DNM_UINT64 ullMask, unsigned char ucErrMac) {
+    short         sStatus = 0;
+    unsigned char aucSlvStat[DEVICENET_MAX_DEVICES / 8];
+
+    DnmMutexLock(&DPMLock);
+    DNM_DRV_CALL(sStatus, DNM_HOP_DPMRAW, usBoardNum, ucErrMac, DevReadWriteDPMRaw(usBoardNum, PARAMETER_READ, 0x2F8, sizeof(aucSlvStat), aucSlvStat));
+    if ( sStatus >= 0 && sStatus < DRV_RCS_ERROR_OFFSET ) {
+        DiagBits(DiagMask(aucSlvStat) & ~ullMask, aucSlvStat);
+        DNM_DRV_CALL(sStatus, DNM_HOP_DPMRAW, usBoardNum, ucErrMac, DevReadWriteDPMRaw(usBoardNum, PARAMETER_WRITE, 0x2F8, sizeof(aucSlvStat), aucSlvStat));
+    }
+    if ( sStatus >= 0 && sStatus < DRV_RCS_ERROR_OFFSET )
+        DnmAtomicUpdate64(&ullDevWanted, 0, ullMask);
+    DnmMutexUnlock(&DPMLock);
+
+    return SetError(ERR_CIF, sStatus, 0, usBoardNum, ucErrMac);
+}
+
+/**
+ * @brief Unallocates several devices at once
+ *
+ * Deactivates all the devices with a single read and write of the slave
+ * status area, instead of two DPM transactions per
+ * device, e.g. on shutdown or to isolate a segment of the network:
+ * @code
+ * Intf.UnallocateMany(Intf.GetActiveDevices());
+ * @endcode
+ * The CIF devices registered with the interface for the MAC IDs are then
+ * marked unallocated as with CDevice::Unallocate.
+ * @param ullMask Devices to unallocate (bit per MAC ID).
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::UnallocateMany(DNM_UINT64 ullMask) {
+    int iErr = 0;
+
+    if ( !bActive )
+        return SetError(ERR_INOPER, "UnallocateMany");
+    if ( ullMask == 0 )
+        return SetError(ERR_NOERR);
+
+    iErr = DisableSlaves(ullMask, ucMacID);
+    if ( iErr != ERR_NOERR )
+        return iErr;
+
+    while ( ullMask != 0 ) {
+        unsigned char ucMac = DnmBitTake64(&ullMask);
+        CDevice       *pDev = GetDevice(ucMac);
+
+        if ( pDev != 0 && pDev->Is<CCIFDevice>() )
+            static_cast<CCIFDevice *>(pDev)->Unallocated();
+        else {
+            SetDevConnected(ucMac, false);
+            SetBusConn(ucMac, 0);
+        }
+    }
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Reads the board diagnostics into device masks
+ *
+ * Makes a single DevGetTaskState call. Doesn't set the error message, so
+ * it could be used from the supervisor thread. DiagScan::ullChanged is not
+ * filled.
+ * @param pScan Receives the masks.
+ * @return Status of the driver call.
+ */
+short CCIFInterface::ReadDiagnostics(DiagScan *pScan) {
+    short           sStatus = 0;
+    DNM_DIAGNOSTICS DevDiag;
+
+    memset(pScan, 0, sizeof(DiagScan));
+    DNM_DRV_CALL(sStatus, DNM_HOP_TASKSTATE, usBoardNum, ucMacID, DevGetTaskState(usBoardNum, 2, sizeof(DevDiag), &DevDiag));
+    if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+        return sStatus;
+
+    pScan->ucState = DevDiag.bDNM_state;
+    pScan->ullConfigured = DiagMask(DevDiag.abDv_cfg);
+    pScan->ullConnected = DiagMask(DevDiag.abDv_state + 8);
+    pScan->ullDiag = DiagMask(DevDiag.abDv_diag);
+    pScan->ullAttention = (pScan->ullConfigured & ~pScan->ullConnected) | pScan->ullDiag;
+
+    return sStatus;
+}
+
+/**
+ * @brief Scans the board diagnostics for devices needing attention
+ *
+ * Reads the diagnostics of the board once and converts its configuration,
+ * connection and diagnostics bits to masks, so the devices needing
+ * attention could be visited without a driver call per device:
+ * @code
+ * DiagScan Scan;
+ * if ( Intf.ScanDiagnostics(&Scan) == 0 ) {
+ *     DNM_UINT64 ullMask = Scan.ullAttention;
+ *     while ( ullMask != 0 ) {
+ *         CDevice *pDev = Intf.GetDevice(DnmBitTake64(&ullMask));
+ *         ...
+ *     }
+ * }
+ * @endcode
+ * @param pScan Receives the masks.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::ScanDiagnostics(DiagScan *pScan) {
+    short sStatus = 0;
+
+    if ( pScan == 0 )
+        return SetError(ERR_INVFPRM, "pScan", "NULL", "ScanDiagnostics");
+    if ( !bActive )
+        return SetError(ERR_INOPER, "ScanDiagnostics");
+
+    sStatus = ReadDiagnostics(pScan);
+    if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+        return SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
+
+    DnmMutexLock(&BoardLock);
+    pScan->ullChanged = pScan->ullConnected ^ ullScanConn;
+    ullScanConn = pScan->ullConnected;
+    DnmMutexUnlock(&BoardLock);
+
+    return SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
+}
+
+/**
+ * @brief Performs one supervision pass
+ *
+ * Compares the connection state of the allocated devices reported by the
+ * board with the state seen on the previous pass. Records drops and
+ * recoveries, attempts reconnection of dropped devices with exponential
+ * backoff and notifies the application about state changes. Devices are
+ * reactivated and callbacks are invoked after the board lock is released. Only the devices selected by
+ * the masks of a single diagnostics read are visited.
+ */
+void CCIFInterface::Supervise(void) {
+    short           sStatus = 0;
+    unsigned long   ulNow   = 0;
+    DiagScan        Scan;
+    DNM_UINT64      ullOld  = 0;
+    DNM_UINT64      ullWant = 0;
+    DNM_UINT64      ullMask = 0;
+    DNM_UINT64      ullRetry = 0;
+    int             iEvents = 0;
+    unsigned char   aucEvMac[DEVICENET_MAX_DEVICES];
+    bool            abEvConn[DEVICENET_MAX_DEVICES];
+    unsigned long   aulEvDown[DEVICENET_MAX_DEVICES];
+
+    sStatus = ReadDiagnostics(&Scan);
+    if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+        return;
+
+    DnmMutexLock(&BoardLock);
+    ulNow = DnmTimeMs();
+    ullOld = DnmAtomicLoad64(&ullDevConn);
+    ullWant = DnmAtomicLoad64(&ullDevWanted);
+    DnmAtomicUpdate64(&ullDevConn, Scan.ullConnected, ~static_cast<DNM_UINT64>(0));
+    if ( Scan.ullConnected != ullOld )
+        InvalidateIOHandles();
+
+    // Allocated devices whose connection changed
+    ullMask = ullWant & (Scan.ullConnected ^ ullOld);
+    while ( ullMask != 0 ) {
+        unsigned char ucMac   = DnmBitTake64(&ullMask);
+        RecoveryStats *pStats = &aRecStats[ucMac];
+
+        aucEvMac[iEvents] = ucMac;
+        abEvConn[iEvents] = ( (Scan.ullConnected >> ucMac) & 1 ) != 0;
+        DnmMetricsDevState(usBoardNum, ucMac, abEvConn[iEvents] ? DNM_DEVST_CONNECTED : DNM_DEVST_DISCONNECTED);
+        if ( abEvConn[iEvents] ) {
+            unsigned long ulDown = ulNow - aulDownSince[ucMac];
+
+            pStats->ulRecoveries++;
+            pStats->ulLastMs = ulDown;
+            if ( ulDown > pStats->ulMaxMs )
+                pStats->ulMaxMs = ulDown;
+            aulRetryIntv[ucMac] = DNETMOD_RECONNECT_MIN_MS;
+            aulEvDown[iEvents] = ulDown;
+            DnmAtomicAdd(&aulReconnects[ucMac], 1);
+        }
+        else {
+            pStats->ulDrops++;
+            aulDownSince[ucMac] = ulNow;
+            aulRetryIntv[ucMac] = DNETMOD_RECONNECT_MIN_MS;
+            aulRetryAt[ucMac] = ulNow + DNETMOD_RECONNECT_MIN_MS;
+            aulEvDown[iEvents] = 0;
+        }
+        iEvents++;
+    }
+
+    // Allocated devices which stay disconnected
+    ullMask = ullWant & ~Scan.ullConnected & ~ullOld;
+    while ( ullMask != 0 ) {
+        unsigned char ucMac = DnmBitTake64(&ullMask);
+
+        if ( DnmTimeReached(ulNow, aulRetryAt[ucMac]) ) {
+            ullRetry |= static_cast<DNM_UINT64>(1) << ucMac;
+            aRecStats[ucMac].ulAttempts++;
+            aulRetryAt[ucMac] = ulNow + aulRetryIntv[ucMac];
+            if ( aulRetryIntv[ucMac] < DNETMOD_RECONNECT_MAX_MS / 2 )
+                aulRetryIntv[ucMac] *= 2;
+            else aulRetryIntv[ucMac] = DNETMOD_RECONNECT_MAX_MS;
+        }
+    }
+    DnmMutexUnlock(&BoardLock);
+
+    // Reactivate outside the board lock, so exchanges do not wait for DPM
+    while ( ullRetry != 0 )
+        EnableSlave(DnmBitTake64(&ullRetry));
+
+    if ( pfnStateCB != 0 )
+        for ( int i = 0; i < iEvents; i++ )
+            pfnStateCB(this, aucEvMac[i], abEvConn[i], aulEvDown[i], pvStateCtx);
+}
+
+/**
+ * @brief Supervisor thread function
+ * @param pvThis Pointer to the interface.
+ * @return Always zero.
+ */
+DNM_THREAD_RET DNM_THREAD_CC CCIFInterface::SupervisorProc(void *pvThis) {
+    CCIFInterface *pIntf = static_cast<CCIFInterface *>(pvThis);
+
+    while ( pIntf->bSupRunning ) {
+        pIntf->Supervise();
+        DnmSleepMs(pIntf->ulSupPeriod);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Starts supervision of allocated devices
+ *
+ * Starts a background thread which watches the I/O connection state of the
+ * allocated devices every ulPeriodMs milliseconds. When a connection drops
+ * the device is reactivated on the board at increasing intervals (starting
+ * at #DNETMOD_RECONNECT_MIN_MS and doubling up to #DNETMOD_RECONNECT_MAX_MS)
+ * until it responds again. The thread never touches the I/O data, so
+ * exchanges from the I/O thread are not blocked. While the supervisor runs
+ * CCIFDevice uses its view of the connection state instead of querying the
+ * board on its own.
+ * @param ulPeriodMs Supervision period in ms. The worst case detection
+ * delay of a drop or recovery equals the period.
+ * @param pfnCallback Function called on each state change or NULL.
+ * @param pvCtx User context passed to the callback.
+ * @remarks The callback is invoked from the supervisor thread and must not
+ * call CCIFInterface::StopSupervisor.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::StartSupervisor(
+    unsigned long      ulPeriodMs,
+    DNM_STATE_CALLBACK pfnCallback,
+    void               *pvCtx)
+{
+    if ( !bActive )
+        return SetError(ERR_INOPER, "StartSupervisor");
+
+    if ( bSupRunning )
+        return SetError(ERR_NOERR);
+
+    if ( ulPeriodMs == 0 ) {
+        char cBuf[12] = {0};
+        sprintf(cBuf, "%lu", ulPeriodMs);
+        return SetError(ERR_INVFPRM, "ulPeriodMs", cBuf, "StartSupervisor");
+    }
+
+    ulSupPeriod = ulPeriodMs;
+    pfnStateCB = pfnCallback;
+    pvStateCtx = pvCtx;
+    bSupRunning = true;
+    if ( !DnmThreadCreate(&hSupervisor, SupervisorProc, this) ) {
+        bSupRunning = false;
+        return SetError(ERR_THREAD, "StartSupervisor");
+    }
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Stops supervision of allocated devices
+ *
+ * Waits for the supervisor thread to finish its current pass.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::StopSupervisor(void) {
+    if ( bSupRunning ) {
+        bSupRunning = false;
+        DnmThreadJoin(hSupervisor);
+    }
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Retrieves recovery statistics of a device
+ * @param ucMacID MAC ID of the device.
+ * @param pStats Receives the statistics.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::GetRecoveryStats(unsigned char ucMacID, RecoveryStats *pStats) {
+    if ( ucMacID >= DEVICENET_MAX_DEVICES ) {
+        char cBuf[4] = {0};
+        sprintf(cBuf, "%d", ucMacID);
+        return SetError(ERR_INVFPRM, "ucMacID", cBuf, "GetRecoveryStats");
+    }
+    if ( pStats == 0 )
+        return SetError(ERR_INVFPRM, "pStats", "NULL", "GetRecoveryStats");
+
+    DnmMutexLock(&BoardLock);
+    *pStats = aRecStats[ucMacID];
+    DnmMutexUnlock(&BoardLock);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Sets bus utilization ceiling
+ *
+ * When set CCIFDevice::Allocate rejects devices which would bring estimated
+ * bus utilization of the allocated devices over the ceiling (see
+ * dnmbload.h).
+ * @param ucPercent Ceiling in percent. Zero disables the check.
+ */
+void CCIFInterface::SetBusLoadCeiling(unsigned char ucPercent) {
+    ucBusLoadCeil = ucPercent;
+}
+
+/**
+ * @brief Estimates bus load of allocated devices
+ * @param pLoad Receives the estimation.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::GetBusLoad(DNM_BUS_LOAD *pLoad) {
+    DNM_BUS_CONN aConns[DEVICENET_MAX_DEVICES];
+
+    DnmMutexLock(&BoardLock);
+    memcpy(aConns, aBusConns, sizeof(aConns));
+    DnmMutexUnlock(&BoardLock);
+
+    return DnmBusLoad(ucBaudRate, aConns, DEVICENET_MAX_DEVICES, pLoad);
+}
+
+/**
+ * @brief Checks bus load of allocated devices and a new one
+ * @param ucMacID MAC ID of the new device.
+ * @param Conn I/O connection of the new device.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::CheckBusLoad(unsigned char ucMacID, const DNM_BUS_CONN &Conn) {
+    DNM_BUS_CONN aConns[DEVICENET_MAX_DEVICES];
+    DNM_BUS_LOAD Load;
+    int          iErr = 0;
+
+    if ( ucBusLoadCeil == 0 )
+        return SetError(ERR_NOERR);
+
+    DnmMutexLock(&BoardLock);
+    memcpy(aConns, aBusConns, sizeof(aConns));
+    DnmMutexUnlock(&BoardLock);
+    aConns[ucMacID] = Conn;
+
+    iErr = DnmBusLoad(ucBaudRate, aConns, DEVICENET_MAX_DEVICES, &Load);
+    if ( iErr != ERR_NOERR )
+        return iErr;
+    if ( Load.dUtilization > ucBusLoadCeil )
+        return SetError(ERR_BUSLOAD, ucMacID, static_cast<unsigned long>(Load.dUtilization + 0.5), ucBusLoadCeil);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Records I/O connection of an allocated device
+ * @param ucMacID MAC ID of the device.
+ * @param pConn I/O connection or NULL when device is unallocated.
+ */
+void CCIFInterface::SetBusConn(unsigned char ucMacID, const DNM_BUS_CONN *pConn) {
+    DnmMutexLock(&BoardLock);
+    if ( pConn != 0 )
+        aBusConns[ucMacID] = *pConn;
+    else memset(&aBusConns[ucMacID], 0, sizeof(DNM_BUS_CONN));
+    DnmMutexUnlock(&BoardLock);
+}
+
 /**
  * @brief Checks if class can identify itself with the specified number.
  *
@@ -141,7 +955,8 @@ bool CCIFInterface::IsA(const char *strCompareName) const {
 /**
  * @brief Writes communication protocol parameters in device
  *
- * Prepares communication parameters and writes them to the board.
+ * Prepares communication parameters (handshake mode, watchdog time) and
+ * writes them to the board.
  * @return Error from \ref SetError function.
  */
 inline int CCIFInterface::SetProtocolParameters(void) {
@@ -149,16 +964,16 @@ inline int CCIFInterface::SetProtocolParameters(void) {
     int   iErr    = 0;
     DNM_INIT_PARAMETERS IniParam;
 
-    IniParam.bMode           = DNM_SET_MODE_BUFFERED_DEVICE_CONTROLLED;
+    IniParam.bMode           = ucHsMode;
     IniParam.usWatchDogTime  = 1000;
     //IniParam.bExtSlaveStatus = ...
 
-    sStatus = DevPutTaskParameter(usBoardNum, 2, sizeof(IniParam), &IniParam);
+    DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevPutTaskParameter(usBoardNum, 2, sizeof(IniParam), &IniParam));
     iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
     if ( sStatus < 0 || sStatus >= 1000 )
         return iErr;
 
-    sStatus = DevReset(usBoardNum, WARMSTART, 8000L);
+    DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevReset(usBoardNum, WARMSTART, Timeouts.ulReset));
     return SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
 }
 
@@ -181,13 +996,13 @@ inline int CCIFInterface::ClearDEVDB(void) {
     MsgBuf.d[0] = 4;        // Clear database
     MsgBuf.d[1] = 8;        // Offset
 
-    sStatus = DevPutMessage(usBoardNum, reinterpret_cast<MSG_STRUC *>(&MsgBuf), 500L);
-    iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
+    sStatus = PutMessage(&MsgBuf, Timeouts.ulPut, ucMacID);
+    iErr = CallResult(sStatus, Timeouts.ulPut, 0, "DevPutMessage");
     if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
         return iErr;
 
-    sStatus = DevGetMessage(usBoardNum, sizeof(MsgBuf), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 3000L);
-    return SetError(ERR_CIF, sStatus, MsgBuf.f, usBoardNum, ucMacID);
+    sStatus = GetMessage(sizeof(MsgBuf), &MsgBuf, Timeouts.ulGetLong, ucMacID);
+    return CallResult(sStatus, Timeouts.ulGetLong, MsgBuf.f, "DevGetMessage");
 }
 
 /**
@@ -228,13 +1043,13 @@ inline int CCIFInterface::DownloadParameters(void) {
 
     MsgBuf.ln = sizeof(BUS_DNM) + sizeof(DNM_DOWNLOAD_REQUEST) - MAX_LEN_DATA_UNIT;
 
-    sStatus = DevPutMessage(usBoardNum, reinterpret_cast<MSG_STRUC *>(&MsgBuf), 500L);
-    iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID, 0);
+    sStatus = PutMessage(&MsgBuf, Timeouts.ulPut, ucMacID);
+    iErr = CallResult(sStatus, Timeouts.ulPut, 0, "DevPutMessage");
     if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
         return iErr;
 
-    sStatus = DevGetMessage(usBoardNum, sizeof(MsgBuf), reinterpret_cast<MSG_STRUC *>(&MsgBuf), 3000L);
-    iErr = SetError(ERR_CIF, sStatus, MsgBuf.f, usBoardNum, ucMacID, 0);
+    sStatus = GetMessage(sizeof(MsgBuf), &MsgBuf, Timeouts.ulGetLong, ucMacID);
+    iErr = CallResult(sStatus, Timeouts.ulGetLong, MsgBuf.f, "DevGetMessage");
     if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
         return iErr;
 
@@ -252,37 +1067,40 @@ inline int CCIFInterface::DownloadParameters(void) {
 int CCIFInterface::Open(void) {
     short           sStatus = 0;
     int             iErr    = 0;
+    unsigned long   ulStart = DnmTimeMs();
+    unsigned long   ulMark  = ulStart;
     DRIVERINFO      DrvInfo;
     DNM_DIAGNOSTICS DevDiag;
+    DNM_PROBE_SCOPE(open, usBoardNum, ucMacID, bActive, 0, sStatus);
 
     if ( !bActive ) {
+        memset(&Timing, 0, sizeof(Timing));
+
         // STAGE1: Open driver
-#if defined(OS_LINUX)
-        sStatus = DevOpenDriver();
-#elif defined(OS_WIN32)
-        sStatus = DevOpenDriver(0);
-#endif
-        iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
-        if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+        iErr = OpenDriver();
+        if ( iErr != ERR_NOERR )
             return iErr;
 
         // STAGE2: Initialize board
 #if defined(OS_LINUX)
-        sStatus = DevInitBoard(usBoardNum);
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevInitBoard(usBoardNum));
 #elif defined(OS_WIN32)
-        sStatus = DevInitBoard(usBoardNum, NULL);
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevInitBoard(usBoardNum, NULL));
 #endif
+        Timing.ulDriverMs = LapMs(ulMark);
         iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
         if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
             return iErr;
 
         STAGE3: //: Set up protocol parameter
+        Timing.ulPasses++;
         iErr = SetProtocolParameters();
+        Timing.ulConfigMs += LapMs(ulMark);
         if ( iErr != ERR_NOERR )
             return Close();
 
         // STAGE5: Read driver state
-        sStatus = DevGetInfo(usBoardNum, GET_DRIVER_INFO, sizeof(DrvInfo), &DrvInfo);
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevGetInfo(usBoardNum, GET_DRIVER_INFO, sizeof(DrvInfo), &DrvInfo));
         iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
         if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
             return Close();
@@ -291,6 +1109,7 @@ int CCIFInterface::Open(void) {
         if ( (DrvInfo.bHostFlags & F_RUN) && (DrvInfo.bHostFlags & F_RDY) ) {
         // STAGE7: Clear the database in DEVICE
             iErr = ClearDEVDB();
+            Timing.ulClearDBMs += LapMs(ulMark);
             if ( iErr == ERR_NOERR )
                 goto STAGE3;
             else return Close();
@@ -298,20 +1117,131 @@ int CCIFInterface::Open(void) {
     }
     // STAGE8: Download parameters to DEVICE
     iErr = DownloadParameters();
+    Timing.ulDownloadMs = LapMs(ulMark);
     if ( iErr != ERR_NOERR )
         return iErr;
 
     if ( !bActive )  // Signal DEVICE that application is running
-        sStatus = DevSetHostState(usBoardNum, HOST_READY, 1000L);
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevSetHostState(usBoardNum, HOST_READY, Timeouts.ulHostState));
 
     // Read diagnostic information
-    sStatus = DevGetTaskState(usBoardNum, 2, sizeof(DevDiag), &DevDiag);
+    DNM_DRV_CALL(sStatus, DNM_HOP_TASKSTATE, usBoardNum, ucMacID, DevGetTaskState(usBoardNum, 2, sizeof(DevDiag), &DevDiag));
+    Timing.ulStartMs = LapMs(ulMark);
+    Timing.ulTotalMs = ulMark - ulStart;
     iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
     if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
         return Close();
 
     // Check DEVICE global state
     bActive = DevDiag.bDNM_state == OPERATE;
+    InvalidateIOHandles();
+
+    return iErr;
+}
+
+/**
+ * @brief Thread function opening an interface for CCIFInterface::OpenMany
+ * @param pvThis Pointer to the interface.
+ * @return Always zero.
+ */
+DNM_THREAD_RET DNM_THREAD_CC CCIFInterface::OpenProc(void *pvThis) {
+    CCIFInterface *pIntf = static_cast<CCIFInterface *>(pvThis);
+
+    // Keep the error message with the interface, so concurrent opens do not
+    // overwrite each other's message and that of the application
+    if ( RedirectErrMsg(pIntf->strOpenErr) ) {
+        pIntf->iOpenErr = pIntf->Open();
+        RedirectErrMsg(0);
+    }
+    else {
+        pIntf->iOpenErr = pIntf->Open();
+        GetErrMsg(sizeof(pIntf->strOpenErr), pIntf->strOpenErr);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Opens several interfaces concurrently
+ *
+ * The connection to the driver is established for all the interfaces first.
+ * Then each interface is opened (board initialization, configuration, warm
+ * start and download of parameters) in its own thread, so bring-up of all
+ * boards takes about as long as the slowest one instead of the sum of all.
+ * Stage durations of each board could be retrieved with
+ * CCIFInterface::GetOpenTiming afterwards.
+ * @param ppIntfs Array of interfaces. Each interface must be for a different
+ * board.
+ * @param iCount Count of interfaces in the array.
+ * @param piErrs Array of iCount elements receiving the result of each open
+ * or NULL.
+ * @remarks The error message (see \ref GetErrMsg) is that of the first
+ * failed interface in the array.
+ * @return ERR_NOERR if all interfaces were opened, otherwise the error of
+ * the first failed interface in the array.
+ */
+int CCIFInterface::OpenMany(
+    CCIFInterface **ppIntfs,
+    int           iCount,
+    int           *piErrs)
+{
+    int         iErr   = ERR_NOERR;
+    int         iFirst = -1;
+    DNM_THREAD  ahThreads[MAX_DEV_BOARDS];
+    bool        abStarted[MAX_DEV_BOARDS];
+
+    if ( ppIntfs == 0 )
+        return SetError(ERR_INVFPRM, "ppIntfs", "NULL", "OpenMany");
+    if ( iCount <= 0 || iCount > MAX_DEV_BOARDS ) {
+        char cBuf[12] = {0};
+        sprintf(cBuf, "%d", iCount);
+        return SetError(ERR_INVFPRM, "iCount", cBuf, "OpenMany");
+    }
+
+    for ( int i = 0; i < iCount; i++ ) {
+        CCIFInterface *pIntf = ppIntfs[i];
+
+        abStarted[i] = false;
+        if ( !ISPTRVALID(pIntf, CCIFInterface) || pIntf->IsActive() )
+            continue;
+
+        pIntf->iOpenErr = pIntf->OpenDriver();
+        if ( pIntf->iOpenErr == ERR_NOERR )
+            abStarted[i] = DnmThreadCreate(&ahThreads[i], OpenProc, pIntf);
+        if ( pIntf->iOpenErr == ERR_NOERR && !abStarted[i] )
+            pIntf->iOpenErr = pIntf->Open();
+        if ( !abStarted[i] )
+            GetErrMsg(sizeof(pIntf->strOpenErr), pIntf->strOpenErr);
+    }
+
+    for ( int i = 0; i < iCount; i++ ) {
+        int iRes = ERR_NOERR;
+
+        if ( abStarted[i] )
+            DnmThreadJoin(ahThreads[i]);
+        if ( !ISPTRVALID(ppIntfs[i], CCIFInterface) )
+            iRes = ERR_INVFPRM;
+        else if ( !ppIntfs[i]->IsActive() )
+            iRes = ppIntfs[i]->iOpenErr != ERR_NOERR ? ppIntfs[i]->iOpenErr : ERR_UKNOW;
+        if ( piErrs != 0 )
+            piErrs[i] = iRes;
+        if ( iErr == ERR_NOERR && iRes != ERR_NOERR ) {
+            iErr = iRes;
+            iFirst = i;
+        }
+    }
+
+    // Report the first failure on the calling thread
+    if ( iFirst < 0 )
+        return SetError(ERR_NOERR);
+    if ( !ISPTRVALID(ppIntfs[iFirst], CCIFInterface) ) {
+        char cBuf[20] = {0};
+        sprintf(cBuf, "%p", static_cast<void *>(ppIntfs[iFirst]));
+        return SetError(ERR_INVFPRM, "ppIntfs", cBuf, "OpenMany");
+    }
+    if ( ppIntfs[iFirst]->iOpenErr == ERR_NOERR )
+        return SetError(ERR_UKNOW);
+    SetErrMsg(ppIntfs[iFirst]->strOpenErr);
 
     return iErr;
 }
@@ -326,26 +1256,56 @@ int CCIFInterface::Open(void) {
 int CCIFInterface::CloseInterface(void) {
     int iErr = 0;
 
+    StopSupervisor();
     if ( bActive ) {
         short sStatus = 0;
 
-        sStatus = DevSetHostState(usBoardNum, HOST_NOT_READY, 1000L);
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevSetHostState(usBoardNum, HOST_NOT_READY, Timeouts.ulHostState));
         iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
 
-        sStatus = DevExitBoard(usBoardNum);
-        iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
-
-#if defined(OS_LINUX)
-        sStatus = DevCloseDriver();
-#elif defined(OS_WIN32)
-        sStatus = DevCloseDriver(0);
-#endif
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevExitBoard(usBoardNum));
         iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
+        bActive = false;
+        InvalidateIOHandles();
     }
+    if ( bDrvOpen )
+        iErr = CloseDriver();
 
     return iErr;
 }
 
+/**
+ * @brief Takes a reference to the driver session
+ *
+ * Does nothing if the interface already holds a reference.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::OpenDriver(void) {
+    int iErr = 0;
+
+    if ( bDrvOpen )
+        return SetError(ERR_NOERR);
+
+    iErr = CCIFDriver::Session.Acquire(usBoardNum, ucMacID);
+    bDrvOpen = iErr == ERR_NOERR;
+
+    return iErr;
+}
+
+/**
+ * @brief Releases the reference to the driver session
+ *
+ * The driver is closed only when no other interface uses it.
+ * @return Error from \ref SetError function.
+ */
+int CCIFInterface::CloseDriver(void) {
+    if ( !bDrvOpen )
+        return SetError(ERR_NOERR);
+
+    bDrvOpen = false;
+    return CCIFDriver::Session.Release(usBoardNum, ucMacID);
+}
+
 /**
  * @brief Stops communication on interface
  * @return Error from \ref SetError function.
@@ -370,21 +1330,17 @@ int CCIFInterface::Reset(void *vpParam) {
     int iErr                 = 0;
     unsigned short usMode    = *(static_cast<unsigned short *>(vpParam));
     unsigned long  ulTimeout = 0;
+    DNM_PROBE_SCOPE(reset, usBoardNum, ucMacID, usMode, 0, sStatus);
 
     if ( !bActive ) {
-#if defined(OS_LINUX)
-        sStatus = DevOpenDriver();
-#elif defined(OS_WIN32)
-        sStatus = DevOpenDriver(0);
-#endif
-        iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
-        if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+        iErr = OpenDriver();
+        if ( iErr != ERR_NOERR )
             return iErr;
 
 #if defined(OS_LINUX)
-        sStatus = DevInitBoard(usBoardNum);
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevInitBoard(usBoardNum));
 #elif defined(OS_WIN32)
-        sStatus = DevInitBoard(usBoardNum, 0);
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevInitBoard(usBoardNum, 0));
 #endif
         iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
         if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
@@ -392,30 +1348,26 @@ int CCIFInterface::Reset(void *vpParam) {
     }
 
     if ( usMode == COLDSTART || usMode == BOOTSTART )
-        ulTimeout = 10000;
+        ulTimeout = Timeouts.ulColdReset;
     else if ( usMode == WARMSTART )
-        ulTimeout = 8000;
+        ulTimeout = Timeouts.ulReset;
     else {
         char cBuf[6] = {0};
         sprintf(cBuf, "%hu", usMode);
         SetError(ERR_INVFPRM, "vpParam", cBuf, "Reset");
     }
 
-    sStatus = DevReset(usBoardNum, usMode, ulTimeout);
+    DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevReset(usBoardNum, usMode, ulTimeout));
+    InvalidateIOHandles();
     iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
     if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
         return iErr;
 
     if ( !bActive ) {
-        sStatus = DevExitBoard(usBoardNum);
+        DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, ucMacID, DevExitBoard(usBoardNum));
         iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
 
-#if defined(OS_LINUX)
-        sStatus = DevCloseDriver();
-#elif defined(OS_WIN32)
-        sStatus = DevCloseDriver(0);
-#endif
-        iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, ucMacID);
+        iErr = CloseDriver();
     }
 
     return iErr;
@@ -424,10 +1376,15 @@ int CCIFInterface::Reset(void *vpParam) {
 /**
  * @brief Destructor.
  *
- * Closes the interface if active.
+ * Closes the interface if active and stops the supervisor.
  */
 CCIFInterface::~CCIFInterface() {
-    if ( bActive )
+    if ( bActive || bDrvOpen )
         CloseInterface();
+    StopSupervisor();
+    DnmMutexDestroy(&BoardLock);
+    DnmMutexDestroy(&DPMLock);
+    DnmMutexDestroy(&MsgLock);
+    DnmMutexDestroy(&AllocLock);
 }
 
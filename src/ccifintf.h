@@ -21,8 +21,142 @@
 #endif
 
 #include "cintf.h"
+#include "cioqueue.h"
+#include "dnmbload.h"
+#include "dnmos.h"
+
+/** Size of a CIF board process data area (input or output) in bytes */
+#define DNETMOD_CIF_IO_AREA_SZ  3584
+/** Size of a CIF board mailbox message in bytes (RCS_SEGMENT_LEN) */
+#define DNETMOD_CIF_MSG_SZ      288
+/** Maximum count of output update queues attached to an interface */
+#define DNETMOD_MAX_IOQUEUES    16
+/** Initial interval between reconnection attempts in ms */
+#define DNETMOD_RECONNECT_MIN_MS    100
+/** Maximum interval between reconnection attempts in ms */
+#define DNETMOD_RECONNECT_MAX_MS    5000
+
+/* Default timeouts of driver calls in ms (see CIFTimeouts) */
+/** DevExchangeIO */
+#define DNETMOD_TMO_EXCHANGE    500
+/** DevPutMessage */
+#define DNETMOD_TMO_PUT         500
+/** DevGetMessage of explicit requests */
+#define DNETMOD_TMO_GET         500
+/** DevGetMessage of downloads, database access and attribute reads */
+#define DNETMOD_TMO_GET_LONG    3000
+/** DevGetMessage of device diagnostics */
+#define DNETMOD_TMO_DIAG        1000
+/** DevSetHostState */
+#define DNETMOD_TMO_HOSTSTATE   1000
+/** DevReset with warm start */
+#define DNETMOD_TMO_RESET       8000
+/** DevReset with cold or boot start */
+#define DNETMOD_TMO_COLDRESET   10000
+
+/*
+ * Process data handshake modes (see CCIFInterface::SetHandshakeMode). The
+ * values are the bMode of DNM_SET_MODE_* in dnm_user.h and ccifintf.cpp
+ * checks them against the header.
+ */
+/**
+ * No handshake. DevExchangeIO accesses the process data area directly while
+ * the board updates it, so an image could mix data of two bus cycles and
+ * only single bytes are consistent. Lowest latency.
+ */
+#define DNETMOD_HS_UNCONTROLLED     0
+/**
+ * Buffered, host controlled. The board hands over its buffers as soon as
+ * the host asks, so each exchange is consistent (the whole image comes from
+ * one buffer), but is not synchronized with the bus cycle and could return
+ * the same inputs as the previous exchange.
+ */
+#define DNETMOD_HS_HOST_BUFFERED    2
+/**
+ * Buffered, device controlled (default). The board swaps the buffers only
+ * after a complete bus cycle, so the inputs of an exchange come from one
+ * cycle and the outputs are sent together in one cycle. The exchange waits
+ * for the board, up to one bus cycle.
+ */
+#define DNETMOD_HS_DEVICE_BUFFERED  4
 
 class CCIFDevice;
+class CCIFInterface;
+
+/**
+ * @brief Device state change notification
+ *
+ * Invoked from the supervisor thread when the I/O connection to an
+ * allocated device drops or is established again. See
+ * CCIFInterface::StartSupervisor.
+ * @param pIntf Interface of the device.
+ * @param ucMacID MAC ID of the device.
+ * @param bConnected True when connection is established, false when dropped.
+ * @param ulDownMs Duration of the outage in ms when connection is
+ * established, otherwise zero.
+ * @param pvCtx User context passed to CCIFInterface::StartSupervisor.
+ */
+typedef void (DNETMOD_CC *DNM_STATE_CALLBACK)(CCIFInterface *pIntf,
+                                              unsigned char ucMacID,
+                                              bool          bConnected,
+                                              unsigned long ulDownMs,
+                                              void          *pvCtx);
+
+/** @brief Recovery statistics of a supervised device */
+typedef struct RecoveryStatsTag {
+    unsigned long ulDrops;      /**< Times the I/O connection dropped   */
+    unsigned long ulRecoveries; /**< Times the I/O connection recovered */
+    unsigned long ulAttempts;   /**< Reconnection attempts              */
+    unsigned long ulLastMs;     /**< Duration of the last outage in ms  */
+    unsigned long ulMaxMs;      /**< Longest outage in ms               */
+} RecoveryStats;
+
+/** @brief Duration of CCIFInterface::Open stages in ms */
+typedef struct OpenTimingTag {
+    unsigned long ulDriverMs;   /**< Opening driver and initializing board   */
+    unsigned long ulConfigMs;   /**< Writing protocol parameters, warm start */
+    unsigned long ulClearDBMs;  /**< Clearing device database                */
+    unsigned long ulDownloadMs; /**< Downloading bus parameters              */
+    unsigned long ulStartMs;    /**< Setting host state, reading diagnostics */
+    unsigned long ulTotalMs;    /**< Whole open                              */
+    unsigned long ulPasses;     /**< Configuration passes                    */
+} OpenTiming;
+
+/**
+ * @brief Timeouts of driver calls in ms
+ *
+ * See CCIFInterface::SetTimeouts and CCIFDevice::SetTimeouts. A zero
+ * timeout makes the call return at once with <code>ERR_WOULDBLOCK</code>
+ * if the board is not ready.
+ */
+typedef struct CIFTimeoutsTag {
+    unsigned long ulExchange;   /**< DevExchangeIO                        */
+    unsigned long ulPut;        /**< DevPutMessage                        */
+    unsigned long ulGet;        /**< DevGetMessage of explicit requests   */
+    unsigned long ulGetLong;    /**< DevGetMessage of downloads, database
+                                     access and attribute reads           */
+    unsigned long ulDiag;       /**< DevGetMessage of device diagnostics  */
+    unsigned long ulHostState;  /**< DevSetHostState                      */
+    unsigned long ulReset;      /**< DevReset with warm start             */
+    unsigned long ulColdReset;  /**< DevReset with cold or boot start     */
+} CIFTimeouts;
+
+/**
+ * @brief Device masks from the board diagnostics
+ *
+ * Bit n of each mask is for the device with MAC ID n. See
+ * CCIFInterface::ScanDiagnostics.
+ */
+typedef struct DiagScanTag {
+    DNM_UINT64    ullConfigured; /**< Devices configured on the board            */
+    DNM_UINT64    ullConnected;  /**< Devices with established I/O connection     */
+    DNM_UINT64    ullDiag;       /**< Devices with new diagnostics data           */
+    DNM_UINT64    ullAttention;  /**< Configured devices not connected or with
+                                      new diagnostics data                       */
+    DNM_UINT64    ullChanged;    /**< Devices whose connection changed since the
+                                      previous scan                              */
+    unsigned char ucState;       /**< State of the DeviceNet master (bDNM_state) */
+} DiagScan;
 
 /**
  * @brief Represents a Hilscher CIF board.
@@ -39,10 +173,86 @@ private:
     /* Bus parameters */
     /** Bus auto clear flag */
     bool bAutoClear;
+    /** Process data handshake mode (DNETMOD_HS_*) */
+    unsigned char ucHsMode;
+    /** Timeouts of driver calls */
+    CIFTimeouts Timeouts;
+    /** Serializes use of the mailbox from CCIFInterface::PutMessage to
+        CCIFInterface::GetMessage */
+    DNM_MUTEX MsgLock;
+    /** Flag showing a mailbox reply is left on the board by a request
+        which did not wait for it */
+    bool bMsgPending;
+    /** MAC ID of the node which put the last request in the mailbox */
+    unsigned char ucMsgOwner;
+    /** Size of the last request put in the mailbox */
+    unsigned short usLastReqSz;
+    /** Last request put in the mailbox */
+    unsigned char aucLastReq[DNETMOD_CIF_MSG_SZ];
     /** Bus input offset in bytes*/
     unsigned short usInputOffset;
     /** Bus output offset in bytes */
     unsigned short usOutputOffset;
+    /* Output process image */
+    /** Output image exchanged with CCIFInterface::ExchangeOutputs */
+    unsigned char aucOutImage[DNETMOD_CIF_IO_AREA_SZ];
+    /** Output offset of each device in the image */
+    unsigned short ausDevOutOffset[DEVICENET_MAX_DEVICES];
+    /** Output size of each device (zero if not allocated) */
+    unsigned char aucDevOutSize[DEVICENET_MAX_DEVICES];
+    /** Output update queues drained by CCIFInterface::ExchangeOutputs */
+    CIOQueue * volatile apQueues[DNETMOD_MAX_IOQUEUES];
+    /* Supervisor */
+    /** Serializes supervisor bookkeeping and access to the output image */
+    DNM_MUTEX BoardLock;
+    /** Serializes read-modify-write of the slave status area */
+    DNM_MUTEX DPMLock;
+    /** Serializes device downloads from computing I/O offsets of a device
+        to reserving them */
+    DNM_MUTEX AllocLock;
+    /** Supervisor thread */
+    DNM_THREAD hSupervisor;
+    /** Flag showing whether supervisor thread runs */
+    volatile bool bSupRunning;
+    /** Supervisor period in ms */
+    unsigned long ulSupPeriod;
+    /** State change callback */
+    DNM_STATE_CALLBACK pfnStateCB;
+    /** State change callback context */
+    void *pvStateCtx;
+    /** Devices allocated by the application (bit per MAC ID) */
+    volatile DNM_UINT64 ullDevWanted;
+    /** Established I/O connections as last seen (bit per MAC ID) */
+    volatile DNM_UINT64 ullDevConn;
+    /** Established I/O connections seen by the previous
+        CCIFInterface::ScanDiagnostics (bit per MAC ID) */
+    DNM_UINT64 ullScanConn;
+    /** Time at which connection to each device dropped */
+    unsigned long aulDownSince[DEVICENET_MAX_DEVICES];
+    /** Time of next reconnection attempt for each device */
+    unsigned long aulRetryAt[DEVICENET_MAX_DEVICES];
+    /** Current interval between reconnection attempts for each device */
+    unsigned long aulRetryIntv[DEVICENET_MAX_DEVICES];
+    /** Recovery statistics for each device */
+    RecoveryStats aRecStats[DEVICENET_MAX_DEVICES];
+    /** Reconnections of each device seen by the supervisor */
+    volatile unsigned long aulReconnects[DEVICENET_MAX_DEVICES];
+    /* Bring-up */
+    /** Flag showing whether interface holds a driver session reference */
+    bool bDrvOpen;
+    /** Stage durations of the last open */
+    OpenTiming Timing;
+    /** Result of open run by CCIFInterface::OpenMany */
+    int iOpenErr;
+    /** Error message of open run by CCIFInterface::OpenMany */
+    char strOpenErr[DNETMOD_MAX_ERRMSG_LEN];
+    /* Bus load */
+    /** Bus utilization ceiling in percent checked on allocation (0 - off) */
+    unsigned char ucBusLoadCeil;
+    /** I/O connections of allocated devices (zero type if not allocated) */
+    DNM_BUS_CONN aBusConns[DEVICENET_MAX_DEVICES];
+    /** Generation of I/O handles, changed when they are to be bound again */
+    volatile unsigned long ulIOGen;
 private:
     CCIFInterface(const CCIFInterface&);
     CCIFInterface& operator =(const CCIFInterface&);
@@ -50,13 +260,43 @@ private:
     int ClearDEVDB(void);
     int DownloadParameters(void);
     int CloseInterface(void);
+    int OpenDriver(void);
+    int CloseDriver(void);
+    static DNM_THREAD_RET DNM_THREAD_CC OpenProc(void *pvThis);
+    void Initialize(void);
+    void ClearOutputImage(void);
+    void MergeUpdate(const IOUpdate &Upd);
+    static DNM_THREAD_RET DNM_THREAD_CC SupervisorProc(void *pvThis);
+    void Supervise(void);
+    short EnableSlave(unsigned char ucMacID);
+    int DisableSlaves(DNM_UINT64 ullMask, unsigned char ucErrMac);
+    void SetDevConnected(unsigned char ucMacID, bool bWanted);
+    bool IsDevConnected(unsigned char ucMacID) const;
+    unsigned long GetDevReconnects(unsigned char ucMacID) const;
+    short ReadDiagnostics(DiagScan *pScan);
+    static DNM_UINT64 DiagMask(const unsigned char *pucBits);
+    static void DiagBits(DNM_UINT64 ullMask, unsigned char *pucBits);
+    short PutMessage(void *pvMsg, unsigned long ulTimeout, unsigned char ucMac);
+    short GetMessage(unsigned short usSize,
+                     void           *pvMsg,
+                     unsigned long  ulTimeout,
+                     unsigned char  ucMac);
+    static bool WouldBlock(short sStatus, unsigned long ulTimeout);
+    int CallResult(short sStatus, unsigned long ulTimeout, unsigned char ucErr, const char *strFunc);
+    int CheckBusLoad(unsigned char ucMacID, const DNM_BUS_CONN &Conn);
+    void SetBusConn(unsigned char ucMacID, const DNM_BUS_CONN *pConn);
+    void InvalidateIOHandles(void);
 protected:
     /** Class's ID */
     static unsigned long ulClassID;
     /** Clsss's name */
     static char strClassName[];
     friend class CCIFDevice;
+    friend class CCIFIOHandle;
 public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_CIFINTERFACE | CInterface::TYPE_MASK };
+
     /* constructors */
     CCIFInterface();
     CCIFInterface(unsigned char  ucMID,
@@ -69,6 +309,35 @@ public:
     void SetBoardNum(unsigned short usBrdNum);
     bool GetAutoClear(void) const;
     void SetAutoClear(bool bAutoClr);
+    unsigned char GetHandshakeMode(void) const;
+    void SetHandshakeMode(unsigned char ucMode);
+    const CIFTimeouts & GetTimeouts(void) const;
+    void SetTimeouts(const CIFTimeouts &Tmo);
+    static CIFTimeouts DefaultTimeouts(void);
+    OpenTiming GetOpenTiming(void) const;
+    /* bring-up */
+    static int OpenMany(CCIFInterface **ppIntfs,
+                        int           iCount,
+                        int           *piErrs = 0);
+    /* devices */
+    int UnallocateMany(DNM_UINT64 ullMask);
+    /* output update queues */
+    int AttachQueue(CIOQueue *pQueue);
+    int DetachQueue(CIOQueue *pQueue);
+    int ExchangeOutputs(void);
+    /* supervisor */
+    int StartSupervisor(unsigned long      ulPeriodMs,
+                        DNM_STATE_CALLBACK pfnCallback = 0,
+                        void               *pvCtx = 0);
+    int StopSupervisor(void);
+    bool IsSupervised(void) const;
+    int GetRecoveryStats(unsigned char ucMacID, RecoveryStats *pStats);
+    /* diagnostics */
+    int ScanDiagnostics(DiagScan *pScan);
+    /* bus load */
+    unsigned char GetBusLoadCeiling(void) const;
+    void SetBusLoadCeiling(unsigned char ucPercent);
+    int GetBusLoad(DNM_BUS_LOAD *pLoad);
     /* overrides */
     virtual bool IsA(unsigned long ulCompareID) const;
     virtual bool IsA(const char *strCompareName) const;
@@ -99,5 +368,103 @@ inline bool CCIFInterface::GetAutoClear(void) const {
     return bAutoClear;
 }
 
+/**
+ * @brief Retrieves process data handshake mode
+ * @return One of DNETMOD_HS_* modes.
+ */
+inline unsigned char CCIFInterface::GetHandshakeMode(void) const {
+    return ucHsMode;
+}
+
+/**
+ * @brief Retrieves timeouts of driver calls
+ * @return The timeouts.
+ */
+inline const CIFTimeouts & CCIFInterface::GetTimeouts(void) const {
+    return Timeouts;
+}
+
+/**
+ * @brief Retrieves stage durations of the last open
+ * @return Stage durations in ms.
+ */
+inline OpenTiming CCIFInterface::GetOpenTiming(void) const {
+    return Timing;
+}
+
+/**
+ * @brief Checks whether supervisor thread runs
+ * @return True if running, false otherwise.
+ */
+inline bool CCIFInterface::IsSupervised(void) const {
+    return bSupRunning;
+}
+
+/**
+ * @brief Retrieves bus utilization ceiling
+ * @return Ceiling in percent or zero if not checked.
+ */
+inline unsigned char CCIFInterface::GetBusLoadCeiling(void) const {
+    return ucBusLoadCeil;
+}
+
+/**
+ * @brief Checks I/O connection state of a device as last seen
+ * @param ucMacID MAC ID of the device.
+ * @return True if connection is established, false otherwise.
+ */
+inline bool CCIFInterface::IsDevConnected(unsigned char ucMacID) const {
+    return ( DnmAtomicLoad64(&ullDevConn) & (static_cast<DNM_UINT64>(1) << ucMacID) ) != 0;
+}
+
+/**
+ * @brief Retrieves count of reconnections of a device
+ *
+ * The count changes each time the supervisor sees the I/O connection to
+ * the device established again after a drop.
+ * @param ucMacID MAC ID of the device.
+ * @return Count of reconnections.
+ */
+inline unsigned long CCIFInterface::GetDevReconnects(unsigned char ucMacID) const {
+    return DnmAtomicLoad(&aulReconnects[ucMacID]);
+}
+
+/**
+ * @brief Converts a device bit array of the board to a mask
+ *
+ * The board keeps a bit per device in 8 bytes, the device with MAC ID n in
+ * bit n % 8 of byte n / 8 (e.g. abDv_cfg of DNM_DIAGNOSTICS and the slave
+ * status area).
+ * @param pucBits Bit array of 8 bytes.
+ * @return Mask with bit n for the device with MAC ID n.
+ */
+inline DNM_UINT64 CCIFInterface::DiagMask(const unsigned char *pucBits) {
+    DNM_UINT64 ullMask = 0;
+
+    for ( int i = DEVICENET_MAX_DEVICES / 8 - 1; i >= 0; i-- )
+        ullMask = (ullMask << 8) | pucBits[i];
+
+    return ullMask;
+}
+
+/**
+ * @brief Converts a mask to a device bit array of the board
+ * @param ullMask Mask with bit n for the device with MAC ID n.
+ * @param pucBits Receives the bit array of 8 bytes (see DiagMask).
+ */
+inline void CCIFInterface::DiagBits(DNM_UINT64 ullMask, unsigned char *pucBits) {
+    for ( int i = 0; i < DEVICENET_MAX_DEVICES / 8; i++, ullMask >>= 8 )
+        pucBits[i] = static_cast<unsigned char>(ullMask);
+}
+
+/**
+ * @brief Makes I/O handles of the devices of the interface bind again
+ *
+ * See CCIFIOHandle.
+ */
+inline void CCIFInterface::InvalidateIOHandles(void) {
+    DnmAtomicAdd(&ulIOGen, 1);
+}
+
 #endif /* ccifintf.h */
 
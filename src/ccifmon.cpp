@@ -0,0 +1,166 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : ccifmon.cpp               Type        : source            *
+ *  Description : CCIFMonitor class implementation.                         *
+ ****************************************************************************/
+
+/**
+ * @file ccifmon.cpp
+ * @brief CCIFMonitor class implementation.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmhist.h"
+#include "ccifdrv.h"
+#include "ccifmon.h"
+
+#if defined(OS_LINUX)
+#include "cif_user.h"
+#elif defined(OS_WIN32)
+#include "cifuser.h"
+#endif
+#include "rcs_user.h"
+#include "cifrec.h"
+
+/**
+ * @brief Constructor
+ *
+ * Initializes members accordingly. The board is not accessed.
+ * @param usBrdNum Board number. Must be a number between 0 and 3.
+ */
+CCIFMonitor::CCIFMonitor(unsigned short usBrdNum) {
+    usBoardNum = usBrdNum < MAX_DEV_BOARDS ? usBrdNum : 0;
+    bOpen = false;
+    usImageSz = 0;
+    ulSeq = 0;
+    ulTorn = 0;
+    memset(aucImage, 0, sizeof(aucImage));
+}
+
+/**
+ * @brief Opens the monitor
+ *
+ * Takes a reference to the driver session and initializes access to the
+ * board without configuring it.
+ * @return Error from \ref SetError function.
+ */
+int CCIFMonitor::Open(void) {
+    short sStatus = 0;
+    int   iErr    = 0;
+
+    if ( bOpen )
+        return SetError(ERR_NOERR);
+
+    iErr = CCIFDriver::Session.Acquire(usBoardNum, 0);
+    if ( iErr != ERR_NOERR )
+        return iErr;
+
+    DNM_DRV_CALL(sStatus, DNM_HOP_CONTROL, usBoardNum, 0, DevInitBoard(usBoardNum));
+    iErr = SetError(ERR_CIF, sStatus, 0, usBoardNum, 0);
+    if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET ) {
+        CCIFDriver::Session.Release(usBoardNum, 0);
+        return iErr;
+    }
+    bOpen = true;
+
+    return iErr;
+}
+
+/**
+ * @brief Closes the monitor
+ *
+ * Releases the reference to the driver session. The board is not exited,
+ * so an interface of the same process using it is not disturbed.
+ * @return Error from \ref SetError function.
+ */
+int CCIFMonitor::Close(void) {
+    if ( !bOpen )
+        return SetError(ERR_NOERR);
+
+    bOpen = false;
+    return CCIFDriver::Session.Release(usBoardNum, 0);
+}
+
+/**
+ * @brief Takes a snapshot of the input area
+ *
+ * Reads the area until two successive reads match, at most
+ * #DNETMOD_DPM_READ_TRIES times. A steady area costs two driver calls.
+ * @param usSize Count of bytes from the start of the area to read.
+ * @return Error from \ref SetError function. <code>ERR_DPMTORN</code> if
+ * the area changed during each read, in which case the previous snapshot
+ * is kept.
+ */
+int CCIFMonitor::Read(unsigned short usSize) {
+    short sStatus = 0;
+    int   iCur    = 0;
+
+    if ( !bOpen )
+        return SetError(ERR_INOPER, "Read");
+    if ( usSize == 0 || usSize > DNETMOD_CIF_IO_AREA_SZ ) {
+        char cBuf[8] = {0};
+
+        sprintf(cBuf, "%hu", usSize);
+        return SetError(ERR_INVFPRM, "usSize", cBuf, "Read");
+    }
+
+    for ( int iTry = 0; iTry < DNETMOD_DPM_READ_TRIES; iTry++ ) {
+        DNM_DRV_CALL(sStatus, DNM_HOP_DPMDATA, usBoardNum, 0, DevReadWriteDPMData(usBoardNum, PARAMETER_READ, DNETMOD_CIF_DPM_INPUT_OFS, usSize, aucRead[iCur]));
+        if ( sStatus < 0 || sStatus >= DRV_RCS_ERROR_OFFSET )
+            return SetError(ERR_CIF, sStatus, 0, usBoardNum, 0);
+
+        if ( iTry > 0 ) {
+            if ( !memcmp(aucRead[0], aucRead[1], usSize) ) {
+                memcpy(aucImage, aucRead[iCur], usSize);
+                usImageSz = usSize;
+                ulSeq++;
+                return SetError(ERR_NOERR);
+            }
+            ulTorn++;
+        }
+        iCur ^= 1;
+    }
+
+    return SetError(ERR_DPMTORN, usBoardNum, DNETMOD_DPM_READ_TRIES);
+}
+
+/**
+ * @brief Copies inputs of a device from the snapshot
+ * @param usOffset Offset of device's input data in the area.
+ * @param usSize Size of device's input data.
+ * @param pvBuf Pointer to the buffer where to store the data.
+ * @return Error from \ref SetError function.
+ */
+int CCIFMonitor::GetInput(
+    unsigned short usOffset,
+    unsigned short usSize,
+    void           *pvBuf) const
+{
+    if ( pvBuf == 0 )
+        return SetError(ERR_INVFPRM, "pvBuf", "NULL", "GetInput");
+    if ( static_cast<unsigned long>(usOffset) + usSize > usImageSz ) {
+        char cBuf[8] = {0};
+
+        sprintf(cBuf, "%hu", usOffset);
+        return SetError(ERR_INVFPRM, "usOffset", cBuf, "GetInput");
+    }
+
+    memcpy(pvBuf, aucImage + usOffset, usSize);
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Destructor
+ *
+ * Closes the monitor if open.
+ */
+CCIFMonitor::~CCIFMonitor() {
+    if ( bOpen )
+        Close();
+}
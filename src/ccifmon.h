@@ -0,0 +1,132 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : ccifmon.h                 Type        : header            *
+ *  Description : CCIFMonitor class declaration.                            *
+ ****************************************************************************/
+
+/**
+ * @file ccifmon.h
+ * @brief CCIFMonitor class declaration.
+ */
+
+#ifndef CCIFMON_H
+#define CCIFMON_H 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File ccifmon.h requires c++ compiler."
+#endif
+
+#include "ccifintf.h"
+
+/** Offset of the input (receive) process data area in the DPM data area */
+#define DNETMOD_CIF_DPM_INPUT_OFS   DNETMOD_CIF_IO_AREA_SZ
+/** Maximum count of reads of the input area for a consistent snapshot */
+#define DNETMOD_DPM_READ_TRIES      4
+
+/**
+ * @brief Reads process inputs of a CIF board directly from its DPM
+ *
+ * Takes snapshots of the input area of a board with raw DPM reads
+ * (DevReadWriteDPMData) instead of DevExchangeIO, so the inputs of all
+ * devices could be watched without taking part in the process data
+ * handshake, e.g. by a monitoring process while another process controls
+ * the board with CCIFInterface. The monitor neither configures nor resets
+ * the board and its reads don't change the handshake of the control loop.
+ *
+ * The board updates the area while it is read, so each snapshot is read
+ * again and accepted only when both reads match. Otherwise the read is
+ * counted as torn and repeated (see CCIFMonitor::Read). Each accepted
+ * snapshot increments the sequence number. The check relies on the board
+ * finishing an update of the area faster than the two reads take, which
+ * its firmware does. It does not detect a writer stopped in the middle of
+ * an update for the whole time of both reads.
+ * @remark A monitor should be used by a single thread. Copy constructor and
+ * assignment operator not supported for this class.
+ */
+class DNETMOD_API CCIFMonitor {
+private:
+    /** Board number */
+    unsigned short usBoardNum;
+    /** Flag showing whether monitor holds a driver session reference */
+    bool bOpen;
+    /** Size of the snapshot in bytes */
+    unsigned short usImageSz;
+    /** Sequence number of the snapshot (zero if none taken yet) */
+    unsigned long ulSeq;
+    /** Count of torn reads */
+    unsigned long ulTorn;
+    /** Last consistent snapshot of the input area */
+    unsigned char aucImage[DNETMOD_CIF_IO_AREA_SZ];
+    /** Two successive reads of the input area */
+    unsigned char aucRead[2][DNETMOD_CIF_IO_AREA_SZ];
+private:
+    CCIFMonitor(const CCIFMonitor&);
+    CCIFMonitor& operator =(const CCIFMonitor&);
+public:
+    /* constructors */
+    explicit CCIFMonitor(unsigned short usBrdNum = 0);
+    /* get */
+    unsigned short GetBoardNum(void) const;
+    bool IsOpen(void) const;
+    unsigned long GetSequence(void) const;
+    unsigned long GetTornCount(void) const;
+    const unsigned char * GetImage(void) const;
+    /* main */
+    int Open(void);
+    int Close(void);
+    int Read(unsigned short usSize = DNETMOD_CIF_IO_AREA_SZ);
+    int GetInput(unsigned short usOffset,
+                 unsigned short usSize,
+                 void           *pvBuf) const;
+    /* destructor */
+    ~CCIFMonitor();
+};
+
+/**
+ * @brief Retrieves Hilscher board number
+ * @return Board number. A value between 0 and 3.
+ */
+inline unsigned short CCIFMonitor::GetBoardNum(void) const {
+    return usBoardNum;
+}
+
+/**
+ * @brief Checks whether monitor is open
+ * @return True if open, false otherwise.
+ */
+inline bool CCIFMonitor::IsOpen(void) const {
+    return bOpen;
+}
+
+/**
+ * @brief Retrieves sequence number of the snapshot
+ *
+ * Incremented on each consistent snapshot, so a caller could tell whether
+ * it has already seen the current one.
+ * @return Sequence number or zero if no snapshot taken yet.
+ */
+inline unsigned long CCIFMonitor::GetSequence(void) const {
+    return ulSeq;
+}
+
+/**
+ * @brief Retrieves count of torn reads
+ * @return Count of reads discarded because the area changed meanwhile.
+ */
+inline unsigned long CCIFMonitor::GetTornCount(void) const {
+    return ulTorn;
+}
+
+/**
+ * @brief Retrieves the snapshot
+ * @return Last consistent snapshot of the input area.
+ */
+inline const unsigned char * CCIFMonitor::GetImage(void) const {
+    return aucImage;
+}
+
+#endif /* ccifmon.h */
@@ -11,9 +11,11 @@
  * @brief CDevice class implementation.
  */
 
+#include <math.h>
 #include <string.h>
 
 #include "dnmdefs.h"
+#include "dnmerrs.h"
 
 #include "cdevice.h"
 
@@ -34,9 +36,12 @@ char CDevice::strClassName[] = "CDevice";
  * Initializes members accordingly.
  */
 CDevice::CDevice() : CNode() {
+    ulTypeMask = TYPE_MASK;
     ucConnType = 0;
     usEPR = 0;
     pInterface = 0;
+    pRegIntf = 0;
+    ResetCycleStats();
 }
 
 /**
@@ -59,10 +64,13 @@ CDevice::CDevice(
     unsigned short usEPR_,
     CInterface     *pIntf)
 : CNode(ucMID, ucCCS, ucPCS) {
+    ulTypeMask = TYPE_MASK;
     ucConnType = 0;
     SetConnType(ucCT);
     usEPR = usEPR_;
     pInterface = pIntf;
+    pRegIntf = 0;
+    ResetCycleStats();
 }
 
 /**
@@ -102,6 +110,122 @@ void CDevice::SetEPR(unsigned short usEPR_) {
         usEPR = usEPR_;
 }
 
+/**
+ * @brief Marks a cycle of data exchange with the device
+ *
+ * Descendants call this function on every successful exchange of input
+ * data. The interval since the previous cycle is added to the statistics
+ * in constant time and memory (Welford's method) and checked against EPR.
+ */
+void CDevice::MarkCycle(void) {
+    DNM_UINT64 ullNow = DnmTimeNs();
+
+    if ( ullLastCycle != 0 ) {
+        DNM_UINT64 ullIntv  = ullNow - ullLastCycle;
+        DNM_UINT64 ullEPRNs = static_cast<DNM_UINT64>(usEPR) * 1000000ULL;
+        double     dDelta   = 0.0;
+
+        ulCycles++;
+        ullLastIntv = ullIntv;
+        if ( ulCycles == 1 || ullIntv < ullMinIntv )
+            ullMinIntv = ullIntv;
+        if ( ullIntv > ullMaxIntv )
+            ullMaxIntv = ullIntv;
+
+        dDelta     = static_cast<double>(ullIntv) - dMeanIntv;
+        dMeanIntv += dDelta / ulCycles;
+        dM2Intv   += dDelta * (static_cast<double>(ullIntv) - dMeanIntv);
+
+        if ( usEPR != 0 && ullIntv > ullEPRNs ) {
+            ulMissed++;
+            if ( ullIntv - ullEPRNs > ullOverrun )
+                ullOverrun = ullIntv - ullEPRNs;
+        }
+    }
+    ullLastCycle = ullNow;
+    if ( pRegIntf != 0 )
+        pRegIntf->aullDevLastIO[ucMacID] = ullNow;
+}
+
+/**
+ * @brief Registers the device in the registry of its interface
+ *
+ * Descendants call this function when the device is allocated.
+ * @param usInOff Offset of device's input data in interface's process
+ * image (zero if the interface has none).
+ * @param usOutOff Offset of device's output data in interface's process
+ * image (zero if the interface has none).
+ */
+void CDevice::Register(unsigned short usInOff, unsigned short usOutOff) {
+    if ( pInterface == 0 || ucMacID >= DEVICENET_MAX_DEVICES )
+        return;
+
+    pInterface->RegisterDevice(this, usInOff, usOutOff);
+    pRegIntf = pInterface;
+}
+
+/**
+ * @brief Unregisters the device from the registry of its interface
+ *
+ * Descendants call this function when the device is unallocated.
+ */
+void CDevice::Unregister(void) {
+    if ( pRegIntf == 0 )
+        return;
+
+    pRegIntf->UnregisterDevice(this);
+    pRegIntf = 0;
+}
+
+/**
+ * @brief Reports fault or recovery of the device to the registry
+ * @param bFaulted Flag showing whether device is faulted.
+ */
+void CDevice::ReportFault(bool bFaulted) {
+    if ( pRegIntf != 0 )
+        pRegIntf->SetDeviceFaulted(this, bFaulted);
+}
+
+/**
+ * @brief Retrieves cycle statistics
+ *
+ * Cycles are the intervals between successive successful exchanges of
+ * input data with the device. An interval longer than EPR is counted as a
+ * missed deadline. The snapshot is not synchronized with the thread doing
+ * the exchanges, so it may mix values of two successive cycles.
+ * @param pStats Receives the statistics.
+ * @return Error from \ref SetError function.
+ */
+int CDevice::GetCycleStats(CycleStats *pStats) const {
+    if ( pStats == 0 )
+        return SetError(ERR_INVFPRM, "pStats", "NULL", "GetCycleStats");
+
+    pStats->ulCycles    = ulCycles;
+    pStats->ulLastUs    = static_cast<unsigned long>(ullLastIntv / 1000);
+    pStats->ulMinUs     = static_cast<unsigned long>(ullMinIntv / 1000);
+    pStats->ulMaxUs     = static_cast<unsigned long>(ullMaxIntv / 1000);
+    pStats->ulMeanUs    = static_cast<unsigned long>(dMeanIntv / 1000.0 + 0.5);
+    pStats->ulStdDevUs  = ulCycles > 1 ? static_cast<unsigned long>(sqrt(dM2Intv / (ulCycles - 1)) / 1000.0 + 0.5) : 0;
+    pStats->ulMissed    = ulMissed;
+    pStats->ulOverrunUs = static_cast<unsigned long>(ullOverrun / 1000);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Clears cycle statistics
+ *
+ * The next exchange starts a new measurement.
+ */
+void CDevice::ResetCycleStats(void) {
+    ullLastCycle = 0;
+    ulCycles = 0;
+    ullMinIntv = ullMaxIntv = ullLastIntv = 0;
+    dMeanIntv = dM2Intv = 0.0;
+    ulMissed = 0;
+    ullOverrun = 0;
+}
+
 /**
  * @brief Checks if class can identify itself with the specified number.
  *
@@ -127,10 +251,12 @@ bool CDevice::IsA(const char *strCompareName) const {
 /**
  * @brief Destructor
  *
- * Does nothing.
+ * Unregisters the device from the registry of its interface.
  * @remarks It is good to unallocate device from the network before destroying
  * a descendant object. A call to CDevice::Unallocate function if not invoked by
  * the user is proposed for implementing in descendants destructors.
  */
-CDevice::~CDevice() {}
+CDevice::~CDevice() {
+    Unregister();
+}
 
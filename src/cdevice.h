@@ -22,6 +22,19 @@
 
 #include "cnode.h"
 #include "cintf.h"
+#include "dnmos.h"
+
+/** @brief Cycle statistics of a device */
+typedef struct CycleStatsTag {
+    unsigned long ulCycles;     /**< Measured intervals                   */
+    unsigned long ulLastUs;     /**< Last interval in us                  */
+    unsigned long ulMinUs;      /**< Shortest interval in us              */
+    unsigned long ulMaxUs;      /**< Longest interval in us               */
+    unsigned long ulMeanUs;     /**< Mean interval in us                  */
+    unsigned long ulStdDevUs;   /**< Standard deviation of intervals in us */
+    unsigned long ulMissed;     /**< Intervals longer than EPR            */
+    unsigned long ulOverrunUs;  /**< Worst excess of an interval over EPR */
+} CycleStats;
 
 /**
  * @brief Base and abstract class for representing a DeviceNet device
@@ -38,6 +51,9 @@ protected:
     static unsigned long ulClassID;
     /** Class's name */
     static char strClassName[];
+public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_DEVICE | CNode::TYPE_MASK };
 protected:
     /** Connection type */
     unsigned char ucConnType;
@@ -45,6 +61,35 @@ protected:
     unsigned short usEPR;
     /** Interface to which device is connected */
     CInterface *pInterface;
+    /* Cycle statistics */
+    /** Time of the last cycle in ns (zero before the first one) */
+    DNM_UINT64 ullLastCycle;
+    /** Measured intervals */
+    unsigned long ulCycles;
+    /** Shortest interval in ns */
+    DNM_UINT64 ullMinIntv;
+    /** Longest interval in ns */
+    DNM_UINT64 ullMaxIntv;
+    /** Last interval in ns */
+    DNM_UINT64 ullLastIntv;
+    /** Running mean of intervals in ns */
+    double dMeanIntv;
+    /** Running sum of squared deviations from the mean */
+    double dM2Intv;
+    /** Intervals longer than EPR */
+    unsigned long ulMissed;
+    /** Worst excess of an interval over EPR in ns */
+    DNM_UINT64 ullOverrun;
+private:
+    /** Interface in whose registry the device is registered or NULL */
+    CInterface *pRegIntf;
+    friend class CInterface;
+protected:
+    void MarkCycle(void);
+    void BreakCycle(void);
+    void Register(unsigned short usInOff = 0, unsigned short usOutOff = 0);
+    void Unregister(void);
+    void ReportFault(bool bFaulted);
 public:
     /* constructors */
     CDevice();
@@ -59,6 +104,9 @@ public:
     void SetConnType(unsigned char ucCT);
     unsigned short GetEPR(void) const;
     void SetEPR(unsigned short usEPR_);
+    /* cycle statistics */
+    int GetCycleStats(CycleStats *pStats) const;
+    void ResetCycleStats(void);
     /* overrides */
     virtual bool IsA(unsigned long ulCompareID) const;
     virtual bool IsA(const char *strCompareName) const;
@@ -241,5 +289,15 @@ inline unsigned short CDevice::GetEPR(void) const {
     return usEPR;
 }
 
+/**
+ * @brief Marks end of the gap between cycles
+ *
+ * Descendants call this function when data exchange stops (e.g. on
+ * unallocation), so the next cycle is not measured against the last one.
+ */
+inline void CDevice::BreakCycle(void) {
+    ullLastCycle = 0;
+}
+
 #endif /* cdevice.h */
 
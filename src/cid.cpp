@@ -18,8 +18,8 @@
 unsigned long CIdentificator::ulClassID = 101;
 char CIdentificator::strClassName[] = "CIdentificator";
 
-/** @brief Default constructor. Does nothing */
-CIdentificator::CIdentificator() {}
+/** @brief Default constructor. Sets the type mask */
+CIdentificator::CIdentificator() : ulTypeMask(TYPE_MASK) {}
 
 /**
  * @brief Retrieves class identification name
@@ -20,6 +20,27 @@
 #error "error: File cid.h requires c++ compiler!"
 #endif
 
+/**
+ * @name Type bits
+ * Each class of the module hierarchy has its own bit. The type mask of a
+ * class (see CIdentificator::Is) is its bit together with the bits of all
+ * of its ancestors.
+ * @{
+ */
+#define DNM_TYPE_IDENTIFICATOR  0x00000001UL
+#define DNM_TYPE_NODE           0x00000002UL
+#define DNM_TYPE_INTERFACE      0x00000004UL
+#define DNM_TYPE_DEVICE         0x00000008UL
+#define DNM_TYPE_NIINTERFACE    0x00000010UL
+#define DNM_TYPE_NIDEVICE       0x00000020UL
+#define DNM_TYPE_CIFINTERFACE   0x00000040UL
+#define DNM_TYPE_CIFDEVICE      0x00000080UL
+#define DNM_TYPE_SIMINTERFACE   0x00000100UL
+#define DNM_TYPE_SIMDEVICE      0x00000200UL
+#define DNM_TYPE_SCANINTERFACE  0x00000400UL
+#define DNM_TYPE_SCANDEVICE     0x00000800UL
+/** @} */
+
 /**
  * @brief Base class for identification
  *
@@ -28,6 +49,9 @@
  * descendant of CIdentificator can identify itself with a single unsigned
  * decimal number or with a name.
  *
+ * Every class of the hierarchy also declares its type mask as TYPE_MASK and
+ * stores it in #ulTypeMask from its constructors, so the type of an object
+ * could be checked with Is without walking the hierarchy.
  * @remark This class doesn't support copy constructor and assignment
  * operator. They are declared in the private section but are not defined.
  * Check class members to see more information about inheriting this class.
@@ -41,13 +65,19 @@ protected:
     static unsigned long ulClassID;
     /** CLass's name */
     static char strClassName[];
+    /** Type mask of the object (TYPE_MASK of its class) */
+    unsigned long ulTypeMask;
 public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_IDENTIFICATOR };
+
     CIdentificator();
     unsigned long GetClassID(void) const;
     void GetClassName(unsigned long ulStrSz, char *strName) const;
 
     virtual bool IsA(unsigned long ulCompareID) const;
     virtual bool IsA(const char *strCompareName) const;
+    template<class T> bool Is(void) const;
 
     virtual ~CIdentificator();
 };
@@ -66,5 +96,20 @@ inline unsigned long CIdentificator::GetClassID(void) const {
     return ulClassID;
 }
 
+/**
+ * @brief Checks if the object is of the specified class or its descendant
+ *
+ * Unlike IsA the check is a single compare of type masks and is done
+ * without virtual calls, so it is preferred in the module's own code.
+ * @code
+ * if ( pInterface->Is<CCIFInterface>() ) ...
+ * @endcode
+ * @return True when the object is of class T or derives from it
+ */
+template<class T>
+inline bool CIdentificator::Is(void) const {
+    return ( (ulTypeMask & T::TYPE_MASK) == static_cast<unsigned long>(T::TYPE_MASK) );
+}
+
 #endif /* cid.h */
 
@@ -0,0 +1,71 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cifrec.h                  Type        : header            *
+ *  Description : Recording layer over the CIF user API.                    *
+ ****************************************************************************/
+
+/**
+ * @file cifrec.h
+ * @brief Recording layer over the CIF user API.
+ *
+ * Must be included after cif_user.h. When the module is compiled with
+ * DNETMOD_RECORD defined the CIF user API calls of the including file are
+ * redirected to the DnmRec wrappers (see dnmrec.cpp), which make the call
+ * and record it while recording is started. Otherwise the header has no
+ * effect.
+ */
+
+#ifndef CIFREC_H
+#define CIFREC_H 1
+
+#include "dnmdefs.h"
+#include "dnmrec.h"
+
+#if defined(DNETMOD_RECORD)
+
+#if !defined(OS_LINUX)
+#error "error: Recording of CIF driver calls is available only for Linux."
+#endif
+
+short DnmRecOpenDriver(void);
+short DnmRecCloseDriver(void);
+short DnmRecInitBoard(unsigned short usDevNumber);
+short DnmRecExitBoard(unsigned short usDevNumber);
+short DnmRecPutTaskParameter(unsigned short usDevNumber, unsigned short usNumber, unsigned short usSize, void *pvData);
+short DnmRecReset(unsigned short usDevNumber, unsigned short usMode, unsigned long ulTimeout);
+short DnmRecPutMessage(unsigned short usDevNumber, MSG_STRUC *ptMessage, unsigned long ulTimeout);
+short DnmRecGetMessage(unsigned short usDevNumber, unsigned short usSize, MSG_STRUC *ptMessage, unsigned long ulTimeout);
+short DnmRecGetTaskState(unsigned short usDevNumber, unsigned short usNumber, unsigned short usSize, void *pvData);
+short DnmRecGetInfo(unsigned short usDevNumber, unsigned short usInfoArea, unsigned short usSize, void *pvData);
+short DnmRecExchangeIO(unsigned short usDevNumber,
+                       unsigned short usSendOffset,
+                       unsigned short usSendSize,
+                       void           *pvSendData,
+                       unsigned short usReceiveOffset,
+                       unsigned short usReceiveSize,
+                       void           *pvReceiveData,
+                       unsigned long  ulTimeout);
+short DnmRecSetHostState(unsigned short usDevNumber, unsigned short usMode, unsigned long ulTimeout);
+short DnmRecReadWriteDPMRaw(unsigned short usDevNumber, unsigned short usMode, unsigned short usOffset, unsigned short usSize, void *pvData);
+short DnmRecReadWriteDPMData(unsigned short usDevNumber, unsigned short usMode, unsigned short usOffset, unsigned short usSize, void *pvData);
+
+#define DevOpenDriver       DnmRecOpenDriver
+#define DevCloseDriver      DnmRecCloseDriver
+#define DevInitBoard        DnmRecInitBoard
+#define DevExitBoard        DnmRecExitBoard
+#define DevPutTaskParameter DnmRecPutTaskParameter
+#define DevReset            DnmRecReset
+#define DevPutMessage       DnmRecPutMessage
+#define DevGetMessage       DnmRecGetMessage
+#define DevGetTaskState     DnmRecGetTaskState
+#define DevGetInfo          DnmRecGetInfo
+#define DevExchangeIO       DnmRecExchangeIO
+#define DevSetHostState     DnmRecSetHostState
+#define DevReadWriteDPMRaw  DnmRecReadWriteDPMRaw
+#define DevReadWriteDPMData DnmRecReadWriteDPMData
+
+#endif /* DNETMOD_RECORD */
+
+#endif /* cifrec.h */
@@ -0,0 +1,364 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cifreplay.cpp             Type        : source            *
+ *  Description : CIF driver replaying recorded driver traffic.             *
+ ****************************************************************************/
+
+/**
+ * @file cifreplay.cpp
+ * @brief CIF driver replaying recorded driver traffic.
+ *
+ * The log is kept in memory. Records of each call and board are chained in
+ * order, so finding the record answering a call takes constant time.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "dnmdefs.h"
+
+#if !defined(OS_LINUX)
+#error "error: Replay CIF driver is available only for Linux."
+#endif
+
+#include "dnmos.h"
+#include "dnmrec.h"
+#include "cifreplay.h"
+
+#include "cif_user.h"
+
+/** Count of record chains (one per call and board) */
+#define REPLAY_CHAINS       (DNM_REC_CALL_COUNT * 256)
+/** End of a record chain */
+#define REPLAY_END          0xFFFFFFFFUL
+/** Size of the header of a mailbox telegram (rx to e) */
+#define REPLAY_MSGHDR_SZ    8
+/** Waits longer than this are slept instead of spun in us */
+#define REPLAY_SPIN_US      2000
+
+/** @brief Record of the log */
+typedef struct ReplayRecTag {
+    DNM_REC_HDR         Hdr;        /**< Header                          */
+    DNM_UINT64          ullStartUs; /**< Start since start of the log    */
+    const unsigned char *pucSent;   /**< Sent bytes                      */
+    const unsigned char *pucRecv;   /**< Received bytes                  */
+    unsigned long       ulNext;     /**< Next record of the same chain   */
+} ReplayRec;
+
+/** Guards the replay state */
+static DNM_MUTEX ReplayLock;
+/** Whether ReplayLock is initialized */
+static bool bLockInit = false;
+/** Contents of the log */
+static unsigned char *pucLog = 0;
+/** Records of the log */
+static ReplayRec *pRecs = 0;
+/** Next unused record of each chain */
+static unsigned long aulCursor[REPLAY_CHAINS];
+/** Speed of the replay (0 for as fast as possible) */
+static double dReplaySpeed = 1.0;
+/** Time corresponding to start of the log in ns (0 until the first call) */
+static DNM_UINT64 ullOrigin = 0;
+/** Whether the log was loaded from the environment */
+static bool bFromEnv = false;
+/** Count of driver opens */
+static unsigned long ulOpenCnt = 0;
+/** Statistics */
+static CifReplayStats Stats;
+
+/**
+ * @brief Waits until a time
+ * @param ullWhen Time in ns.
+ */
+static void WaitUntil(DNM_UINT64 ullWhen) {
+    DNM_UINT64 ullNow = DnmTimeNs();
+
+    if ( ullWhen > ullNow + REPLAY_SPIN_US * 1000ULL )
+        DnmSleepUs(static_cast<unsigned long>((ullWhen - ullNow) / 1000 - REPLAY_SPIN_US / 2));
+    while ( DnmTimeNs() < ullWhen )
+        ;
+}
+
+/**
+ * @brief Loads the log named by the environment if no log is loaded
+ */
+static void LoadFromEnv(void) {
+    const char *strFile  = getenv("DNETMOD_REPLAY");
+    const char *strSpeed = getenv("DNETMOD_REPLAY_SPEED");
+
+    if ( pRecs != 0 || strFile == 0 )
+        return;
+    if ( CifReplayLoad(strFile, strSpeed != 0 ? atof(strSpeed) : 1.0) != 0 )
+        fprintf(stderr, "cifreplay: Can't load log '%s'.\n", strFile);
+    else bFromEnv = true;
+}
+
+/**
+ * @brief Prints statistics of a replay loaded from the environment
+ */
+static void PrintStats(void) {
+    if ( bFromEnv )
+        fprintf(stderr, "cifreplay: %lu records, %lu calls answered, %lu missing, %lu differing\n",
+                Stats.ulRecords, Stats.ulCalls, Stats.ulMissing, Stats.ulDiffering);
+}
+
+/**
+ * @brief Answers a driver call from the log
+ *
+ * Takes the next unused record of the call and board, compares the sent
+ * data, copies the received data and waits for the recorded duration of
+ * the call, or until the recorded end of the call relative to the start of
+ * the replay if that is later.
+ * @param eCall The call.
+ * @param usBoard Board number.
+ * @param usParam Parameter of the call.
+ * @param pvSent Data passed to the driver.
+ * @param usSentLen Count of bytes passed to the driver.
+ * @param pvRecv Buffer for the data returned by the driver.
+ * @param usRecvSz Size of the buffer.
+ * @param sMissing Result if there is no record left.
+ * @return Recorded result of the call or sMissing.
+ */
+static short Replay(
+    DNM_REC_CALL   eCall,
+    unsigned short usBoard,
+    unsigned short usParam,
+    const void     *pvSent,
+    unsigned short usSentLen,
+    void           *pvRecv,
+    unsigned short usRecvSz,
+    short          sMissing)
+{
+    unsigned long ulChain   = static_cast<unsigned long>(eCall) * 256 + (usBoard & 0xFF);
+    DNM_UINT64    ullCalled = DnmTimeNs();
+    DNM_UINT64    ullEnd    = 0;
+    ReplayRec     *pRec     = 0;
+
+    if ( !bLockInit || pRecs == 0 )
+        return sMissing;
+
+    DnmMutexLock(&ReplayLock);
+    if ( aulCursor[ulChain] == REPLAY_END ) {
+        Stats.ulMissing++;
+        DnmMutexUnlock(&ReplayLock);
+        return sMissing;
+    }
+    pRec = &pRecs[aulCursor[ulChain]];
+    aulCursor[ulChain] = pRec->ulNext;
+    Stats.ulCalls++;
+    if ( pvSent == 0 )
+        usSentLen = 0;
+    if ( pRec->Hdr.usParam != usParam || pRec->Hdr.usSentLen != usSentLen ||
+         (usSentLen > 0 && memcmp(pRec->pucSent, pvSent, usSentLen) != 0) )
+        Stats.ulDiffering++;
+    if ( dReplaySpeed > 0 ) {
+        if ( ullOrigin == 0 )
+            ullOrigin = ullCalled - static_cast<DNM_UINT64>(pRec->ullStartUs * 1000.0 / dReplaySpeed);
+        ullEnd = ullOrigin + static_cast<DNM_UINT64>((pRec->ullStartUs + pRec->Hdr.ulDurUs) * 1000.0 / dReplaySpeed);
+        if ( ullEnd < ullCalled + static_cast<DNM_UINT64>(pRec->Hdr.ulDurUs * 1000.0 / dReplaySpeed) )
+            ullEnd = ullCalled + static_cast<DNM_UINT64>(pRec->Hdr.ulDurUs * 1000.0 / dReplaySpeed);
+    }
+    DnmMutexUnlock(&ReplayLock);
+
+    if ( pRec->Hdr.usRecvLen > 0 && pvRecv != 0 )
+        memcpy(pvRecv, pRec->pucRecv, pRec->Hdr.usRecvLen < usRecvSz ? pRec->Hdr.usRecvLen : usRecvSz);
+    if ( ullEnd != 0 )
+        WaitUntil(ullEnd);
+
+    return pRec->Hdr.sResult;
+}
+
+/**
+ * @brief Loads a log for replay
+ *
+ * A log loaded before is discarded together with its statistics.
+ * @param strFile Log file name.
+ * @param dSpeed Speed of the replay relative to the recording, e.g. 1 for
+ * real speed, 2 for twice as fast, 0 for as fast as possible.
+ * @return 0 on success or -1 if file could not be read or is not a log.
+ */
+int CifReplayLoad(const char *strFile, double dSpeed) {
+    FILE          *pFile    = 0;
+    long          lSize     = 0;
+    unsigned char *pucBuf   = 0;
+    unsigned long ulRecs    = 0;
+    unsigned long ulOff     = 0;
+    DNM_UINT64    ullStart  = 0;
+    unsigned long aulLast[REPLAY_CHAINS];
+
+    if ( strFile == 0 || (pFile = fopen(strFile, "rb")) == 0 )
+        return -1;
+    if ( fseek(pFile, 0, SEEK_END) == 0 )
+        lSize = ftell(pFile);
+    if ( lSize < DNM_REC_FILEHDR_SZ || fseek(pFile, 0, SEEK_SET) != 0 ) {
+        fclose(pFile);
+        return -1;
+    }
+    pucBuf = new unsigned char[lSize];
+    if ( fread(pucBuf, lSize, 1, pFile) != 1 ||
+         memcmp(pucBuf, DNM_REC_MAGIC, 6) != 0 || pucBuf[6] != DNM_REC_VERSION ) {
+        fclose(pFile);
+        delete [] pucBuf;
+        return -1;
+    }
+    fclose(pFile);
+
+    /* count records */
+    for ( ulOff = DNM_REC_FILEHDR_SZ; ulOff + DNM_REC_HDR_SZ <= static_cast<unsigned long>(lSize); ulRecs++ ) {
+        DNM_REC_HDR Hdr;
+
+        DnmRecDecodeHdr(pucBuf + ulOff, &Hdr);
+        ulOff += DNM_REC_HDR_SZ + Hdr.usSentLen + Hdr.usRecvLen;
+    }
+    if ( ulOff > static_cast<unsigned long>(lSize) )
+        ulRecs--; /* truncated last record */
+
+    CifReplayUnload();
+    if ( !bLockInit ) {
+        DnmMutexInit(&ReplayLock);
+        bLockInit = true;
+    }
+    DnmMutexLock(&ReplayLock);
+    pucLog = pucBuf;
+    pRecs = new ReplayRec[ulRecs > 0 ? ulRecs : 1];
+    for ( unsigned long i = 0; i < REPLAY_CHAINS; i++ )
+        aulCursor[i] = aulLast[i] = REPLAY_END;
+
+    ulOff = DNM_REC_FILEHDR_SZ;
+    for ( unsigned long i = 0; i < ulRecs; i++ ) {
+        ReplayRec     *pRec = &pRecs[i];
+        unsigned long ulChain = 0;
+
+        DnmRecDecodeHdr(pucBuf + ulOff, &pRec->Hdr);
+        ullStart += pRec->Hdr.ulDeltaUs;
+        pRec->ullStartUs = ullStart;
+        pRec->pucSent = pucBuf + ulOff + DNM_REC_HDR_SZ;
+        pRec->pucRecv = pRec->pucSent + pRec->Hdr.usSentLen;
+        pRec->ulNext = REPLAY_END;
+        ulOff += DNM_REC_HDR_SZ + pRec->Hdr.usSentLen + pRec->Hdr.usRecvLen;
+        if ( pRec->Hdr.ucCall >= DNM_REC_CALL_COUNT )
+            continue;
+        ulChain = static_cast<unsigned long>(pRec->Hdr.ucCall) * 256 + pRec->Hdr.ucBoard;
+        if ( aulLast[ulChain] == REPLAY_END )
+            aulCursor[ulChain] = i;
+        else pRecs[aulLast[ulChain]].ulNext = i;
+        aulLast[ulChain] = i;
+    }
+    dReplaySpeed = dSpeed;
+    ullOrigin = 0;
+    memset(&Stats, 0, sizeof(Stats));
+    Stats.ulRecords = ulRecs;
+    DnmMutexUnlock(&ReplayLock);
+
+    return 0;
+}
+
+/**
+ * @brief Discards the loaded log
+ *
+ * Must not be called while driver calls are made.
+ */
+void CifReplayUnload(void) {
+    delete [] pRecs;
+    delete [] pucLog;
+    pRecs = 0;
+    pucLog = 0;
+    bFromEnv = false;
+}
+
+/**
+ * @brief Retrieves statistics of the replay
+ * @param pStats Statistics.
+ */
+void CifReplayGetStats(CifReplayStats *pStats) {
+    if ( pStats == 0 )
+        return;
+    if ( bLockInit )
+        DnmMutexLock(&ReplayLock);
+    *pStats = Stats;
+    if ( bLockInit )
+        DnmMutexUnlock(&ReplayLock);
+}
+
+short DevOpenDriver(void) {
+    LoadFromEnv();
+    ulOpenCnt++;
+    return Replay(DNM_REC_OPENDRIVER, DNM_REC_NOBOARD, 0, 0, 0, 0, 0, DRV_USR_OPEN_ERROR);
+}
+
+short DevCloseDriver(void) {
+    short sRes = Replay(DNM_REC_CLOSEDRIVER, DNM_REC_NOBOARD, 0, 0, 0, 0, 0, DRV_NO_ERROR);
+
+    if ( ulOpenCnt > 0 && --ulOpenCnt == 0 )
+        PrintStats();
+    return sRes;
+}
+
+short DevInitBoard(unsigned short usDevNumber) {
+    return Replay(DNM_REC_INITBOARD, usDevNumber, 0, 0, 0, 0, 0, DRV_USR_DEV_NUMBER_INVALID);
+}
+
+short DevExitBoard(unsigned short usDevNumber) {
+    return Replay(DNM_REC_EXITBOARD, usDevNumber, 0, 0, 0, 0, 0, DRV_NO_ERROR);
+}
+
+short DevPutTaskParameter(unsigned short usDevNumber, unsigned short usNumber, unsigned short usSize, void *pvData) {
+    return Replay(DNM_REC_PUTTASKPARAM, usDevNumber, usNumber, pvData, usSize, 0, 0, DRV_DEV_FUNCTION_FAILED);
+}
+
+short DevReset(unsigned short usDevNumber, unsigned short usMode, unsigned long /*ulTimeout*/) {
+    return Replay(DNM_REC_RESET, usDevNumber, usMode, 0, 0, 0, 0, DRV_DEV_RESET_TIMEOUT);
+}
+
+short DevSetHostState(unsigned short usDevNumber, unsigned short usMode, unsigned long /*ulTimeout*/) {
+    return Replay(DNM_REC_SETHOSTSTATE, usDevNumber, usMode, 0, 0, 0, 0, DRV_DEV_FUNCTION_FAILED);
+}
+
+short DevGetInfo(unsigned short usDevNumber, unsigned short usInfoArea, unsigned short usSize, void *pvData) {
+    return Replay(DNM_REC_GETINFO, usDevNumber, usInfoArea, 0, 0, pvData, usSize, DRV_DEV_FUNCTION_FAILED);
+}
+
+short DevGetTaskState(unsigned short usDevNumber, unsigned short usNumber, unsigned short usSize, void *pvData) {
+    return Replay(DNM_REC_GETTASKSTATE, usDevNumber, usNumber, 0, 0, pvData, usSize, DRV_DEV_FUNCTION_FAILED);
+}
+
+short DevPutMessage(unsigned short usDevNumber, MSG_STRUC *ptMessage, unsigned long /*ulTimeout*/) {
+    unsigned short usLen = static_cast<unsigned short>(REPLAY_MSGHDR_SZ + ptMessage->ln);
+
+    if ( usLen > sizeof(MSG_STRUC) )
+        usLen = sizeof(MSG_STRUC);
+    return Replay(DNM_REC_PUTMESSAGE, usDevNumber, 0, ptMessage, usLen, 0, 0, DRV_DEV_PUT_TIMEOUT);
+}
+
+short DevGetMessage(unsigned short usDevNumber, unsigned short usSize, MSG_STRUC *ptMessage, unsigned long /*ulTimeout*/) {
+    return Replay(DNM_REC_GETMESSAGE, usDevNumber, 0, 0, 0, ptMessage, usSize, DRV_DEV_GET_TIMEOUT);
+}
+
+short DevExchangeIO(
+    unsigned short usDevNumber,
+    unsigned short /*usSendOffset*/,
+    unsigned short usSendSize,
+    void           *pvSendData,
+    unsigned short usReceiveOffset,
+    unsigned short usReceiveSize,
+    void           *pvReceiveData,
+    unsigned long  /*ulTimeout*/)
+{
+    return Replay(DNM_REC_EXCHANGEIO, usDevNumber, usReceiveOffset, pvSendData, usSendSize,
+                  pvReceiveData, usReceiveSize, DRV_DEV_EXCHANGE_TIMEOUT);
+}
+
+short DevReadWriteDPMRaw(unsigned short usDevNumber, unsigned short usMode, unsigned short usOffset, unsigned short usSize, void *pvData) {
+    if ( usMode == PARAMETER_WRITE )
+        return Replay(DNM_REC_DPMRAW, usDevNumber, usOffset, pvData, usSize, 0, 0, DRV_DEV_FUNCTION_FAILED);
+    return Replay(DNM_REC_DPMRAW, usDevNumber, usOffset, 0, 0, pvData, usSize, DRV_DEV_FUNCTION_FAILED);
+}
+
+short DevReadWriteDPMData(unsigned short usDevNumber, unsigned short usMode, unsigned short usOffset, unsigned short usSize, void *pvData) {
+    if ( usMode == PARAMETER_WRITE )
+        return Replay(DNM_REC_DPMDATA, usDevNumber, usOffset, pvData, usSize, 0, 0, DRV_DEV_FUNCTION_FAILED);
+    return Replay(DNM_REC_DPMDATA, usDevNumber, usOffset, 0, 0, pvData, usSize, DRV_DEV_FUNCTION_FAILED);
+}
@@ -0,0 +1,44 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cifreplay.h               Type        : header            *
+ *  Description : CIF driver replaying recorded driver traffic.             *
+ ****************************************************************************/
+
+/**
+ * @file cifreplay.h
+ * @brief CIF driver replaying recorded driver traffic.
+ *
+ * Implements the CIF user API (cif_user.h) from a log recorded with
+ * DnmRecStart (see dnmrec.h), so a run of an application could be
+ * reproduced without the board and the network. Each call is answered with
+ * the result and the data of the next unused record of the same call and
+ * board, so the log is followed per board even if threads interleave
+ * differently than when recording. Linked instead of cif_api.o (see replay
+ * target in the Makefile).
+ *
+ * The log is loaded with CifReplayLoad or on the first DevOpenDriver from
+ * the file named by the DNETMOD_REPLAY environment variable, with the speed
+ * from DNETMOD_REPLAY_SPEED (default 1). In the latter case the statistics
+ * are printed to the standard error when the driver is closed.
+ */
+
+#ifndef CIFREPLAY_H
+#define CIFREPLAY_H 1
+
+#include "dnmdefs.h"
+
+/** @brief Statistics of a replay */
+typedef struct CifReplayStatsTag {
+    unsigned long ulRecords;    /**< Records in the log                      */
+    unsigned long ulCalls;      /**< Calls answered from the log             */
+    unsigned long ulMissing;    /**< Calls without a record left in the log  */
+    unsigned long ulDiffering;  /**< Calls which passed other data or sizes  */
+} CifReplayStats;
+
+int CifReplayLoad(const char *strFile, double dSpeed);
+void CifReplayUnload(void);
+void CifReplayGetStats(CifReplayStats *pStats);
+
+#endif /* cifreplay.h */
@@ -0,0 +1,374 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cifstub.cpp               Type        : source            *
+ *  Description : Stand-in CIF driver used for benchmarks.                  *
+ ****************************************************************************/
+
+/**
+ * @file cifstub.cpp
+ * @brief Stand-in CIF driver used for benchmarks.
+ *
+ * Calls for the same board must not be made concurrently.
+ */
+
+#include <string.h>
+
+#include "dnmdefs.h"
+
+#if !defined(OS_LINUX)
+#error "error: Stub CIF driver is available only for Linux."
+#endif
+
+#include "dnmos.h"
+#include "cifstub.h"
+#include "ccifintf.h"
+
+#include "cif_user.h"
+#include "rcs_user.h"
+#include "dnm_user.h"
+
+/** Size of the I/O areas of a board in bytes */
+#define STUB_IO_AREA_SZ     3584
+/** Size of the raw DPM area of a board in bytes */
+#define STUB_DPM_SZ         0x800
+/** Offset of the slave status area in DPM */
+#define STUB_SLV_STAT_OFF   0x2F8
+/** Flag run */
+#define STUB_F_RUN          0x40
+/** Flag ready */
+#define STUB_F_RDY          0x80
+
+/** @brief Simulated board */
+typedef struct StubBoardTag {
+    bool          bInit;                         /**< Board initialized     */
+    bool          bDBLoaded;                     /**< Database present      */
+    bool          bHostReady;                    /**< Host state ready      */
+    bool          bReply;                        /**< Reply waiting         */
+    unsigned char ucHsMode;                      /**< Handshake mode        */
+    DNM_UINT64    ullExchAt;                     /**< Handshake ready (ns)  */
+    DNM_UINT64    ullReplyAt;                    /**< Reply ready (ns)      */
+    unsigned char aucCfg[DEVICENET_MAX_DEVICES / 8]; /**< Configured devices */
+    unsigned char aucDPM[STUB_DPM_SZ];           /**< Raw DPM               */
+    unsigned char aucIn[STUB_IO_AREA_SZ];        /**< Input area            */
+    unsigned char aucOut[STUB_IO_AREA_SZ];       /**< Output area           */
+    RCS_MESSAGE   Reply;                         /**< Mailbox reply         */
+} StubBoard;
+
+/** Simulated boards */
+static StubBoard aBoards[MAX_DEV_BOARDS];
+/** Simulated latencies */
+static CifStubConfig StubCfg;
+/** Count of driver calls */
+static unsigned long ulCalls = 0;
+/** Count of driver opens */
+static unsigned long ulOpenCnt = 0;
+
+/**
+ * @brief Busy waits to simulate latency of the driver
+ * @param ulUs Microseconds to wait.
+ */
+static void Spin(unsigned long ulUs) {
+    if ( ulUs == 0 )
+        return;
+
+    DNM_UINT64 ullEnd = DnmTimeNs() + static_cast<DNM_UINT64>(ulUs) * 1000ULL;
+
+    while ( DnmTimeNs() < ullEnd )
+        ;
+}
+
+/**
+ * @brief Waits until a simulated event within a timeout
+ * @param ullAt Time of the event in ns (see DnmTimeNs).
+ * @param ulTimeout Timeout in ms.
+ * @return True if the event happened, false if timed out.
+ */
+static bool WaitUntil(DNM_UINT64 ullAt, unsigned long ulTimeout) {
+    DNM_UINT64 ullNow = DnmTimeNs();
+
+    if ( ullAt <= ullNow )
+        return true;
+    if ( ullAt - ullNow > static_cast<DNM_UINT64>(ulTimeout) * 1000000ULL ) {
+        Spin(ulTimeout * 1000);
+        return false;
+    }
+    Spin(static_cast<unsigned long>((ullAt - ullNow) / 1000));
+    return true;
+}
+
+/**
+ * @brief Retrieves an initialized board
+ * @param usDevNumber Board number.
+ * @return Pointer to the board or NULL if number is invalid or board is not
+ * initialized.
+ */
+static StubBoard * GetBoard(unsigned short usDevNumber) {
+    ulCalls++;
+    if ( ulOpenCnt == 0 || usDevNumber >= MAX_DEV_BOARDS || !aBoards[usDevNumber].bInit )
+        return 0;
+    return &aBoards[usDevNumber];
+}
+
+/**
+ * @brief Sets simulated latencies
+ * @param pCfg Latencies. NULL resets all latencies to zero.
+ */
+void CifStubConfigure(const CifStubConfig *pCfg) {
+    if ( pCfg != 0 )
+        StubCfg = *pCfg;
+    else memset(&StubCfg, 0, sizeof(StubCfg));
+}
+
+/**
+ * @brief Retrieves count of driver calls made so far
+ * @return Count of calls.
+ */
+unsigned long CifStubGetCalls(void) {
+    return ulCalls;
+}
+
+short DevOpenDriver(void) {
+    ulCalls++;
+    ulOpenCnt++;
+    return DRV_NO_ERROR;
+}
+
+short DevCloseDriver(void) {
+    ulCalls++;
+    if ( ulOpenCnt == 0 )
+        return DRV_USR_NOT_INITIALIZED;
+    ulOpenCnt--;
+    return DRV_NO_ERROR;
+}
+
+short DevInitBoard(unsigned short usDevNumber) {
+    ulCalls++;
+    if ( ulOpenCnt == 0 )
+        return DRV_USR_NOT_INITIALIZED;
+    if ( usDevNumber >= MAX_DEV_BOARDS )
+        return DRV_USR_DEV_NUMBER_INVALID;
+    if ( !aBoards[usDevNumber].bInit ) {
+        memset(&aBoards[usDevNumber], 0, sizeof(StubBoard));
+        aBoards[usDevNumber].bInit = true;
+        aBoards[usDevNumber].bDBLoaded = true; /* board comes configured */
+        aBoards[usDevNumber].ucHsMode = DNETMOD_HS_DEVICE_BUFFERED;
+    }
+    return DRV_NO_ERROR;
+}
+
+short DevExitBoard(unsigned short usDevNumber) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    pBoard->bHostReady = false;
+    return DRV_NO_ERROR;
+}
+
+short DevPutTaskParameter(unsigned short usDevNumber, unsigned short /*usNumber*/, unsigned short usSize, void *pvData) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    if ( usSize >= sizeof(DNM_INIT_PARAMETERS) )
+        pBoard->ucHsMode = static_cast<DNM_INIT_PARAMETERS *>(pvData)->bMode;
+    return DRV_NO_ERROR;
+}
+
+short DevReset(unsigned short usDevNumber, unsigned short /*usMode*/, unsigned long /*ulTimeout*/) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    Spin(StubCfg.ulResetMs * 1000);
+    pBoard->bHostReady = false;
+    pBoard->bReply = false;
+    return DRV_NO_ERROR;
+}
+
+short DevSetHostState(unsigned short usDevNumber, unsigned short usMode, unsigned long /*ulTimeout*/) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    pBoard->bHostReady = usMode == HOST_READY;
+    return DRV_NO_ERROR;
+}
+
+short DevGetInfo(unsigned short usDevNumber, unsigned short usInfoArea, unsigned short usSize, void *pvData) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    Spin(StubCfg.ulStateUs);
+    if ( usInfoArea != GET_DRIVER_INFO || usSize < sizeof(DRIVERINFO) )
+        return DRV_USR_INFO_AREA_INVALID;
+
+    DRIVERINFO *pInfo = static_cast<DRIVERINFO *>(pvData);
+
+    memset(pInfo, 0, sizeof(DRIVERINFO));
+    pInfo->bHostFlags = static_cast<unsigned char>(pBoard->bDBLoaded ? STUB_F_RUN | STUB_F_RDY : STUB_F_RDY);
+    return DRV_NO_ERROR;
+}
+
+short DevGetTaskState(unsigned short usDevNumber, unsigned short /*usNumber*/, unsigned short usSize, void *pvData) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    Spin(StubCfg.ulStateUs);
+    if ( usSize < sizeof(DNM_DIAGNOSTICS) )
+        return DRV_USR_SIZE_INVALID;
+
+    DNM_DIAGNOSTICS *pDiag = static_cast<DNM_DIAGNOSTICS *>(pvData);
+
+    memset(pDiag, 0, sizeof(DNM_DIAGNOSTICS));
+    pDiag->bDNM_state = static_cast<unsigned char>(pBoard->bHostReady ? OPERATE : 0);
+    for ( int i = 0; i < DEVICENET_MAX_DEVICES / 8; i++ ) {
+        pDiag->abDv_cfg[i] = pBoard->aucCfg[i];
+        pDiag->abDv_state[i + 8] = pBoard->aucCfg[i] & pBoard->aucDPM[STUB_SLV_STAT_OFF + i];
+    }
+    return DRV_NO_ERROR;
+}
+
+short DevPutMessage(unsigned short usDevNumber, MSG_STRUC *ptMessage, unsigned long /*ulTimeout*/) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    if ( pBoard->bReply )
+        return DRV_DEV_MAILBOX_FULL;
+
+    RCS_MESSAGE *pMsg   = &pBoard->Reply;
+    unsigned char ucTmp = 0;
+
+    memcpy(pMsg, ptMessage, sizeof(RCS_MESSAGE));
+    ucTmp = pMsg->rx;
+    pMsg->rx = pMsg->tx;
+    pMsg->tx = ucTmp;
+    pMsg->a = pMsg->b;
+    pMsg->f = TASK_F_OK;
+
+    if ( ucTmp == 0 && pMsg->b == 6 && pMsg->d[0] == 4 ) { /* clear database */
+        pBoard->bDBLoaded = false;
+        memset(pBoard->aucCfg, 0, sizeof(pBoard->aucCfg));
+        memset(pBoard->aucDPM + STUB_SLV_STAT_OFF, 0, DEVICENET_MAX_DEVICES / 8);
+    }
+    else if ( pMsg->b == DNM_Download ) {
+        DNM_DOWNLOAD_REQUEST *pReq = reinterpret_cast<DNM_DOWNLOAD_REQUEST *>(pMsg->d);
+
+        pBoard->bDBLoaded = true;
+        if ( pReq->bArea_Code < DEVICENET_MAX_DEVICES ) {
+            unsigned char ucBit = static_cast<unsigned char>(1 << (pReq->bArea_Code % 8));
+
+            pBoard->aucCfg[pReq->bArea_Code / 8] |= ucBit;
+            pBoard->aucDPM[STUB_SLV_STAT_OFF + pReq->bArea_Code / 8] |= ucBit;
+        }
+    }
+    else if ( pMsg->b == DNM_Device_Diag )
+        memset(pMsg->d, 0, sizeof(DNM_DEVICE_DIAG_CONFIRM));
+    else if ( pMsg->b == DNM_Get_Set_Attribute ) {
+        RCS_MESSAGETELEGRAM_10 *pTlg = reinterpret_cast<RCS_MESSAGETELEGRAM_10 *>(pMsg);
+
+        if ( pTlg->function == TASK_TFC_READ )
+            memset(pTlg->d, 0, pTlg->data_cnt);
+    }
+    pBoard->bReply = true;
+    pBoard->ullReplyAt = DnmTimeNs() + static_cast<DNM_UINT64>(StubCfg.ulMailboxUs) * 1000ULL;
+    return DRV_NO_ERROR;
+}
+
+short DevGetMessage(unsigned short usDevNumber, unsigned short usSize, MSG_STRUC *ptMessage, unsigned long ulTimeout) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    if ( !pBoard->bReply ) {
+        if ( ulTimeout == 0 )
+            return DRV_DEV_GET_NO_MESSAGE;
+        Spin(StubCfg.ulMailboxUs);
+        return DRV_DEV_GET_TIMEOUT;
+    }
+    if ( !WaitUntil(pBoard->ullReplyAt, ulTimeout) )
+        return ulTimeout == 0 ? DRV_DEV_GET_NO_MESSAGE : DRV_DEV_GET_TIMEOUT;
+    memcpy(ptMessage, &pBoard->Reply, usSize < sizeof(RCS_MESSAGE) ? usSize : sizeof(RCS_MESSAGE));
+    pBoard->bReply = false;
+    return DRV_NO_ERROR;
+}
+
+short DevExchangeIO(
+    unsigned short usDevNumber,
+    unsigned short usSendOffset,
+    unsigned short usSendSize,
+    void           *pvSendData,
+    unsigned short usReceiveOffset,
+    unsigned short usReceiveSize,
+    void           *pvReceiveData,
+    unsigned long  ulTimeout)
+{
+    StubBoard     *pBoard    = GetBoard(usDevNumber);
+    unsigned long ulCycleUs = 0;
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    if ( pBoard->ucHsMode == DNETMOD_HS_DEVICE_BUFFERED )
+        ulCycleUs = StubCfg.ulExchangeUs;
+    else if ( pBoard->ucHsMode == DNETMOD_HS_HOST_BUFFERED )
+        ulCycleUs = StubCfg.ulExchangeUs * StubCfg.ulHostPct / 100;
+    if ( ulCycleUs > 0 ) {
+        if ( !WaitUntil(pBoard->ullExchAt, ulTimeout) )
+            return DRV_DEV_EXCHANGE_TIMEOUT;
+        pBoard->ullExchAt = DnmTimeNs() + static_cast<DNM_UINT64>(ulCycleUs) * 1000ULL;
+    }
+    else
+        Spin(StubCfg.ulDPMUs);
+    if ( usSendOffset + usSendSize > STUB_IO_AREA_SZ )
+        return DRV_USR_SENDSIZE_TOO_LONG;
+    if ( usReceiveOffset + usReceiveSize > STUB_IO_AREA_SZ )
+        return DRV_USR_RECVSIZE_TOO_LONG;
+    if ( usSendSize > 0 )
+        memcpy(pBoard->aucOut + usSendOffset, pvSendData, usSendSize);
+    if ( usReceiveSize > 0 )
+        memcpy(pvReceiveData, pBoard->aucIn + usReceiveOffset, usReceiveSize);
+    return DRV_NO_ERROR;
+}
+
+short DevReadWriteDPMRaw(unsigned short usDevNumber, unsigned short usMode, unsigned short usOffset, unsigned short usSize, void *pvData) {
+    StubBoard *pBoard = GetBoard(usDevNumber);
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    Spin(StubCfg.ulDPMUs);
+    if ( usOffset + usSize > STUB_DPM_SZ )
+        return DRV_USR_SIZE_TOO_LONG;
+    if ( usMode == PARAMETER_READ )
+        memcpy(pvData, pBoard->aucDPM + usOffset, usSize);
+    else if ( usMode == PARAMETER_WRITE )
+        memcpy(pBoard->aucDPM + usOffset, pvData, usSize);
+    else return DRV_USR_MODE_INVALID;
+    return DRV_NO_ERROR;
+}
+
+short DevReadWriteDPMData(unsigned short usDevNumber, unsigned short usMode, unsigned short usOffset, unsigned short usSize, void *pvData) {
+    StubBoard     *pBoard = GetBoard(usDevNumber);
+    unsigned char *pucArea = 0;
+
+    if ( pBoard == 0 )
+        return DRV_BOARD_NOT_INITIALIZED;
+    Spin(StubCfg.ulDPMUs);
+    /* Send area followed by receive area */
+    if ( usOffset + usSize > 2 * STUB_IO_AREA_SZ ||
+         (usOffset < STUB_IO_AREA_SZ && usOffset + usSize > STUB_IO_AREA_SZ) )
+        return DRV_USR_SIZE_TOO_LONG;
+    if ( usOffset < STUB_IO_AREA_SZ )
+        pucArea = pBoard->aucOut + usOffset;
+    else pucArea = pBoard->aucIn + (usOffset - STUB_IO_AREA_SZ);
+    if ( usMode == PARAMETER_READ )
+        memcpy(pvData, pucArea, usSize);
+    else if ( usMode == PARAMETER_WRITE )
+        memcpy(pucArea, pvData, usSize);
+    else return DRV_USR_MODE_INVALID;
+    return DRV_NO_ERROR;
+}
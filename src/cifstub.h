@@ -0,0 +1,55 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cifstub.h                 Type        : header            *
+ *  Description : Stand-in CIF driver used for benchmarks.                  *
+ ****************************************************************************/
+
+/**
+ * @file cifstub.h
+ * @brief Stand-in CIF driver used for benchmarks.
+ *
+ * Implements the CIF user API (cif_user.h) in memory so the module could be
+ * measured without a Hilscher board. The stub simulates a DeviceNet master
+ * which accepts any configuration, establishes I/O connection to every
+ * downloaded device and answers every mailbox request successfully after a
+ * configurable latency. Linked instead of cif_api.o (see bench target in
+ * the Makefile).
+ */
+
+#ifndef CIFSTUB_H
+#define CIFSTUB_H 1
+
+#include "dnmdefs.h"
+
+/**
+ * @brief Latencies simulated by the stub driver
+ *
+ * DevExchangeIO takes ulExchangeUs in the device controlled handshake mode
+ * (default), ulHostPct percent of it in the host controlled mode (the board
+ * does not wait for the end of its bus cycle) and ulDPMUs without handshake
+ * (see CCIFInterface::SetHandshakeMode). The stub does not model the
+ * handshake of a board, so the modes differ only by these latencies. With handshake the time is counted from
+ * the previous exchange, so the board is ready at once if the caller did
+ * other work meanwhile. The reply of a mailbox request is ready
+ * ulMailboxUs after DevPutMessage. Calls whose timeout ends earlier fail
+ * with the timeout status of the driver (DRV_DEV_GET_NO_MESSAGE for
+ * DevGetMessage with zero timeout).
+ */
+/** Default host controlled exchange in percent of device controlled one */
+#define CIFSTUB_DEF_HOST_PCT    50
+
+typedef struct CifStubConfigTag {
+    unsigned long ulExchangeUs; /**< DevExchangeIO in us (see below)     */
+    unsigned long ulHostPct;    /**< Host controlled exchange in percent */
+    unsigned long ulMailboxUs;  /**< DevPutMessage/DevGetMessage in us   */
+    unsigned long ulStateUs;    /**< DevGetTaskState/DevGetInfo in us    */
+    unsigned long ulDPMUs;      /**< DevReadWriteDPMRaw/Data in us       */
+    unsigned long ulResetMs;    /**< DevReset in ms                      */
+} CifStubConfig;
+
+void CifStubConfigure(const CifStubConfig *pCfg);
+unsigned long CifStubGetCalls(void);
+
+#endif /* cifstub.h */
@@ -13,7 +13,9 @@
 
 #include <string.h>
 
+#include "dnmerrs.h"
 #include "cintf.h"
+#include "cdevice.h"
 
 /**
  * @brief Validates baud rate values
@@ -31,7 +33,9 @@ char CInterface::strClassName[] = "CInterface";
  * Initializes members accordingly.
  */
 CInterface::CInterface() : CNode() {
+    ulTypeMask = TYPE_MASK;
     ucBaudRate = 0;
+    InitRegistry();
 }
 
 /**
@@ -49,10 +53,172 @@ CInterface::CInterface(
     unsigned char ucPCS,
     unsigned char ucBR)
 : CNode(ucMID, ucCCS, ucPCS) {
+    ulTypeMask = TYPE_MASK;
     ucBaudRate = 0;
+    InitRegistry();
     SetBaudRate(ucBR);
 }
 
+/**
+ * @brief Empties the device registry
+ */
+void CInterface::InitRegistry(void) {
+    ullDevActive = ullDevFaulted = ullDevChanged = 0;
+    memset(apDevices, 0, sizeof(apDevices));
+    memset(ausDevInOffset, 0, sizeof(ausDevInOffset));
+    memset(ausDevOutOffset, 0, sizeof(ausDevOutOffset));
+    memset(aucDevConsumedSz, 0, sizeof(aucDevConsumedSz));
+    memset(aucDevProducedSz, 0, sizeof(aucDevProducedSz));
+    memset(ausDevEPR, 0, sizeof(ausDevEPR));
+    memset(aullDevLastIO, 0, sizeof(aullDevLastIO));
+}
+
+/**
+ * @brief Registers an allocated device
+ *
+ * Fills the slot of device's MAC ID and then publishes it in the active
+ * mask, so a reader seeing the bit sees the slot filled. A device
+ * registered before on the same MAC ID is replaced.
+ * @param pDevice The device.
+ * @param usInOff Offset of device's input data in the process image.
+ * @param usOutOff Offset of device's output data in the process image.
+ */
+void CInterface::RegisterDevice(CDevice *pDevice, unsigned short usInOff, unsigned short usOutOff) {
+    unsigned char ucMacID = pDevice->GetMacID();
+    DNM_UINT64    ullBit  = 0;
+
+    if ( ucMacID >= DEVICENET_MAX_DEVICES )
+        return;
+    ullBit = static_cast<DNM_UINT64>(1) << ucMacID;
+
+    apDevices[ucMacID] = pDevice;
+    ausDevInOffset[ucMacID] = usInOff;
+    ausDevOutOffset[ucMacID] = usOutOff;
+    aucDevConsumedSz[ucMacID] = pDevice->GetConsumedConnSize();
+    aucDevProducedSz[ucMacID] = pDevice->GetProducedConnSize();
+    ausDevEPR[ucMacID] = pDevice->GetEPR();
+    aullDevLastIO[ucMacID] = 0;
+    DnmAtomicUpdate64(&ullDevFaulted, 0, ullBit);
+    DnmAtomicUpdate64(&ullDevActive, ullBit, 0);
+    DnmAtomicUpdate64(&ullDevChanged, ullBit, 0);
+}
+
+/**
+ * @brief Unregisters a device
+ *
+ * Does nothing if the slot of device's MAC ID holds another device.
+ * @param pDevice The device.
+ */
+void CInterface::UnregisterDevice(CDevice *pDevice) {
+    unsigned char ucMacID = pDevice->GetMacID();
+    DNM_UINT64    ullBit  = 0;
+
+    if ( ucMacID >= DEVICENET_MAX_DEVICES || apDevices[ucMacID] != pDevice )
+        return;
+    ullBit = static_cast<DNM_UINT64>(1) << ucMacID;
+
+    DnmAtomicUpdate64(&ullDevActive, 0, ullBit);
+    DnmAtomicUpdate64(&ullDevFaulted, 0, ullBit);
+    DnmAtomicUpdate64(&ullDevChanged, ullBit, 0);
+    apDevices[ucMacID] = 0;
+}
+
+/**
+ * @brief Marks a registered device as faulted or recovered
+ * @param pDevice The device.
+ * @param bFaulted Flag showing whether device is faulted.
+ */
+void CInterface::SetDeviceFaulted(CDevice *pDevice, bool bFaulted) {
+    unsigned char ucMacID = pDevice->GetMacID();
+    DNM_UINT64    ullBit  = 0;
+    DNM_UINT64    ullOld  = 0;
+
+    if ( ucMacID >= DEVICENET_MAX_DEVICES || apDevices[ucMacID] != pDevice )
+        return;
+    ullBit = static_cast<DNM_UINT64>(1) << ucMacID;
+
+    ullOld = DnmAtomicUpdate64(&ullDevFaulted, bFaulted ? ullBit : 0, bFaulted ? 0 : ullBit);
+    if ( ((ullOld & ullBit) != 0) != bFaulted )
+        DnmAtomicUpdate64(&ullDevChanged, ullBit, 0);
+}
+
+/**
+ * @brief Retrieves and clears changed devices
+ *
+ * A device is changed when it is registered (allocated), unregistered
+ * (unallocated), faulted or recovered.
+ * @return Mask with a bit set for the MAC ID of each device changed since
+ * the previous call.
+ */
+DNM_UINT64 CInterface::TakeChangedDevices(void) {
+    return DnmAtomicUpdate64(&ullDevChanged, 0, ~static_cast<DNM_UINT64>(0));
+}
+
+/**
+ * @brief Retrieves registered device by MAC ID
+ * @param ucMacID MAC ID of the device.
+ * @return Pointer to the device or NULL if none is registered.
+ */
+CDevice * CInterface::GetDevice(unsigned char ucMacID) const {
+    if ( ucMacID >= DEVICENET_MAX_DEVICES )
+        return 0;
+    if ( (GetActiveDevices() & (static_cast<DNM_UINT64>(1) << ucMacID)) == 0 )
+        return 0;
+
+    return apDevices[ucMacID];
+}
+
+/**
+ * @brief Retrieves registry entry of a device
+ * @param ucMacID MAC ID of the device.
+ * @param pSlot Receives the entry.
+ * @return Error from \ref SetError function.
+ */
+int CInterface::GetDeviceSlot(unsigned char ucMacID, DeviceSlot *pSlot) const {
+    DNM_UINT64 ullBit = 0;
+
+    if ( pSlot == 0 )
+        return SetError(ERR_INVFPRM, "pSlot", "NULL", "GetDeviceSlot");
+    if ( ucMacID >= DEVICENET_MAX_DEVICES || GetDevice(ucMacID) == 0 )
+        return SetError(ERR_NOALOC, ucMacID);
+
+    ullBit = static_cast<DNM_UINT64>(1) << ucMacID;
+    pSlot->usInOffset = ausDevInOffset[ucMacID];
+    pSlot->usOutOffset = ausDevOutOffset[ucMacID];
+    pSlot->ucConsumedSz = aucDevConsumedSz[ucMacID];
+    pSlot->ucProducedSz = aucDevProducedSz[ucMacID];
+    pSlot->usEPR = ausDevEPR[ucMacID];
+    pSlot->ullLastIONs = aullDevLastIO[ucMacID];
+    pSlot->bFaulted = ( (GetFaultedDevices() & ullBit) != 0 );
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Retrieves registered devices without recent exchange
+ *
+ * Only the slots of registered devices are visited.
+ * @param ulMaxAgeMs Maximum time since the last exchange in ms.
+ * @return Mask with a bit set for the MAC ID of each registered device not
+ * exchanged with within ulMaxAgeMs or not exchanged with at all.
+ */
+DNM_UINT64 CInterface::GetStaleDevices(unsigned long ulMaxAgeMs) const {
+    DNM_UINT64 ullMask   = GetActiveDevices();
+    DNM_UINT64 ullStale  = 0;
+    DNM_UINT64 ullNow    = DnmTimeNs();
+    DNM_UINT64 ullMaxAge = static_cast<DNM_UINT64>(ulMaxAgeMs) * 1000000ULL;
+
+    while ( ullMask != 0 ) {
+        unsigned char ucMacID = DnmBitTake64(&ullMask);
+        DNM_UINT64    ullLast = aullDevLastIO[ucMacID];
+
+        if ( ullLast == 0 || ullNow - ullLast > ullMaxAge )
+            ullStale |= static_cast<DNM_UINT64>(1) << ucMacID;
+    }
+
+    return ullStale;
+}
+
 /**
  * @brief Set baud rate for the interface
  *
@@ -98,11 +264,16 @@ bool CInterface::IsA(const char *strCompareName) const {
 /**
  * @brief Destructor
  *
- * Does nothing.
+ * Detaches registered devices from the interface.
  * @remarks It is good to stop communication on the interface and to do
  * finalization on it when destroying an object of class descended from
  * CInterface. A call to Close method, if not invoked by the user, is proposed
  * for implementing in descendants destructors.
  */
-CInterface::~CInterface() {}
+CInterface::~CInterface() {
+    DNM_UINT64 ullMask = GetActiveDevices();
+
+    while ( ullMask != 0 )
+        apDevices[DnmBitTake64(&ullMask)]->pRegIntf = 0;
+}
 
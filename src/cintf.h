@@ -21,12 +21,32 @@
 #endif
 
 #include "cnode.h"
+#include "dnmos.h"
+
+class CDevice;
+
+/** @brief Registry entry of a device (see CInterface::GetDeviceSlot) */
+typedef struct DeviceSlotTag {
+    unsigned short usInOffset;   /**< Offset of input data in process image  */
+    unsigned short usOutOffset;  /**< Offset of output data in process image */
+    unsigned char  ucConsumedSz; /**< Consumed connection size               */
+    unsigned char  ucProducedSz; /**< Produced connection size               */
+    unsigned short usEPR;        /**< Expected Packet Rate in ms             */
+    DNM_UINT64     ullLastIONs;  /**< Time of last exchange in ns (0 - none) */
+    bool           bFaulted;     /**< Flag showing whether device is faulted */
+} DeviceSlot;
 
 /**
  * @brief Base and abstract class for all DeviceNet™ interfaces
  *
  * The interface class abstractly represents a DeviceNet interface and/or a
  * master device on the network.
+ *
+ * The interface keeps a registry of its allocated devices indexed by MAC
+ * ID. Devices register on allocation and report faults and exchanges (see
+ * CDevice::Register), so network wide queries are bit operations over the
+ * active, faulted and changed masks (bit per MAC ID, see DnmBitTake64 for
+ * iterating them) instead of calls to each device.
  * @remark Copy constructor and assignment operator not supported for this class.
  */
 class DNETMOD_API CInterface : public CNode {
@@ -38,9 +58,41 @@ protected:
     static unsigned long ulClassID;
     /** Class's name */
     static char strClassName[];
+public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_INTERFACE | CNode::TYPE_MASK };
 protected:
     /** Interface's baud rate */
     unsigned char ucBaudRate;
+private:
+    /* Device registry (struct of arrays indexed by MAC ID) */
+    /** Registered devices (bit per MAC ID) */
+    volatile DNM_UINT64 ullDevActive;
+    /** Faulted devices (bit per MAC ID) */
+    volatile DNM_UINT64 ullDevFaulted;
+    /** Devices registered, unregistered, faulted or recovered since last
+        CInterface::TakeChangedDevices (bit per MAC ID) */
+    volatile DNM_UINT64 ullDevChanged;
+    /** Registered device objects */
+    CDevice *apDevices[DEVICENET_MAX_DEVICES];
+    /** Offset of input data of each device in the process image */
+    unsigned short ausDevInOffset[DEVICENET_MAX_DEVICES];
+    /** Offset of output data of each device in the process image */
+    unsigned short ausDevOutOffset[DEVICENET_MAX_DEVICES];
+    /** Consumed connection size of each device */
+    unsigned char aucDevConsumedSz[DEVICENET_MAX_DEVICES];
+    /** Produced connection size of each device */
+    unsigned char aucDevProducedSz[DEVICENET_MAX_DEVICES];
+    /** EPR of each device */
+    unsigned short ausDevEPR[DEVICENET_MAX_DEVICES];
+    /** Time of last exchange with each device in ns (zero if none) */
+    DNM_UINT64 aullDevLastIO[DEVICENET_MAX_DEVICES];
+private:
+    void InitRegistry(void);
+    void RegisterDevice(CDevice *pDevice, unsigned short usInOff, unsigned short usOutOff);
+    void UnregisterDevice(CDevice *pDevice);
+    void SetDeviceFaulted(CDevice *pDevice, bool bFaulted);
+    friend class CDevice;
 public:
     /* constructors */
     CInterface();
@@ -48,6 +100,14 @@ public:
     /* get/set */
     unsigned char GetBaudRate(void) const;
     void SetBaudRate(unsigned char ucBR);
+    /* device registry */
+    DNM_UINT64 GetActiveDevices(void) const;
+    DNM_UINT64 GetFaultedDevices(void) const;
+    DNM_UINT64 TakeChangedDevices(void);
+    unsigned int GetDeviceCount(void) const;
+    CDevice * GetDevice(unsigned char ucMacID) const;
+    int GetDeviceSlot(unsigned char ucMacID, DeviceSlot *pSlot) const;
+    DNM_UINT64 GetStaleDevices(unsigned long ulMaxAgeMs) const;
     /* overrides */
     virtual bool IsA(unsigned long ulCompareID) const;
     virtual bool IsA(const char *strCompareName) const;
@@ -111,5 +171,30 @@ inline unsigned char CInterface::GetBaudRate(void) const {
     return ucBaudRate;
 }
 
+/**
+ * @brief Retrieves registered devices
+ * @return Mask with a bit set for the MAC ID of each registered device.
+ */
+inline DNM_UINT64 CInterface::GetActiveDevices(void) const {
+    return DnmAtomicLoad64(&ullDevActive);
+}
+
+/**
+ * @brief Retrieves faulted devices
+ * @return Mask with a bit set for the MAC ID of each registered device
+ * which is faulted.
+ */
+inline DNM_UINT64 CInterface::GetFaultedDevices(void) const {
+    return DnmAtomicLoad64(&ullDevFaulted) & DnmAtomicLoad64(&ullDevActive);
+}
+
+/**
+ * @brief Retrieves count of registered devices
+ * @return Count of devices.
+ */
+inline unsigned int CInterface::GetDeviceCount(void) const {
+    return DnmBitCount64(DnmAtomicLoad64(&ullDevActive));
+}
+
 #endif /* cintf.h */
 
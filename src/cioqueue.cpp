@@ -0,0 +1,49 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cioqueue.cpp              Type        : source            *
+ *  Description : CIOQueue class implementation.                            *
+ ****************************************************************************/
+
+/**
+ * @file cioqueue.cpp
+ * @brief CIOQueue class implementation.
+ */
+
+#include <new>
+
+#include "cioqueue.h"
+
+/**
+ * @brief Constructor
+ *
+ * Allocates the ring buffer. Capacity is rounded up to the next power of
+ * two. Use CIOQueue::IsValid to check whether allocation succeeded.
+ * @param ulCapacity Minimum count of updates the queue must hold.
+ */
+CIOQueue::CIOQueue(unsigned long ulCapacity) {
+    unsigned long ulCap = 2;
+
+    while ( ulCap < ulCapacity )
+        ulCap <<= 1;
+
+    pRing = new (std::nothrow) IOUpdate[ulCap];
+    ulMask = ulCap - 1;
+    ulDropped = 0;
+    ulHeadCache = 0;
+    ulTail = 0;
+    ulHead = 0;
+}
+
+/**
+ * @brief Destructor
+ *
+ * Frees the ring buffer.
+ * @remarks The queue must be detached from the interface before it is
+ * destroyed.
+ */
+CIOQueue::~CIOQueue() {
+    if ( pRing != 0 )
+        delete [] pRing;
+}
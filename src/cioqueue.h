@@ -0,0 +1,203 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cioqueue.h                Type        : header            *
+ *  Description : CIOQueue class declaration.                               *
+ ****************************************************************************/
+
+/**
+ * @file cioqueue.h
+ * @brief CIOQueue class declaration.
+ */
+
+#ifndef CIOQUEUE_H
+#define CIOQUEUE_H 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File cioqueue.h requires c++ compiler."
+#endif
+
+#include <string.h>
+
+#include "dnmos.h"
+
+/** Maximum data bytes carried by a single output update */
+#define DNETMOD_IOQ_MAX_DATA    8
+/** Default capacity of an output update queue */
+#define DNETMOD_IOQ_DEF_CAP     256
+
+/** @brief Output update passed from an application thread to the I/O thread */
+typedef struct IOUpdateTag {
+    unsigned char ucMacID;                      /**< Target device MAC ID      */
+    unsigned char ucOffset;                     /**< Offset in device's output */
+    unsigned char ucSize;                       /**< Valid bytes in abData     */
+    unsigned char abData[DNETMOD_IOQ_MAX_DATA]; /**< New output bytes          */
+    unsigned char abMask[DNETMOD_IOQ_MAX_DATA]; /**< Bits of abData to apply   */
+} IOUpdate;
+
+/**
+ * @brief Single-producer/single-consumer queue of output updates
+ *
+ * The queue is a fixed size ring buffer which lets one application thread
+ * pass output updates to the thread exchanging I/O data with the interface
+ * without locks or calls to the driver. Each producer thread must use its
+ * own queue. The queues are attached to the interface with
+ * CCIFInterface::AttachQueue and drained with CCIFInterface::ExchangeOutputs.
+ * @remark Copy constructor and assignment operator not supported for this class.
+ */
+class DNETMOD_API CIOQueue {
+private:
+    /** Ring buffer */
+    IOUpdate *pRing;
+    /** Capacity minus one (capacity is a power of two) */
+    unsigned long ulMask;
+    /** Updates rejected because the queue was full (producer side) */
+    volatile unsigned long ulDropped;
+    /** Producer's copy of the head index */
+    unsigned long ulHeadCache;
+    unsigned char aucPad1[DNETMOD_CACHE_LINE];
+    /** Index of the next update to be written (producer side) */
+    volatile unsigned long ulTail;
+    unsigned char aucPad2[DNETMOD_CACHE_LINE - sizeof(unsigned long)];
+    /** Index of the next update to be read (consumer side) */
+    volatile unsigned long ulHead;
+    unsigned char aucPad3[DNETMOD_CACHE_LINE - sizeof(unsigned long)];
+private:
+    CIOQueue(const CIOQueue&);
+    CIOQueue& operator =(const CIOQueue&);
+public:
+    /* constructors */
+    CIOQueue(unsigned long ulCapacity = DNETMOD_IOQ_DEF_CAP);
+    /* get */
+    bool IsValid(void) const;
+    unsigned long GetCapacity(void) const;
+    unsigned long GetDropped(void) const;
+    unsigned long GetSize(void) const;
+    /* main */
+    bool Push(const IOUpdate &Upd);
+    bool Push(unsigned char ucMacID,
+              unsigned char ucOffset,
+              unsigned char ucSize,
+              const void    *pvData,
+              const void    *pvMask = 0);
+    bool Pop(IOUpdate &Upd);
+    /* destructor */
+    ~CIOQueue();
+};
+
+/**
+ * @brief Checks whether the ring buffer was allocated
+ * @return True if the queue is usable, false otherwise.
+ */
+inline bool CIOQueue::IsValid(void) const {
+    return pRing != 0;
+}
+
+/**
+ * @brief Retrieves queue's capacity
+ * @return Maximum count of updates the queue can hold.
+ */
+inline unsigned long CIOQueue::GetCapacity(void) const {
+    return pRing != 0 ? ulMask + 1 : 0;
+}
+
+/**
+ * @brief Retrieves count of rejected updates
+ *
+ * An update is rejected when the queue is full, i.e. the I/O thread does not
+ * drain it fast enough.
+ * @return Count of updates rejected by CIOQueue::Push.
+ */
+inline unsigned long CIOQueue::GetDropped(void) const {
+    return DnmAtomicLoad(&ulDropped);
+}
+
+/**
+ * @brief Retrieves count of updates waiting in the queue
+ * @return Approximate count of queued updates.
+ */
+inline unsigned long CIOQueue::GetSize(void) const {
+    return DnmAtomicLoad(&ulTail) - DnmAtomicLoad(&ulHead);
+}
+
+/**
+ * @brief Queues an output update
+ *
+ * May only be called from the producer thread owning the queue. Never
+ * blocks.
+ * @param Upd Update to be queued.
+ * @return True if queued, false if the queue is full.
+ */
+inline bool CIOQueue::Push(const IOUpdate &Upd) {
+    unsigned long ulT = ulTail;
+
+    if ( ulT - ulHeadCache > ulMask ) {
+        ulHeadCache = DnmAtomicLoad(&ulHead);
+        if ( ulT - ulHeadCache > ulMask ) {
+            DnmAtomicAdd(&ulDropped, 1);
+            return false;
+        }
+    }
+    pRing[ulT & ulMask] = Upd;
+    DnmAtomicStore(&ulTail, ulT + 1);
+
+    return true;
+}
+
+/**
+ * @brief Queues an output update built from parameters
+ *
+ * May only be called from the producer thread owning the queue. Never
+ * blocks.
+ * @param ucMacID MAC ID of the device.
+ * @param ucOffset Offset of the first byte in device's output data.
+ * @param ucSize Count of bytes. Must not exceed #DNETMOD_IOQ_MAX_DATA.
+ * @param pvData New output bytes.
+ * @param pvMask Bits of the data to be applied. When NULL all bits are applied.
+ * @return True if queued, false if the queue is full or size is invalid.
+ */
+inline bool CIOQueue::Push(
+    unsigned char ucMacID,
+    unsigned char ucOffset,
+    unsigned char ucSize,
+    const void    *pvData,
+    const void    *pvMask)
+{
+    IOUpdate Upd;
+
+    if ( ucSize > DNETMOD_IOQ_MAX_DATA )
+        return false;
+
+    Upd.ucMacID  = ucMacID;
+    Upd.ucOffset = ucOffset;
+    Upd.ucSize   = ucSize;
+    memcpy(Upd.abData, pvData, ucSize);
+    if ( pvMask != 0 )
+        memcpy(Upd.abMask, pvMask, ucSize);
+    else memset(Upd.abMask, 0xFF, ucSize);
+
+    return Push(Upd);
+}
+
+/**
+ * @brief Takes the oldest update from the queue
+ *
+ * May only be called from the consumer (I/O) thread. Never blocks.
+ * @param Upd Receives the update.
+ * @return True if an update was taken, false if the queue is empty.
+ */
+inline bool CIOQueue::Pop(IOUpdate &Upd) {
+    unsigned long ulH = ulHead;
+
+    if ( ulH == DnmAtomicLoad(&ulTail) )
+        return false;
+    Upd = pRing[ulH & ulMask];
+    DnmAtomicStore(&ulHead, ulH + 1);
+
+    return true;
+}
+
+#endif /* cioqueue.h */
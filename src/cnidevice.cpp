@@ -38,7 +38,9 @@ char CNIDevice::strClassName[] = "CNIDevice";
  *
  * Initializes members accordingly.
  */
-CNIDevice::CNIDevice() : ulHIO(0), ulHEM(0), CDevice() {}
+CNIDevice::CNIDevice() : ulHIO(0), ulHEM(0), CDevice() {
+    ulTypeMask = TYPE_MASK;
+}
 
 /**
  * @brief Constructors with parameters.
@@ -58,7 +60,9 @@ CNIDevice::CNIDevice(
     unsigned char  ucCT,
     unsigned short usEPR,
     CInterface     *pIntf)
-: ulHIO(0), ulHEM(0), CDevice(ucMID, ucCCS, ucPCS, ucCT, usEPR, pIntf) {}
+: ulHIO(0), ulHEM(0), CDevice(ucMID, ucCCS, ucPCS, ucCT, usEPR, pIntf) {
+    ulTypeMask = TYPE_MASK;
+}
 
 /**
  * @brief Checks if class can identify itself with the specified number.
@@ -94,7 +98,7 @@ int CNIDevice::Allocate(unsigned char ucFlags) {
     unsigned long ulCurrState = 0;
 
     if ( ISPTRVALID(pInterface, CInterface) ) {
-      if ( pInterface->IsA("CNIInterface") ) {
+      if ( pInterface->Is<CNIInterface>() ) {
         if ( pInterface->IsActive() ) {
             int iStatus = 0;
             char strIName[7] = {0};
@@ -128,8 +132,10 @@ int CNIDevice::Allocate(unsigned char ucFlags) {
     }
     else return SetError(ERR_INVPTR, ucMacID, "pInterface", pInterface);
 
-    if ( iErr == 0 )
+    if ( iErr == 0 ) {
         bActive = true;
+        Register();
+    }
 
     return iErr;
 }
@@ -146,7 +152,7 @@ int CNIDevice::UnallocateDevice(void) {
     unsigned short usIID = 0;
 
     if ( ISPTRVALID(pInterface, CInterface) )
-        if ( pInterface->IsA("CNIInterface") )
+        if ( pInterface->Is<CNIInterface>() )
             usIID = (dynamic_cast<CNIInterface *>(pInterface))->GetIntfID();
 
     if ( ulHIO != 0 ) {
@@ -160,6 +166,7 @@ int CNIDevice::UnallocateDevice(void) {
         ulHEM = 0;
     }
     bActive = false;
+    Unregister();
 
     return iErr;
 }
@@ -184,7 +191,7 @@ int CNIDevice::ReadIOData(unsigned long ulBufSz, void *pvBuf) {
     unsigned long ulCurrState = 0;
 
     if ( ISPTRVALID(pInterface, CInterface) ) {
-      if ( pInterface->IsA("CNIInterface") ) {
+      if ( pInterface->Is<CNIInterface>() ) {
         if ( pInterface->IsActive() ) {
           if ( ulHIO != 0 ) {
             int iStatus = 0;
@@ -221,7 +228,7 @@ int CNIDevice::ReadIOData(unsigned long ulBufSz, void *pvBuf) {
  */
 int CNIDevice::WriteIOData(unsigned long ulBufSz, void *pvBuf) {
     if ( ISPTRVALID(pInterface, CInterface) ) {
-      if ( pInterface->IsA("CNIInterface") ) {
+      if ( pInterface->Is<CNIInterface>() ) {
         if ( pInterface->IsActive() ) {
           if ( ulHIO != 0 ) {
             int iStatus = 0;
@@ -262,7 +269,7 @@ int CNIDevice::GetAttribute(
     unsigned short *pusActDataSz)
 {
     if ( ISPTRVALID(pInterface, CInterface) ) {
-      if ( pInterface->IsA("CNIInterface") ) {
+      if ( pInterface->Is<CNIInterface>() ) {
         if ( pInterface->IsActive() ) {
           if ( ulHEM != 0 ) {
             unsigned short usDevError = 0;
@@ -305,7 +312,7 @@ int CNIDevice::SetAttribute(
     void           *pvData)
 {
     if ( ISPTRVALID(pInterface, CInterface) ) {
-      if ( pInterface->IsA("CNIInterface") ) {
+      if ( pInterface->Is<CNIInterface>() ) {
         if ( pInterface->IsActive() ) {
           if ( ulHEM != 0 ) {
             unsigned short usDevError = 0;
@@ -349,7 +356,7 @@ int CNIDevice::ExecService(
     void           *pvData)
 {
     if ( ISPTRVALID(pInterface, CInterface) ) {
-      if ( pInterface->IsA("CNIInterface") ) {
+      if ( pInterface->Is<CNIInterface>() ) {
         if ( pInterface->IsActive() ) {
           if ( ulHEM != 0 ) {
             int iStatus = 0;
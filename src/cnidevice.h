@@ -49,6 +49,9 @@ protected:
     /** Class's name */
     static char strClassName[];
 public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_NIDEVICE | CDevice::TYPE_MASK };
+
     /* constructors */
     CNIDevice();
     CNIDevice(unsigned char  ucMID,
@@ -43,6 +43,7 @@ char CNIInterface::strClassName[] = "CNIInterface";
  * Initializes members accordingly.
  */
 CNIInterface::CNIInterface() : CInterface() {
+    ulTypeMask = TYPE_MASK;
     ucIntfID = 0;
     ulNIDNET_ID = 0;
 }
@@ -60,6 +61,7 @@ CNIInterface::CNIInterface(
     unsigned char ucBR,
     unsigned char ucIID)
 : CInterface(ucMID, 0, 0, ucBR) {
+    ulTypeMask = TYPE_MASK;
     ucIntfID = 0;
     SetIntfID(ucIID);
     ulNIDNET_ID = 0;
@@ -45,6 +45,9 @@ protected:
     /** Class's name */
     static char strClassName[];
 public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_NIINTERFACE | CInterface::TYPE_MASK };
+
     /* constructors */
     CNIInterface();
     CNIInterface(unsigned char ucMID, unsigned char ucBR, unsigned char ucIID);
@@ -24,6 +24,7 @@ char CNode::strClassName[] = "CNode";
  * Initializes all members accordingly.
  */
 CNode::CNode() : CIdentificator() {
+    ulTypeMask = TYPE_MASK;
     bActive = false;
     ucMacID = 0;
     ucConsumedConnSize = 0;
@@ -39,6 +40,7 @@ CNode::CNode() : CIdentificator() {
  * @param ucPCS Produced connection size of the node.
  */
 CNode::CNode(unsigned char ucMID, unsigned char ucCCS, unsigned char ucPCS) {
+    ulTypeMask = TYPE_MASK;
     bActive = false;
     ucMacID = 0;
     SetMacID(ucMID);
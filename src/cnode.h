@@ -42,6 +42,9 @@ protected:
     static unsigned long ulClassID;
     /** Class's name */
     static char strClassName[];
+public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_NODE | CIdentificator::TYPE_MASK };
 protected:
     /** Flag showing whether node is active or not. */
     bool bActive;
@@ -0,0 +1,675 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cscandevice.cpp           Type        : source            *
+ *  Description : CSocketCANDevice class implementation.                    *
+ ****************************************************************************/
+
+/**
+ * @file cscandevice.cpp
+ * @brief CSocketCANDevice class implementation.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmcan.h"
+#include "cscanintf.h"
+#include "cscandevice.h"
+
+/** No explicit transaction pending */
+#define DNM_EXPL_IDLE   0
+/** Waiting for explicit response */
+#define DNM_EXPL_WAIT   1
+/** Explicit response received */
+#define DNM_EXPL_DONE   2
+
+unsigned long CSocketCANDevice::ulClassID = 354;
+char CSocketCANDevice::strClassName[] = "CSocketCANDevice";
+
+/**
+ * @brief Default constructor
+ *
+ * Initializes members accordingly.
+ */
+CSocketCANDevice::CSocketCANDevice() : CDevice() {
+    ulTypeMask = TYPE_MASK;
+    Initialize();
+}
+
+/**
+ * @brief Constructor with parameters
+ *
+ * Initializes members from parameters.
+ * @param ucMID MAC ID of the device.
+ * @param ucCCS Consumed connection size of the device.
+ * @param ucPCS Produced connection size of the device.
+ * @param ucCT Connection type.
+ * @param usEPR Expected Packed Rate (EPR) from device.
+ * @param pIntf Pointer to a SocketCAN interface.
+ */
+CSocketCANDevice::CSocketCANDevice(
+    unsigned char  ucMID,
+    unsigned char  ucCCS,
+    unsigned char  ucPCS,
+    unsigned char  ucCT,
+    unsigned short usEPR,
+    CInterface     *pIntf)
+: CDevice(ucMID, ucCCS, ucPCS, ucCT, usEPR, pIntf) {
+    ulTypeMask = TYPE_MASK;
+    Initialize();
+}
+
+/**
+ * @brief Initializes members common to all constructors
+ */
+void CSocketCANDevice::Initialize(void) {
+    memset(aucInput, 0, sizeof(aucInput));
+    memset(aucOutput, 0, sizeof(aucOutput));
+    memset(&InAsm, 0, sizeof(InAsm));
+    memset(&ExplAsm, 0, sizeof(ExplAsm));
+    ullInputTime = 0;
+    ulInputs = 0;
+    ulExplState = DNM_EXPL_IDLE;
+    ulExplAcked = 0;
+    ucExplSrv = 0;
+    ucAllocChoice = 0;
+    DnmMutexInit(&IOLock);
+    DnmMutexInit(&ExplLock);
+}
+
+/**
+ * @brief Retrieves kernel receive time of the latest input
+ * @return Time in ns since the epoch or zero if nothing was received.
+ */
+DNM_UINT64 CSocketCANDevice::GetInputTime(void) const {
+    DNM_MUTEX  *pLock = const_cast<DNM_MUTEX *>(&IOLock);
+    DNM_UINT64 ullTime = 0;
+
+    DnmMutexLock(pLock);
+    ullTime = ullInputTime;
+    DnmMutexUnlock(pLock);
+
+    return ullTime;
+}
+
+/**
+ * @brief Retrieves number of inputs received since allocation
+ * @return The number.
+ */
+unsigned long CSocketCANDevice::GetInputCount(void) const {
+    DNM_MUTEX     *pLock = const_cast<DNM_MUTEX *>(&IOLock);
+    unsigned long ulCount = 0;
+
+    DnmMutexLock(pLock);
+    ulCount = ulInputs;
+    DnmMutexUnlock(pLock);
+
+    return ulCount;
+}
+
+/**
+ * @brief Maps connection type to allocation choice
+ *
+ * Change of state takes precedence over cyclic as both use the same
+ * connection instance.
+ * @return Allocation choice bits.
+ */
+unsigned char CSocketCANDevice::AllocChoice(void) const {
+    unsigned char ucChoice = DNM_CAN_ALLOC_EXPL;
+
+    if ( ucConnType & DEVICENET_CONN_POLLED )
+        ucChoice |= DNM_CAN_ALLOC_POLL;
+    if ( ucConnType & DEVICENET_CONN_STRBED )
+        ucChoice |= DNM_CAN_ALLOC_STROBE;
+    if ( ucConnType & DEVICENET_CONN_COS )
+        ucChoice |= DNM_CAN_ALLOC_COS;
+    else if ( ucConnType & DEVICENET_CONN_CYCLIC )
+        ucChoice |= DNM_CAN_ALLOC_CYCLIC;
+
+    return ucChoice;
+}
+
+/**
+ * @brief Checks preconditions of an operation
+ * @param strFunc Name of the operation.
+ * @param ppCanIntf Receives the interface.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::Check(const char *strFunc, CSocketCANInterface **ppCanIntf) {
+    if ( !ISPTRVALID(pInterface, CInterface) )
+        return SetError(ERR_INVPTR, ucMacID, "pInterface", pInterface);
+    if ( !pInterface->Is<CSocketCANInterface>() )
+        return SetError(ERR_INVITF, ucMacID, "CSocketCANInterface");
+    if ( !pInterface->IsActive() )
+        return SetError(ERR_INOPER, strFunc);
+    if ( !bActive )
+        return SetError(ERR_NOALOC, ucMacID);
+
+    *ppCanIntf = static_cast<CSocketCANInterface *>(pInterface);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Waits for a value set by the receiver thread
+ * @param pulVal Pointer to the value.
+ * @param ulVal Value to wait for (or greater).
+ * @param ulTimeout Timeout in ms.
+ * @return True if the value was reached, false on timeout.
+ */
+bool CSocketCANDevice::WaitExpl(volatile unsigned long *pulVal, unsigned long ulVal, unsigned long ulTimeout) {
+    unsigned long ulStart = DnmTimeMs();
+
+    while ( DnmAtomicLoad(pulVal) < ulVal ) {
+        if ( DnmTimeReached(DnmTimeMs(), ulStart + ulTimeout) )
+            return false;
+        DnmSleepUs(100);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Performs explicit request/response transaction
+ *
+ * Requests longer than a frame are sent fragment by fragment, waiting for
+ * the acknowledge of each. Fragmented responses are assembled and
+ * acknowledged by the receiver thread.
+ * @param pCanIntf The interface.
+ * @param ucMsgID Group 2 message ID of the request (#DNM_CAN_G2_EXPL_REQ
+ * or #DNM_CAN_G2_UNCON_REQ).
+ * @param pucReq Request body (service code and data).
+ * @param usReqLen Length of the request body.
+ * @param usRespSz Size of the response buffer.
+ * @param pvResp Receives response data (without service code) or NULL.
+ * @param pusRespLen Receives length of response data or NULL.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::Transact(
+    CSocketCANInterface *pCanIntf,
+    unsigned char       ucMsgID,
+    const unsigned char *pucReq,
+    unsigned short      usReqLen,
+    unsigned short      usRespSz,
+    void                *pvResp,
+    unsigned short      *pusRespLen)
+{
+    canid_t          Id      = DnmCanGroup2Id(ucMacID, ucMsgID);
+    unsigned char    ucHdr   = static_cast<unsigned char>(pCanIntf->GetMacID() & DNM_CAN_HDR_MAC);
+    int              iFrags  = DnmCanExplFragments(usReqLen);
+    unsigned long    ulTmout = pCanIntf->GetExplTimeout();
+    int              iErr    = ERR_NOERR;
+    struct can_frame Frame;
+
+    if ( iFrags > 64 ) {
+        char cBuf[8] = {0};
+        sprintf(cBuf, "%hu", usReqLen);
+        return SetError(ERR_INVFPRM, "usDataSz", cBuf, "Transact");
+    }
+
+    DnmMutexLock(&ExplLock);
+    ucExplSrv = pucReq[0];
+    DnmAtomicStore(&ulExplAcked, 0);
+    DnmAtomicStore(&ulExplState, DNM_EXPL_WAIT);
+
+    for ( int i = 0; i < iFrags && iErr == ERR_NOERR; i++ ) {
+        DnmCanExplFrame(Id, ucHdr, pucReq, usReqLen, i, &Frame);
+        iErr = pCanIntf->Send(&Frame, 1);
+        if ( iErr == ERR_NOERR && iFrags > 1 && !WaitExpl(&ulExplAcked, static_cast<unsigned long>(i + 1), ulTmout) )
+            iErr = SetError(ERR_EXPLCT, ucMacID, DERR_NO_RESP, 0);
+    }
+
+    if ( iErr == ERR_NOERR ) {
+        if ( !WaitExpl(&ulExplState, DNM_EXPL_DONE, ulTmout) )
+            iErr = SetError(ERR_EXPLCT, ucMacID, DERR_NO_RESP, 0);
+        else if ( (ExplAsm.aucBuf[0] & ~DNM_CAN_SRV_RESPONSE) == DNM_CAN_SRV_ERROR )
+            iErr = SetError(ERR_EXPLCT, ucMacID,
+                            ExplAsm.usLen > 1 ? ExplAsm.aucBuf[1] : DERR_VENDSPEC,
+                            ExplAsm.usLen > 2 ? ExplAsm.aucBuf[2] : 0);
+        else {
+            unsigned short usLen = static_cast<unsigned short>(ExplAsm.usLen - 1);
+
+            if ( pusRespLen != 0 )
+                *pusRespLen = usLen;
+            if ( pvResp != 0 )
+                memcpy(pvResp, &ExplAsm.aucBuf[1], usLen < usRespSz ? usLen : usRespSz);
+            if ( pvResp != 0 && usLen > usRespSz )
+                iErr = SetError(ERR_EXPLCT, ucMacID, DERR_DLBS, 0);
+            else
+                iErr = SetError(ERR_NOERR);
+        }
+    }
+
+    DnmAtomicStore(&ulExplState, DNM_EXPL_IDLE);
+    DnmMutexUnlock(&ExplLock);
+
+    return iErr;
+}
+
+/**
+ * @brief Sets Expected Packet Rate of a connection
+ * @param pCanIntf The interface.
+ * @param ucInst Connection instance.
+ * @param usMs Rate in ms. Zero disables inactivity timeout.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::SetEPRAttr(CSocketCANInterface *pCanIntf, unsigned char ucInst, unsigned short usMs) {
+    unsigned char aucReq[6];
+
+    aucReq[0] = DNM_CAN_SRV_SET_SINGLE;
+    aucReq[1] = DNM_CAN_CLS_CONNECTION;
+    aucReq[2] = ucInst;
+    aucReq[3] = DNM_CAN_ATTR_EPR;
+    aucReq[4] = static_cast<unsigned char>(usMs & 0xFF);
+    aucReq[5] = static_cast<unsigned char>(usMs >> 8);
+
+    return Transact(pCanIntf, DNM_CAN_G2_EXPL_REQ, aucReq, sizeof(aucReq), 0, 0, 0);
+}
+
+/**
+ * @brief Sends output on the change of state connection
+ * @param pCanIntf The interface.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::SendOutput(CSocketCANInterface *pCanIntf) {
+    struct can_frame aFrames[DNETMOD_CAN_TX_BATCH];
+    int              iCount = 0;
+
+    DnmMutexLock(&IOLock);
+    iCount = DnmCanIOFrames(DnmCanGroup2Id(ucMacID, DNM_CAN_G2_POLL_CMD), aucOutput, ucProducedConnSize,
+                            aFrames, DNETMOD_CAN_TX_BATCH);
+    DnmMutexUnlock(&IOLock);
+
+    return pCanIntf->Send(aFrames, iCount);
+}
+
+/**
+ * @brief Stores received input
+ *
+ * Called by the receiver thread of the interface.
+ * @param pCanIntf The interface.
+ * @param pFrame The frame.
+ * @param ullTimeNs Kernel receive time in ns since the epoch.
+ * @return True if the frame completed an input message, false if more
+ * fragments are expected or the frame was dropped.
+ */
+bool CSocketCANDevice::OnInput(CSocketCANInterface * /*pCanIntf*/, const struct can_frame *pFrame, DNM_UINT64 ullTimeNs) {
+    if ( DnmCanIOAssemble(&InAsm, pFrame, ucConsumedConnSize) != DNM_CAN_ASM_DONE )
+        return false;
+
+    DnmMutexLock(&IOLock);
+    memcpy(aucInput, InAsm.aucBuf, InAsm.usLen);
+    ullInputTime = ullTimeNs;
+    ulInputs++;
+    DnmMutexUnlock(&IOLock);
+    MarkCycle();
+
+    return true;
+}
+
+/**
+ * @brief Processes frame of explicit response
+ *
+ * Called by the receiver thread of the interface. Acknowledges fragments
+ * and completes the pending transaction.
+ * @param pCanIntf The interface.
+ * @param pFrame The frame.
+ */
+void CSocketCANDevice::OnExplicit(CSocketCANInterface *pCanIntf, const struct can_frame *pFrame) {
+    bool bFrag = pFrame->can_dlc >= 2 && (pFrame->data[0] & DNM_CAN_HDR_FRAG);
+
+    if ( DnmAtomicLoad(&ulExplState) != DNM_EXPL_WAIT )
+        return;
+
+    if ( bFrag && (pFrame->data[1] >> 6) == DNM_CAN_FRAG_ACK ) {
+        if ( pFrame->can_dlc >= 3 && pFrame->data[2] == 0 )
+            DnmAtomicStore(&ulExplAcked, (pFrame->data[1] & 0x3F) + 1UL);
+        return;
+    }
+
+    switch ( DnmCanExplAssemble(&ExplAsm, pFrame) ) {
+        case DNM_CAN_ASM_DONE:
+            if ( bFrag ) {
+                struct can_frame Ack;
+
+                DnmCanExplAck(DnmCanGroup2Id(ucMacID, DNM_CAN_G2_EXPL_REQ), pFrame->data[0] & DNM_CAN_HDR_MAC,
+                              pFrame->data[1] & 0x3F, &Ack);
+                pCanIntf->Transmit(&Ack, 1);
+            }
+            if ( ExplAsm.usLen > 0 &&
+                 ((ExplAsm.aucBuf[0] & ~DNM_CAN_SRV_RESPONSE) == ucExplSrv ||
+                  (ExplAsm.aucBuf[0] & ~DNM_CAN_SRV_RESPONSE) == DNM_CAN_SRV_ERROR) )
+                DnmAtomicStore(&ulExplState, DNM_EXPL_DONE);
+            break;
+        case DNM_CAN_ASM_MORE: {
+            struct can_frame Ack;
+
+            DnmCanExplAck(DnmCanGroup2Id(ucMacID, DNM_CAN_G2_EXPL_REQ), pFrame->data[0] & DNM_CAN_HDR_MAC,
+                          pFrame->data[1] & 0x3F, &Ack);
+            pCanIntf->Transmit(&Ack, 1);
+        }
+        break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Checks if class can identify itself with the specified number.
+ *
+ * If not then passes the check to the base class.
+ * @param ulCompareID ID to be compared.
+ * @return True when match otherwise false.
+ */
+bool CSocketCANDevice::IsA(unsigned long ulCompareID) const {
+    return ( ulCompareID == ulClassID ) ? true : CDevice::IsA(ulCompareID);
+}
+
+/**
+ * @brief Checks if class can identify itself with the specified name.
+ *
+ * If not then passes the check to the base class.
+ * @param strCompareName Name to be compared.
+ * @return True when match otherwise false.
+ */
+bool CSocketCANDevice::IsA(const char *strCompareName) const {
+    return ( !strcmp(strClassName, strCompareName) ) ? true : CDevice::IsA(strCompareName);
+}
+
+/**
+ * @brief Allocates the device
+ *
+ * Sends Allocate_Master/Slave_Connection_Set through the unconnected port
+ * of the device, disables the inactivity timeout of the explicit
+ * connection and sets the Expected Packet Rate of the I/O connections.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::Allocate(unsigned char /*ucFlags*/) {
+    CSocketCANInterface *pCanIntf = 0;
+    unsigned char       aucReq[5];
+    unsigned char       ucFormat  = 0;
+    int                 iErr      = 0;
+
+    if ( !ISPTRVALID(pInterface, CInterface) )
+        return SetError(ERR_INVPTR, ucMacID, "pInterface", pInterface);
+    if ( !pInterface->Is<CSocketCANInterface>() )
+        return SetError(ERR_INVITF, ucMacID, "CSocketCANInterface");
+    if ( !pInterface->IsActive() )
+        return SetError(ERR_INOPER, "Allocate");
+    if ( bActive )
+        return SetError(ERR_NOERR);
+
+    pCanIntf = static_cast<CSocketCANInterface *>(pInterface);
+    iErr = pCanIntf->Claim(this);
+    if ( iErr != ERR_NOERR )
+        return iErr;
+
+    ucAllocChoice = AllocChoice();
+    aucReq[0] = DNM_CAN_SRV_ALLOCATE;
+    aucReq[1] = DNM_CAN_CLS_DEVICENET;
+    aucReq[2] = 1;
+    aucReq[3] = ucAllocChoice;
+    aucReq[4] = pCanIntf->GetMacID();
+    iErr = Transact(pCanIntf, DNM_CAN_G2_UNCON_REQ, aucReq, sizeof(aucReq), 1, &ucFormat, 0);
+    if ( iErr != ERR_NOERR ) {
+        pCanIntf->Release(this);
+        ucAllocChoice = 0;
+        return iErr;
+    }
+
+    iErr = SetEPRAttr(pCanIntf, DNM_CAN_INST_EXPL, 0);
+    if ( iErr == ERR_NOERR && (ucAllocChoice & DNM_CAN_ALLOC_POLL) )
+        iErr = SetEPRAttr(pCanIntf, DNM_CAN_INST_POLL, usEPR);
+    if ( iErr == ERR_NOERR && (ucAllocChoice & DNM_CAN_ALLOC_STROBE) )
+        iErr = SetEPRAttr(pCanIntf, DNM_CAN_INST_STROBE, usEPR);
+    if ( iErr == ERR_NOERR && (ucAllocChoice & (DNM_CAN_ALLOC_COS | DNM_CAN_ALLOC_CYCLIC)) )
+        iErr = SetEPRAttr(pCanIntf, DNM_CAN_INST_COS, usEPR);
+
+    if ( iErr != ERR_NOERR ) {
+        unsigned char    aucRel[4] = { DNM_CAN_SRV_RELEASE, DNM_CAN_CLS_DEVICENET, 1, ucAllocChoice };
+        struct can_frame Frame;
+
+        /* Release without waiting, so the error message is kept */
+        DnmCanExplFrame(DnmCanGroup2Id(ucMacID, DNM_CAN_G2_UNCON_REQ), pCanIntf->GetMacID(),
+                        aucRel, sizeof(aucRel), 0, &Frame);
+        pCanIntf->Transmit(&Frame, 1);
+        pCanIntf->Release(this);
+        ucAllocChoice = 0;
+        return iErr;
+    }
+
+    bActive = true;
+    Register();
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Unallocates the device
+ *
+ * Sends Release_Master/Slave_Connection_Set if the interface is active.
+ * The device is unallocated by the module even if the release fails.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::Unallocate(void) {
+    CSocketCANInterface *pCanIntf = 0;
+    int                 iErr      = ERR_NOERR;
+
+    if ( !bActive )
+        return SetError(ERR_NOALOC, ucMacID);
+
+    if ( ISPTRVALID(pInterface, CInterface) && pInterface->Is<CSocketCANInterface>() ) {
+        pCanIntf = static_cast<CSocketCANInterface *>(pInterface);
+        if ( pCanIntf->IsActive() ) {
+            unsigned char aucReq[4] = { DNM_CAN_SRV_RELEASE, DNM_CAN_CLS_DEVICENET, 1, ucAllocChoice };
+
+            iErr = Transact(pCanIntf, DNM_CAN_G2_UNCON_REQ, aucReq, sizeof(aucReq), 0, 0, 0);
+        }
+        pCanIntf->Release(this);
+    }
+
+    ucAllocChoice = 0;
+    bActive = false;
+    Unregister();
+    BreakCycle();
+
+    return iErr == ERR_NOERR ? SetError(ERR_NOERR) : iErr;
+}
+
+/**
+ * @brief Reads the latest input of the device
+ * @param ulBufSz Size of the buffer.
+ * @param pvBuf Pointer to the buffer.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::ReadIOData(unsigned long ulBufSz, void *pvBuf) {
+    CSocketCANInterface *pCanIntf = 0;
+    int                 iErr = Check("ReadIOData", &pCanIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+    if ( pvBuf == 0 )
+        return SetError(ERR_INVFPRM, "pvBuf", "NULL", "ReadIOData");
+
+    DnmMutexLock(&IOLock);
+    memcpy(pvBuf, aucInput, ulBufSz < ucConsumedConnSize ? ulBufSz : ucConsumedConnSize);
+    DnmMutexUnlock(&IOLock);
+    if ( ulBufSz < ucConsumedConnSize ) {
+        char cBuf[24] = {0};
+        sprintf(cBuf, "%lu", ulBufSz);
+        return SetError(ERR_INVFPRM, "ulBufSz", cBuf, "ReadIOData");
+    }
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Writes output of the device
+ *
+ * Output is sent on the next CSocketCANInterface::Scan or right away when
+ * it changed on a change of state connection.
+ * @param ulBufSz Size of the buffer. Must equal produced connection size.
+ * @param pvBuf Pointer to the buffer.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::WriteIOData(unsigned long ulBufSz, void *pvBuf) {
+    CSocketCANInterface *pCanIntf = 0;
+    bool                bChanged  = false;
+    int                 iErr = Check("WriteIOData", &pCanIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+    if ( ulBufSz != ucProducedConnSize || (pvBuf == 0 && ulBufSz != 0) ) {
+        char cBuf[24] = {0};
+        sprintf(cBuf, "%lu", ulBufSz);
+        return SetError(ERR_INVFPRM, "ulBufSz", cBuf, "WriteIOData");
+    }
+
+    DnmMutexLock(&IOLock);
+    bChanged = memcmp(aucOutput, pvBuf, ulBufSz) != 0;
+    memcpy(aucOutput, pvBuf, ulBufSz);
+    DnmMutexUnlock(&IOLock);
+
+    if ( bChanged && (ucAllocChoice & DNM_CAN_ALLOC_COS) )
+        return SendOutput(pCanIntf);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Reads attribute with Get_Attribute_Single service
+ * @param usClsId Class identifier of the attribute.
+ * @param usInstId Instance identifier of the attribute.
+ * @param ucAttrId Attribute identifier.
+ * @param usDataSz Length in bytes of the attribute data.
+ * @param pvData Pointer to a buffer where to copy attribute data.
+ * @param pusActDataSz Actual size of the attribute data in bytes.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::GetAttribute(
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned char  ucAttrId,
+    unsigned short usDataSz,
+    void           *pvData,
+    unsigned short *pusActDataSz)
+{
+    CSocketCANInterface *pCanIntf = 0;
+    unsigned char       aucReq[4];
+    int                 iErr = Check("GetAttribute", &pCanIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+    if ( usClsId > 0xFF || usInstId > 0xFF ) /* 8/8 message body format */
+        return SetError(ERR_INVFPRM, "usClsId/usInstId", "> 255", "GetAttribute");
+
+    aucReq[0] = DNM_CAN_SRV_GET_SINGLE;
+    aucReq[1] = static_cast<unsigned char>(usClsId);
+    aucReq[2] = static_cast<unsigned char>(usInstId);
+    aucReq[3] = ucAttrId;
+
+    return Transact(pCanIntf, DNM_CAN_G2_EXPL_REQ, aucReq, sizeof(aucReq), usDataSz, pvData, pusActDataSz);
+}
+
+/**
+ * @brief Writes attribute with Set_Attribute_Single service
+ * @param usClsId Class identifier of the parameter.
+ * @param usInstId Instance identifier of the parameter.
+ * @param ucAttrId Parameter identifier.
+ * @param usDataSz Size of parameter's data in bytes.
+ * @param pvData Pointer to parameter's data.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::SetAttribute(
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned char  ucAttrId,
+    unsigned short usDataSz,
+    void           *pvData)
+{
+    CSocketCANInterface *pCanIntf = 0;
+    unsigned char       aucReq[DNM_CAN_MSG_MAX];
+    int                 iErr = Check("SetAttribute", &pCanIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+    if ( usClsId > 0xFF || usInstId > 0xFF )
+        return SetError(ERR_INVFPRM, "usClsId/usInstId", "> 255", "SetAttribute");
+    if ( usDataSz > sizeof(aucReq) - 4 || (pvData == 0 && usDataSz != 0) ) {
+        char cBuf[8] = {0};
+        sprintf(cBuf, "%hu", usDataSz);
+        return SetError(ERR_INVFPRM, "usDataSz", cBuf, "SetAttribute");
+    }
+
+    aucReq[0] = DNM_CAN_SRV_SET_SINGLE;
+    aucReq[1] = static_cast<unsigned char>(usClsId);
+    aucReq[2] = static_cast<unsigned char>(usInstId);
+    aucReq[3] = ucAttrId;
+    if ( usDataSz > 0 )
+        memcpy(&aucReq[4], pvData, usDataSz);
+
+    return Transact(pCanIntf, DNM_CAN_G2_EXPL_REQ, aucReq, static_cast<unsigned short>(usDataSz + 4), 0, 0, 0);
+}
+
+/**
+ * @brief Executes service on the device
+ * @param ucSrvCode Service code.
+ * @param usClsId Class identifier of the service.
+ * @param usInstId Instance identifier of the service.
+ * @param usDataSz Size of service's data in bytes.
+ * @param pvData Pointer to service's data.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::ExecService(
+    unsigned char  ucSrvCode,
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned short usDataSz,
+    void           *pvData)
+{
+    CSocketCANInterface *pCanIntf = 0;
+    unsigned char       aucReq[DNM_CAN_MSG_MAX];
+    int                 iErr = Check("ExecService", &pCanIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+    if ( usClsId > 0xFF || usInstId > 0xFF )
+        return SetError(ERR_INVFPRM, "usClsId/usInstId", "> 255", "ExecService");
+    if ( usDataSz > sizeof(aucReq) - 3 || (pvData == 0 && usDataSz != 0) ) {
+        char cBuf[8] = {0};
+        sprintf(cBuf, "%hu", usDataSz);
+        return SetError(ERR_INVFPRM, "usDataSz", cBuf, "ExecService");
+    }
+
+    aucReq[0] = static_cast<unsigned char>(ucSrvCode & ~DNM_CAN_SRV_RESPONSE);
+    aucReq[1] = static_cast<unsigned char>(usClsId);
+    aucReq[2] = static_cast<unsigned char>(usInstId);
+    if ( usDataSz > 0 )
+        memcpy(&aucReq[3], pvData, usDataSz);
+
+    return Transact(pCanIntf, DNM_CAN_G2_EXPL_REQ, aucReq, static_cast<unsigned short>(usDataSz + 3), 0, 0, 0);
+}
+
+/**
+ * @brief Executes Reset service of the Identity object
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANDevice::Reset(void) {
+    return ExecService(DNM_CAN_SRV_RESET, DNM_CAN_CLS_IDENTITY, 1, 0, 0);
+}
+
+/**
+ * @brief Destructor
+ *
+ * Unallocates device if active.
+ */
+CSocketCANDevice::~CSocketCANDevice() {
+    if ( bActive )
+        Unallocate();
+    DnmMutexDestroy(&ExplLock);
+    DnmMutexDestroy(&IOLock);
+}
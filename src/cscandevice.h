@@ -0,0 +1,136 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cscandevice.h             Type        : header            *
+ *  Description : CSocketCANDevice class declaration.                       *
+ ****************************************************************************/
+
+/**
+ * @file cscandevice.h
+ * @brief CSocketCANDevice class declaration.
+ */
+
+#ifndef CSCANDEVICE_H
+#define CSCANDEVICE_H 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File cscandevice.h requires c++ compiler."
+#endif
+
+#include "cdevice.h"
+#include "dnmos.h"
+#include "dnmcan.h"
+
+class CSocketCANInterface;
+
+/**
+ * @brief Represents a slave device on a SocketCAN network
+ *
+ * Allocate allocates the Predefined Master/Slave Connection Set with
+ * explicit messaging and the I/O connections of the connection type and
+ * sets their Expected Packet Rate. Inputs are stored by the receiver
+ * thread of the interface as they arrive, ReadIOData returns the latest
+ * one. Outputs written with WriteIOData are sent by
+ * CSocketCANInterface::Scan for polled, strobed and cyclic connections and
+ * right away for change of state connections. Explicit messages longer than
+ * a frame are fragmented in both directions.
+ * @remark Copy constructor and assignment operator not supported for
+ * this class.
+ */
+class DNETMOD_API CSocketCANDevice : public CDevice {
+private:
+    /** Latest input */
+    unsigned char aucInput[DNM_CAN_MSG_MAX];
+    /** Latest output */
+    unsigned char aucOutput[DNM_CAN_MSG_MAX];
+    /** Kernel receive time of the latest input in ns since the epoch */
+    DNM_UINT64 ullInputTime;
+    /** Number of received inputs */
+    unsigned long ulInputs;
+    /** Guards input and output */
+    DNM_MUTEX IOLock;
+    /** Assembly of fragmented input */
+    DNM_CAN_ASM InAsm;
+    /** Serializes explicit transactions */
+    DNM_MUTEX ExplLock;
+    /** Assembly of explicit response */
+    DNM_CAN_ASM ExplAsm;
+    /** State of explicit transaction */
+    volatile unsigned long ulExplState;
+    /** Number of acknowledged request fragments */
+    volatile unsigned long ulExplAcked;
+    /** Service code of the pending request */
+    unsigned char ucExplSrv;
+    /** Allocation choice in effect */
+    unsigned char ucAllocChoice;
+private:
+    CSocketCANDevice(const CSocketCANDevice&);
+    CSocketCANDevice& operator =(const CSocketCANDevice&);
+    void Initialize(void);
+    int Check(const char *strFunc, CSocketCANInterface **ppCanIntf);
+    int Transact(CSocketCANInterface *pCanIntf,
+                 unsigned char       ucMsgID,
+                 const unsigned char *pucReq,
+                 unsigned short      usReqLen,
+                 unsigned short      usRespSz,
+                 void                *pvResp,
+                 unsigned short      *pusRespLen);
+    bool WaitExpl(volatile unsigned long *pulVal, unsigned long ulVal, unsigned long ulTimeout);
+    int SetEPRAttr(CSocketCANInterface *pCanIntf, unsigned char ucInst, unsigned short usMs);
+    int SendOutput(CSocketCANInterface *pCanIntf);
+    bool OnInput(CSocketCANInterface *pCanIntf, const struct can_frame *pFrame, DNM_UINT64 ullTimeNs);
+    void OnExplicit(CSocketCANInterface *pCanIntf, const struct can_frame *pFrame);
+    unsigned char AllocChoice(void) const;
+protected:
+    /** Class's ID */
+    static unsigned long ulClassID;
+    /** Class's name */
+    static char strClassName[];
+    friend class CSocketCANInterface;
+public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_SCANDEVICE | CDevice::TYPE_MASK };
+
+    /* constructors */
+    CSocketCANDevice();
+    CSocketCANDevice(unsigned char  ucMID,
+                     unsigned char  ucCCS,
+                     unsigned char  ucPCS,
+                     unsigned char  ucCT,
+                     unsigned short usEPR,
+                     CInterface     *pIntf);
+    /* get/set */
+    DNM_UINT64 GetInputTime(void) const;
+    unsigned long GetInputCount(void) const;
+    /* overrides */
+    virtual bool IsA(unsigned long ulCompareID) const;
+    virtual bool IsA(const char *strCompareName) const;
+    virtual int Allocate(unsigned char ucFlags = 0);
+    virtual int Unallocate(void);
+    virtual int ReadIOData(unsigned long ulBufSz, void *pvBuf);
+    virtual int WriteIOData(unsigned long ulBufSz, void *pvBuf);
+    virtual int GetAttribute(unsigned short usClsId,
+                             unsigned short usInstId,
+                             unsigned char  ucAttrId,
+                             unsigned short usDataSz,
+                             void           *pvData,
+                             unsigned short *pusActDataSz);
+    virtual int SetAttribute(unsigned short usClsId,
+                             unsigned short usInstId,
+                             unsigned char  ucAttrId,
+                             unsigned short usDataSz,
+                             void           *pvData);
+    virtual int ExecService(unsigned char  ucSrvCode,
+                            unsigned short usClsId,
+                            unsigned short usInstId,
+                            unsigned short usDataSz,
+                            void           *pvData);
+    virtual int Reset(void);
+    /* destructor */
+    virtual ~CSocketCANDevice();
+};
+
+#endif /* cscandevice.h */
@@ -0,0 +1,618 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cscanintf.cpp             Type        : source            *
+ *  Description : CSocketCANInterface class implementation.                 *
+ ****************************************************************************/
+
+/**
+ * @file cscanintf.cpp
+ * @brief CSocketCANInterface class implementation.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmcan.h"
+#include "cscanintf.h"
+#include "cscandevice.h"
+
+unsigned long CSocketCANInterface::ulClassID = 404;
+char CSocketCANInterface::strClassName[] = "CSocketCANInterface";
+
+/**
+ * @brief Default constructor
+ *
+ * Initializes members accordingly. Network interface is can0.
+ */
+CSocketCANInterface::CSocketCANInterface() : CInterface() {
+    ulTypeMask = TYPE_MASK;
+    Initialize("can0");
+}
+
+/**
+ * @brief Constructor with parameters
+ *
+ * Initializes members from parameters.
+ * @param strIf Name of the network interface (e.g. can0 or vcan0).
+ * @param ucMID MAC ID of the interface node.
+ * @param ucCCS Consumed connection size of the interface node.
+ * @param ucPCS Produced connection size of the interface node.
+ * @param ucBR Baud rate. Informational only.
+ */
+CSocketCANInterface::CSocketCANInterface(
+    const char    *strIf,
+    unsigned char ucMID,
+    unsigned char ucCCS,
+    unsigned char ucPCS,
+    unsigned char ucBR)
+: CInterface(ucMID, ucCCS, ucPCS, ucBR) {
+    ulTypeMask = TYPE_MASK;
+    Initialize(strIf);
+}
+
+/**
+ * @brief Initializes members common to all constructors
+ * @param strIf Name of the network interface.
+ */
+void CSocketCANInterface::Initialize(const char *strIf) {
+    memset(strIfName, 0, sizeof(strIfName));
+    if ( strIf != 0 )
+        strncpy(strIfName, strIf, sizeof(strIfName) - 1);
+    iSocket = -1;
+    ulRxRunning = 0;
+    ulDupMac = 0;
+    ulClaiming = 0;
+    usVendId = 0;
+    ulSerial = 0;
+    ulExplTimeout = DNETMOD_CAN_EXPL_TIMEOUT;
+    for ( int i = 0; i < DEVICENET_MAX_DEVICES; i++ )
+        apDevs[i] = 0;
+    DnmMutexInit(&DevLock);
+}
+
+/**
+ * @brief Sets name of the network interface
+ * @param strIf The name.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANInterface::SetIfName(const char *strIf) {
+    if ( bActive )
+        return SetError(ERR_IOPER, "SetIfName");
+    if ( strIf == 0 || strlen(strIf) >= sizeof(strIfName) )
+        return SetError(ERR_INVFPRM, "strIf", strIf == 0 ? "NULL" : strIf, "SetIfName");
+
+    memset(strIfName, 0, sizeof(strIfName));
+    strncpy(strIfName, strIf, sizeof(strIfName) - 1);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Sets identity sent in Duplicate MAC ID Check messages
+ * @param usVendId_ Vendor ID.
+ * @param ulSerial_ Serial number.
+ */
+void CSocketCANInterface::SetIdentity(unsigned short usVendId_, unsigned long ulSerial_) {
+    usVendId = usVendId_;
+    ulSerial = ulSerial_;
+}
+
+/**
+ * @brief Sets timeout of explicit messaging
+ *
+ * Applies to each response and fragment acknowledge awaited from devices.
+ * @param ulMs Timeout in ms.
+ */
+void CSocketCANInterface::SetExplTimeout(unsigned long ulMs) {
+    ulExplTimeout = ulMs;
+}
+
+/**
+ * @brief Reserves MAC ID of a device
+ * @param pDev The device.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANInterface::Claim(CSocketCANDevice *pDev) {
+    unsigned char ucMID = pDev->GetMacID();
+    int           iErr  = 0;
+
+    if ( ucMID >= DEVICENET_MAX_DEVICES ) {
+        char cBuf[4] = {0};
+        sprintf(cBuf, "%d", ucMID);
+        return SetError(ERR_INVFPRM, "ucMacID", cBuf, "Allocate");
+    }
+
+    DnmMutexLock(&DevLock);
+    if ( ucMID == ucMacID || (apDevs[ucMID] != 0 && apDevs[ucMID] != pDev) )
+        iErr = SetError(ERR_DUPMAC, ucMID);
+    else {
+        apDevs[ucMID] = pDev;
+        iErr = SetError(ERR_NOERR);
+    }
+    DnmMutexUnlock(&DevLock);
+
+    return iErr;
+}
+
+/**
+ * @brief Releases MAC ID of a device
+ *
+ * After return the receiver thread no longer dispatches frames to it.
+ * @param pDev The device.
+ */
+void CSocketCANInterface::Release(CSocketCANDevice *pDev) {
+    unsigned char ucMID = pDev->GetMacID();
+
+    DnmMutexLock(&DevLock);
+    if ( ucMID < DEVICENET_MAX_DEVICES && apDevs[ucMID] == pDev )
+        apDevs[ucMID] = 0;
+    DnmMutexUnlock(&DevLock);
+}
+
+/**
+ * @brief Sends frames in batches
+ *
+ * Waits shortly and retries while the transmit queue of the network
+ * interface is full. Doesn't touch the error message, so it's safe to use
+ * from the receiver thread.
+ * @param aFrames The frames.
+ * @param iCount Number of frames.
+ * @return Zero on success, errno otherwise.
+ */
+int CSocketCANInterface::Transmit(const struct can_frame *aFrames, int iCount) {
+    struct mmsghdr aMsgs[DNETMOD_CAN_TX_BATCH];
+    struct iovec   aIov[DNETMOD_CAN_TX_BATCH];
+    int            iSent  = 0;
+    int            iRetry = 0;
+
+    while ( iSent < iCount ) {
+        int iBatch = iCount - iSent < DNETMOD_CAN_TX_BATCH ? iCount - iSent : DNETMOD_CAN_TX_BATCH;
+        int iRes   = 0;
+
+        memset(aMsgs, 0, sizeof(aMsgs[0]) * iBatch);
+        for ( int i = 0; i < iBatch; i++ ) {
+            aIov[i].iov_base = const_cast<struct can_frame *>(&aFrames[iSent + i]);
+            aIov[i].iov_len = sizeof(struct can_frame);
+            aMsgs[i].msg_hdr.msg_iov = &aIov[i];
+            aMsgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        iRes = sendmmsg(iSocket, aMsgs, iBatch, 0);
+        if ( iRes < 0 ) {
+            if ( (errno == ENOBUFS || errno == EAGAIN || errno == EINTR) && iRetry++ < 100 ) {
+                DnmSleepUs(1000);
+                continue;
+            }
+            return errno;
+        }
+        iSent += iRes;
+        iRetry = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Sends frames
+ * @param aFrames The frames.
+ * @param iCount Number of frames.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANInterface::Send(const struct can_frame *aFrames, int iCount) {
+    int iErrNo = Transmit(aFrames, iCount);
+
+    if ( iErrNo != 0 )
+        return SetError(ERR_SOCKET, "Send", iErrNo);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Sends Duplicate MAC ID Check message
+ * @param bResponse True for response, false for request.
+ * @return Zero on success, errno otherwise.
+ */
+int CSocketCANInterface::SendDupMac(bool bResponse) {
+    struct can_frame Frame;
+    unsigned char    aucData[7];
+
+    aucData[0] = bResponse ? DNM_CAN_DUPMAC_RESP : 0; /* physical port 0 */
+    aucData[1] = static_cast<unsigned char>(usVendId & 0xFF);
+    aucData[2] = static_cast<unsigned char>(usVendId >> 8);
+    for ( int i = 0; i < 4; i++ )
+        aucData[3 + i] = static_cast<unsigned char>((ulSerial >> (8 * i)) & 0xFF);
+    DnmCanFrame(&Frame, DnmCanGroup2Id(ucMacID, DNM_CAN_G2_DUPMAC), aucData, sizeof(aucData));
+
+    return Transmit(&Frame, 1);
+}
+
+/**
+ * @brief Receiver thread function
+ * @param pvThis Pointer to the interface.
+ * @return Always zero.
+ */
+DNM_THREAD_RET DNM_THREAD_CC CSocketCANInterface::ReceiverProc(void *pvThis) {
+    static_cast<CSocketCANInterface *>(pvThis)->Receive();
+
+    return 0;
+}
+
+/**
+ * @brief Receives frames until the receiver is stopped
+ *
+ * Frames are taken in batches of up to #DNETMOD_CAN_RX_BATCH with their
+ * kernel receive timestamps and dispatched under the device lock, so
+ * devices can't be released while a batch is processed. Acknowledges are
+ * sent after the lock is released.
+ */
+void CSocketCANInterface::Receive(void) {
+    struct mmsghdr   aMsgs[DNETMOD_CAN_RX_BATCH];
+    struct iovec     aIov[DNETMOD_CAN_RX_BATCH];
+    struct can_frame aFrames[DNETMOD_CAN_RX_BATCH];
+    struct can_frame aAcks[DNETMOD_CAN_RX_BATCH];
+    char             aCtrl[DNETMOD_CAN_RX_BATCH][CMSG_SPACE(sizeof(struct timespec))];
+
+    while ( DnmAtomicLoad(&ulRxRunning) ) {
+        struct pollfd Pfd;
+        int           iCount = 0;
+        int           iAcks  = 0;
+
+        Pfd.fd = iSocket;
+        Pfd.events = POLLIN;
+        Pfd.revents = 0;
+        if ( poll(&Pfd, 1, 100) <= 0 )
+            continue;
+
+        memset(aMsgs, 0, sizeof(aMsgs));
+        for ( int i = 0; i < DNETMOD_CAN_RX_BATCH; i++ ) {
+            aIov[i].iov_base = &aFrames[i];
+            aIov[i].iov_len = sizeof(aFrames[i]);
+            aMsgs[i].msg_hdr.msg_iov = &aIov[i];
+            aMsgs[i].msg_hdr.msg_iovlen = 1;
+            aMsgs[i].msg_hdr.msg_control = aCtrl[i];
+            aMsgs[i].msg_hdr.msg_controllen = sizeof(aCtrl[i]);
+        }
+
+        iCount = recvmmsg(iSocket, aMsgs, DNETMOD_CAN_RX_BATCH, MSG_DONTWAIT, 0);
+        if ( iCount <= 0 )
+            continue;
+
+        DnmMutexLock(&DevLock);
+        for ( int i = 0; i < iCount; i++ ) {
+            DNM_UINT64     ullTimeNs = 0;
+            struct cmsghdr *pCmsg    = 0;
+
+            if ( aMsgs[i].msg_len < sizeof(struct can_frame) )
+                continue;
+            for ( pCmsg = CMSG_FIRSTHDR(&aMsgs[i].msg_hdr); pCmsg != 0; pCmsg = CMSG_NXTHDR(&aMsgs[i].msg_hdr, pCmsg) ) {
+                if ( pCmsg->cmsg_level == SOL_SOCKET && pCmsg->cmsg_type == SCM_TIMESTAMPNS ) {
+                    struct timespec Ts;
+                    memcpy(&Ts, CMSG_DATA(pCmsg), sizeof(Ts));
+                    ullTimeNs = static_cast<DNM_UINT64>(Ts.tv_sec) * 1000000000ULL + static_cast<DNM_UINT64>(Ts.tv_nsec);
+                }
+            }
+            if ( Dispatch(&aFrames[i], ullTimeNs, &aAcks[iAcks]) )
+                iAcks++;
+        }
+        DnmMutexUnlock(&DevLock);
+
+        if ( iAcks > 0 )
+            Transmit(aAcks, iAcks);
+    }
+}
+
+/**
+ * @brief Dispatches a received frame
+ *
+ * Called by the receiver thread with the device lock held. Change of
+ * state and cyclic messages of slaves are acknowledged by the master once
+ * per message, i.e. on the last fragment of a fragmented message.
+ * @param pFrame The frame.
+ * @param ullTimeNs Kernel receive time in ns since the epoch.
+ * @param pAck Frame receiving the acknowledge to be sent.
+ * @return True if the acknowledge should be sent, false otherwise.
+ */
+bool CSocketCANInterface::Dispatch(
+    const struct can_frame *pFrame,
+    DNM_UINT64             ullTimeNs,
+    struct can_frame       *pAck)
+{
+    unsigned char    ucGroup = 0;
+    unsigned char    ucMID   = 0;
+    unsigned char    ucMsgID = 0;
+    CSocketCANDevice *pDev   = 0;
+
+    if ( !DnmCanParseId(pFrame->can_id, &ucGroup, &ucMID, &ucMsgID) )
+        return false;
+
+    if ( ucGroup == 2 && ucMsgID == DNM_CAN_G2_DUPMAC ) {
+        if ( ucMID != ucMacID )
+            return false;
+        /* Another node uses our MAC ID. Defend it once we are on-line. */
+        if ( DnmAtomicLoad(&ulClaiming) || (pFrame->can_dlc > 0 && (pFrame->data[0] & DNM_CAN_DUPMAC_RESP)) )
+            DnmAtomicStore(&ulDupMac, 1);
+        else
+            SendDupMac(true);
+        return false;
+    }
+
+    pDev = apDevs[ucMID];
+    if ( pDev == 0 )
+        return false;
+
+    if ( ucGroup == 1 ) {
+        switch ( ucMsgID ) {
+            case DNM_CAN_G1_COS_CYC:
+                if ( pDev->OnInput(this, pFrame, ullTimeNs) &&
+                     (pDev->ucAllocChoice & (DNM_CAN_ALLOC_COS | DNM_CAN_ALLOC_CYCLIC)) ) {
+                    DnmCanFrame(pAck, DnmCanGroup2Id(ucMID, DNM_CAN_G2_COS_ACK), 0, 0);
+                    return true;
+                }
+                break;
+            case DNM_CAN_G1_STROBE_RESP:
+                pDev->OnInput(this, pFrame, ullTimeNs);
+                break;
+            case DNM_CAN_G1_POLL_RESP:
+                /* Otherwise acknowledge of our change of state output */
+                if ( pDev->ucAllocChoice & DNM_CAN_ALLOC_POLL )
+                    pDev->OnInput(this, pFrame, ullTimeNs);
+                break;
+            default:
+                break;
+        }
+    }
+    else if ( ucMsgID == DNM_CAN_G2_EXPL_RESP )
+        pDev->OnExplicit(this, pFrame);
+
+    return false;
+}
+
+/**
+ * @brief Stops receiver thread
+ */
+void CSocketCANInterface::StopReceiver(void) {
+    if ( DnmAtomicLoad(&ulRxRunning) ) {
+        DnmAtomicStore(&ulRxRunning, 0);
+        DnmThreadJoin(hReceiver);
+    }
+}
+
+/**
+ * @brief Checks if class can identify itself with the specified number.
+ *
+ * If not then passes the check to the base class.
+ * @param ulCompareID ID to be compared.
+ * @return True when match otherwise false.
+ */
+bool CSocketCANInterface::IsA(unsigned long ulCompareID) const {
+    return ( ulCompareID == ulClassID ) ? true : CInterface::IsA(ulCompareID);
+}
+
+/**
+ * @brief Checks if class can identify itself with the specified name.
+ *
+ * If not then passes the check to the base class.
+ * @param strCompareName Name to be compared.
+ * @return True when match otherwise false.
+ */
+bool CSocketCANInterface::IsA(const char *strCompareName) const {
+    return ( !strcmp(strClassName, strCompareName) ) ? true : CInterface::IsA(strCompareName);
+}
+
+/**
+ * @brief Opens the network interface and goes on-line
+ *
+ * Binds a raw CAN socket to the network interface, starts the receiver
+ * thread and sends the Duplicate MAC ID Check request twice, waiting
+ * #DNETMOD_CAN_DUPMAC_TIMEOUT ms for a response after each. Fails with
+ * <code>ERR_DUPMAC</code> if another node uses the MAC ID.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANInterface::Open(void) {
+    struct ifreq        Ifr;
+    struct sockaddr_can Addr;
+    struct can_filter   aFilters[2];
+    int                 iOn = 1;
+    int                 iErrNo = 0;
+
+    if ( bActive )
+        return SetError(ERR_IOPER, "Open");
+
+    if ( ucMacID >= DEVICENET_MAX_DEVICES ) {
+        char cBuf[4] = {0};
+        sprintf(cBuf, "%d", ucMacID);
+        return SetError(ERR_INVFPRM, "ucMacID", cBuf, "Open");
+    }
+
+    iSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if ( iSocket < 0 )
+        return SetError(ERR_SOCKET, "Open", errno);
+
+    memset(&Ifr, 0, sizeof(Ifr));
+    strncpy(Ifr.ifr_name, strIfName, IFNAMSIZ - 1);
+    memset(&Addr, 0, sizeof(Addr));
+    Addr.can_family = AF_CAN;
+    /* Group 1 and Group 2 data frames only */
+    aFilters[0].can_id = 0x000;
+    aFilters[0].can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG | 0x400;
+    aFilters[1].can_id = 0x400;
+    aFilters[1].can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG | 0x600;
+
+    if ( ioctl(iSocket, SIOCGIFINDEX, &Ifr) < 0 )
+        iErrNo = errno;
+    else {
+        Addr.can_ifindex = Ifr.ifr_ifindex;
+        if ( bind(iSocket, reinterpret_cast<struct sockaddr *>(&Addr), sizeof(Addr)) < 0 ||
+             setsockopt(iSocket, SOL_SOCKET, SO_TIMESTAMPNS, &iOn, sizeof(iOn)) < 0 ||
+             setsockopt(iSocket, SOL_CAN_RAW, CAN_RAW_FILTER, aFilters, sizeof(aFilters)) < 0 )
+            iErrNo = errno;
+    }
+    if ( iErrNo != 0 ) {
+        close(iSocket);
+        iSocket = -1;
+        return SetError(ERR_SOCKET, "Open", iErrNo);
+    }
+
+    DnmAtomicStore(&ulDupMac, 0);
+    DnmAtomicStore(&ulClaiming, 1);
+    DnmAtomicStore(&ulRxRunning, 1);
+    if ( !DnmThreadCreate(&hReceiver, ReceiverProc, this) ) {
+        DnmAtomicStore(&ulRxRunning, 0);
+        close(iSocket);
+        iSocket = -1;
+        return SetError(ERR_THREAD, "Open");
+    }
+
+    for ( int i = 0; i < 2 && iErrNo == 0 && !DnmAtomicLoad(&ulDupMac); i++ ) {
+        unsigned long ulStart = DnmTimeMs();
+
+        iErrNo = SendDupMac(false);
+        while ( iErrNo == 0 && !DnmAtomicLoad(&ulDupMac) &&
+                !DnmTimeReached(DnmTimeMs(), ulStart + DNETMOD_CAN_DUPMAC_TIMEOUT) )
+            DnmSleepMs(10);
+    }
+    DnmAtomicStore(&ulClaiming, 0);
+
+    if ( iErrNo != 0 || DnmAtomicLoad(&ulDupMac) ) {
+        StopReceiver();
+        close(iSocket);
+        iSocket = -1;
+        if ( iErrNo != 0 )
+            return SetError(ERR_SOCKET, "Open", iErrNo);
+        return SetError(ERR_DUPMAC, ucMacID);
+    }
+
+    bActive = true;
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Goes off-line and closes the socket
+ *
+ * Devices stay allocated by the module, but their operations fail until
+ * the interface is opened again. Slaves drop their connections on their
+ * own once the Expected Packet Rate expires.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANInterface::Close(void) {
+    if ( !bActive )
+        return SetError(ERR_NOERR);
+
+    bActive = false;
+    StopReceiver();
+    close(iSocket);
+    iSocket = -1;
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Closes and reopens the network interface
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANInterface::Reset(void *) {
+    Close();
+
+    return Open();
+}
+
+/**
+ * @brief Sends outputs of all allocated devices
+ *
+ * Builds Poll Commands of polled devices, Cyclic messages of cyclic
+ * devices and a single Bit-Strobe Command for strobed devices (the first
+ * output bit of each) and sends them in batches of up to
+ * #DNETMOD_CAN_TX_BATCH frames. Each batch is built under the locks and
+ * sent after they are released, so the receiver thread is not stalled
+ * while the transmit queue is full. Call it once per cycle. Responses are
+ * received in the background and read with CSocketCANDevice::ReadIOData.
+ * @return Error from \ref SetError function.
+ */
+int CSocketCANInterface::Scan(void) {
+    struct can_frame aFrames[DNETMOD_CAN_TX_BATCH];
+    unsigned char    aucStrobe[8] = {0};
+    bool             bStrobe = false;
+    int              iCount  = 0;
+    int              iErr    = ERR_NOERR;
+    int              i       = 0;
+
+    if ( !bActive )
+        return SetError(ERR_INOPER, "Scan");
+
+    while ( i < DEVICENET_MAX_DEVICES ) {
+        DnmMutexLock(&DevLock);
+        for ( ; i < DEVICENET_MAX_DEVICES; i++ ) {
+            CSocketCANDevice *pDev = apDevs[i];
+            bool             bFull = false;
+
+            if ( pDev == 0 || !pDev->IsActive() )
+                continue;
+
+            DnmMutexLock(&pDev->IOLock);
+            if ( pDev->ucAllocChoice & DNM_CAN_ALLOC_STROBE ) {
+                if ( pDev->GetProducedConnSize() > 0 && (pDev->aucOutput[0] & 0x01) )
+                    aucStrobe[i / 8] |= static_cast<unsigned char>(1 << (i % 8));
+                bStrobe = true;
+            }
+            if ( pDev->ucAllocChoice & (DNM_CAN_ALLOC_POLL | DNM_CAN_ALLOC_CYCLIC) ) {
+                int iBuilt = DnmCanIOFrames(DnmCanGroup2Id(static_cast<unsigned char>(i), DNM_CAN_G2_POLL_CMD),
+                                            pDev->aucOutput, pDev->GetProducedConnSize(),
+                                            &aFrames[iCount], DNETMOD_CAN_TX_BATCH - iCount);
+
+                bFull = iBuilt == 0 && iCount > 0;
+                iCount += iBuilt;
+            }
+            DnmMutexUnlock(&pDev->IOLock);
+            if ( bFull )
+                break;
+        }
+        DnmMutexUnlock(&DevLock);
+
+        // Batch is full, send it and build the device again in the next
+        if ( i < DEVICENET_MAX_DEVICES ) {
+            iErr = Send(aFrames, iCount);
+            if ( iErr != ERR_NOERR )
+                return iErr;
+            iCount = 0;
+        }
+    }
+
+    if ( bStrobe ) {
+        if ( iCount == DNETMOD_CAN_TX_BATCH ) {
+            iErr = Send(aFrames, iCount);
+            if ( iErr != ERR_NOERR )
+                return iErr;
+            iCount = 0;
+        }
+        DnmCanFrame(&aFrames[iCount++], DnmCanGroup2Id(ucMacID, DNM_CAN_G2_STROBE_CMD), aucStrobe, sizeof(aucStrobe));
+    }
+
+    if ( iCount > 0 )
+        return Send(aFrames, iCount);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Destructor
+ *
+ * Closes the interface.
+ * @remarks Devices must be unallocated or destroyed before the interface.
+ */
+CSocketCANInterface::~CSocketCANInterface() {
+    Close();
+    DnmMutexDestroy(&DevLock);
+}
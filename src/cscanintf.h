@@ -0,0 +1,143 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : cscanintf.h               Type        : header            *
+ *  Description : CSocketCANInterface class declaration.                    *
+ ****************************************************************************/
+
+/**
+ * @file cscanintf.h
+ * @brief CSocketCANInterface class declaration.
+ */
+
+#ifndef CSCANINTF_H
+#define CSCANINTF_H 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File cscanintf.h requires c++ compiler."
+#endif
+
+#include "cintf.h"
+#include "dnmos.h"
+
+/** Maximum length of a network interface name */
+#define DNETMOD_CAN_IFNAME_LEN      16
+/** Default timeout of explicit messaging in ms */
+#define DNETMOD_CAN_EXPL_TIMEOUT    1000
+/** Default timeout of a Duplicate MAC ID Check request in ms */
+#define DNETMOD_CAN_DUPMAC_TIMEOUT  1000
+/** Frames received with a single system call */
+#define DNETMOD_CAN_RX_BATCH        32
+/** Frames sent with a single system call */
+#define DNETMOD_CAN_TX_BATCH        64
+
+class CSocketCANDevice;
+struct can_frame;
+
+/**
+ * @brief DeviceNet master on a Linux SocketCAN network interface
+ *
+ * Implements the Predefined Master/Slave Connection Set directly on a raw
+ * CAN socket, so any adapter with a SocketCAN driver (or a vcan interface)
+ * could be used as master. On Open the interface claims its MAC ID with
+ * the Duplicate MAC ID Check and starts a receiver thread which takes
+ * frames from the socket in batches (recvmmsg) together with their kernel
+ * receive timestamps. The bit rate must be configured on the network
+ * interface (e.g. <code>ip link set can0 type can bitrate 125000</code>),
+ * ucBaudRate is informational only. Polled, strobed and cyclic outputs are
+ * sent by Scan in a single batch (sendmmsg). Available only on Linux.
+ * @remark Copy constructor and assignment operator not supported for
+ * this class.
+ */
+class DNETMOD_API CSocketCANInterface : public CInterface {
+private:
+    /** Name of the network interface */
+    char strIfName[DNETMOD_CAN_IFNAME_LEN];
+    /** Raw CAN socket */
+    int iSocket;
+    /** Receiver thread */
+    DNM_THREAD hReceiver;
+    /** Flag showing whether receiver thread runs */
+    volatile unsigned long ulRxRunning;
+    /** Flag showing that another node claims our MAC ID */
+    volatile unsigned long ulDupMac;
+    /** Flag showing that MAC ID is being claimed */
+    volatile unsigned long ulClaiming;
+    /** Vendor ID sent in Duplicate MAC ID Check messages */
+    unsigned short usVendId;
+    /** Serial number sent in Duplicate MAC ID Check messages */
+    unsigned long ulSerial;
+    /** Timeout of explicit messaging in ms */
+    unsigned long ulExplTimeout;
+    /** Allocated devices by MAC ID */
+    CSocketCANDevice *apDevs[DEVICENET_MAX_DEVICES];
+    /** Serializes allocation with the receiver thread */
+    DNM_MUTEX DevLock;
+private:
+    CSocketCANInterface(const CSocketCANInterface&);
+    CSocketCANInterface& operator =(const CSocketCANInterface&);
+    void Initialize(const char *strIf);
+    int Claim(CSocketCANDevice *pDev);
+    void Release(CSocketCANDevice *pDev);
+    int Transmit(const struct can_frame *aFrames, int iCount);
+    int Send(const struct can_frame *aFrames, int iCount);
+    int SendDupMac(bool bResponse);
+    static DNM_THREAD_RET DNM_THREAD_CC ReceiverProc(void *pvThis);
+    void Receive(void);
+    bool Dispatch(const struct can_frame *pFrame, DNM_UINT64 ullTimeNs, struct can_frame *pAck);
+    void StopReceiver(void);
+protected:
+    /** Class's ID */
+    static unsigned long ulClassID;
+    /** Class's name */
+    static char strClassName[];
+    friend class CSocketCANDevice;
+public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_SCANINTERFACE | CInterface::TYPE_MASK };
+
+    /* constructors */
+    CSocketCANInterface();
+    CSocketCANInterface(const char    *strIf,
+                        unsigned char ucMID,
+                        unsigned char ucCCS,
+                        unsigned char ucPCS,
+                        unsigned char ucBR);
+    /* get/set */
+    const char * GetIfName(void) const;
+    int SetIfName(const char *strIf);
+    void SetIdentity(unsigned short usVendId_, unsigned long ulSerial_);
+    unsigned long GetExplTimeout(void) const;
+    void SetExplTimeout(unsigned long ulMs);
+    /* overrides */
+    virtual bool IsA(unsigned long ulCompareID) const;
+    virtual bool IsA(const char *strCompareName) const;
+    virtual int Open(void);
+    virtual int Close(void);
+    virtual int Reset(void *);
+    /* main */
+    int Scan(void);
+    /* destructor */
+    virtual ~CSocketCANInterface();
+};
+
+/**
+ * @brief Retrieves name of the network interface
+ * @return The name.
+ */
+inline const char * CSocketCANInterface::GetIfName(void) const {
+    return strIfName;
+}
+
+/**
+ * @brief Retrieves timeout of explicit messaging
+ * @return Timeout in ms.
+ */
+inline unsigned long CSocketCANInterface::GetExplTimeout(void) const {
+    return ulExplTimeout;
+}
+
+#endif /* cscanintf.h */
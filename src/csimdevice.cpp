@@ -0,0 +1,371 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : csimdevice.cpp            Type        : source            *
+ *  Description : CSimDevice class implementation.                          *
+ ****************************************************************************/
+
+/**
+ * @file csimdevice.cpp
+ * @brief CSimDevice class implementation.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmos.h"
+#include "csimintf.h"
+#include "csimdevice.h"
+
+unsigned long CSimDevice::ulClassID = 353;
+char CSimDevice::strClassName[] = "CSimDevice";
+
+/**
+ * @brief Default constructor
+ *
+ * Initializes members accordingly.
+ */
+CSimDevice::CSimDevice() : CDevice() {
+    ulTypeMask = TYPE_MASK;
+    pModel = &DefModel;
+    bOffline = false;
+    ulRandState = 1;
+}
+
+/**
+ * @brief Constructor with parameters
+ *
+ * Initializes members from parameters.
+ * @param ucMID MAC ID of the device.
+ * @param ucCCS Consumed connection size of the device.
+ * @param ucPCS Produced connection size of the device.
+ * @param ucCT Connection type.
+ * @param usEPR Expected Packed Rate (EPR) from device.
+ * @param pIntf Pointer to a simulated interface.
+ * @param pMdl Model of the device. Not owned by the device.
+ */
+CSimDevice::CSimDevice(
+    unsigned char  ucMID,
+    unsigned char  ucCCS,
+    unsigned char  ucPCS,
+    unsigned char  ucCT,
+    unsigned short usEPR,
+    CInterface     *pIntf,
+    CSimModel      *pMdl)
+: CDevice(ucMID, ucCCS, ucPCS, ucCT, usEPR, pIntf) {
+    ulTypeMask = TYPE_MASK;
+    pModel = pMdl != 0 ? pMdl : &DefModel;
+    bOffline = false;
+    ulRandState = 1;
+}
+
+/**
+ * @brief Sets model of the device
+ * @param pMdl The model or NULL for the default one. Not owned by the
+ * device.
+ */
+void CSimDevice::SetModel(CSimModel *pMdl) {
+    pModel = pMdl != 0 ? pMdl : &DefModel;
+}
+
+/**
+ * @brief Takes device off or back on the simulated network
+ *
+ * Operations of an offline device fail as if it doesn't respond. An
+ * allocated device is reported faulted to the registry of its interface
+ * while offline.
+ * @param bOff True to take device offline, false to bring it back.
+ */
+void CSimDevice::SetOffline(bool bOff) {
+    bOffline = bOff;
+    ReportFault(bOff);
+}
+
+/**
+ * @brief Checks preconditions of an operation and simulates its latency
+ * @param strFunc Name of the operation.
+ * @param bIO True for I/O operations, false for explicit messaging.
+ * @param ppSimIntf Receives the interface.
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::Prepare(const char *strFunc, bool bIO, CSimInterface **ppSimIntf) {
+    if ( !ISPTRVALID(pInterface, CInterface) )
+        return SetError(ERR_INVPTR, ucMacID, "pInterface", pInterface);
+    if ( !pInterface->Is<CSimInterface>() )
+        return SetError(ERR_INVITF, ucMacID, "CSimInterface");
+    if ( !pInterface->IsActive() )
+        return SetError(ERR_INOPER, strFunc);
+    if ( !bActive )
+        return SetError(ERR_NOALOC, ucMacID);
+
+    CSimInterface *pSimIntf = static_cast<CSimInterface *>(pInterface);
+    unsigned long ulLatency = bIO ? pSimIntf->GetIOLatency() : pSimIntf->GetExplLatency();
+
+    if ( ulLatency != 0 )
+        DnmSleepUs(ulLatency);
+    if ( InjectFailure(pSimIntf) )
+        return SetError(ERR_SIMFAIL, ucMacID, strFunc);
+    if ( bOffline )
+        return bIO ? SetError(ERR_DEVFAULT, ucMacID) : SetError(ERR_EXPLCT, ucMacID, DERR_NO_RESP, 0);
+
+    *ppSimIntf = pSimIntf;
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Decides whether to inject a failure in the operation
+ * @param pSimIntf Interface of the device.
+ * @return True if operation must fail, false otherwise.
+ */
+bool CSimDevice::InjectFailure(CSimInterface *pSimIntf) {
+    if ( pSimIntf->GetFailureRate() == 0 )
+        return false;
+
+    /* xorshift32 */
+    ulRandState ^= (ulRandState << 13) & 0xFFFFFFFFUL;
+    ulRandState ^= ulRandState >> 17;
+    ulRandState ^= (ulRandState << 5) & 0xFFFFFFFFUL;
+
+    return (ulRandState % 1000000UL) < pSimIntf->GetFailureRate();
+}
+
+/**
+ * @brief Translates result of a model explicit operation to an error
+ * @param ucGenErr DeviceNet general error code.
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::ExplResult(unsigned char ucGenErr) {
+    if ( ucGenErr != DERR_OK )
+        return SetError(ERR_EXPLCT, ucMacID, ucGenErr, 0);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Checks if class can identify itself with the specified number.
+ *
+ * If not then passes the check to the base class.
+ * @param ulCompareID ID to be compared.
+ * @return True when match otherwise false.
+ */
+bool CSimDevice::IsA(unsigned long ulCompareID) const {
+    return ( ulCompareID == ulClassID ) ? true : CDevice::IsA(ulCompareID);
+}
+
+/**
+ * @brief Checks if class can identify itself with the specified name.
+ *
+ * If not then passes the check to the base class.
+ * @param strCompareName Name to be compared.
+ * @return True when match otherwise false.
+ */
+bool CSimDevice::IsA(const char *strCompareName) const {
+    return ( !strcmp(strClassName, strCompareName) ) ? true : CDevice::IsA(strCompareName);
+}
+
+/**
+ * @brief Allocates the simulated device
+ *
+ * Fails if another device with the same MAC ID is allocated on the
+ * interface or the MAC ID is the one of the interface.
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::Allocate(unsigned char /*ucFlags*/) {
+    CSimInterface *pSimIntf = 0;
+    int           iErr      = 0;
+
+    if ( !ISPTRVALID(pInterface, CInterface) )
+        return SetError(ERR_INVPTR, ucMacID, "pInterface", pInterface);
+    if ( !pInterface->Is<CSimInterface>() )
+        return SetError(ERR_INVITF, ucMacID, "CSimInterface");
+    if ( !pInterface->IsActive() )
+        return SetError(ERR_INOPER, "Allocate");
+
+    pSimIntf = static_cast<CSimInterface *>(pInterface);
+    if ( pSimIntf->GetExplLatency() != 0 )
+        DnmSleepUs(pSimIntf->GetExplLatency());
+    if ( bOffline )
+        return SetError(ERR_EXPLCT, ucMacID, DERR_NO_RESP, 0);
+
+    iErr = pSimIntf->Claim(this);
+    if ( iErr != ERR_NOERR )
+        return iErr;
+
+    ulRandState = (pSimIntf->GetSeed() ^ (0x9E3779B9UL * (ucMacID + 1UL))) & 0xFFFFFFFFUL;
+    if ( ulRandState == 0 )
+        ulRandState = 1;
+    bActive = true;
+    Register();
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Unallocates the simulated device
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::Unallocate(void) {
+    if ( !bActive )
+        return SetError(ERR_NOALOC, ucMacID);
+
+    if ( ISPTRVALID(pInterface, CInterface) && pInterface->Is<CSimInterface>() )
+        static_cast<CSimInterface *>(pInterface)->Release(this);
+    bActive = false;
+    Unregister();
+    BreakCycle();
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Reads I/O data produced by the model
+ *
+ * Model produces consumed connection size bytes (the input of the
+ * master).
+ * @param ulBufSz Size of the buffer.
+ * @param pvBuf Pointer to the buffer.
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::ReadIOData(unsigned long ulBufSz, void *pvBuf) {
+    CSimInterface *pSimIntf = 0;
+    unsigned char aucData[256];
+    int           iErr = Prepare("ReadIOData", true, &pSimIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+    if ( pvBuf == 0 )
+        return SetError(ERR_INVFPRM, "pvBuf", "NULL", "ReadIOData");
+
+    pModel->Produce(ucConsumedConnSize, aucData);
+    memcpy(pvBuf, aucData, ulBufSz < ucConsumedConnSize ? ulBufSz : ucConsumedConnSize);
+    MarkCycle();
+    if ( ulBufSz < ucConsumedConnSize ) {
+        char cBuf[24] = {0};
+        sprintf(cBuf, "%lu", ulBufSz);
+        return SetError(ERR_INVFPRM, "ulBufSz", cBuf, "ReadIOData");
+    }
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Writes I/O data to the model
+ * @param ulBufSz Size of the buffer. Must equal produced connection size.
+ * @param pvBuf Pointer to the buffer.
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::WriteIOData(unsigned long ulBufSz, void *pvBuf) {
+    CSimInterface *pSimIntf = 0;
+    int           iErr = Prepare("WriteIOData", true, &pSimIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+    if ( ulBufSz != ucProducedConnSize || (pvBuf == 0 && ulBufSz != 0) ) {
+        char cBuf[24] = {0};
+        sprintf(cBuf, "%lu", ulBufSz);
+        return SetError(ERR_INVFPRM, "ulBufSz", cBuf, "WriteIOData");
+    }
+
+    pModel->Consume(ucProducedConnSize, static_cast<const unsigned char *>(pvBuf));
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Reads attribute from the model
+ * @param usClsId Class identifier of the attribute.
+ * @param usInstId Instance identifier of the attribute.
+ * @param ucAttrId Attribute identifier.
+ * @param usDataSz Length in bytes of the attribute data.
+ * @param pvData Pointer to a buffer where to copy attribute data.
+ * @param pusActDataSz Actual size of the attribute data in bytes.
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::GetAttribute(
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned char  ucAttrId,
+    unsigned short usDataSz,
+    void           *pvData,
+    unsigned short *pusActDataSz)
+{
+    CSimInterface *pSimIntf = 0;
+    int           iErr = Prepare("GetAttribute", false, &pSimIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+
+    return ExplResult(pModel->GetAttribute(usClsId, usInstId, ucAttrId, usDataSz, pvData, pusActDataSz));
+}
+
+/**
+ * @brief Writes attribute in the model
+ * @param usClsId Class identifier of the parameter.
+ * @param usInstId Instance identifier of the parameter.
+ * @param ucAttrId Parameter identifier.
+ * @param usDataSz Size of parameter's data in bytes.
+ * @param pvData Pointer to parameter's data.
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::SetAttribute(
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned char  ucAttrId,
+    unsigned short usDataSz,
+    void           *pvData)
+{
+    CSimInterface *pSimIntf = 0;
+    int           iErr = Prepare("SetAttribute", false, &pSimIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+
+    return ExplResult(pModel->SetAttribute(usClsId, usInstId, ucAttrId, usDataSz, pvData));
+}
+
+/**
+ * @brief Executes service in the model
+ * @param ucSrvCode Service code.
+ * @param usClsId Class identifier of the service.
+ * @param usInstId Instance identifier of the service.
+ * @param usDataSz Size of service's data in bytes.
+ * @param pvData Pointer to service's data.
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::ExecService(
+    unsigned char  ucSrvCode,
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned short usDataSz,
+    void           *pvData)
+{
+    CSimInterface *pSimIntf = 0;
+    int           iErr = Prepare("ExecService", false, &pSimIntf);
+
+    if ( iErr != ERR_NOERR )
+        return iErr;
+
+    return ExplResult(pModel->ExecService(ucSrvCode, usClsId, usInstId, usDataSz, pvData));
+}
+
+/**
+ * @brief Executes Reset service of the Identity object
+ * @return Error from \ref SetError function.
+ */
+int CSimDevice::Reset(void) {
+    return ExecService(DNETMOD_SRV_RESET, DNETMOD_CLS_IDENTITY, 1, 0, 0);
+}
+
+/**
+ * @brief Destructor
+ *
+ * Unallocates device if active.
+ */
+CSimDevice::~CSimDevice() {
+    if ( bActive )
+        Unallocate();
+}
@@ -0,0 +1,121 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : csimdevice.h              Type        : header            *
+ *  Description : CSimDevice class declaration.                             *
+ ****************************************************************************/
+
+/**
+ * @file csimdevice.h
+ * @brief CSimDevice class declaration.
+ */
+
+#ifndef CSIMDEVICE_H
+#define CSIMDEVICE_H 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File csimdevice.h requires c++ compiler."
+#endif
+
+#include "cdevice.h"
+#include "csimmodel.h"
+
+class CSimInterface;
+
+/**
+ * @brief Represents a simulated device
+ *
+ * Device attached to CSimInterface. Its behaviour is defined by a model
+ * (see CSimModel). Without a model the device behaves as CSimModel. A
+ * device could be set offline to simulate a device dropping off the
+ * network.
+ * @remark Copy constructor and assignment operator not supported for
+ * this class.
+ */
+class DNETMOD_API CSimDevice : public CDevice {
+private:
+    /** Model of the device (not owned) */
+    CSimModel *pModel;
+    /** Model used when none is set */
+    CSimModel DefModel;
+    /** Flag showing whether device is offline */
+    bool bOffline;
+    /** State of failure injection */
+    unsigned long ulRandState;
+private:
+    CSimDevice(const CSimDevice&);
+    CSimDevice& operator =(const CSimDevice&);
+    int Prepare(const char *strFunc, bool bIO, CSimInterface **ppSimIntf);
+    bool InjectFailure(CSimInterface *pSimIntf);
+    int ExplResult(unsigned char ucGenErr);
+protected:
+    /** Class's ID */
+    static unsigned long ulClassID;
+    /** Class's name */
+    static char strClassName[];
+public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_SIMDEVICE | CDevice::TYPE_MASK };
+
+    /* constructors */
+    CSimDevice();
+    CSimDevice(unsigned char  ucMID,
+               unsigned char  ucCCS,
+               unsigned char  ucPCS,
+               unsigned char  ucCT,
+               unsigned short usEPR,
+               CInterface     *pIntf,
+               CSimModel      *pMdl = 0);
+    /* get/set */
+    CSimModel * GetModel(void) const;
+    void SetModel(CSimModel *pMdl);
+    bool IsOffline(void) const;
+    void SetOffline(bool bOff);
+    /* overrides */
+    virtual bool IsA(unsigned long ulCompareID) const;
+    virtual bool IsA(const char *strCompareName) const;
+    virtual int Allocate(unsigned char ucFlags = 0);
+    virtual int Unallocate(void);
+    virtual int ReadIOData(unsigned long ulBufSz, void *pvBuf);
+    virtual int WriteIOData(unsigned long ulBufSz, void *pvBuf);
+    virtual int GetAttribute(unsigned short usClsId,
+                             unsigned short usInstId,
+                             unsigned char  ucAttrId,
+                             unsigned short usDataSz,
+                             void           *pvData,
+                             unsigned short *pusActDataSz);
+    virtual int SetAttribute(unsigned short usClsId,
+                             unsigned short usInstId,
+                             unsigned char  ucAttrId,
+                             unsigned short usDataSz,
+                             void           *pvData);
+    virtual int ExecService(unsigned char  ucSrvCode,
+                            unsigned short usClsId,
+                            unsigned short usInstId,
+                            unsigned short usDataSz,
+                            void           *pvData);
+    virtual int Reset(void);
+    /* destructor */
+    virtual ~CSimDevice();
+};
+
+/**
+ * @brief Retrieves model of the device
+ * @return The model.
+ */
+inline CSimModel * CSimDevice::GetModel(void) const {
+    return pModel;
+}
+
+/**
+ * @brief Checks whether device is offline
+ * @return True if offline, false otherwise.
+ */
+inline bool CSimDevice::IsOffline(void) const {
+    return bOffline;
+}
+
+#endif /* csimdevice.h */
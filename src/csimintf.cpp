@@ -0,0 +1,209 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : csimintf.cpp              Type        : source            *
+ *  Description : CSimInterface class implementation.                       *
+ ****************************************************************************/
+
+/**
+ * @file csimintf.cpp
+ * @brief CSimInterface class implementation.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "csimintf.h"
+#include "csimdevice.h"
+
+unsigned long CSimInterface::ulClassID = 403;
+char CSimInterface::strClassName[] = "CSimInterface";
+
+/**
+ * @brief Default constructor
+ *
+ * Initializes members accordingly.
+ */
+CSimInterface::CSimInterface() : CInterface() {
+    ulTypeMask = TYPE_MASK;
+    Initialize();
+}
+
+/**
+ * @brief Constructor with parameters
+ *
+ * Initializes members from parameters.
+ * @param ucMID MAC ID of the interface node.
+ * @param ucCCS Consumed connection size of the interface node.
+ * @param ucPCS Produced connection size of the interface node.
+ * @param ucBR Baud rate.
+ */
+CSimInterface::CSimInterface(
+    unsigned char ucMID,
+    unsigned char ucCCS,
+    unsigned char ucPCS,
+    unsigned char ucBR)
+: CInterface(ucMID, ucCCS, ucPCS, ucBR) {
+    ulTypeMask = TYPE_MASK;
+    Initialize();
+}
+
+/**
+ * @brief Initializes members common to all constructors
+ */
+void CSimInterface::Initialize(void) {
+    ulIOLatency = ulExplLatency = 0;
+    ulFailRate = 0;
+    ulSeed = 1;
+    for ( int i = 0; i < DEVICENET_MAX_DEVICES; i++ )
+        apDevs[i] = 0;
+    DnmMutexInit(&DevLock);
+}
+
+/**
+ * @brief Sets latency of operations
+ *
+ * Each operation of an attached device suspends the calling thread for
+ * the latency of its kind.
+ * @param ulIOUs Latency of I/O operations in us.
+ * @param ulExplUs Latency of explicit messaging operations in us.
+ */
+void CSimInterface::SetLatency(unsigned long ulIOUs, unsigned long ulExplUs) {
+    ulIOLatency = ulIOUs;
+    ulExplLatency = ulExplUs;
+}
+
+/**
+ * @brief Sets rate of injected failures
+ *
+ * Operations of attached devices fail at random with
+ * <code>ERR_SIMFAIL</code> at the given rate. Each device draws from its
+ * own sequence derived from the seed and its MAC ID, so runs are
+ * repeatable. New rate applies to devices allocated afterwards.
+ * @param ulPerMillion Failures per million operations. Zero disables
+ * injection.
+ * @param ulSeed_ Seed of the sequences.
+ */
+void CSimInterface::SetFailureRate(unsigned long ulPerMillion, unsigned long ulSeed_) {
+    ulFailRate = ulPerMillion > 1000000UL ? 1000000UL : ulPerMillion;
+    ulSeed = ulSeed_;
+}
+
+/**
+ * @brief Reserves MAC ID of a device on the simulated network
+ * @param pDev The device.
+ * @return Error from \ref SetError function.
+ */
+int CSimInterface::Claim(CSimDevice *pDev) {
+    unsigned char ucMID = pDev->GetMacID();
+    int           iErr  = 0;
+
+    if ( ucMID >= DEVICENET_MAX_DEVICES ) {
+        char cBuf[4] = {0};
+        sprintf(cBuf, "%d", ucMID);
+        return SetError(ERR_INVFPRM, "ucMacID", cBuf, "Allocate");
+    }
+
+    DnmMutexLock(&DevLock);
+    if ( ucMID == ucMacID || (apDevs[ucMID] != 0 && apDevs[ucMID] != pDev) )
+        iErr = SetError(ERR_DUPMAC, ucMID);
+    else {
+        apDevs[ucMID] = pDev;
+        iErr = SetError(ERR_NOERR);
+    }
+    DnmMutexUnlock(&DevLock);
+
+    return iErr;
+}
+
+/**
+ * @brief Releases MAC ID of a device
+ * @param pDev The device.
+ */
+void CSimInterface::Release(CSimDevice *pDev) {
+    unsigned char ucMID = pDev->GetMacID();
+
+    DnmMutexLock(&DevLock);
+    if ( ucMID < DEVICENET_MAX_DEVICES && apDevs[ucMID] == pDev )
+        apDevs[ucMID] = 0;
+    DnmMutexUnlock(&DevLock);
+}
+
+/**
+ * @brief Checks if class can identify itself with the specified number.
+ *
+ * If not then passes the check to the base class.
+ * @param ulCompareID ID to be compared.
+ * @return True when match otherwise false.
+ */
+bool CSimInterface::IsA(unsigned long ulCompareID) const {
+    return ( ulCompareID == ulClassID ) ? true : CInterface::IsA(ulCompareID);
+}
+
+/**
+ * @brief Checks if class can identify itself with the specified name.
+ *
+ * If not then passes the check to the base class.
+ * @param strCompareName Name to be compared.
+ * @return True when match otherwise false.
+ */
+bool CSimInterface::IsA(const char *strCompareName) const {
+    return ( !strcmp(strClassName, strCompareName) ) ? true : CInterface::IsA(strCompareName);
+}
+
+/**
+ * @brief Starts the simulated network
+ * @return Error from \ref SetError function.
+ */
+int CSimInterface::Open(void) {
+    if ( bActive )
+        return SetError(ERR_IOPER, "Open");
+
+    bActive = true;
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Stops the simulated network
+ *
+ * Devices stay allocated, but their operations fail until the interface
+ * is opened again.
+ * @return Error from \ref SetError function.
+ */
+int CSimInterface::Close(void) {
+    bActive = false;
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Resets models of all allocated devices
+ * @return Error from \ref SetError function.
+ */
+int CSimInterface::Reset(void *) {
+    if ( !bActive )
+        return SetError(ERR_INOPER, "Reset");
+
+    DnmMutexLock(&DevLock);
+    for ( int i = 0; i < DEVICENET_MAX_DEVICES; i++ )
+        if ( apDevs[i] != 0 && apDevs[i]->GetModel() != 0 )
+            apDevs[i]->GetModel()->Reset();
+    DnmMutexUnlock(&DevLock);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Destructor
+ *
+ * Closes the interface.
+ * @remarks Devices must be unallocated or destroyed before the interface.
+ */
+CSimInterface::~CSimInterface() {
+    Close();
+    DnmMutexDestroy(&DevLock);
+}
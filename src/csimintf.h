@@ -0,0 +1,124 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : csimintf.h                Type        : header            *
+ *  Description : CSimInterface class declaration.                          *
+ ****************************************************************************/
+
+/**
+ * @file csimintf.h
+ * @brief CSimInterface class declaration.
+ */
+
+#ifndef CSIMINTF_H
+#define CSIMINTF_H 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File csimintf.h requires c++ compiler."
+#endif
+
+#include "cintf.h"
+#include "dnmos.h"
+
+class CSimDevice;
+
+/**
+ * @brief Simulated DeviceNet master
+ *
+ * Software interface needing no hardware. Devices attached to it
+ * (CSimDevice) exchange data with pluggable models (see csimmodel.h).
+ * Latency of I/O and explicit messaging operations and a rate of injected
+ * failures could be configured, so applications could be load tested and
+ * their error handling exercised.
+ * @remark Copy constructor and assignment operator not supported for
+ * this class.
+ */
+class DNETMOD_API CSimInterface : public CInterface {
+private:
+    /** Latency of I/O operations in us */
+    unsigned long ulIOLatency;
+    /** Latency of explicit messaging operations in us */
+    unsigned long ulExplLatency;
+    /** Injected failures per million operations */
+    unsigned long ulFailRate;
+    /** Seed of failure injection */
+    unsigned long ulSeed;
+    /** Allocated devices by MAC ID */
+    CSimDevice *apDevs[DEVICENET_MAX_DEVICES];
+    /** Serializes allocation */
+    DNM_MUTEX DevLock;
+private:
+    CSimInterface(const CSimInterface&);
+    CSimInterface& operator =(const CSimInterface&);
+    void Initialize(void);
+    int Claim(CSimDevice *pDev);
+    void Release(CSimDevice *pDev);
+protected:
+    /** Class's ID */
+    static unsigned long ulClassID;
+    /** Class's name */
+    static char strClassName[];
+    friend class CSimDevice;
+public:
+    /** Type mask of the class */
+    enum { TYPE_MASK = DNM_TYPE_SIMINTERFACE | CInterface::TYPE_MASK };
+
+    /* constructors */
+    CSimInterface();
+    CSimInterface(unsigned char ucMID,
+                  unsigned char ucCCS,
+                  unsigned char ucPCS,
+                  unsigned char ucBR);
+    /* get/set */
+    unsigned long GetIOLatency(void) const;
+    unsigned long GetExplLatency(void) const;
+    void SetLatency(unsigned long ulIOUs, unsigned long ulExplUs);
+    unsigned long GetFailureRate(void) const;
+    void SetFailureRate(unsigned long ulPerMillion, unsigned long ulSeed_ = 1);
+    unsigned long GetSeed(void) const;
+    /* overrides */
+    virtual bool IsA(unsigned long ulCompareID) const;
+    virtual bool IsA(const char *strCompareName) const;
+    virtual int Open(void);
+    virtual int Close(void);
+    virtual int Reset(void *);
+    /* destructor */
+    virtual ~CSimInterface();
+};
+
+/**
+ * @brief Retrieves latency of I/O operations
+ * @return Latency in us.
+ */
+inline unsigned long CSimInterface::GetIOLatency(void) const {
+    return ulIOLatency;
+}
+
+/**
+ * @brief Retrieves latency of explicit messaging operations
+ * @return Latency in us.
+ */
+inline unsigned long CSimInterface::GetExplLatency(void) const {
+    return ulExplLatency;
+}
+
+/**
+ * @brief Retrieves rate of injected failures
+ * @return Failures per million operations.
+ */
+inline unsigned long CSimInterface::GetFailureRate(void) const {
+    return ulFailRate;
+}
+
+/**
+ * @brief Retrieves seed of failure injection
+ * @return The seed.
+ */
+inline unsigned long CSimInterface::GetSeed(void) const {
+    return ulSeed;
+}
+
+#endif /* csimintf.h */
@@ -0,0 +1,349 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : csimmodel.cpp             Type        : source            *
+ *  Description : Simulated device models implementation.                   *
+ ****************************************************************************/
+
+/**
+ * @file csimmodel.cpp
+ * @brief Simulated device models implementation.
+ */
+
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "csimmodel.h"
+
+/**
+ * @brief Copies attribute value to caller buffer
+ * @param pvVal Attribute value.
+ * @param usValSz Size of the value.
+ * @param usDataSz Size of the buffer.
+ * @param pvData The buffer.
+ * @param pusActDataSz Receives size of the value. May be NULL.
+ * @return DeviceNet general error code.
+ */
+static unsigned char CopyAttr(
+    const void     *pvVal,
+    unsigned short usValSz,
+    unsigned short usDataSz,
+    void           *pvData,
+    unsigned short *pusActDataSz)
+{
+    if ( pusActDataSz != 0 )
+        *pusActDataSz = usValSz;
+    if ( usDataSz < usValSz || pvData == 0 )
+        return DERR_DLBS;
+    memcpy(pvData, pvVal, usValSz);
+
+    return DERR_OK;
+}
+
+/**
+ * @brief Default constructor
+ *
+ * Identity describes a generic device of the module.
+ */
+CSimModel::CSimModel() {
+    memset(&Identity, 0, sizeof(Identity));
+    Identity.ucMajorRev = 1;
+    Identity.ucMinorRev = 1;
+    strcpy(Identity.strProdName, "DNetMod Simulated Device");
+}
+
+/**
+ * @brief Sets identity of the model
+ * @param Ident Identity object.
+ */
+void CSimModel::SetIdentity(const SimIdentity &Ident) {
+    Identity = Ident;
+    Identity.strProdName[DNETMOD_SIM_NAME_LEN - 1] = 0;
+}
+
+/**
+ * @brief Produces input data of the device
+ * @param ucSize Size of the data.
+ * @param pucBuf Buffer receiving the data.
+ */
+void CSimModel::Produce(unsigned char ucSize, unsigned char *pucBuf) {
+    memset(pucBuf, 0, ucSize);
+}
+
+/**
+ * @brief Consumes output data for the device
+ * @param ucSize Size of the data.
+ * @param pucBuf The data.
+ */
+void CSimModel::Consume(unsigned char /*ucSize*/, const unsigned char * /*pucBuf*/) {}
+
+/**
+ * @brief Reads attribute
+ *
+ * Values are encoded little endian as on the network. Product name is a
+ * SHORT_STRING (length byte followed by characters).
+ * @param usClsId Class identifier.
+ * @param usInstId Instance identifier.
+ * @param ucAttrId Attribute identifier.
+ * @param usDataSz Size of the buffer.
+ * @param pvData Buffer receiving the value.
+ * @param pusActDataSz Receives actual size of the value. May be NULL.
+ * @return DeviceNet general error code.
+ */
+unsigned char CSimModel::GetAttribute(
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned char  ucAttrId,
+    unsigned short usDataSz,
+    void           *pvData,
+    unsigned short *pusActDataSz)
+{
+    unsigned char aucVal[DNETMOD_SIM_NAME_LEN + 1];
+    unsigned long ulVal = 0;
+    unsigned short usValSz = 2;
+
+    if ( usClsId != DNETMOD_CLS_IDENTITY || usInstId != 1 )
+        return DERR_OBJ_DONT_EXST;
+
+    switch ( ucAttrId ) {
+        case 1: ulVal = Identity.usVendId;
+                break;
+        case 2: ulVal = Identity.usDevType;
+                break;
+        case 3: ulVal = Identity.usProdCode;
+                break;
+        case 4: ulVal = Identity.ucMajorRev | (Identity.ucMinorRev << 8);
+                break;
+        case 5: ulVal = Identity.usStatus;
+                break;
+        case 6: ulVal = Identity.ulSerial;
+                usValSz = 4;
+                break;
+        case 7: aucVal[0] = static_cast<unsigned char>(strlen(Identity.strProdName));
+                memcpy(&aucVal[1], Identity.strProdName, aucVal[0]);
+                return CopyAttr(aucVal, aucVal[0] + 1, usDataSz, pvData, pusActDataSz);
+        default:
+                return DERR_ATT_NOT_SUP;
+    }
+
+    for ( int i = 0; i < usValSz; i++ )
+        aucVal[i] = static_cast<unsigned char>(ulVal >> (8 * i));
+
+    return CopyAttr(aucVal, usValSz, usDataSz, pvData, pusActDataSz);
+}
+
+/**
+ * @brief Writes attribute
+ *
+ * Attributes of the Identity object are not settable.
+ * @param usClsId Class identifier.
+ * @param usInstId Instance identifier.
+ * @param ucAttrId Attribute identifier.
+ * @param usDataSz Size of the value.
+ * @param pvData The value.
+ * @return DeviceNet general error code.
+ */
+unsigned char CSimModel::SetAttribute(
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned char  ucAttrId,
+    unsigned short /*usDataSz*/,
+    const void *   /*pvData*/)
+{
+    if ( usClsId != DNETMOD_CLS_IDENTITY || usInstId != 1 )
+        return DERR_OBJ_DONT_EXST;
+    if ( ucAttrId == 0 || ucAttrId > 7 )
+        return DERR_ATT_NOT_SUP;
+
+    return DERR_ATT_NOT_SET;
+}
+
+/**
+ * @brief Executes service
+ *
+ * Only Reset service of the Identity object is supported.
+ * @param ucSrvCode Service code.
+ * @param usClsId Class identifier.
+ * @param usInstId Instance identifier.
+ * @param usDataSz Size of service data.
+ * @param pvData Service data.
+ * @return DeviceNet general error code.
+ */
+unsigned char CSimModel::ExecService(
+    unsigned char  ucSrvCode,
+    unsigned short usClsId,
+    unsigned short usInstId,
+    unsigned short /*usDataSz*/,
+    void *         /*pvData*/)
+{
+    if ( usClsId != DNETMOD_CLS_IDENTITY || usInstId != 1 )
+        return DERR_OBJ_DONT_EXST;
+    if ( ucSrvCode != DNETMOD_SRV_RESET )
+        return DERR_SRV_UNAV;
+
+    Reset();
+
+    return DERR_OK;
+}
+
+/**
+ * @brief Returns model to its initial state
+ */
+void CSimModel::Reset(void) {}
+
+/**
+ * @brief Destructor
+ *
+ * Does nothing.
+ */
+CSimModel::~CSimModel() {}
+
+/**
+ * @brief Default constructor
+ */
+CSimEchoModel::CSimEchoModel() : CSimModel() {
+    Reset();
+}
+
+/**
+ * @brief Produces the last consumed data
+ *
+ * Bytes not consumed yet are zero.
+ * @param ucSize Size of the data.
+ * @param pucBuf Buffer receiving the data.
+ */
+void CSimEchoModel::Produce(unsigned char ucSize, unsigned char *pucBuf) {
+    memcpy(pucBuf, aucData, ucSize);
+}
+
+/**
+ * @brief Stores consumed data
+ * @param ucSize Size of the data.
+ * @param pucBuf The data.
+ */
+void CSimEchoModel::Consume(unsigned char ucSize, const unsigned char *pucBuf) {
+    memcpy(aucData, pucBuf, ucSize);
+    if ( ucSize < ucDataSz )
+        memset(aucData + ucSize, 0, ucDataSz - ucSize);
+    ucDataSz = ucSize;
+}
+
+/**
+ * @brief Forgets consumed data
+ */
+void CSimEchoModel::Reset(void) {
+    memset(aucData, 0, sizeof(aucData));
+    ucDataSz = 0;
+}
+
+/**
+ * @brief Default constructor
+ */
+CSimCounterModel::CSimCounterModel() : CSimModel() {
+    ulCounter = 0;
+}
+
+/**
+ * @brief Produces incremented counter
+ * @param ucSize Size of the data.
+ * @param pucBuf Buffer receiving the data.
+ */
+void CSimCounterModel::Produce(unsigned char ucSize, unsigned char *pucBuf) {
+    ulCounter++;
+    memset(pucBuf, 0, ucSize);
+    for ( int i = 0; i < 4 && i < ucSize; i++ )
+        pucBuf[i] = static_cast<unsigned char>(ulCounter >> (8 * i));
+}
+
+/**
+ * @brief Clears the counter
+ */
+void CSimCounterModel::Reset(void) {
+    ulCounter = 0;
+}
+
+/**
+ * @brief Constructor
+ * @param ulSeed_ Seed of the sequence. Zero is replaced by one.
+ */
+CSimNoiseModel::CSimNoiseModel(unsigned long ulSeed_) : CSimModel() {
+    ulSeed = ulSeed_ != 0 ? ulSeed_ : 1;
+    Reset();
+}
+
+/**
+ * @brief Produces pseudo-random data (xorshift32)
+ * @param ucSize Size of the data.
+ * @param pucBuf Buffer receiving the data.
+ */
+void CSimNoiseModel::Produce(unsigned char ucSize, unsigned char *pucBuf) {
+    for ( int i = 0; i < ucSize; i++ ) {
+        ulState ^= (ulState << 13) & 0xFFFFFFFFUL;
+        ulState ^= ulState >> 17;
+        ulState ^= (ulState << 5) & 0xFFFFFFFFUL;
+        pucBuf[i] = static_cast<unsigned char>(ulState);
+    }
+}
+
+/**
+ * @brief Restarts the sequence
+ */
+void CSimNoiseModel::Reset(void) {
+    ulState = ulSeed & 0xFFFFFFFFUL;
+}
+
+/**
+ * @brief Constructor
+ * @param pvFrames Frames of the script one after another. Copied.
+ * @param ucFrameSz_ Size of a frame.
+ * @param ulFrames_ Count of frames.
+ */
+CSimScriptModel::CSimScriptModel(
+    const void    *pvFrames,
+    unsigned char ucFrameSz_,
+    unsigned long ulFrames_)
+: CSimModel() {
+    ucFrameSz = ucFrameSz_;
+    ulFrames = pvFrames != 0 && ucFrameSz_ != 0 ? ulFrames_ : 0;
+    pucFrames = 0;
+    if ( ulFrames != 0 ) {
+        pucFrames = new unsigned char[ulFrames * ucFrameSz];
+        memcpy(pucFrames, pvFrames, ulFrames * ucFrameSz);
+    }
+    ulNext = 0;
+}
+
+/**
+ * @brief Produces next frame of the script
+ *
+ * Frame is truncated or padded with zeros to the size of the data.
+ * @param ucSize Size of the data.
+ * @param pucBuf Buffer receiving the data.
+ */
+void CSimScriptModel::Produce(unsigned char ucSize, unsigned char *pucBuf) {
+    memset(pucBuf, 0, ucSize);
+    if ( ulFrames == 0 )
+        return;
+
+    memcpy(pucBuf, pucFrames + ulNext * ucFrameSz, ucSize < ucFrameSz ? ucSize : ucFrameSz);
+    if ( ++ulNext == ulFrames )
+        ulNext = 0;
+}
+
+/**
+ * @brief Restarts the script
+ */
+void CSimScriptModel::Reset(void) {
+    ulNext = 0;
+}
+
+/**
+ * @brief Destructor
+ *
+ * Frees the script.
+ */
+CSimScriptModel::~CSimScriptModel() {
+    delete [] pucFrames;
+}
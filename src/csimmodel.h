@@ -0,0 +1,181 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : csimmodel.h               Type        : header            *
+ *  Description : Simulated device models declaration.                      *
+ ****************************************************************************/
+
+/**
+ * @file csimmodel.h
+ * @brief Simulated device models declaration.
+ */
+
+#ifndef CSIMMODEL_H
+#define CSIMMODEL_H 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File csimmodel.h requires c++ compiler."
+#endif
+
+/** Maximum length of simulated product name */
+#define DNETMOD_SIM_NAME_LEN    32
+/** DeviceNet Identity object class */
+#define DNETMOD_CLS_IDENTITY    0x01
+/** DeviceNet Reset service code */
+#define DNETMOD_SRV_RESET       0x05
+
+/** @brief Identity object of a simulated device */
+typedef struct SimIdentityTag {
+    unsigned short usVendId;    /**< (1) Vendor ID            */
+    unsigned short usDevType;   /**< (2) Device Type          */
+    unsigned short usProdCode;  /**< (3) Product Code         */
+    unsigned char  ucMajorRev;  /**< (4) Revision Major       */
+    unsigned char  ucMinorRev;  /**<     Revision Minor       */
+    unsigned short usStatus;    /**< (5) Device Status        */
+    unsigned long  ulSerial;    /**< (6) Device Serial Number */
+    char strProdName[DNETMOD_SIM_NAME_LEN]; /**< (7) Product Name */
+} SimIdentity;
+
+/**
+ * @brief Behaviour of a simulated device
+ *
+ * Base class for models plugged in CSimDevice. It answers the attributes
+ * of the Identity object (class 1, instance 1) and the Reset service,
+ * produces zeros and ignores consumed data. Descendants override the
+ * functions they need. Explicit messaging functions return DeviceNet
+ * general error codes (DERR_*).
+ * @remark A model may be shared by several devices, but it is not
+ * synchronized.
+ */
+class DNETMOD_API CSimModel {
+protected:
+    /** Identity object */
+    SimIdentity Identity;
+public:
+    /* constructors */
+    CSimModel();
+    /* get/set */
+    const SimIdentity & GetIdentity(void) const;
+    void SetIdentity(const SimIdentity &Ident);
+    /* behaviour */
+    virtual void Produce(unsigned char ucSize, unsigned char *pucBuf);
+    virtual void Consume(unsigned char ucSize, const unsigned char *pucBuf);
+    virtual unsigned char GetAttribute(unsigned short usClsId,
+                                       unsigned short usInstId,
+                                       unsigned char  ucAttrId,
+                                       unsigned short usDataSz,
+                                       void           *pvData,
+                                       unsigned short *pusActDataSz);
+    virtual unsigned char SetAttribute(unsigned short usClsId,
+                                       unsigned short usInstId,
+                                       unsigned char  ucAttrId,
+                                       unsigned short usDataSz,
+                                       const void     *pvData);
+    virtual unsigned char ExecService(unsigned char  ucSrvCode,
+                                      unsigned short usClsId,
+                                      unsigned short usInstId,
+                                      unsigned short usDataSz,
+                                      void           *pvData);
+    virtual void Reset(void);
+    /* destructor */
+    virtual ~CSimModel();
+};
+
+/**
+ * @brief Retrieves identity of the model
+ * @return Identity object.
+ */
+inline const SimIdentity & CSimModel::GetIdentity(void) const {
+    return Identity;
+}
+
+/**
+ * @brief Model producing the data it last consumed
+ */
+class DNETMOD_API CSimEchoModel : public CSimModel {
+private:
+    /** Last consumed data */
+    unsigned char aucData[256];
+    /** Size of last consumed data */
+    unsigned char ucDataSz;
+public:
+    CSimEchoModel();
+    virtual void Produce(unsigned char ucSize, unsigned char *pucBuf);
+    virtual void Consume(unsigned char ucSize, const unsigned char *pucBuf);
+    virtual void Reset(void);
+};
+
+/**
+ * @brief Model producing a counter
+ *
+ * Produced data starts with a 32-bit little endian counter incremented on
+ * every production. Remaining bytes are zero.
+ */
+class DNETMOD_API CSimCounterModel : public CSimModel {
+private:
+    /** The counter */
+    unsigned long ulCounter;
+public:
+    CSimCounterModel();
+    unsigned long GetCounter(void) const;
+    virtual void Produce(unsigned char ucSize, unsigned char *pucBuf);
+    virtual void Reset(void);
+};
+
+/**
+ * @brief Retrieves the counter
+ * @return Count of productions since creation or reset.
+ */
+inline unsigned long CSimCounterModel::GetCounter(void) const {
+    return ulCounter;
+}
+
+/**
+ * @brief Model producing pseudo-random data
+ *
+ * Sequence is determined by the seed, so runs are repeatable.
+ */
+class DNETMOD_API CSimNoiseModel : public CSimModel {
+private:
+    /** Seed */
+    unsigned long ulSeed;
+    /** Generator state */
+    unsigned long ulState;
+public:
+    CSimNoiseModel(unsigned long ulSeed_ = 1);
+    virtual void Produce(unsigned char ucSize, unsigned char *pucBuf);
+    virtual void Reset(void);
+};
+
+/**
+ * @brief Model producing a script of frames
+ *
+ * Produces the frames of the script one after another and starts over
+ * after the last one.
+ */
+class DNETMOD_API CSimScriptModel : public CSimModel {
+private:
+    /** Frames of the script */
+    unsigned char *pucFrames;
+    /** Size of a frame */
+    unsigned char ucFrameSz;
+    /** Count of frames */
+    unsigned long ulFrames;
+    /** Next frame */
+    unsigned long ulNext;
+private:
+    CSimScriptModel(const CSimScriptModel&);
+    CSimScriptModel& operator =(const CSimScriptModel&);
+public:
+    CSimScriptModel(const void    *pvFrames,
+                    unsigned char ucFrameSz_,
+                    unsigned long ulFrames_);
+    virtual void Produce(unsigned char ucSize, unsigned char *pucBuf);
+    virtual void Reset(void);
+    virtual ~CSimScriptModel();
+};
+
+#endif /* csimmodel.h */
@@ -25,6 +25,7 @@
 #include "dnetmod.h"
 #include "dnmerrs.h"
 #include "dnmsd.h"
+#include "dnmos.h"
 
 #if defined(OS_WIN32)
 #include "nidnet.h"
@@ -42,6 +43,88 @@
 /** Contains the last error message */
 char errmsg[DNETMOD_MAX_ERRMSG_LEN];
 
+/** Maximum count of threads with error message buffers of their own */
+#define DNETMOD_MAX_ERRBUFS     16
+
+/** @brief Error message buffer of a thread (see RedirectErrMsg) */
+typedef struct DNM_ERRBUFTag {
+    DNM_THREAD_ID Thread;   /**< Thread                            */
+    char          *pstrMsg; /**< Buffer or NULL if the slot is free */
+} DNM_ERRBUF;
+
+/** @brief Error message buffers of threads */
+typedef struct DNM_ERRBUFSTag {
+    DNM_MUTEX              Lock;                           /**< Guards the slots */
+    volatile unsigned long ulCount;                        /**< Used slots       */
+    DNM_ERRBUF             aBufs[DNETMOD_MAX_ERRBUFS];     /**< Slots            */
+
+    DNM_ERRBUFSTag() {
+        DnmMutexInit(&Lock);
+        ulCount = 0;
+        memset(aBufs, 0, sizeof(aBufs));
+    }
+    ~DNM_ERRBUFSTag() {
+        DnmMutexDestroy(&Lock);
+    }
+} DNM_ERRBUFS;
+
+/** Error message buffers of threads */
+static DNM_ERRBUFS ErrBufs;
+
+/**
+ * @brief Retrieves the error message buffer of the calling thread
+ * @return Buffer set with RedirectErrMsg or #errmsg.
+ */
+static char * ErrMsgBuf(void) {
+    char *pstrMsg = errmsg;
+
+    if ( DnmAtomicLoad(&ErrBufs.ulCount) == 0 )
+        return pstrMsg;
+
+    DnmMutexLock(&ErrBufs.Lock);
+    for ( int i = 0; i < DNETMOD_MAX_ERRBUFS; i++ )
+        if ( ErrBufs.aBufs[i].pstrMsg != 0 && DnmThreadIsSelf(ErrBufs.aBufs[i].Thread) ) {
+            pstrMsg = ErrBufs.aBufs[i].pstrMsg;
+            break;
+        }
+    DnmMutexUnlock(&ErrBufs.Lock);
+
+    return pstrMsg;
+}
+
+/**
+ * @brief Redirects error messages of the calling thread
+ *
+ * Until called again with NULL, messages set by the calling thread are
+ * written to the buffer instead of #errmsg, so an operation run by a worker
+ * thread could keep its message without overwriting the one of the
+ * application (see CCIFInterface::OpenMany).
+ * @param pstrMsg Buffer of #DNETMOD_MAX_ERRMSG_LEN characters or NULL to
+ * write to #errmsg again.
+ * @return True on success, false if too many threads have own buffers.
+ */
+bool DNETMOD_CC RedirectErrMsg(char *pstrMsg) {
+    bool bDone = pstrMsg == 0;
+
+    DnmMutexLock(&ErrBufs.Lock);
+    for ( int i = 0; i < DNETMOD_MAX_ERRBUFS; i++ )
+        if ( ErrBufs.aBufs[i].pstrMsg != 0 && DnmThreadIsSelf(ErrBufs.aBufs[i].Thread) ) {
+            ErrBufs.aBufs[i].pstrMsg = 0;
+            DnmAtomicStore(&ErrBufs.ulCount, ErrBufs.ulCount - 1);
+        }
+    for ( int i = 0; !bDone && i < DNETMOD_MAX_ERRBUFS; i++ )
+        if ( ErrBufs.aBufs[i].pstrMsg == 0 ) {
+            *pstrMsg = 0;
+            ErrBufs.aBufs[i].Thread = DnmThreadSelf();
+            ErrBufs.aBufs[i].pstrMsg = pstrMsg;
+            DnmAtomicStore(&ErrBufs.ulCount, ErrBufs.ulCount + 1);
+            bDone = true;
+        }
+    DnmMutexUnlock(&ErrBufs.Lock);
+
+    return bDone;
+}
+
 /**
  * @brief Retrieves vendor identification string from vendor ID
  * @param usVendId Vendor identifier.
@@ -429,6 +512,8 @@ void DNETMOD_CC CIFTskErrToString(
  * @param pArgList Arguments list (variable).
  */
 long DNETMOD_CC SetNIError(long lError, char *strMsgFmt, va_list pArgList) {
+    char *pstrErr = ErrMsgBuf();
+
     if ( lError != 0 ) {
         unsigned short usIID = 0;
         unsigned short usDevMacId = 0;
@@ -437,12 +522,12 @@ long DNETMOD_CC SetNIError(long lError, char *strMsgFmt, va_list pArgList) {
         usIID      = (unsigned short)va_arg(pArgList, int);
         usDevMacId = (unsinged short)va_arg(pArgList, int);
         ncStatusToString(lError, sizeof(strMessage), strMessage);
-        if ( ISPTRVALID(errmsg, char) )
-            sprintf(errmsg, strMsgFmt, usIID, usDevMacId, strMessage);
+        if ( ISPTRVALID(pstrErr, char) )
+            sprintf(pstrErr, strMsgFmt, usIID, usDevMacId, strMessage);
         return ERR_NIDNET;
     }
-    if ( ISPTRVALID(errmsg, char) )
-        *errmsg = 0;
+    if ( ISPTRVALID(pstrErr, char) )
+        *pstrErr = 0;
     return ERR_NOERR;
 }
 #endif /* if defined(OS_WIN32) */
@@ -454,6 +539,7 @@ long DNETMOD_CC SetNIError(long lError, char *strMsgFmt, va_list pArgList) {
  * @param pArgList Arguments list (variable).
  */
 long DNETMOD_CC SetCIFError(short sCIFError, char * strMsgFmt, va_list pArgList) {
+    char *pstrErr = ErrMsgBuf();
     unsigned char ucTskErr = 0;
     unsigned short usBID = 0;
     unsigned short usDevMacId = 0;
@@ -465,18 +551,18 @@ long DNETMOD_CC SetCIFError(short sCIFError, char * strMsgFmt, va_list pArgList)
         char strMessage[80] = {0};
         if ( sCIFError != DRV_NO_ERROR ) {
             CIFErrToString(sCIFError, sizeof(strMessage), strMessage);
-            if ( ISPTRVALID(errmsg, char) )
-                sprintf(errmsg, strMsgFmt, usBID, usDevMacId, "E", sCIFError, strMessage);
+            if ( ISPTRVALID(pstrErr, char) )
+                sprintf(pstrErr, strMsgFmt, usBID, usDevMacId, "E", sCIFError, strMessage);
         }
         else if ( ucTskErr != TASK_F_OK ) {
             CIFTskErrToString(ucTskErr, sizeof(strMessage), strMessage);
-            if ( ISPTRVALID(errmsg, char) )
-                sprintf(errmsg, strMsgFmt, usBID, usDevMacId, "TE", ucTskErr, strMessage);
+            if ( ISPTRVALID(pstrErr, char) )
+                sprintf(pstrErr, strMsgFmt, usBID, usDevMacId, "TE", ucTskErr, strMessage);
         }
         return ERR_CIF;
     }
-    if ( ISPTRVALID(errmsg, char) )
-        *errmsg = 0;
+    if ( ISPTRVALID(pstrErr, char) )
+        *pstrErr = 0;
     return ERR_NOERR;
 }
 
@@ -486,6 +572,7 @@ long DNETMOD_CC SetCIFError(short sCIFError, char * strMsgFmt, va_list pArgList)
  * @return THe error code passed as first parameter.
  */
 long DNETMOD_CC SetError(long lErrCode...) {
+    char *pstrErr = ErrMsgBuf();
     va_list pArgList;
     char strErrFmt[DNETMOD_MAX_ERRMSG_LEN] = {0};
 
@@ -526,7 +613,7 @@ long DNETMOD_CC SetError(long lErrCode...) {
             DevErrToString(ucGen, sizeof(strGen), strGen);
             DevErrToString(ucAdd, sizeof(strAdd), strAdd);
             strncpy(strErrFmt, ESTR_EXPLCT, sizeof(strErrFmt));
-            if ( ISPTRVALID(errmsg, char) ) sprintf(errmsg, strErrFmt,
+            if ( ISPTRVALID(pstrErr, char) ) sprintf(pstrErr, strErrFmt,
                 ucMacID, ucGen, strGen, ucAdd, strAdd);
         }
         break;
@@ -566,21 +653,66 @@ long DNETMOD_CC SetError(long lErrCode...) {
         case ERR_DEVTYPE:
             strncpy(strErrFmt, ESTR_DEVTYPE, sizeof(strErrFmt));
             break;
+        case ERR_IOQFULL:
+            strncpy(strErrFmt, ESTR_IOQFULL, sizeof(strErrFmt));
+            break;
+        case ERR_DEVFAULT:
+            strncpy(strErrFmt, ESTR_DEVFAULT, sizeof(strErrFmt));
+            break;
+        case ERR_THREAD:
+            strncpy(strErrFmt, ESTR_THREAD, sizeof(strErrFmt));
+            break;
+        case ERR_FILE:
+            strncpy(strErrFmt, ESTR_FILE, sizeof(strErrFmt));
+            break;
+        case ERR_BUSLOAD:
+            strncpy(strErrFmt, ESTR_BUSLOAD, sizeof(strErrFmt));
+            break;
+        case ERR_SOCKET:
+            strncpy(strErrFmt, ESTR_SOCKET, sizeof(strErrFmt));
+            break;
+        case ERR_DUPMAC:
+            strncpy(strErrFmt, ESTR_DUPMAC, sizeof(strErrFmt));
+            break;
+        case ERR_SIMFAIL:
+            strncpy(strErrFmt, ESTR_SIMFAIL, sizeof(strErrFmt));
+            break;
+        case ERR_DPMTORN:
+            strncpy(strErrFmt, ESTR_DPMTORN, sizeof(strErrFmt));
+            break;
+        case ERR_WOULDBLOCK:
+            strncpy(strErrFmt, ESTR_WOULDBLOCK, sizeof(strErrFmt));
+            break;
     }
     if ( lErrCode != ERR_NOERR  && lErrCode != ERR_NIDNET && lErrCode != ERR_CIF && lErrCode != ERR_EXPLCT )
-        if ( ISPTRVALID(errmsg, char) )
-            vsprintf(errmsg, strErrFmt, pArgList);
+        if ( ISPTRVALID(pstrErr, char) )
+            vsprintf(pstrErr, strErrFmt, pArgList);
     va_end(pArgList);
+    DnmMetricsError(lErrCode);
 
     return lErrCode;
 }
 
+/**
+ * @brief Sets #errmsg global variable to a message
+ *
+ * Used to pass the message of an operation run in another thread to the
+ * calling thread.
+ * @param strMsg The message.
+ */
+void DNETMOD_CC SetErrMsg(const char *strMsg) {
+    char *pstrErr = ErrMsgBuf();
+
+    strncpy(pstrErr, strMsg, DNETMOD_MAX_ERRMSG_LEN - 1);
+    pstrErr[DNETMOD_MAX_ERRMSG_LEN - 1] = 0;
+}
+
 /**
  * @brief Retrieves error message string
  * @param ulStrSz Length of the buffer provided as second parameter
  * @param strMsg Pointer to a character buffer
  */
 void DNETMOD_CC GetErrMsg(unsigned long ulStrSz, char *strMsg) {
-    strncpy(strMsg, errmsg, ulStrSz);
+    strncpy(strMsg, ErrMsgBuf(), ulStrSz);
 }
 
@@ -21,6 +21,18 @@
 #include "cnode.h"
 #include "cintf.h"
 #include "cdevice.h"
+#include "cioqueue.h"
+#include "dnmbload.h"
+#include "dnmhist.h"
+#include "dnmmetrics.h"
+#include "dnmtrace.h"
+#include "dnmrec.h"
+#include "dnmiomap.h"
+
+/* Simulated interfaces have no platform dependencies */
+#include "csimmodel.h"
+#include "csimintf.h"
+#include "csimdevice.h"
 
 /* NI-DNET Interfaces have support only on Win32 platform */
 #if defined(OS_WIN32)
@@ -28,12 +40,24 @@
 #include "cnidevice.h"
 #endif
 
+/* SocketCAN Interfaces have support only on Linux platform */
+#if defined(OS_LINUX)
+#include "dnmcan.h"
+#include "cscanintf.h"
+#include "cscandevice.h"
+#endif
+
 /* CIF Interfaces supporting both Linux and Win32 */
 #if defined(OS_LINUX) || defined(OS_WIN32)
+#include "ccifdrv.h"
 #include "ccifintf.h"
 #include "ccifdevice.h"
+#include "ccifmon.h"
 #endif
 
+/* Statically bound facades over the interfaces above */
+#include "dnmstatic.h"
+
 #ifdef COMPILER_GNUC
 /** Specifies structure alignment to the byte */
 #define DI_PACKED __attribute__ ((aligned(1)))
@@ -92,6 +116,8 @@ long DNETMOD_CC SetCIFError(short sStatus, char *strFmt, va_list vaList);
 long DNETMOD_CC SetNIError(long lStatus, char *strFmt, va_list vaList);
 #endif
 long DNETMOD_CC SetError(long lErrCode...);
+void DNETMOD_CC SetErrMsg(const char *strMsg);
+bool DNETMOD_CC RedirectErrMsg(char *pstrMsg);
 
 /* API functions */
 DNETMOD_API int DNETMOD_CC
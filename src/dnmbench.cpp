@@ -0,0 +1,352 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmbench.cpp              Type        : source            *
+ *  Description : Benchmark of the module against the stub CIF driver.      *
+ ****************************************************************************/
+
+/**
+ * @file dnmbench.cpp
+ * @brief Benchmark of the module against the stub CIF driver.
+ *
+ * Measures the cost of the main operations of CCIFInterface, CCIFDevice and
+ * CCIFIOHandle (compare with ReadIOData and WriteIOData for the per-call
+ * validation overhead saved by the handle) and of the statically bound
+ * DnmStaticDevice facade (see dnmstatic.h) and of a snapshot of the whole
+ * input area taken by CCIFMonitor
+ * with driver latencies simulated by cifstub.cpp and prints the results as
+ * JSON to the standard output. Usage:
+ *
+ * dnmbench [-n ops] [-s slow_ops] [-x exchange_us] [-p host_pct]
+ *          [-m mailbox_us] [-t state_us] [-d dpm_us] [-r reset_ms]
+ *          [-H handshake] [-o trace_file]
+ *
+ * where ops is the count of iterations for I/O and attribute operations and
+ * slow_ops the count for Open and Allocate. The handshake is the process
+ * data handshake mode of the interface: device (default), host or none
+ * (see CCIFInterface::SetHandshakeMode). The difference between the modes
+ * is simulated by the stub: an exchange takes exchange_us with device
+ * handshake, host_pct percent of it (50 by default) with host handshake and
+ * dpm_us without handshake, e.g. dnmbench -x 200 -p 40 -d 5 -H host. So the
+ * results show the overhead of the module in each mode on top of assumed
+ * latencies, not the latencies of a real board. With -o the run is recorded and
+ * written to trace_file as Chrome trace-event JSON (the module must be built
+ * with DNETMOD_TRACE defined, otherwise the trace is empty).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "dnmerrs.h"
+#include "dnetmod.h"
+#include "cifstub.h"
+
+/** Default count of iterations for fast operations */
+#define BENCH_DEF_OPS       100000
+/** Default count of iterations for slow operations */
+#define BENCH_DEF_SLOW_OPS  10
+/** MAC ID of the interface */
+#define BENCH_INTF_MAC      0
+/** MAC ID of the device */
+#define BENCH_DEV_MAC       10
+/** I/O connection size of the device */
+#define BENCH_IO_SIZE       8
+
+/** Benchmarked operation */
+typedef int (*BENCH_OP)(void *pvCtx);
+
+/** @brief Result of a benchmark */
+typedef struct BenchResultTag {
+    const char    *strName;     /**< Operation name              */
+    unsigned long ulIters;      /**< Completed iterations        */
+    DNM_UINT64    ullNs;        /**< Time spent in the operation */
+    unsigned long ulCalls;      /**< Driver calls made           */
+    int           iErr;         /**< First error or ERR_NOERR    */
+} BenchResult;
+
+/** @brief Objects used by the operations */
+typedef struct BenchCtxTag {
+    CCIFInterface *pIntf;
+    CCIFDevice    *pDev;
+    CCIFIOHandle  Handle;
+    DnmStaticDevice<CCIFDevice> *pStatic;
+    CCIFMonitor   *pMon;
+    unsigned char aucBuf[BENCH_IO_SIZE];
+} BenchCtx;
+
+static int OpRead(void *pvCtx) {
+    BenchCtx *pCtx = static_cast<BenchCtx *>(pvCtx);
+    return pCtx->pDev->ReadIOData(sizeof(pCtx->aucBuf), pCtx->aucBuf);
+}
+
+static int OpWrite(void *pvCtx) {
+    BenchCtx *pCtx = static_cast<BenchCtx *>(pvCtx);
+    return pCtx->pDev->WriteIOData(sizeof(pCtx->aucBuf), pCtx->aucBuf);
+}
+
+static int OpReadHandle(void *pvCtx) {
+    BenchCtx *pCtx = static_cast<BenchCtx *>(pvCtx);
+    return pCtx->Handle.Read(pCtx->aucBuf);
+}
+
+static int OpWriteHandle(void *pvCtx) {
+    BenchCtx *pCtx = static_cast<BenchCtx *>(pvCtx);
+    return pCtx->Handle.Write(pCtx->aucBuf);
+}
+
+static int OpReadStatic(void *pvCtx) {
+    BenchCtx *pCtx = static_cast<BenchCtx *>(pvCtx);
+    return pCtx->pStatic->ReadIOData(sizeof(pCtx->aucBuf), pCtx->aucBuf);
+}
+
+static int OpWriteStatic(void *pvCtx) {
+    BenchCtx *pCtx = static_cast<BenchCtx *>(pvCtx);
+    return pCtx->pStatic->WriteIOData(sizeof(pCtx->aucBuf), pCtx->aucBuf);
+}
+
+static int OpReadMonitor(void *pvCtx) {
+    return static_cast<BenchCtx *>(pvCtx)->pMon->Read();
+}
+
+static int OpGetAttr(void *pvCtx) {
+    BenchCtx       *pCtx = static_cast<BenchCtx *>(pvCtx);
+    unsigned short usAct = 0;
+    /* Identity object, instance 1, vendor ID */
+    return pCtx->pDev->GetAttribute(1, 1, 1, 2, pCtx->aucBuf, &usAct);
+}
+
+static int OpAllocate(void *pvCtx) {
+    return static_cast<BenchCtx *>(pvCtx)->pDev->Allocate(0);
+}
+
+static int OpUnallocate(void *pvCtx) {
+    return static_cast<BenchCtx *>(pvCtx)->pDev->Unallocate();
+}
+
+static int OpOpen(void *pvCtx) {
+    return static_cast<BenchCtx *>(pvCtx)->pIntf->Open();
+}
+
+static int OpClose(void *pvCtx) {
+    return static_cast<BenchCtx *>(pvCtx)->pIntf->Close();
+}
+
+/**
+ * @brief Runs a benchmark
+ *
+ * Only the operation is timed. The preparation (if any) runs before each
+ * iteration outside of the measured time.
+ * @param strName Operation name.
+ * @param ulIters Count of iterations.
+ * @param pfnPrep Preparation or NULL.
+ * @param pfnOp Operation.
+ * @param pvCtx Context passed to preparation and operation.
+ * @return The result.
+ */
+static BenchResult Run(
+    const char    *strName,
+    unsigned long ulIters,
+    BENCH_OP      pfnPrep,
+    BENCH_OP      pfnOp,
+    void          *pvCtx)
+{
+    BenchResult Res;
+
+    Res.strName = strName;
+    Res.ulIters = 0;
+    Res.ullNs   = 0;
+    Res.ulCalls = 0;
+    Res.iErr    = ERR_NOERR;
+
+    if ( pfnPrep == 0 ) {
+        unsigned long ulCalls = CifStubGetCalls();
+        DNM_UINT64    ullStart = DnmTimeNs();
+
+        for ( ; Res.ulIters < ulIters; Res.ulIters++ )
+            if ( (Res.iErr = pfnOp(pvCtx)) != ERR_NOERR )
+                break;
+        Res.ullNs = DnmTimeNs() - ullStart;
+        Res.ulCalls = CifStubGetCalls() - ulCalls;
+    }
+    else {
+        for ( ; Res.ulIters < ulIters; Res.ulIters++ ) {
+            pfnPrep(pvCtx);
+
+            unsigned long ulCalls = CifStubGetCalls();
+            DNM_UINT64    ullStart = DnmTimeNs();
+
+            Res.iErr = pfnOp(pvCtx);
+            Res.ullNs += DnmTimeNs() - ullStart;
+            Res.ulCalls += CifStubGetCalls() - ulCalls;
+            if ( Res.iErr != ERR_NOERR )
+                break;
+        }
+    }
+
+    return Res;
+}
+
+/**
+ * @brief Prints a result as JSON object
+ * @param Res The result.
+ * @param bLast True if this is the last result.
+ */
+static void PrintResult(const BenchResult &Res, bool bLast) {
+    double dNsOp  = Res.ulIters ? static_cast<double>(Res.ullNs) / Res.ulIters : 0.0;
+    double dOpsSec = Res.ullNs ? Res.ulIters * 1e9 / static_cast<double>(Res.ullNs) : 0.0;
+    double dCallsOp = Res.ulIters ? static_cast<double>(Res.ulCalls) / Res.ulIters : 0.0;
+
+    printf("    {\"name\": \"%s\", \"iterations\": %lu, \"total_ns\": %llu, "
+           "\"ns_per_op\": %.1f, \"ops_per_sec\": %.1f, \"driver_calls_per_op\": %.2f, "
+           "\"error\": %d}%s\n",
+           Res.strName, Res.ulIters, static_cast<unsigned long long>(Res.ullNs),
+           dNsOp, dOpsSec, dCallsOp, Res.iErr, bLast ? "" : ",");
+}
+
+/** @brief Handshake modes selectable with -H option */
+static const struct {
+    const char    *strName;
+    unsigned char ucMode;
+} aHsModes[] = {
+    { "device", DNETMOD_HS_DEVICE_BUFFERED },
+    { "host",   DNETMOD_HS_HOST_BUFFERED   },
+    { "none",   DNETMOD_HS_UNCONTROLLED    }
+};
+
+/**
+ * @brief Prints usage
+ * @param strProg Program name.
+ */
+static void Usage(const char *strProg) {
+    fprintf(stderr, "Usage: %s [-n ops] [-s slow_ops] [-x exchange_us] "
+                    "[-p host_pct] [-m mailbox_us] [-t state_us] [-d dpm_us] "
+                    "[-r reset_ms] [-H device|host|none] [-o trace_file]\n", strProg);
+}
+
+/**
+ * @brief Benchmark program
+ * @return Zero on success, non-zero otherwise.
+ */
+int main(int argc, char *argv[]) {
+    unsigned long ulOps     = BENCH_DEF_OPS;
+    unsigned long ulSlowOps = BENCH_DEF_SLOW_OPS;
+    const char    *strTrace = 0;
+    int           iHsMode   = 0;
+    CifStubConfig Cfg;
+    BenchCtx      Ctx;
+    BenchResult   aRes[10];
+    int           iRes = 0;
+    int           iRet = 0;
+
+    memset(&Cfg, 0, sizeof(Cfg));
+    Cfg.ulHostPct = CIFSTUB_DEF_HOST_PCT;
+    for ( int i = 1; i < argc; i++ ) {
+        unsigned long *pulVal = 0;
+
+        if ( !strcmp(argv[i], "-n") )
+            pulVal = &ulOps;
+        else if ( !strcmp(argv[i], "-s") )
+            pulVal = &ulSlowOps;
+        else if ( !strcmp(argv[i], "-x") )
+            pulVal = &Cfg.ulExchangeUs;
+        else if ( !strcmp(argv[i], "-p") )
+            pulVal = &Cfg.ulHostPct;
+        else if ( !strcmp(argv[i], "-m") )
+            pulVal = &Cfg.ulMailboxUs;
+        else if ( !strcmp(argv[i], "-t") )
+            pulVal = &Cfg.ulStateUs;
+        else if ( !strcmp(argv[i], "-d") )
+            pulVal = &Cfg.ulDPMUs;
+        else if ( !strcmp(argv[i], "-r") )
+            pulVal = &Cfg.ulResetMs;
+        else if ( !strcmp(argv[i], "-o") && i + 1 < argc ) {
+            strTrace = argv[++i];
+            continue;
+        }
+        else if ( !strcmp(argv[i], "-H") && i + 1 < argc ) {
+            const int iModes = sizeof(aHsModes) / sizeof(aHsModes[0]);
+
+            ++i;
+            for ( iHsMode = 0; iHsMode < iModes; iHsMode++ )
+                if ( !strcmp(argv[i], aHsModes[iHsMode].strName) )
+                    break;
+            if ( iHsMode < iModes )
+                continue;
+        }
+
+        if ( pulVal == 0 || ++i >= argc ) {
+            Usage(argv[0]);
+            return 2;
+        }
+        *pulVal = strtoul(argv[i], 0, 10);
+    }
+    CifStubConfigure(&Cfg);
+
+    CCIFInterface Intf(BENCH_INTF_MAC, BENCH_IO_SIZE, BENCH_IO_SIZE, DEVICENET_BAUD_500K, 0);
+    CCIFDevice    Dev(BENCH_DEV_MAC, BENCH_IO_SIZE, BENCH_IO_SIZE, DEVICENET_CONN_POLLED, 100, &Intf);
+    DnmStaticDevice<CCIFDevice> StaticDev(&Dev);
+    CCIFMonitor   Mon(0);
+
+    Intf.SetHandshakeMode(aHsModes[iHsMode].ucMode);
+
+    Ctx.pIntf = &Intf;
+    Ctx.pDev  = &Dev;
+    Ctx.pStatic = &StaticDev;
+    Ctx.pMon = &Mon;
+    memset(Ctx.aucBuf, 0, sizeof(Ctx.aucBuf));
+
+    if ( strTrace != 0 )
+        DnmTraceStart(0);
+    aRes[iRes++] = Run("Open", ulSlowOps, OpClose, OpOpen, &Ctx);
+    if ( Intf.IsActive() || Intf.Open() == ERR_NOERR ) {
+        aRes[iRes++] = Run("Allocate", ulSlowOps, OpUnallocate, OpAllocate, &Ctx);
+        if ( Dev.IsActive() || Dev.Allocate(0) == ERR_NOERR ) {
+            aRes[iRes++] = Run("ReadIOData", ulOps, 0, OpRead, &Ctx);
+            aRes[iRes++] = Run("WriteIOData", ulOps, 0, OpWrite, &Ctx);
+            if ( Ctx.Handle.Bind(&Dev) == ERR_NOERR ) {
+                aRes[iRes++] = Run("CCIFIOHandle::Read", ulOps, 0, OpReadHandle, &Ctx);
+                aRes[iRes++] = Run("CCIFIOHandle::Write", ulOps, 0, OpWriteHandle, &Ctx);
+            }
+            aRes[iRes++] = Run("DnmStaticDevice::ReadIOData", ulOps, 0, OpReadStatic, &Ctx);
+            aRes[iRes++] = Run("DnmStaticDevice::WriteIOData", ulOps, 0, OpWriteStatic, &Ctx);
+            aRes[iRes++] = Run("GetAttribute", ulOps, 0, OpGetAttr, &Ctx);
+            if ( Mon.Open() == ERR_NOERR ) {
+                aRes[iRes++] = Run("CCIFMonitor::Read", ulOps, 0, OpReadMonitor, &Ctx);
+                Mon.Close();
+            }
+            Dev.Unallocate();
+        }
+        Intf.Close();
+    }
+
+    if ( strTrace != 0 ) {
+        DnmTraceStop();
+        if ( DnmTraceWrite(strTrace) != ERR_NOERR )
+            iRet = 1;
+    }
+
+    printf("{\n");
+    printf("  \"benchmark\": \"dnmbench\",\n");
+    printf("  \"config\": {\"ops\": %lu, \"slow_ops\": %lu, \"exchange_us\": %lu, "
+           "\"host_pct\": %lu, \"mailbox_us\": %lu, \"state_us\": %lu, \"dpm_us\": %lu, \"reset_ms\": %lu, "
+           "\"handshake\": \"%s\"},\n",
+           ulOps, ulSlowOps, Cfg.ulExchangeUs, Cfg.ulHostPct, Cfg.ulMailboxUs, Cfg.ulStateUs,
+           Cfg.ulDPMUs, Cfg.ulResetMs, aHsModes[iHsMode].strName);
+    printf("  \"results\": [\n");
+    for ( int i = 0; i < iRes; i++ ) {
+        PrintResult(aRes[i], i == iRes - 1);
+        if ( aRes[i].iErr != ERR_NOERR )
+            iRet = 1;
+    }
+    printf("  ]\n}\n");
+
+    if ( iRet != 0 ) {
+        char strMsg[DNETMOD_MAX_ERRMSG_LEN] = {0};
+        GetErrMsg(sizeof(strMsg), strMsg);
+        fprintf(stderr, "%s\n", strMsg);
+    }
+
+    return iRet;
+}
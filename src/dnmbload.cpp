@@ -0,0 +1,213 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmbload.cpp              Type        : source            *
+ *  Description : Bus load and scan time estimation.                        *
+ ****************************************************************************/
+
+/**
+ * @file dnmbload.cpp
+ * @brief Bus load and scan time estimation.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmbload.h"
+
+/**
+ * @brief Retrieves bit rate for a baud rate
+ * @param ucBaudRate Baud rate (DEVICENET_BAUD_*).
+ * @return Bit rate in bit/s or zero if baud rate is unknown.
+ */
+DNETMOD_API unsigned long DNETMOD_CC DnmBitRate(unsigned char ucBaudRate) {
+    switch ( ucBaudRate ) {
+        case DEVICENET_BAUD_125K: return 125000UL;
+        case DEVICENET_BAUD_250K: return 250000UL;
+        case DEVICENET_BAUD_500K: return 500000UL;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Retrieves worst case length of a CAN frame
+ *
+ * Standard frame with 47 bits of overhead (including interframe space) and
+ * the maximum stuff bits.
+ * @param ucDataSz Data bytes in the frame (up to 8).
+ * @return Length in bits.
+ */
+DNETMOD_API unsigned long DNETMOD_CC DnmFrameBits(unsigned char ucDataSz) {
+    unsigned long ulData = ucDataSz > 8 ? 64UL : 8UL * ucDataSz;
+
+    return 47UL + ulData + (34UL + ulData - 1UL) / 4UL;
+}
+
+/**
+ * @brief Retrieves count of frames of an I/O message
+ * @param ucMsgSz Message size in bytes.
+ * @return One for messages up to 8 bytes, count of fragments otherwise.
+ */
+DNETMOD_API unsigned int DNETMOD_CC DnmFragments(unsigned char ucMsgSz) {
+    if ( ucMsgSz <= 8 )
+        return 1;
+
+    return (ucMsgSz + DNETMOD_FRAG_DATA_SZ - 1) / DNETMOD_FRAG_DATA_SZ;
+}
+
+/**
+ * @brief Retrieves bits of an I/O message
+ * @param ucMsgSz Message size in bytes.
+ * @return Length in bits of all frames of the message.
+ */
+static unsigned long MessageBits(unsigned char ucMsgSz) {
+    unsigned int uiFrags = DnmFragments(ucMsgSz);
+
+    if ( uiFrags == 1 )
+        return DnmFrameBits(ucMsgSz);
+
+    /* full fragments carry 7 data bytes and the fragmentation byte */
+    unsigned char ucLast = static_cast<unsigned char>(ucMsgSz - (uiFrags - 1) * DNETMOD_FRAG_DATA_SZ);
+
+    return (uiFrags - 1) * DnmFrameBits(DNETMOD_FRAG_DATA_SZ + 1) + DnmFrameBits(ucLast + 1);
+}
+
+/**
+ * @brief Estimates bus load of I/O connections
+ * @param ucBaudRate Baud rate of the bus (DEVICENET_BAUD_*).
+ * @param pConns I/O connections. Connections with zero type are skipped.
+ * @param iCount Count of connections.
+ * @param pLoad Receives the estimation.
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC
+DnmBusLoad(unsigned char      ucBaudRate,
+           const DNM_BUS_CONN *pConns,
+           int                iCount,
+           DNM_BUS_LOAD       *pLoad)
+{
+    double         dFrames     = 0.0;
+    double         dBits       = 0.0;
+    unsigned long  ulScanBits  = 0;
+    unsigned short usStrobeEPR = 0;
+    bool           bStrobed    = false;
+
+    if ( pLoad == 0 )
+        return SetError(ERR_INVFPRM, "pLoad", "NULL", "DnmBusLoad");
+    if ( pConns == 0 && iCount > 0 )
+        return SetError(ERR_INVFPRM, "pConns", "NULL", "DnmBusLoad");
+
+    memset(pLoad, 0, sizeof(DNM_BUS_LOAD));
+    pLoad->ulBitRate = DnmBitRate(ucBaudRate);
+    if ( pLoad->ulBitRate == 0 ) {
+        char cBuf[4] = {0};
+        sprintf(cBuf, "%d", ucBaudRate);
+        return SetError(ERR_INVFPRM, "ucBaudRate", cBuf, "DnmBusLoad");
+    }
+
+    for ( int i = 0; i < iCount; i++ ) {
+        const DNM_BUS_CONN *pConn = &pConns[i];
+        unsigned long      ulFrames = 0;
+        unsigned long      ulBits   = 0;
+
+        if ( pConn->ucConnType & DEVICENET_CONN_POLLED ) {
+            ulFrames += DnmFragments(pConn->ucOutSize) + DnmFragments(pConn->ucInSize);
+            ulBits   += MessageBits(pConn->ucOutSize) + MessageBits(pConn->ucInSize);
+            pLoad->ulFragmented += (pConn->ucOutSize > 8) + (pConn->ucInSize > 8);
+        }
+        if ( pConn->ucConnType & DEVICENET_CONN_STRBED ) {
+            /* strobe response is limited to a single frame */
+            ulFrames += 1;
+            ulBits   += DnmFrameBits(pConn->ucInSize);
+            /* strobe request goes at the fastest rate of strobed devices */
+            if ( pConn->usEPR != 0 && (usStrobeEPR == 0 || pConn->usEPR < usStrobeEPR) )
+                usStrobeEPR = pConn->usEPR;
+            bStrobed = true;
+        }
+        if ( pConn->ucConnType & (DEVICENET_CONN_COS | DEVICENET_CONN_CYCLIC) ) {
+            ulFrames += DnmFragments(pConn->ucInSize) + 1;
+            ulBits   += MessageBits(pConn->ucInSize) + DnmFrameBits(0);
+            pLoad->ulFragmented += (pConn->ucInSize > 8);
+            if ( pConn->ucOutSize != 0 ) {
+                ulFrames += DnmFragments(pConn->ucOutSize) + 1;
+                ulBits   += MessageBits(pConn->ucOutSize) + DnmFrameBits(0);
+                pLoad->ulFragmented += (pConn->ucOutSize > 8);
+            }
+        }
+
+        pLoad->ulFrames += ulFrames;
+        ulScanBits += ulBits;
+        if ( pConn->usEPR != 0 ) {
+            dFrames += ulFrames * 1000.0 / pConn->usEPR;
+            dBits   += ulBits * 1000.0 / pConn->usEPR;
+        }
+    }
+
+    if ( bStrobed ) {
+        pLoad->ulFrames += 1;
+        ulScanBits += DnmFrameBits(DNETMOD_STROBE_REQ_SZ);
+        if ( usStrobeEPR != 0 ) {
+            dFrames += 1000.0 / usStrobeEPR;
+            dBits   += DnmFrameBits(DNETMOD_STROBE_REQ_SZ) * 1000.0 / usStrobeEPR;
+        }
+    }
+
+    pLoad->ulFramesPerSec = static_cast<unsigned long>(dFrames + 0.5);
+    pLoad->ulBitsPerSec   = static_cast<unsigned long>(dBits + 0.5);
+    pLoad->dUtilization   = dBits * 100.0 / pLoad->ulBitRate;
+    pLoad->ulMinScanUs    = static_cast<unsigned long>((ulScanBits * 1000000.0) / pLoad->ulBitRate + 0.5);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Describes I/O connection of a device
+ *
+ * Consumed connection size of the device is the input of the master and
+ * produced connection size is the output, as mapped by the module.
+ * @param pDev The device.
+ * @param pConn Receives the connection.
+ */
+DNETMOD_API void DNETMOD_CC DnmDeviceToBusConn(const CDevice *pDev, DNM_BUS_CONN *pConn) {
+    pConn->ucConnType = pDev->GetConnType();
+    pConn->usEPR      = pDev->GetEPR();
+    pConn->ucInSize   = pDev->GetConsumedConnSize();
+    pConn->ucOutSize  = pDev->GetProducedConnSize();
+}
+
+/**
+ * @brief Estimates bus load of devices
+ * @param pIntf Interface (master) of the devices.
+ * @param ppDevs The devices.
+ * @param iCount Count of devices.
+ * @param pLoad Receives the estimation.
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC
+DnmBusLoadDevices(const CInterface *pIntf,
+                  CDevice * const  *ppDevs,
+                  int              iCount,
+                  DNM_BUS_LOAD     *pLoad)
+{
+    DNM_BUS_CONN aConns[DEVICENET_MAX_DEVICES];
+
+    if ( pIntf == 0 )
+        return SetError(ERR_INVFPRM, "pIntf", "NULL", "DnmBusLoadDevices");
+    if ( (ppDevs == 0 && iCount > 0) || iCount > DEVICENET_MAX_DEVICES ) {
+        char cBuf[12] = {0};
+        sprintf(cBuf, "%d", iCount);
+        return SetError(ERR_INVFPRM, "iCount", cBuf, "DnmBusLoadDevices");
+    }
+
+    for ( int i = 0; i < iCount; i++ ) {
+        if ( ppDevs[i] == 0 )
+            return SetError(ERR_INVFPRM, "ppDevs[i]", "NULL", "DnmBusLoadDevices");
+        DnmDeviceToBusConn(ppDevs[i], &aConns[i]);
+    }
+
+    return DnmBusLoad(pIntf->GetBaudRate(), aConns, iCount, pLoad);
+}
@@ -0,0 +1,85 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmbload.h                Type        : header            *
+ *  Description : Bus load and scan time estimation.                        *
+ ****************************************************************************/
+
+/**
+ * @file dnmbload.h
+ * @brief Bus load and scan time estimation.
+ *
+ * Estimates the load which the I/O connections of a master put on the CAN
+ * bus. Each frame is counted with its worst case length including bit
+ * stuffing and interframe space. I/O messages longer than 8 bytes are
+ * fragmented in frames of 7 data bytes and one fragmentation byte. Frames
+ * per connection and scan are:
+ *
+ *   - polled: output frames from master and input frames from device;
+ *   - strobed: input frames from device and a single 8 bytes strobe request
+ *     shared by all strobed devices;
+ *   - change of state and cyclic: input frames from device and output
+ *     frames from master (if any), each acknowledged by a zero length frame.
+ *
+ * Connections are produced once per Expected Packet Rate (EPR). For change
+ * of state that is the worst case. Connections with zero EPR are counted in
+ * the scan time, but not in the rates.
+ */
+
+#ifndef DNETMOD_BLOAD_HEADER
+#define DNETMOD_BLOAD_HEADER 1
+
+#include "dnmdefs.h"
+
+#ifndef COMPILER_CPP
+#error "error: File dnmbload.h requires c++ compiler."
+#endif
+
+#include "cintf.h"
+#include "cdevice.h"
+
+/** Data bytes in a fragment of a fragmented I/O message */
+#define DNETMOD_FRAG_DATA_SZ    7
+/** Data bytes of strobe request */
+#define DNETMOD_STROBE_REQ_SZ   8
+
+/** @brief I/O connection of a device as seen by the estimator */
+typedef struct DNM_BUS_CONNTag {
+    unsigned char  ucConnType;  /**< Connection type (DEVICENET_CONN_*)  */
+    unsigned short usEPR;       /**< Expected Packet Rate in ms          */
+    unsigned char  ucInSize;    /**< Input bytes (device to master)      */
+    unsigned char  ucOutSize;   /**< Output bytes (master to device)     */
+} DNM_BUS_CONN;
+
+/** @brief Estimated bus load */
+typedef struct DNM_BUS_LOADTag {
+    unsigned long ulBitRate;        /**< Bus bit rate in bit/s              */
+    unsigned long ulFrames;         /**< Frames in a scan                   */
+    unsigned long ulFragmented;     /**< Fragmented messages in a scan      */
+    unsigned long ulFramesPerSec;   /**< Frames per second                  */
+    unsigned long ulBitsPerSec;     /**< Bits per second                    */
+    double        dUtilization;     /**< Bus utilization in percent         */
+    unsigned long ulMinScanUs;      /**< Time to transmit a scan in us      */
+} DNM_BUS_LOAD;
+
+DNETMOD_API unsigned long DNETMOD_CC DnmBitRate(unsigned char ucBaudRate);
+DNETMOD_API unsigned long DNETMOD_CC DnmFrameBits(unsigned char ucDataSz);
+DNETMOD_API unsigned int DNETMOD_CC DnmFragments(unsigned char ucMsgSz);
+
+DNETMOD_API int DNETMOD_CC
+DnmBusLoad(unsigned char      ucBaudRate,
+           const DNM_BUS_CONN *pConns,
+           int                iCount,
+           DNM_BUS_LOAD       *pLoad);
+
+DNETMOD_API int DNETMOD_CC
+DnmBusLoadDevices(const CInterface *pIntf,
+                  CDevice * const  *ppDevs,
+                  int              iCount,
+                  DNM_BUS_LOAD     *pLoad);
+
+DNETMOD_API void DNETMOD_CC
+DnmDeviceToBusConn(const CDevice *pDev, DNM_BUS_CONN *pConn);
+
+#endif /* dnmbload.h */
@@ -0,0 +1,292 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmcan.cpp                Type        : source            *
+ *  Description : DeviceNet framing on CAN implementation.                  *
+ ****************************************************************************/
+
+/**
+ * @file dnmcan.cpp
+ * @brief DeviceNet framing on CAN implementation.
+ */
+
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmcan.h"
+
+/** Data bytes in a fragment of I/O message */
+#define DNM_CAN_IO_FRAG_DATA    7
+/** Data bytes in a fragment of explicit message */
+#define DNM_CAN_EXPL_FRAG_DATA  6
+
+/**
+ * @brief Splits CAN identifier into DeviceNet fields
+ * @param Id CAN identifier.
+ * @param pucGroup Receives message group (1 or 2).
+ * @param pucMacID Receives MAC ID.
+ * @param pucMsgID Receives message ID within the group.
+ * @return True if identifier belongs to Group 1 or Group 2, false
+ * otherwise (Group 3, Group 4, extended, remote or error frames).
+ */
+bool DnmCanParseId(
+    canid_t       Id,
+    unsigned char *pucGroup,
+    unsigned char *pucMacID,
+    unsigned char *pucMsgID)
+{
+    if ( Id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG) )
+        return false;
+
+    Id &= CAN_SFF_MASK;
+    if ( (Id & 0x400) == 0 ) {
+        *pucGroup = 1;
+        *pucMsgID = static_cast<unsigned char>((Id >> 6) & 0x0F);
+        *pucMacID = static_cast<unsigned char>(Id & 0x3F);
+        return true;
+    }
+    if ( (Id & 0x600) == 0x400 ) {
+        *pucGroup = 2;
+        *pucMacID = static_cast<unsigned char>((Id >> 3) & 0x3F);
+        *pucMsgID = static_cast<unsigned char>(Id & 0x07);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Fills a CAN frame
+ * @param pFrame The frame.
+ * @param Id CAN identifier.
+ * @param pvData Data bytes or NULL.
+ * @param ucLen Number of data bytes (at most 8).
+ */
+void DnmCanFrame(struct can_frame *pFrame, canid_t Id, const void *pvData, unsigned char ucLen) {
+    memset(pFrame, 0, sizeof(*pFrame));
+    pFrame->can_id = Id;
+    pFrame->can_dlc = ucLen > CAN_MAX_DLEN ? CAN_MAX_DLEN : ucLen;
+    if ( pvData != 0 )
+        memcpy(pFrame->data, pvData, pFrame->can_dlc);
+}
+
+/**
+ * @brief Builds frames of an I/O message
+ *
+ * Messages up to 8 bytes fit in a single frame. Longer messages are sent
+ * with the I/O fragmentation protocol, seven data bytes per frame.
+ * @param Id CAN identifier of the frames.
+ * @param pvData Message bytes.
+ * @param usLen Message length.
+ * @param aFrames Receives the frames.
+ * @param iMax Size of aFrames.
+ * @return Number of frames built or zero if aFrames is too small.
+ */
+int DnmCanIOFrames(
+    canid_t            Id,
+    const void         *pvData,
+    unsigned short     usLen,
+    struct can_frame   *aFrames,
+    int                iMax)
+{
+    const unsigned char *pucData = static_cast<const unsigned char *>(pvData);
+    int                 iFrags   = 0;
+
+    if ( usLen <= CAN_MAX_DLEN ) {
+        if ( iMax < 1 )
+            return 0;
+        DnmCanFrame(&aFrames[0], Id, pvData, static_cast<unsigned char>(usLen));
+        return 1;
+    }
+
+    iFrags = (usLen + DNM_CAN_IO_FRAG_DATA - 1) / DNM_CAN_IO_FRAG_DATA;
+    if ( iFrags > iMax )
+        return 0;
+
+    for ( int i = 0; i < iFrags; i++ ) {
+        unsigned short usOff  = static_cast<unsigned short>(i * DNM_CAN_IO_FRAG_DATA);
+        unsigned short usPart = usLen - usOff < DNM_CAN_IO_FRAG_DATA ? usLen - usOff : DNM_CAN_IO_FRAG_DATA;
+        unsigned char  ucType = i == 0 ? DNM_CAN_FRAG_FIRST : (i == iFrags - 1 ? DNM_CAN_FRAG_LAST : DNM_CAN_FRAG_MIDDLE);
+
+        DnmCanFrame(&aFrames[i], Id, 0, static_cast<unsigned char>(usPart + 1));
+        aFrames[i].data[0] = static_cast<unsigned char>((ucType << 6) | (i & 0x3F));
+        memcpy(&aFrames[i].data[1], pucData + usOff, usPart);
+    }
+
+    return iFrags;
+}
+
+/**
+ * @brief Adds a received frame to an I/O message
+ * @param pAsm The assembly.
+ * @param pFrame The frame.
+ * @param usLen Expected message length. Messages longer than 8 bytes are
+ * expected to be fragmented.
+ * @return #DNM_CAN_ASM_DONE when the message is complete,
+ * #DNM_CAN_ASM_MORE when more fragments are expected or
+ * #DNM_CAN_ASM_ERROR on fragment out of sequence.
+ */
+int DnmCanIOAssemble(DNM_CAN_ASM *pAsm, const struct can_frame *pFrame, unsigned short usLen) {
+    unsigned char ucType  = 0;
+    unsigned char ucCount = 0;
+    unsigned char ucPart  = 0;
+
+    if ( usLen <= CAN_MAX_DLEN ) {
+        pAsm->usLen = pFrame->can_dlc;
+        memcpy(pAsm->aucBuf, pFrame->data, pFrame->can_dlc);
+        pAsm->bOpen = false;
+        return DNM_CAN_ASM_DONE;
+    }
+
+    if ( pFrame->can_dlc < 1 )
+        return DNM_CAN_ASM_ERROR;
+
+    ucType = pFrame->data[0] >> 6;
+    ucCount = pFrame->data[0] & 0x3F;
+    ucPart = static_cast<unsigned char>(pFrame->can_dlc - 1);
+
+    if ( ucType == DNM_CAN_FRAG_FIRST ) {
+        pAsm->usLen = 0;
+        pAsm->ucNext = 0;
+        pAsm->bOpen = true;
+    }
+    if ( !pAsm->bOpen || ucCount != pAsm->ucNext || pAsm->usLen + ucPart > DNM_CAN_MSG_MAX ) {
+        pAsm->bOpen = false;
+        return DNM_CAN_ASM_ERROR;
+    }
+
+    memcpy(pAsm->aucBuf + pAsm->usLen, &pFrame->data[1], ucPart);
+    pAsm->usLen = static_cast<unsigned short>(pAsm->usLen + ucPart);
+    pAsm->ucNext = static_cast<unsigned char>((pAsm->ucNext + 1) & 0x3F);
+    if ( ucType == DNM_CAN_FRAG_LAST || pAsm->usLen >= usLen ) {
+        pAsm->bOpen = false;
+        return DNM_CAN_ASM_DONE;
+    }
+
+    return DNM_CAN_ASM_MORE;
+}
+
+/**
+ * @brief Retrieves number of frames of an explicit message
+ * @param usLen Length of message body (service code and data, without
+ * the header byte).
+ * @return One if the message fits in a frame, number of fragments
+ * otherwise.
+ */
+int DnmCanExplFragments(unsigned short usLen) {
+    if ( usLen < CAN_MAX_DLEN )
+        return 1;
+
+    return (usLen + DNM_CAN_EXPL_FRAG_DATA - 1) / DNM_CAN_EXPL_FRAG_DATA;
+}
+
+/**
+ * @brief Builds a frame of an explicit message
+ *
+ * Explicit fragments carry six body bytes each and must be acknowledged
+ * by the receiver before the next one is sent.
+ * @param Id CAN identifier of the frame.
+ * @param ucHdr Message header (MAC ID of the other end).
+ * @param pucBody Message body (service code and data).
+ * @param usLen Length of the body.
+ * @param iFrag Index of the frame (see DnmCanExplFragments).
+ * @param pFrame Receives the frame.
+ */
+void DnmCanExplFrame(
+    canid_t             Id,
+    unsigned char       ucHdr,
+    const unsigned char *pucBody,
+    unsigned short      usLen,
+    int                 iFrag,
+    struct can_frame    *pFrame)
+{
+    int            iFrags = DnmCanExplFragments(usLen);
+    unsigned short usOff  = 0;
+    unsigned short usPart = 0;
+    unsigned char  ucType = 0;
+
+    if ( iFrags == 1 ) {
+        DnmCanFrame(pFrame, Id, 0, static_cast<unsigned char>(usLen + 1));
+        pFrame->data[0] = static_cast<unsigned char>(ucHdr & ~DNM_CAN_HDR_FRAG);
+        memcpy(&pFrame->data[1], pucBody, usLen);
+        return;
+    }
+
+    usOff = static_cast<unsigned short>(iFrag * DNM_CAN_EXPL_FRAG_DATA);
+    usPart = usLen - usOff < DNM_CAN_EXPL_FRAG_DATA ? usLen - usOff : DNM_CAN_EXPL_FRAG_DATA;
+    ucType = iFrag == 0 ? DNM_CAN_FRAG_FIRST : (iFrag == iFrags - 1 ? DNM_CAN_FRAG_LAST : DNM_CAN_FRAG_MIDDLE);
+
+    DnmCanFrame(pFrame, Id, 0, static_cast<unsigned char>(usPart + 2));
+    pFrame->data[0] = static_cast<unsigned char>(ucHdr | DNM_CAN_HDR_FRAG);
+    pFrame->data[1] = static_cast<unsigned char>((ucType << 6) | (iFrag & 0x3F));
+    memcpy(&pFrame->data[2], pucBody + usOff, usPart);
+}
+
+/**
+ * @brief Adds a received frame to an explicit message
+ *
+ * Acknowledge frames must be filtered out by the caller. The assembled
+ * body excludes the header byte.
+ * @param pAsm The assembly.
+ * @param pFrame The frame.
+ * @return #DNM_CAN_ASM_DONE when the message is complete,
+ * #DNM_CAN_ASM_MORE when more fragments are expected or
+ * #DNM_CAN_ASM_ERROR on fragment out of sequence.
+ */
+int DnmCanExplAssemble(DNM_CAN_ASM *pAsm, const struct can_frame *pFrame) {
+    unsigned char ucType  = 0;
+    unsigned char ucCount = 0;
+    unsigned char ucPart  = 0;
+
+    if ( pFrame->can_dlc < 1 )
+        return DNM_CAN_ASM_ERROR;
+
+    if ( (pFrame->data[0] & DNM_CAN_HDR_FRAG) == 0 ) {
+        pAsm->usLen = static_cast<unsigned short>(pFrame->can_dlc - 1);
+        memcpy(pAsm->aucBuf, &pFrame->data[1], pAsm->usLen);
+        pAsm->bOpen = false;
+        return DNM_CAN_ASM_DONE;
+    }
+
+    if ( pFrame->can_dlc < 2 )
+        return DNM_CAN_ASM_ERROR;
+
+    ucType = pFrame->data[1] >> 6;
+    ucCount = pFrame->data[1] & 0x3F;
+    ucPart = static_cast<unsigned char>(pFrame->can_dlc - 2);
+
+    if ( ucType == DNM_CAN_FRAG_FIRST ) {
+        pAsm->usLen = 0;
+        pAsm->ucNext = 0;
+        pAsm->bOpen = true;
+    }
+    if ( !pAsm->bOpen || ucCount != pAsm->ucNext || pAsm->usLen + ucPart > DNM_CAN_MSG_MAX ) {
+        pAsm->bOpen = false;
+        return DNM_CAN_ASM_ERROR;
+    }
+
+    memcpy(pAsm->aucBuf + pAsm->usLen, &pFrame->data[2], ucPart);
+    pAsm->usLen = static_cast<unsigned short>(pAsm->usLen + ucPart);
+    pAsm->ucNext = static_cast<unsigned char>((pAsm->ucNext + 1) & 0x3F);
+    if ( ucType == DNM_CAN_FRAG_LAST ) {
+        pAsm->bOpen = false;
+        return DNM_CAN_ASM_DONE;
+    }
+
+    return DNM_CAN_ASM_MORE;
+}
+
+/**
+ * @brief Builds acknowledge of an explicit fragment
+ * @param Id CAN identifier of the frame.
+ * @param ucHdr Message header (MAC ID of the other end).
+ * @param ucCount Count of the acknowledged fragment.
+ * @param pFrame Receives the frame.
+ */
+void DnmCanExplAck(canid_t Id, unsigned char ucHdr, unsigned char ucCount, struct can_frame *pFrame) {
+    DnmCanFrame(pFrame, Id, 0, 3);
+    pFrame->data[0] = static_cast<unsigned char>(ucHdr | DNM_CAN_HDR_FRAG);
+    pFrame->data[1] = static_cast<unsigned char>((DNM_CAN_FRAG_ACK << 6) | (ucCount & 0x3F));
+    pFrame->data[2] = 0; /* success */
+}
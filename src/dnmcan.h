@@ -0,0 +1,164 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmcan.h                  Type        : header            *
+ *  Description : DeviceNet framing on CAN declarations.                    *
+ ****************************************************************************/
+
+/**
+ * @file dnmcan.h
+ * @brief DeviceNet framing on CAN declarations.
+ *
+ * Identifiers, services and fragmentation of the Predefined Master/Slave
+ * Connection Set as used on a raw CAN network. The functions work on Linux
+ * SocketCAN frames and are shared by CSocketCANInterface and the slave
+ * emulator (dnmcanslave.cpp).
+ */
+
+#ifndef DNETMOD_CAN_HEADER
+#define DNETMOD_CAN_HEADER 1
+
+#include "dnmdefs.h"
+
+#include <linux/can.h>
+
+/* Group 1 message IDs (sent by slaves) */
+/** Slave's I/O Multicast Poll Response */
+#define DNM_CAN_G1_MPOLL_RESP   0x0C
+/** Slave's I/O Change of State or Cyclic Message */
+#define DNM_CAN_G1_COS_CYC      0x0D
+/** Slave's I/O Bit-Strobe Response */
+#define DNM_CAN_G1_STROBE_RESP  0x0E
+/** Slave's I/O Poll Response or Change of State/Cyclic Acknowledge */
+#define DNM_CAN_G1_POLL_RESP    0x0F
+
+/* Group 2 message IDs */
+/** Master's I/O Bit-Strobe Command (source MAC ID) */
+#define DNM_CAN_G2_STROBE_CMD   0
+/** Master's I/O Multicast Poll Command (source MAC ID) */
+#define DNM_CAN_G2_MPOLL_CMD    1
+/** Master's Change of State or Cyclic Acknowledge */
+#define DNM_CAN_G2_COS_ACK      2
+/** Slave's Explicit or Unconnected Response (source MAC ID) */
+#define DNM_CAN_G2_EXPL_RESP    3
+/** Master's Explicit Request */
+#define DNM_CAN_G2_EXPL_REQ     4
+/** Master's I/O Poll Command or Change of State/Cyclic Message */
+#define DNM_CAN_G2_POLL_CMD     5
+/** Group 2 Only Unconnected Explicit Request */
+#define DNM_CAN_G2_UNCON_REQ    6
+/** Duplicate MAC ID Check Message (source MAC ID) */
+#define DNM_CAN_G2_DUPMAC       7
+
+/* Services */
+/** Reset service */
+#define DNM_CAN_SRV_RESET       0x05
+/** Get_Attribute_Single service */
+#define DNM_CAN_SRV_GET_SINGLE  0x0E
+/** Set_Attribute_Single service */
+#define DNM_CAN_SRV_SET_SINGLE  0x10
+/** Error response */
+#define DNM_CAN_SRV_ERROR       0x14
+/** Allocate_Master/Slave_Connection_Set service */
+#define DNM_CAN_SRV_ALLOCATE    0x4B
+/** Release_Master/Slave_Connection_Set service */
+#define DNM_CAN_SRV_RELEASE     0x4C
+/** Response bit of the service code */
+#define DNM_CAN_SRV_RESPONSE    0x80
+
+/* Objects */
+/** Identity object class */
+#define DNM_CAN_CLS_IDENTITY    0x01
+/** DeviceNet object class */
+#define DNM_CAN_CLS_DEVICENET   0x03
+/** Connection object class */
+#define DNM_CAN_CLS_CONNECTION  0x05
+/** Expected Packet Rate attribute of Connection object */
+#define DNM_CAN_ATTR_EPR        9
+
+/* Allocation choice bits and connection instances */
+/** Explicit messaging connection */
+#define DNM_CAN_ALLOC_EXPL      0x01
+/** Polled I/O connection */
+#define DNM_CAN_ALLOC_POLL      0x02
+/** Bit-Strobe I/O connection */
+#define DNM_CAN_ALLOC_STROBE    0x04
+/** Change of State I/O connection */
+#define DNM_CAN_ALLOC_COS       0x10
+/** Cyclic I/O connection */
+#define DNM_CAN_ALLOC_CYCLIC    0x20
+/** Explicit messaging connection instance */
+#define DNM_CAN_INST_EXPL       1
+/** Polled I/O connection instance */
+#define DNM_CAN_INST_POLL       2
+/** Bit-Strobe I/O connection instance */
+#define DNM_CAN_INST_STROBE     3
+/** Change of State/Cyclic I/O connection instance */
+#define DNM_CAN_INST_COS        4
+
+/* Message header and fragmentation */
+/** Fragmentation bit of explicit message header */
+#define DNM_CAN_HDR_FRAG        0x80
+/** MAC ID field of explicit message header */
+#define DNM_CAN_HDR_MAC         0x3F
+/** First fragment */
+#define DNM_CAN_FRAG_FIRST      0
+/** Middle fragment */
+#define DNM_CAN_FRAG_MIDDLE     1
+/** Last fragment */
+#define DNM_CAN_FRAG_LAST       2
+/** Fragment acknowledge */
+#define DNM_CAN_FRAG_ACK        3
+/** Response bit of Duplicate MAC ID Check message */
+#define DNM_CAN_DUPMAC_RESP     0x80
+
+/** Maximum length of an assembled message in bytes */
+#define DNM_CAN_MSG_MAX         256
+
+/** Message assembly is incomplete */
+#define DNM_CAN_ASM_MORE        0
+/** Message assembly is complete */
+#define DNM_CAN_ASM_DONE        1
+/** Fragment out of sequence, assembly was restarted */
+#define DNM_CAN_ASM_ERROR       (-1)
+
+/** @brief Assembly of a fragmented message */
+typedef struct DnmCanAsmTag {
+    unsigned char  aucBuf[DNM_CAN_MSG_MAX]; /**< Assembled bytes           */
+    unsigned short usLen;                   /**< Assembled length          */
+    unsigned char  ucNext;                  /**< Expected fragment count   */
+    bool           bOpen;                   /**< First fragment was seen   */
+} DNM_CAN_ASM;
+
+/**
+ * @brief Builds identifier of a Group 1 message
+ * @param ucMsgID Group 1 message ID.
+ * @param ucMacID Source MAC ID.
+ * @return CAN identifier.
+ */
+inline canid_t DnmCanGroup1Id(unsigned char ucMsgID, unsigned char ucMacID) {
+    return (static_cast<canid_t>(ucMsgID & 0x0F) << 6) | (ucMacID & 0x3F);
+}
+
+/**
+ * @brief Builds identifier of a Group 2 message
+ * @param ucMacID Source or destination MAC ID.
+ * @param ucMsgID Group 2 message ID.
+ * @return CAN identifier.
+ */
+inline canid_t DnmCanGroup2Id(unsigned char ucMacID, unsigned char ucMsgID) {
+    return 0x400 | (static_cast<canid_t>(ucMacID & 0x3F) << 3) | (ucMsgID & 0x07);
+}
+
+bool DnmCanParseId(canid_t Id, unsigned char *pucGroup, unsigned char *pucMacID, unsigned char *pucMsgID);
+void DnmCanFrame(struct can_frame *pFrame, canid_t Id, const void *pvData, unsigned char ucLen);
+int DnmCanIOFrames(canid_t Id, const void *pvData, unsigned short usLen, struct can_frame *aFrames, int iMax);
+int DnmCanIOAssemble(DNM_CAN_ASM *pAsm, const struct can_frame *pFrame, unsigned short usLen);
+int DnmCanExplFragments(unsigned short usLen);
+void DnmCanExplFrame(canid_t Id, unsigned char ucHdr, const unsigned char *pucBody, unsigned short usLen,
+                     int iFrag, struct can_frame *pFrame);
+int DnmCanExplAssemble(DNM_CAN_ASM *pAsm, const struct can_frame *pFrame);
+void DnmCanExplAck(canid_t Id, unsigned char ucHdr, unsigned char ucCount, struct can_frame *pFrame);
+
+#endif /* dnmcan.h */
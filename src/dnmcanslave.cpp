@@ -0,0 +1,405 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmcanslave.cpp           Type        : source            *
+ *  Description : DeviceNet slave emulator on SocketCAN.                    *
+ ****************************************************************************/
+
+/**
+ * @file dnmcanslave.cpp
+ * @brief DeviceNet slave emulator on SocketCAN.
+ *
+ * Emulates group 2 only slaves on a SocketCAN network interface, so
+ * CSocketCANInterface could be tried without hardware on a vcan interface:
+ *
+ * <pre>
+ * ip link add dev vcan0 type vcan && ip link set up vcan0
+ * dnmcanslave -i vcan0 -p 4 -c 4 10 11 12
+ * </pre>
+ *
+ * Usage:
+ *
+ * dnmcanslave [-i interface] [-m echo|counter|noise] [-p produced]
+ *             [-c consumed] mac_id [mac_id ...]
+ *
+ * Each slave allocates the Predefined Master/Slave Connection Set, accepts
+ * Expected Packet Rate of its connections, answers polled, strobed and
+ * change of state/cyclic I/O with data produced by a CSimModel and serves
+ * the Identity object and any explicit request the model understands. Both
+ * I/O and explicit messages are fragmented as needed.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmcan.h"
+#include "csimmodel.h"
+
+/** @brief Emulated slave */
+typedef struct SlaveTag {
+    unsigned char  ucMacID;                  /**< MAC ID                       */
+    unsigned char  ucMaster;                 /**< MAC ID of allocating master  */
+    unsigned char  ucAlloc;                  /**< Allocation choice in effect  */
+    unsigned short ausEPR[5];                /**< EPR by connection instance   */
+    CSimModel      *pModel;                  /**< Behaviour                    */
+    DNM_CAN_ASM    ExplAsm;                  /**< Explicit request assembly    */
+    DNM_CAN_ASM    IOAsm;                    /**< Output assembly              */
+    unsigned char  aucResp[DNM_CAN_MSG_MAX]; /**< Pending explicit response    */
+    unsigned short usRespLen;                /**< Length of pending response   */
+    int            iRespFrag;                /**< Next fragment to send        */
+} Slave;
+
+/** Socket bound to the network interface */
+static int iSock = -1;
+/** Produced connection size of the slaves */
+static unsigned short usProduced = 4;
+/** Consumed connection size of the slaves */
+static unsigned short usConsumed = 4;
+
+/**
+ * @brief Sends a frame
+ * @param pFrame The frame.
+ */
+static void SendFrame(const struct can_frame *pFrame) {
+    if ( write(iSock, pFrame, sizeof(*pFrame)) != sizeof(*pFrame) )
+        perror("write");
+}
+
+/**
+ * @brief Sends produced data of a slave
+ * @param pSlave The slave.
+ * @param ucMsgID Group 1 message ID.
+ */
+static void Produce(Slave *pSlave, unsigned char ucMsgID) {
+    unsigned char    aucData[DNM_CAN_MSG_MAX];
+    struct can_frame aFrames[40];
+    unsigned short   usLen = ucMsgID == DNM_CAN_G1_STROBE_RESP && usProduced > 8 ? 8 : usProduced;
+    int              iCount = 0;
+
+    pSlave->pModel->Produce(static_cast<unsigned char>(usLen), aucData);
+    iCount = DnmCanIOFrames(DnmCanGroup1Id(ucMsgID, pSlave->ucMacID), aucData, usLen, aFrames, 40);
+    for ( int i = 0; i < iCount; i++ )
+        SendFrame(&aFrames[i]);
+}
+
+/**
+ * @brief Sends next fragment (or the whole) pending explicit response
+ * @param pSlave The slave.
+ */
+static void SendResponse(Slave *pSlave) {
+    struct can_frame Frame;
+
+    if ( pSlave->iRespFrag >= DnmCanExplFragments(pSlave->usRespLen) )
+        return;
+
+    DnmCanExplFrame(DnmCanGroup2Id(pSlave->ucMacID, DNM_CAN_G2_EXPL_RESP), pSlave->ucMaster,
+                    pSlave->aucResp, pSlave->usRespLen, pSlave->iRespFrag++, &Frame);
+    SendFrame(&Frame);
+}
+
+/**
+ * @brief Prepares explicit response
+ * @param pSlave The slave.
+ * @param ucSrv Service code of the request.
+ * @param ucGenErr General error code or DERR_OK.
+ * @param pucData Response data.
+ * @param usLen Length of response data.
+ */
+static void Respond(Slave *pSlave, unsigned char ucSrv, unsigned char ucGenErr,
+                    const unsigned char *pucData, unsigned short usLen) {
+    if ( ucGenErr != DERR_OK ) {
+        pSlave->aucResp[0] = DNM_CAN_SRV_ERROR | DNM_CAN_SRV_RESPONSE;
+        pSlave->aucResp[1] = ucGenErr;
+        pSlave->aucResp[2] = 0xFF;
+        pSlave->usRespLen = 3;
+    }
+    else {
+        if ( usLen > DNM_CAN_MSG_MAX - 1 )
+            usLen = DNM_CAN_MSG_MAX - 1;
+        pSlave->aucResp[0] = static_cast<unsigned char>(ucSrv | DNM_CAN_SRV_RESPONSE);
+        memcpy(&pSlave->aucResp[1], pucData, usLen);
+        pSlave->usRespLen = static_cast<unsigned short>(usLen + 1);
+    }
+    pSlave->iRespFrag = 0;
+    SendResponse(pSlave);
+}
+
+/**
+ * @brief Serves unconnected request (allocation and release)
+ * @param pSlave The slave.
+ * @param pFrame The frame.
+ */
+static void OnUnconnected(Slave *pSlave, const struct can_frame *pFrame) {
+    unsigned char ucSrv = pFrame->can_dlc > 1 ? pFrame->data[1] : 0;
+
+    if ( pFrame->can_dlc < 5 || (pFrame->data[0] & DNM_CAN_HDR_FRAG) ||
+         pFrame->data[2] != DNM_CAN_CLS_DEVICENET || pFrame->data[3] != 1 ) {
+        pSlave->ucMaster = pFrame->data[0] & DNM_CAN_HDR_MAC;
+        Respond(pSlave, ucSrv, DERR_SRV_UNAV, 0, 0);
+        return;
+    }
+
+    if ( ucSrv == DNM_CAN_SRV_ALLOCATE && pFrame->can_dlc >= 6 ) {
+        unsigned char ucFormat = 0; /* 8/8 */
+
+        if ( pSlave->ucAlloc != 0 && pSlave->ucMaster != pFrame->data[5] ) {
+            Respond(pSlave, ucSrv, DERR_VENDSPEC, 0, 0);
+            return;
+        }
+        pSlave->ucMaster = pFrame->data[5] & DNM_CAN_HDR_MAC;
+        pSlave->ucAlloc |= pFrame->data[4];
+        Respond(pSlave, ucSrv, DERR_OK, &ucFormat, 1);
+        printf("MAC %d: allocated 0x%02X by %d\n", pSlave->ucMacID, pSlave->ucAlloc, pSlave->ucMaster);
+    }
+    else if ( ucSrv == DNM_CAN_SRV_RELEASE ) {
+        pSlave->ucAlloc &= static_cast<unsigned char>(~pFrame->data[4]);
+        Respond(pSlave, ucSrv, DERR_OK, 0, 0);
+        printf("MAC %d: released to 0x%02X\n", pSlave->ucMacID, pSlave->ucAlloc);
+    }
+    else
+        Respond(pSlave, ucSrv, DERR_SRV_UNAV, 0, 0);
+}
+
+/**
+ * @brief Serves assembled explicit request
+ * @param pSlave The slave.
+ */
+static void OnRequest(Slave *pSlave) {
+    const unsigned char *pucReq = pSlave->ExplAsm.aucBuf;
+    unsigned short      usLen   = pSlave->ExplAsm.usLen;
+    unsigned char       aucData[DNM_CAN_MSG_MAX];
+    unsigned short      usAct   = 0;
+    unsigned char       ucErr   = DERR_OK;
+
+    if ( usLen < 3 ) {
+        Respond(pSlave, usLen > 0 ? pucReq[0] : 0, DERR_SRV_UNAV, 0, 0);
+        return;
+    }
+
+    if ( pucReq[1] == DNM_CAN_CLS_CONNECTION && pucReq[2] >= 1 && pucReq[2] <= 4 && usLen >= 4 &&
+         pucReq[3] == DNM_CAN_ATTR_EPR ) {
+        if ( pucReq[0] == DNM_CAN_SRV_SET_SINGLE && usLen >= 6 ) {
+            pSlave->ausEPR[pucReq[2]] = static_cast<unsigned short>(pucReq[4] | (pucReq[5] << 8));
+            Respond(pSlave, pucReq[0], DERR_OK, 0, 0);
+            return;
+        }
+        if ( pucReq[0] == DNM_CAN_SRV_GET_SINGLE ) {
+            aucData[0] = static_cast<unsigned char>(pSlave->ausEPR[pucReq[2]] & 0xFF);
+            aucData[1] = static_cast<unsigned char>(pSlave->ausEPR[pucReq[2]] >> 8);
+            Respond(pSlave, pucReq[0], DERR_OK, aucData, 2);
+            return;
+        }
+    }
+
+    switch ( pucReq[0] ) {
+        case DNM_CAN_SRV_GET_SINGLE:
+            if ( usLen < 4 )
+                ucErr = DERR_SRV_UNAV;
+            else
+                ucErr = pSlave->pModel->GetAttribute(pucReq[1], pucReq[2], pucReq[3], sizeof(aucData) - 1, aucData, &usAct);
+            break;
+        case DNM_CAN_SRV_SET_SINGLE:
+            if ( usLen < 4 )
+                ucErr = DERR_SRV_UNAV;
+            else
+                ucErr = pSlave->pModel->SetAttribute(pucReq[1], pucReq[2], pucReq[3], usLen - 4, &pucReq[4]);
+            break;
+        default:
+            memcpy(aucData, &pucReq[3], usLen - 3);
+            ucErr = pSlave->pModel->ExecService(pucReq[0], pucReq[1], pucReq[2], usLen - 3, aucData);
+            break;
+    }
+    Respond(pSlave, pucReq[0], ucErr, aucData, usAct);
+}
+
+/**
+ * @brief Serves frame of explicit request or acknowledge
+ * @param pSlave The slave.
+ * @param pFrame The frame.
+ */
+static void OnExplicit(Slave *pSlave, const struct can_frame *pFrame) {
+    bool bFrag = pFrame->can_dlc >= 2 && (pFrame->data[0] & DNM_CAN_HDR_FRAG);
+    int  iRes  = 0;
+
+    if ( (pSlave->ucAlloc & DNM_CAN_ALLOC_EXPL) == 0 )
+        return;
+
+    if ( bFrag && (pFrame->data[1] >> 6) == DNM_CAN_FRAG_ACK ) {
+        SendResponse(pSlave);
+        return;
+    }
+
+    iRes = DnmCanExplAssemble(&pSlave->ExplAsm, pFrame);
+    if ( bFrag && iRes != DNM_CAN_ASM_ERROR ) {
+        struct can_frame Ack;
+
+        DnmCanExplAck(DnmCanGroup2Id(pSlave->ucMacID, DNM_CAN_G2_EXPL_RESP), pSlave->ucMaster,
+                      pFrame->data[1] & 0x3F, &Ack);
+        SendFrame(&Ack);
+    }
+    if ( iRes == DNM_CAN_ASM_DONE )
+        OnRequest(pSlave);
+}
+
+/**
+ * @brief Serves output of the master
+ * @param pSlave The slave.
+ * @param pFrame The frame.
+ */
+static void OnOutput(Slave *pSlave, const struct can_frame *pFrame) {
+    if ( (pSlave->ucAlloc & (DNM_CAN_ALLOC_POLL | DNM_CAN_ALLOC_COS | DNM_CAN_ALLOC_CYCLIC)) == 0 )
+        return;
+    if ( DnmCanIOAssemble(&pSlave->IOAsm, pFrame, usConsumed) != DNM_CAN_ASM_DONE )
+        return;
+
+    pSlave->pModel->Consume(static_cast<unsigned char>(pSlave->IOAsm.usLen), pSlave->IOAsm.aucBuf);
+    if ( pSlave->ucAlloc & DNM_CAN_ALLOC_POLL )
+        Produce(pSlave, DNM_CAN_G1_POLL_RESP);
+    else {
+        struct can_frame Ack;
+
+        DnmCanFrame(&Ack, DnmCanGroup1Id(DNM_CAN_G1_POLL_RESP, pSlave->ucMacID), 0, 0);
+        SendFrame(&Ack);
+        Produce(pSlave, DNM_CAN_G1_COS_CYC);
+    }
+}
+
+/**
+ * @brief Prints usage
+ * @param strProg Program name.
+ */
+static void Usage(const char *strProg) {
+    fprintf(stderr, "Usage: %s [-i interface] [-m echo|counter|noise] [-p produced] "
+                    "[-c consumed] mac_id [mac_id ...]\n", strProg);
+}
+
+/**
+ * @brief Slave emulator program
+ * @return Zero on success, non-zero otherwise.
+ */
+int main(int argc, char *argv[]) {
+    const char          *strIf    = "vcan0";
+    const char          *strModel = "echo";
+    Slave               *apSlaves[DEVICENET_MAX_DEVICES] = {0};
+    int                 iSlaves   = 0;
+    struct ifreq        Ifr;
+    struct sockaddr_can Addr;
+
+    for ( int i = 1; i < argc; i++ ) {
+        if ( !strcmp(argv[i], "-i") && i + 1 < argc )
+            strIf = argv[++i];
+        else if ( !strcmp(argv[i], "-m") && i + 1 < argc )
+            strModel = argv[++i];
+        else if ( !strcmp(argv[i], "-p") && i + 1 < argc )
+            usProduced = static_cast<unsigned short>(atoi(argv[++i]));
+        else if ( !strcmp(argv[i], "-c") && i + 1 < argc )
+            usConsumed = static_cast<unsigned short>(atoi(argv[++i]));
+        else if ( argv[i][0] != '-' && atoi(argv[i]) >= 0 && atoi(argv[i]) < DEVICENET_MAX_DEVICES &&
+                  apSlaves[atoi(argv[i])] == 0 ) {
+            Slave *pSlave = new Slave;
+
+            memset(pSlave, 0, sizeof(*pSlave));
+            pSlave->ucMacID = static_cast<unsigned char>(atoi(argv[i]));
+            if ( !strcmp(strModel, "counter") )
+                pSlave->pModel = new CSimCounterModel();
+            else if ( !strcmp(strModel, "noise") )
+                pSlave->pModel = new CSimNoiseModel(pSlave->ucMacID + 1UL);
+            else
+                pSlave->pModel = new CSimEchoModel();
+            apSlaves[pSlave->ucMacID] = pSlave;
+            iSlaves++;
+        }
+        else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if ( iSlaves == 0 || usProduced > DNM_CAN_MSG_MAX - 1 || usConsumed > DNM_CAN_MSG_MAX - 1 ) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    iSock = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    memset(&Ifr, 0, sizeof(Ifr));
+    strncpy(Ifr.ifr_name, strIf, IFNAMSIZ - 1);
+    memset(&Addr, 0, sizeof(Addr));
+    Addr.can_family = AF_CAN;
+    if ( iSock < 0 || ioctl(iSock, SIOCGIFINDEX, &Ifr) < 0 ) {
+        perror(strIf);
+        return 1;
+    }
+    Addr.can_ifindex = Ifr.ifr_ifindex;
+    if ( bind(iSock, reinterpret_cast<struct sockaddr *>(&Addr), sizeof(Addr)) < 0 ) {
+        perror("bind");
+        return 1;
+    }
+    printf("Emulating %d slave(s) on %s\n", iSlaves, strIf);
+    fflush(stdout);
+
+    for ( ;; ) {
+        struct can_frame Frame;
+        unsigned char    ucGroup = 0;
+        unsigned char    ucMID   = 0;
+        unsigned char    ucMsgID = 0;
+        Slave            *pSlave = 0;
+
+        if ( read(iSock, &Frame, sizeof(Frame)) != sizeof(Frame) ) {
+            if ( errno == EINTR )
+                continue;
+            perror("read");
+            return 1;
+        }
+        if ( !DnmCanParseId(Frame.can_id, &ucGroup, &ucMID, &ucMsgID) || ucGroup != 2 )
+            continue;
+
+        if ( ucMsgID == DNM_CAN_G2_STROBE_CMD ) {
+            for ( int i = 0; i < DEVICENET_MAX_DEVICES; i++ ) {
+                unsigned char ucBit = 0;
+
+                if ( apSlaves[i] == 0 || (apSlaves[i]->ucAlloc & DNM_CAN_ALLOC_STROBE) == 0 )
+                    continue;
+                if ( Frame.can_dlc > i / 8 )
+                    ucBit = (Frame.data[i / 8] >> (i % 8)) & 0x01;
+                apSlaves[i]->pModel->Consume(1, &ucBit);
+                Produce(apSlaves[i], DNM_CAN_G1_STROBE_RESP);
+            }
+            continue;
+        }
+
+        pSlave = apSlaves[ucMID];
+        if ( pSlave == 0 )
+            continue;
+        switch ( ucMsgID ) {
+            case DNM_CAN_G2_DUPMAC:
+                if ( Frame.can_dlc > 0 && (Frame.data[0] & DNM_CAN_DUPMAC_RESP) == 0 ) {
+                    Frame.data[0] |= DNM_CAN_DUPMAC_RESP;
+                    SendFrame(&Frame);
+                }
+                break;
+            case DNM_CAN_G2_UNCON_REQ:
+                OnUnconnected(pSlave, &Frame);
+                break;
+            case DNM_CAN_G2_EXPL_REQ:
+                OnExplicit(pSlave, &Frame);
+                break;
+            case DNM_CAN_G2_POLL_CMD:
+                OnOutput(pSlave, &Frame);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return 0;
+}
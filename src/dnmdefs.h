@@ -156,6 +156,22 @@
  * @param lErrCode Error code
  */
 extern long DNETMOD_CC SetError(long lErrCode...);
+/**
+ * @brief Sets #errmsg global variable to a message
+ * @param strMsg The message
+ */
+extern void DNETMOD_CC SetErrMsg(const char *strMsg);
+/**
+ * @brief Redirects error messages of the calling thread to a buffer
+ * @param pstrMsg The buffer or NULL
+ */
+extern bool DNETMOD_CC RedirectErrMsg(char *pstrMsg);
+/**
+ * @brief Retrieves #errmsg global variable
+ * @param ulStrSz Size of the buffer
+ * @param strMsg The buffer
+ */
+extern DNETMOD_API void DNETMOD_CC GetErrMsg(unsigned long ulStrSz, char *strMsg);
 
 #endif /* dnmdefs.h */
 
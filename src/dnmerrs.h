@@ -36,6 +36,16 @@
 #define ERR_NOALOCEM        107
 #define ERR_VENDID          108
 #define ERR_DEVTYPE         109
+#define ERR_IOQFULL         110
+#define ERR_DEVFAULT        111
+#define ERR_THREAD          112
+#define ERR_FILE            113
+#define ERR_BUSLOAD         114
+#define ERR_SOCKET          115
+#define ERR_DUPMAC          116
+#define ERR_SIMFAIL         117
+#define ERR_DPMTORN         118
+#define ERR_WOULDBLOCK      119
 
 /* Device specific error codes */
 #define  DERR_OK            0x00
@@ -83,6 +93,16 @@
 #define ESTR_NOALOCEM       "Dev:%hu : Device not using EM connection."
 #define ESTR_VENDID         "%d - No such vendor ID!"
 #define ESTR_DEVTYPE        "%d - No such device type ID!"
+#define ESTR_IOQFULL        "%s: No free slot for I/O queue (maximum %d)."
+#define ESTR_DEVFAULT       "Dev:%hu : Device faulted. Skipped until it responds again."
+#define ESTR_THREAD         "%s: Can't start thread."
+#define ESTR_FILE           "%s: Can't write file '%s'."
+#define ESTR_BUSLOAD        "Dev:%hu : Bus load would be %lu%% exceeding ceiling of %d%%."
+#define ESTR_SOCKET         "%s: Socket error %d."
+#define ESTR_DUPMAC         "Dev:%hu : MAC ID already in use."
+#define ESTR_SIMFAIL        "Dev:%hu : Injected failure in %s."
+#define ESTR_DPMTORN        "Brd:%hu : Input area changed during each of %d reads."
+#define ESTR_WOULDBLOCK     "Dev:%hu : %s would block."
 
 /* DeviceNet device errors */
 #define DESTR_OK            "OK"
@@ -0,0 +1,300 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmhist.cpp               Type        : source            *
+ *  Description : Latency histograms of driver calls.                       *
+ ****************************************************************************/
+
+/**
+ * @file dnmhist.cpp
+ * @brief Latency histograms of driver calls.
+ */
+
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmhist.h"
+
+/** @brief Histogram buckets */
+typedef struct DNM_HISTTag {
+    volatile unsigned long aulBuckets[DNETMOD_HIST_BUCKETS];
+} DNM_HIST;
+
+/** @brief Histograms recorded by a thread */
+typedef struct DNM_HIST_SETTag {
+    struct DNM_HIST_SETTag *pNext;  /**< Next set in the list */
+    /** Histograms allocated on first record */
+    DNM_HIST * volatile apHists[DNM_HOP_COUNT][DNETMOD_HIST_BOARDS][DEVICENET_MAX_DEVICES];
+} DNM_HIST_SET;
+
+/** List of the sets of all threads */
+static DNM_HIST_SET * volatile pHistSets = 0;
+/** Set of the calling thread */
+static DNM_THREAD_LOCAL DNM_HIST_SET *pThreadSet = 0;
+
+/**
+ * @brief Retrieves index of the bucket for a value
+ * @param ullVal The value.
+ * @return Bucket index.
+ */
+static inline int BucketOf(DNM_UINT64 ullVal) {
+    int iMsb = 0;
+
+    if ( ullVal < (1ULL << DNETMOD_HIST_SUB_BITS) )
+        return static_cast<int>(ullVal);
+    if ( ullVal >> (DNETMOD_HIST_MAX_EXP + 1) )
+        return DNETMOD_HIST_BUCKETS - 1;
+
+    for ( DNM_UINT64 ullTmp = ullVal; ullTmp >>= 1; )
+        iMsb++;
+
+    return ((iMsb - DNETMOD_HIST_SUB_BITS + 1) << DNETMOD_HIST_SUB_BITS) +
+           static_cast<int>((ullVal >> (iMsb - DNETMOD_HIST_SUB_BITS)) & ((1 << DNETMOD_HIST_SUB_BITS) - 1));
+}
+
+/**
+ * @brief Retrieves highest value falling in a bucket
+ * @param iBucket Bucket index.
+ * @return The value.
+ */
+static inline DNM_UINT64 BucketHigh(int iBucket) {
+    if ( iBucket < (1 << DNETMOD_HIST_SUB_BITS) )
+        return static_cast<DNM_UINT64>(iBucket);
+
+    int iMsb = (iBucket >> DNETMOD_HIST_SUB_BITS) + DNETMOD_HIST_SUB_BITS - 1;
+    int iShift = iMsb - DNETMOD_HIST_SUB_BITS;
+    DNM_UINT64 ullLow = static_cast<DNM_UINT64>((1 << DNETMOD_HIST_SUB_BITS) + (iBucket & ((1 << DNETMOD_HIST_SUB_BITS) - 1))) << iShift;
+
+    return ullLow + (1ULL << iShift) - 1;
+}
+
+/**
+ * @brief Checks whether a key is valid
+ * @param eOp Kind of call.
+ * @param usBoard Board number.
+ * @param ucMacID MAC ID.
+ * @return True if histograms are kept for the key.
+ */
+static inline bool IsKey(DNM_HIST_OP eOp, unsigned short usBoard, unsigned char ucMacID) {
+    return static_cast<unsigned int>(eOp) < DNM_HOP_COUNT && usBoard < DNETMOD_HIST_BOARDS && ucMacID < DEVICENET_MAX_DEVICES;
+}
+
+/**
+ * @brief Retrieves histogram of a set for a key
+ * @param pSet The set.
+ * @param eOp Kind of call.
+ * @param usBoard Board number.
+ * @param ucMacID MAC ID.
+ * @return Pointer to the histogram or NULL if not recorded yet.
+ */
+static inline DNM_HIST * Find(DNM_HIST_SET *pSet, DNM_HIST_OP eOp, unsigned short usBoard, unsigned char ucMacID) {
+    return static_cast<DNM_HIST *>(DnmAtomicLoadPtr(reinterpret_cast<void * const volatile *>(&pSet->apHists[eOp][usBoard][ucMacID])));
+}
+
+/**
+ * @brief Sums the histograms of all threads for a key
+ * @param eOp Kind of call.
+ * @param usBoard Board number.
+ * @param ucMacID MAC ID.
+ * @param aulSnap Receives count of calls in each bucket.
+ * @return Count of recorded calls.
+ */
+static unsigned long Merge(
+    DNM_HIST_OP    eOp,
+    unsigned short usBoard,
+    unsigned char  ucMacID,
+    unsigned long  aulSnap[DNETMOD_HIST_BUCKETS])
+{
+    unsigned long ulCount = 0;
+    DNM_HIST_SET  *pSet   = static_cast<DNM_HIST_SET *>(DnmAtomicLoadPtr(reinterpret_cast<void * const volatile *>(&pHistSets)));
+
+    memset(aulSnap, 0, DNETMOD_HIST_BUCKETS * sizeof(unsigned long));
+    if ( !IsKey(eOp, usBoard, ucMacID) )
+        return 0;
+
+    for ( ; pSet != 0; pSet = pSet->pNext ) {
+        DNM_HIST *pHist = Find(pSet, eOp, usBoard, ucMacID);
+
+        if ( pHist != 0 )
+            for ( int i = 0; i < DNETMOD_HIST_BUCKETS; i++ ) {
+                unsigned long ulCnt = DnmAtomicLoad(&pHist->aulBuckets[i]);
+
+                aulSnap[i] += ulCnt;
+                ulCount += ulCnt;
+            }
+    }
+
+    return ulCount;
+}
+
+/**
+ * @brief Creates histogram set of the calling thread
+ * @return Pointer to the set.
+ */
+static DNM_HIST_SET * CreateSet(void) {
+    DNM_HIST_SET *pSet = new DNM_HIST_SET();
+
+    do {
+        pSet->pNext = static_cast<DNM_HIST_SET *>(DnmAtomicLoadPtr(reinterpret_cast<void * const volatile *>(&pHistSets)));
+    } while ( !DnmAtomicCasPtr(reinterpret_cast<void * volatile *>(&pHistSets), pSet->pNext, pSet) );
+
+    return pSet;
+}
+
+/**
+ * @brief Records latency of a driver call
+ *
+ * Records in the histograms of the calling thread, which are allocated on
+ * its first record. Only the thread writes them, so recording takes no
+ * locks and no atomic read-modify-write.
+ * @param eOp Kind of call.
+ * @param usBoard Board number.
+ * @param ucMacID MAC ID of the node.
+ * @param ullNs Latency in ns.
+ */
+void DnmHistRecord(DNM_HIST_OP eOp, unsigned short usBoard, unsigned char ucMacID, DNM_UINT64 ullNs) {
+    DNM_HIST_SET *pSet = pThreadSet;
+
+    if ( !IsKey(eOp, usBoard, ucMacID) )
+        return;
+    if ( pSet == 0 )
+        pSet = pThreadSet = CreateSet();
+
+    DNM_HIST *pHist = pSet->apHists[eOp][usBoard][ucMacID];
+
+    if ( pHist == 0 ) {
+        pHist = new DNM_HIST();
+        DnmAtomicCasPtr(reinterpret_cast<void * volatile *>(&pSet->apHists[eOp][usBoard][ucMacID]), 0, pHist);
+    }
+
+    volatile unsigned long *pulBucket = &pHist->aulBuckets[BucketOf(ullNs)];
+
+    DnmAtomicStore(pulBucket, *pulBucket + 1);
+}
+
+/**
+ * @brief Retrieves snapshot of a histogram
+ * @param eOp Kind of call.
+ * @param usBoard Board number.
+ * @param ucMacID MAC ID of the node.
+ * @param pStats Receives the snapshot. All values are zero if nothing was
+ * recorded for the key.
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC
+DnmHistGetStats(
+    DNM_HIST_OP    eOp,
+    unsigned short usBoard,
+    unsigned char  ucMacID,
+    DNM_HIST_STATS *pStats)
+{
+    unsigned long aulSnap[DNETMOD_HIST_BUCKETS];
+
+    if ( pStats == 0 )
+        return SetError(ERR_INVFPRM, "pStats", "NULL", "DnmHistGetStats");
+
+    memset(pStats, 0, sizeof(DNM_HIST_STATS));
+    pStats->ulCount = Merge(eOp, usBoard, ucMacID, aulSnap);
+    for ( int i = 0; i < DNETMOD_HIST_BUCKETS; i++ )
+        if ( aulSnap[i] != 0 )
+            pStats->ullMax = BucketHigh(i);
+    if ( pStats->ulCount == 0 )
+        return SetError(ERR_NOERR);
+
+    /* Ranks of the percentiles (rounded up) */
+    double        adPct[4] = { 50.0, 90.0, 99.0, 99.9 };
+    DNM_UINT64    *apullOut[4] = { &pStats->ullP50, &pStats->ullP90, &pStats->ullP99, &pStats->ullP999 };
+    unsigned long ulSeen = 0;
+    int           iPct   = 0;
+
+    for ( int i = 0; i < DNETMOD_HIST_BUCKETS && iPct < 4; i++ ) {
+        ulSeen += aulSnap[i];
+        while ( iPct < 4 && ulSeen >= static_cast<unsigned long>(pStats->ulCount * adPct[iPct] / 100.0 + 0.999999) ) {
+            *apullOut[iPct] = BucketHigh(i);
+            iPct++;
+        }
+    }
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Retrieves a percentile of a histogram
+ * @param eOp Kind of call.
+ * @param usBoard Board number.
+ * @param ucMacID MAC ID of the node.
+ * @param dPercent Percentile between 0 and 100.
+ * @return Latency in ns under which dPercent of the calls completed or zero
+ * if nothing was recorded.
+ */
+DNETMOD_API DNM_UINT64 DNETMOD_CC
+DnmHistPercentile(
+    DNM_HIST_OP    eOp,
+    unsigned short usBoard,
+    unsigned char  ucMacID,
+    double         dPercent)
+{
+    unsigned long aulSnap[DNETMOD_HIST_BUCKETS];
+    unsigned long ulCount = Merge(eOp, usBoard, ucMacID, aulSnap);
+    unsigned long ulSeen  = 0;
+    unsigned long ulRank  = 0;
+
+    if ( ulCount == 0 )
+        return 0;
+
+    ulRank = static_cast<unsigned long>(ulCount * dPercent / 100.0 + 0.999999);
+    if ( ulRank == 0 )
+        ulRank = 1;
+
+    for ( int i = 0; i < DNETMOD_HIST_BUCKETS; i++ ) {
+        ulSeen += aulSnap[i];
+        if ( ulSeen >= ulRank )
+            return BucketHigh(i);
+    }
+
+    return BucketHigh(DNETMOD_HIST_BUCKETS - 1);
+}
+
+/**
+ * @brief Clears all histograms
+ *
+ * Calls recorded concurrently may be lost.
+ */
+DNETMOD_API void DNETMOD_CC DnmHistReset(void) {
+    DNM_HIST_SET *pSet = static_cast<DNM_HIST_SET *>(DnmAtomicLoadPtr(reinterpret_cast<void * const volatile *>(&pHistSets)));
+
+    for ( ; pSet != 0; pSet = pSet->pNext )
+        for ( int iOp = 0; iOp < DNM_HOP_COUNT; iOp++ )
+            for ( int iBrd = 0; iBrd < DNETMOD_HIST_BOARDS; iBrd++ )
+                for ( int iMac = 0; iMac < DEVICENET_MAX_DEVICES; iMac++ ) {
+                    DNM_HIST *pHist = Find(pSet, static_cast<DNM_HIST_OP>(iOp), static_cast<unsigned short>(iBrd), static_cast<unsigned char>(iMac));
+
+                    if ( pHist != 0 )
+                        for ( int i = 0; i < DNETMOD_HIST_BUCKETS; i++ )
+                            DnmAtomicStore(&pHist->aulBuckets[i], 0);
+                }
+}
+
+/**
+ * @brief Retrieves name of a kind of driver calls
+ * @param eOp Kind of driver calls.
+ * @return Name of the driver function (e.g. "DevExchangeIO").
+ */
+DNETMOD_API const char * DNETMOD_CC DnmHistOpName(DNM_HIST_OP eOp) {
+    static const char * const astrNames[DNM_HOP_COUNT] = {
+        "DevExchangeIO",
+        "DevPutMessage",
+        "DevGetMessage",
+        "DevGetTaskState",
+        "DevReadWriteDPMRaw",
+        "DevControl",
+        "DevReadWriteDPMData"
+    };
+
+    if ( static_cast<unsigned int>(eOp) >= DNM_HOP_COUNT )
+        return "Unknown";
+
+    return astrNames[eOp];
+}
@@ -0,0 +1,125 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmhist.h                 Type        : header            *
+ *  Description : Latency histograms of driver calls.                       *
+ ****************************************************************************/
+
+/**
+ * @file dnmhist.h
+ * @brief Latency histograms of driver calls.
+ *
+ * When the module is compiled with DNETMOD_HISTOGRAMS defined every driver
+ * call is timed and recorded in a histogram kept for the kind of the call,
+ * the board and the MAC ID of the node on which behalf the call is made.
+ * Histograms are log-linear: each power of two is divided in
+ * 2^#DNETMOD_HIST_SUB_BITS buckets, so the relative error of reported
+ * values is below 12.5%. Each thread records in histograms of its own,
+ * which are merged when read, so recording takes no locks and the threads
+ * (e.g. the I/O thread and the supervisor) do not contend for counters.
+ * Without DNETMOD_HISTOGRAMS the driver calls are not instrumented at all
+ * and the snapshot functions report empty histograms. Likewise the driver
+ * calls are counted in the metrics (see dnmmetrics.h) only when the module
+ * is compiled with DNETMOD_DRV_METRICS.
+ */
+
+#ifndef DNETMOD_HIST_HEADER
+#define DNETMOD_HIST_HEADER 1
+
+#include "dnmdefs.h"
+#include "dnmos.h"
+#include "dnmtrace.h"
+#include "dnmmetrics.h"
+
+/** Kinds of driver calls */
+typedef enum DNM_HIST_OPTag {
+    DNM_HOP_EXCHANGE,   //!< DevExchangeIO
+    DNM_HOP_PUTMSG,     //!< DevPutMessage
+    DNM_HOP_GETMSG,     //!< DevGetMessage
+    DNM_HOP_TASKSTATE,  //!< DevGetTaskState
+    DNM_HOP_DPMRAW,     //!< DevReadWriteDPMRaw
+    DNM_HOP_CONTROL,    //!< Driver, board and host state control calls
+    DNM_HOP_DPMDATA,    //!< DevReadWriteDPMData
+    DNM_HOP_COUNT
+} DNM_HIST_OP;
+
+/** Maximum count of boards with histograms */
+#define DNETMOD_HIST_BOARDS     4
+/** Bits of sub-bucket index (buckets per power of two is 2^bits) */
+#define DNETMOD_HIST_SUB_BITS   3
+/** Highest power of two covered by histograms (2^40 ns is about 18 min) */
+#define DNETMOD_HIST_MAX_EXP    40
+/** Count of buckets in a histogram */
+#define DNETMOD_HIST_BUCKETS    ((DNETMOD_HIST_MAX_EXP - DNETMOD_HIST_SUB_BITS + 2) << DNETMOD_HIST_SUB_BITS)
+
+/** @brief Snapshot of a latency histogram */
+typedef struct DNM_HIST_STATSTag {
+    unsigned long ulCount;  /**< Recorded calls               */
+    DNM_UINT64    ullP50;   /**< Median latency in ns         */
+    DNM_UINT64    ullP90;   /**< 90th percentile in ns        */
+    DNM_UINT64    ullP99;   /**< 99th percentile in ns        */
+    DNM_UINT64    ullP999;  /**< 99.9th percentile in ns      */
+    DNM_UINT64    ullMax;   /**< Highest recorded latency     */
+} DNM_HIST_STATS;
+
+void DnmHistRecord(DNM_HIST_OP eOp, unsigned short usBoard, unsigned char ucMacID, DNM_UINT64 ullNs);
+
+DNETMOD_API int DNETMOD_CC
+DnmHistGetStats(DNM_HIST_OP    eOp,
+                unsigned short usBoard,
+                unsigned char  ucMacID,
+                DNM_HIST_STATS *pStats);
+
+DNETMOD_API DNM_UINT64 DNETMOD_CC
+DnmHistPercentile(DNM_HIST_OP    eOp,
+                  unsigned short usBoard,
+                  unsigned char  ucMacID,
+                  double         dPercent);
+
+DNETMOD_API void DNETMOD_CC DnmHistReset(void);
+
+DNETMOD_API const char * DNETMOD_CC DnmHistOpName(DNM_HIST_OP eOp);
+
+#if defined(DNETMOD_HISTOGRAMS)
+#define DNM_HIST_RECORD(op, brd, mac, ns) DnmHistRecord((op), (brd), (mac), (ns))
+#else
+#define DNM_HIST_RECORD(op, brd, mac, ns)
+#endif
+
+#if defined(DNETMOD_DRV_METRICS)
+#define DNM_METRICS_DRV_CALL(op, brd, res) DnmMetricsDriverCall((op), (brd), (res))
+#else
+#define DNM_METRICS_DRV_CALL(op, brd, res)
+#endif
+
+/**
+ * @brief Makes a driver call and records its latency
+ *
+ * The call is counted in the metrics (see dnmmetrics.h), recorded in its
+ * histogram and as a trace span, when the module is compiled with
+ * DNETMOD_DRV_METRICS, DNETMOD_HISTOGRAMS or DNETMOD_TRACE respectively.
+ * Otherwise it is a plain assignment.
+ * @param res Variable receiving the result of the call.
+ * @param op Kind of the call (see #DNM_HIST_OP).
+ * @param brd Board number.
+ * @param mac MAC ID of the node.
+ * @param call The call.
+ */
+#if defined(DNETMOD_HISTOGRAMS) || defined(DNETMOD_TRACE)
+#define DNM_DRV_CALL(res, op, brd, mac, call) do {                      \
+    DNM_UINT64 ullStart_ = DnmTimeNs();                                 \
+    (res) = (call);                                                     \
+    DNM_UINT64 ullEnd_ = DnmTimeNs();                                   \
+    DNM_HIST_RECORD((op), (brd), (mac), ullEnd_ - ullStart_);           \
+    DNM_TRACE_SPAN(DnmHistOpName(op), (brd), (mac), ullStart_, ullEnd_); \
+    DNM_METRICS_DRV_CALL((op), (brd), (res));                           \
+} while ( 0 )
+#else
+#define DNM_DRV_CALL(res, op, brd, mac, call) do {                      \
+    (res) = (call);                                                     \
+    DNM_METRICS_DRV_CALL((op), (brd), (res));                           \
+} while ( 0 )
+#endif
+
+#endif /* dnmhist.h */
@@ -0,0 +1,344 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmiomap.h                Type        : header            *
+ *  Description : Typed I/O assembly maps.                                  *
+ ****************************************************************************/
+
+/**
+ * @file dnmiomap.h
+ * @brief Typed I/O assembly maps.
+ *
+ * Templates for declaring the layout of a produced or consumed I/O assembly
+ * of a device as a chain of typed fields. Offsets and sizes of the fields
+ * are computed by the compiler and the accessors are inline, so decoding a
+ * field compiles to loads from the process image at constant offsets. The
+ * data is always decoded as little endian, as DeviceNet transfers it,
+ * regardless of the host byte order.
+ *
+ * Each field is declared after the previous one (DnmIOBegin for the first)
+ * and the layout is closed with DnmIOLayout, which checks at compile time
+ * that the fields take exactly the declared size of the assembly:
+ * @code
+ * typedef DnmIOField<DnmIO_USINT, DnmIOBegin> Status;
+ * typedef DnmIOBit<Status, 0>                 Running;
+ * typedef DnmIOField<DnmIO_INT, Status>       Speed;
+ * typedef DnmIOField<DnmIO_REAL, Speed>       Torque;
+ * typedef DnmIOLayout<Torque, 7>              DriveInput;
+ *
+ * DnmIOImage<DriveInput> Input;
+ * if ( DriveInput::MatchesInput(pDevice) &&
+ *      Input.Read(pDevice) == 0 && Input.Get<Running>() )
+ *     printf("%d rpm\n", Input.Get<Speed>());
+ * @endcode
+ * The module is compiled as C++98, so the size checks are done with
+ * DNM_IO_STATIC_CHECK instead of static_assert and the connection sizes of
+ * a node, which are known only at run time, are checked with
+ * DnmIOLayout::MatchesInput and DnmIOLayout::MatchesOutput.
+ */
+
+#ifndef DNETMOD_IOMAP_HEADER
+#define DNETMOD_IOMAP_HEADER 1
+
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "cnode.h"
+#include "cdevice.h"
+
+#ifndef COMPILER_CPP
+#error "error: File dnmiomap.h requires c++ compiler!"
+#endif
+
+/** @brief Helper of DNM_IO_STATIC_CHECK. Defined only for true */
+template<bool bCond> struct DnmIOStaticCheck;
+template<> struct DnmIOStaticCheck<true> { enum { OK = 1 }; };
+
+/**
+ * @brief Compile time check
+ *
+ * Declares an enumerator, which needs the size of an incomplete type when
+ * the condition is false, so the compilation fails with the name of the
+ * check in the message. Could be used in class and in function scope.
+ * @param cond Constant condition
+ * @param name Name of the check
+ */
+#define DNM_IO_STATIC_CHECK(cond, name) \
+    enum { name = sizeof(DnmIOStaticCheck<(cond)>) }
+
+/**
+ * @name Little endian access
+ * @{
+ */
+/** @brief Reads 16 bits little endian value */
+inline unsigned short DnmIOGet16(const unsigned char *pucSrc) {
+    return static_cast<unsigned short>(pucSrc[0] | (pucSrc[1] << 8));
+}
+
+/** @brief Reads 32 bits little endian value */
+inline unsigned int DnmIOGet32(const unsigned char *pucSrc) {
+    return static_cast<unsigned int>(pucSrc[0])
+         | (static_cast<unsigned int>(pucSrc[1]) << 8)
+         | (static_cast<unsigned int>(pucSrc[2]) << 16)
+         | (static_cast<unsigned int>(pucSrc[3]) << 24);
+}
+
+/** @brief Writes 16 bits little endian value */
+inline void DnmIOPut16(unsigned char *pucDst, unsigned short usVal) {
+    pucDst[0] = static_cast<unsigned char>(usVal);
+    pucDst[1] = static_cast<unsigned char>(usVal >> 8);
+}
+
+/** @brief Writes 32 bits little endian value */
+inline void DnmIOPut32(unsigned char *pucDst, unsigned int uiVal) {
+    pucDst[0] = static_cast<unsigned char>(uiVal);
+    pucDst[1] = static_cast<unsigned char>(uiVal >> 8);
+    pucDst[2] = static_cast<unsigned char>(uiVal >> 16);
+    pucDst[3] = static_cast<unsigned char>(uiVal >> 24);
+}
+/** @} */
+
+/**
+ * @name Data types
+ * Elementary data types of the assemblies. Each type gives the C++ type of
+ * the values (ValueType), its size in the assembly (SIZE) and functions to
+ * decode and encode a value.
+ * @{
+ */
+/** @brief USINT - unsigned 8 bits integer */
+struct DnmIO_USINT {
+    typedef unsigned char ValueType;
+    enum { SIZE = 1 };
+    static ValueType Decode(const unsigned char *pucSrc) { return pucSrc[0]; }
+    static void Encode(unsigned char *pucDst, ValueType Val) { pucDst[0] = Val; }
+};
+
+/** @brief SINT - signed 8 bits integer */
+struct DnmIO_SINT {
+    typedef signed char ValueType;
+    enum { SIZE = 1 };
+    static ValueType Decode(const unsigned char *pucSrc) {
+        return static_cast<ValueType>(pucSrc[0]);
+    }
+    static void Encode(unsigned char *pucDst, ValueType Val) {
+        pucDst[0] = static_cast<unsigned char>(Val);
+    }
+};
+
+/** @brief UINT - unsigned 16 bits integer */
+struct DnmIO_UINT {
+    typedef unsigned short ValueType;
+    enum { SIZE = 2 };
+    static ValueType Decode(const unsigned char *pucSrc) { return DnmIOGet16(pucSrc); }
+    static void Encode(unsigned char *pucDst, ValueType Val) { DnmIOPut16(pucDst, Val); }
+};
+
+/** @brief INT - signed 16 bits integer */
+struct DnmIO_INT {
+    typedef short ValueType;
+    enum { SIZE = 2 };
+    static ValueType Decode(const unsigned char *pucSrc) {
+        return static_cast<ValueType>(DnmIOGet16(pucSrc));
+    }
+    static void Encode(unsigned char *pucDst, ValueType Val) {
+        DnmIOPut16(pucDst, static_cast<unsigned short>(Val));
+    }
+};
+
+/** @brief UDINT - unsigned 32 bits integer */
+struct DnmIO_UDINT {
+    typedef unsigned int ValueType;
+    enum { SIZE = 4 };
+    static ValueType Decode(const unsigned char *pucSrc) { return DnmIOGet32(pucSrc); }
+    static void Encode(unsigned char *pucDst, ValueType Val) { DnmIOPut32(pucDst, Val); }
+};
+
+/** @brief DINT - signed 32 bits integer */
+struct DnmIO_DINT {
+    typedef int ValueType;
+    enum { SIZE = 4 };
+    static ValueType Decode(const unsigned char *pucSrc) {
+        return static_cast<ValueType>(DnmIOGet32(pucSrc));
+    }
+    static void Encode(unsigned char *pucDst, ValueType Val) {
+        DnmIOPut32(pucDst, static_cast<unsigned int>(Val));
+    }
+};
+
+/** @brief REAL - IEEE 754 single precision floating point */
+struct DnmIO_REAL {
+    typedef float ValueType;
+    enum { SIZE = 4 };
+    static ValueType Decode(const unsigned char *pucSrc) {
+        unsigned int uiBits = DnmIOGet32(pucSrc);
+        ValueType Val;
+        memcpy(&Val, &uiBits, sizeof(Val));
+        return Val;
+    }
+    static void Encode(unsigned char *pucDst, ValueType Val) {
+        unsigned int uiBits;
+        memcpy(&uiBits, &Val, sizeof(uiBits));
+        DnmIOPut32(pucDst, uiBits);
+    }
+};
+
+/** BYTE - bit string of 8 bits */
+typedef DnmIO_USINT DnmIO_BYTE;
+/** WORD - bit string of 16 bits */
+typedef DnmIO_UINT  DnmIO_WORD;
+/** DWORD - bit string of 32 bits */
+typedef DnmIO_UDINT DnmIO_DWORD;
+/** @} */
+
+/** @brief Start of an assembly. Used as previous field of the first field */
+struct DnmIOBegin {
+    enum { OFFSET = 0, SIZE = 0, END = 0 };
+};
+
+/**
+ * @brief Typed field of an assembly
+ *
+ * Field of type Type placed right after field Prev.
+ * @param Type Data type of the field (see DnmIO_USINT, DnmIO_INT, etc.)
+ * @param Prev Previous field or DnmIOBegin
+ */
+template<class Type, class Prev>
+struct DnmIOField {
+    typedef typename Type::ValueType ValueType;
+    enum {
+        OFFSET = Prev::END,             /**< Offset in the assembly */
+        SIZE   = Type::SIZE,            /**< Size in bytes */
+        END    = Prev::END + Type::SIZE /**< Offset after the field */
+    };
+
+    /** @brief Decodes the field from process image */
+    static ValueType Get(const unsigned char *pucImage) {
+        return Type::Decode(pucImage + OFFSET);
+    }
+
+    /** @brief Encodes the field into process image */
+    static void Set(unsigned char *pucImage, ValueType Val) {
+        Type::Encode(pucImage + OFFSET, Val);
+    }
+};
+
+/**
+ * @brief Single bit of a field
+ *
+ * Bit number ucBit (from the least significant bit of the first byte) of a
+ * bit string or integer field. The bit takes no space in the assembly, so
+ * it could not be used as previous field.
+ * @param Field Field holding the bit
+ * @param ucBit Bit number
+ */
+template<class Field, unsigned char ucBit>
+struct DnmIOBit {
+    typedef bool ValueType;
+    enum {
+        OFFSET = Field::OFFSET + ucBit / 8, /**< Offset of the byte holding the bit */
+        END    = Field::END,                /**< Offset after the field */
+        MASK   = 1 << (ucBit % 8)           /**< Mask of the bit in the byte */
+    };
+    DNM_IO_STATIC_CHECK(ucBit < 8 * static_cast<int>(Field::SIZE), DnmIOBitOutOfField);
+
+    /** @brief Reads the bit from process image */
+    static ValueType Get(const unsigned char *pucImage) {
+        return ( (pucImage[OFFSET] & MASK) != 0 );
+    }
+
+    /** @brief Writes the bit into process image */
+    static void Set(unsigned char *pucImage, ValueType bVal) {
+        if ( bVal )
+            pucImage[OFFSET] |= static_cast<unsigned char>(MASK);
+        else
+            pucImage[OFFSET] &= static_cast<unsigned char>(~MASK);
+    }
+};
+
+/**
+ * @brief Layout of an assembly
+ *
+ * Closes the chain of fields. Compilation fails when the fields do not take
+ * exactly usSize bytes.
+ * @param Last Last field of the assembly
+ * @param usSize Declared size of the assembly in bytes
+ */
+template<class Last, unsigned short usSize>
+struct DnmIOLayout {
+    enum { SIZE = usSize /**< Size of the assembly in bytes */ };
+    DNM_IO_STATIC_CHECK(static_cast<int>(Last::END) == usSize, DnmIOLayoutSizeMismatch);
+
+    /**
+     * @brief Checks the layout of an input assembly against a device
+     *
+     * Input data read with CDevice::ReadIOData has the consumed
+     * connection size of the device.
+     * @param pNode Node
+     * @return True when the sizes match otherwise false
+     */
+    static bool MatchesInput(const CNode *pNode) {
+        return ( pNode->GetConsumedConnSize() == SIZE );
+    }
+
+    /**
+     * @brief Checks the layout of an output assembly against a device
+     *
+     * Output data written with CDevice::WriteIOData has the produced
+     * connection size of the device.
+     * @param pNode Node
+     * @return True when the sizes match otherwise false
+     */
+    static bool MatchesOutput(const CNode *pNode) {
+        return ( pNode->GetProducedConnSize() == SIZE );
+    }
+};
+
+/**
+ * @brief Process image of an assembly
+ *
+ * Buffer of the size of the layout with typed access to its fields and
+ * transfer to and from a device.
+ * @param Layout Layout of the assembly (see DnmIOLayout)
+ */
+template<class Layout>
+class DnmIOImage {
+public:
+    /** Process image */
+    unsigned char aucData[Layout::SIZE];
+
+    /** @brief Constructor. Clears the process image */
+    DnmIOImage() { memset(aucData, 0, sizeof(aucData)); }
+
+    /** @brief Decodes a field of the layout */
+    template<class Field>
+    typename Field::ValueType Get(void) const {
+        DNM_IO_STATIC_CHECK(static_cast<int>(Field::END) <= static_cast<int>(Layout::SIZE), DnmIOFieldOutOfLayout);
+        return Field::Get(aucData);
+    }
+
+    /** @brief Encodes a field of the layout */
+    template<class Field>
+    void Set(typename Field::ValueType Val) {
+        DNM_IO_STATIC_CHECK(static_cast<int>(Field::END) <= static_cast<int>(Layout::SIZE), DnmIOFieldOutOfLayout);
+        Field::Set(aucData, Val);
+    }
+
+    /**
+     * @brief Reads the process image from device (see CDevice::ReadIOData)
+     * @return Zero on success otherwise error code
+     */
+    int Read(CDevice *pDevice) {
+        return pDevice->ReadIOData(sizeof(aucData), aucData);
+    }
+
+    /**
+     * @brief Writes the process image to device (see CDevice::WriteIOData)
+     * @return Zero on success otherwise error code
+     */
+    int Write(CDevice *pDevice) {
+        return pDevice->WriteIOData(sizeof(aucData), aucData);
+    }
+};
+
+#endif /* dnmiomap.h */
@@ -0,0 +1,431 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmmetrics.cpp            Type        : source            *
+ *  Description : Metrics in Prometheus text format.                        *
+ ****************************************************************************/
+
+/**
+ * @file dnmmetrics.cpp
+ * @brief Metrics in Prometheus text format.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmos.h"
+#include "dnmhist.h"
+#include "dnmmetrics.h"
+
+#if defined(OS_LINUX)
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#if defined(COMPILER_MSC)
+#define vsnprintf _vsnprintf
+#endif
+
+/** @brief Count of a driver status */
+typedef struct DNM_MET_STATUSTag {
+    volatile unsigned long ulKey;   /**< Status with bit 16 set, zero if free */
+    volatile unsigned long ulCount; /**< Times the status was returned        */
+} DNM_MET_STATUS;
+
+/** @brief Output buffer of the renderer */
+typedef struct DNM_MET_OUTTag {
+    char          *strBuf;  /**< Buffer                                   */
+    unsigned long ulSz;     /**< Size of the buffer                       */
+    unsigned long ulLen;    /**< Length of the output (even if truncated) */
+} DNM_MET_OUT;
+
+/** Board counters */
+static volatile unsigned long aulCounters[DNM_MET_COUNT][DNETMOD_METRICS_BOARDS];
+/** Driver calls by kind */
+static volatile unsigned long aulDrvCalls[DNM_HOP_COUNT][DNETMOD_METRICS_BOARDS];
+/** Driver statuses other than success */
+static DNM_MET_STATUS aStatuses[DNETMOD_METRICS_BOARDS][DNETMOD_METRICS_STATUSES];
+/** Errors by code */
+static volatile unsigned long aulErrors[DNETMOD_METRICS_ERRORS];
+/** Device states */
+static volatile unsigned char aucDevStates[DNETMOD_METRICS_BOARDS][DEVICENET_MAX_DEVICES];
+
+/**
+ * @brief Adds to a board counter
+ * @param eMet The counter.
+ * @param usBoard Board number.
+ * @param ulVal Value to be added.
+ */
+void DnmMetricsAdd(DNM_METRIC eMet, unsigned short usBoard, unsigned long ulVal) {
+    if ( static_cast<unsigned int>(eMet) < DNM_MET_COUNT && usBoard < DNETMOD_METRICS_BOARDS )
+        DnmAtomicAdd(&aulCounters[eMet][usBoard], ulVal);
+}
+
+/**
+ * @brief Counts a driver call and its status
+ *
+ * Called through DNM_DRV_CALL.
+ * @param iOp Kind of the call (see #DNM_HIST_OP).
+ * @param usBoard Board number.
+ * @param sStatus Status returned by the driver.
+ */
+void DnmMetricsDriverCall(int iOp, unsigned short usBoard, short sStatus) {
+    if ( static_cast<unsigned int>(iOp) >= DNM_HOP_COUNT || usBoard >= DNETMOD_METRICS_BOARDS )
+        return;
+
+    DnmAtomicAdd(&aulDrvCalls[iOp][usBoard], 1);
+    if ( sStatus == 0 )
+        return;
+
+    /* Find or claim slot of the status (open addressing) */
+    unsigned long ulKey = static_cast<unsigned short>(sStatus) | 0x10000UL;
+    unsigned int  uiIdx = static_cast<unsigned short>(sStatus) % DNETMOD_METRICS_STATUSES;
+
+    for ( int i = 0; i < DNETMOD_METRICS_STATUSES; i++ ) {
+        DNM_MET_STATUS *pSlot = &aStatuses[usBoard][(uiIdx + i) % DNETMOD_METRICS_STATUSES];
+        unsigned long  ulOld  = DnmAtomicLoad(&pSlot->ulKey);
+
+        if ( ulOld == 0 && DnmAtomicCas(&pSlot->ulKey, 0, ulKey) )
+            ulOld = ulKey;
+        else if ( ulOld == 0 )
+            ulOld = DnmAtomicLoad(&pSlot->ulKey);
+        if ( ulOld == ulKey ) {
+            DnmAtomicAdd(&pSlot->ulCount, 1);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Counts an error
+ *
+ * Called by \ref SetError function.
+ * @param lErrCode Error code.
+ */
+void DnmMetricsError(long lErrCode) {
+    if ( lErrCode > 0 && lErrCode < DNETMOD_METRICS_ERRORS )
+        DnmAtomicAdd(&aulErrors[lErrCode], 1);
+}
+
+/**
+ * @brief Sets state of a device
+ * @param usBoard Board number.
+ * @param ucMacID MAC ID of the device.
+ * @param eState The state.
+ */
+void DnmMetricsDevState(unsigned short usBoard, unsigned char ucMacID, DNM_DEV_STATE eState) {
+    if ( usBoard < DNETMOD_METRICS_BOARDS && ucMacID < DEVICENET_MAX_DEVICES )
+        aucDevStates[usBoard][ucMacID] = static_cast<unsigned char>(eState);
+}
+
+/**
+ * @brief Appends formatted text to the output
+ *
+ * Text which doesn't fit is counted in the length, but not written.
+ * @param pOut The output.
+ * @param strFmt Format string.
+ */
+static void Out(DNM_MET_OUT *pOut, const char *strFmt, ...) {
+    char    strLine[256];
+    va_list pArgList;
+    int     iLen = 0;
+
+    va_start(pArgList, strFmt);
+    iLen = vsnprintf(strLine, sizeof(strLine), strFmt, pArgList);
+    va_end(pArgList);
+    if ( iLen < 0 || iLen >= static_cast<int>(sizeof(strLine)) )
+        iLen = sizeof(strLine) - 1;
+
+    if ( pOut->ulLen + iLen < pOut->ulSz )
+        memcpy(pOut->strBuf + pOut->ulLen, strLine, iLen);
+    pOut->ulLen += iLen;
+}
+
+/**
+ * @brief Renders metrics in Prometheus text exposition format
+ *
+ * Counters are read without locks, so values updated concurrently may be
+ * from slightly different points in time.
+ * @param ulBufSz Size of the buffer.
+ * @param strBuf Buffer receiving the text (null terminated).
+ * @param pulLen Receives length of the text without the terminating null
+ * character, even if it didn't fit in the buffer. May be NULL.
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC
+DnmMetricsRender(unsigned long ulBufSz, char *strBuf, unsigned long *pulLen) {
+    static const char * const astrDirs[2] = { "in", "out" };
+    static const char * const astrStates[4] = { "none", "connected", "disconnected", "faulted" };
+    DNM_MET_OUT Output = { strBuf, ulBufSz, 0 };
+    DNM_MET_OUT *pOut  = &Output;
+
+    if ( strBuf == 0 || ulBufSz == 0 )
+        return SetError(ERR_INVFPRM, "strBuf", "NULL", "DnmMetricsRender");
+
+    Out(pOut, "# HELP dnetmod_exchanges_total I/O data exchanges.\n");
+    Out(pOut, "# TYPE dnetmod_exchanges_total counter\n");
+    for ( int iBrd = 0; iBrd < DNETMOD_METRICS_BOARDS; iBrd++ )
+        for ( int iDir = 0; iDir < 2; iDir++ )
+            Out(pOut, "dnetmod_exchanges_total{board=\"%d\",dir=\"%s\"} %lu\n", iBrd, astrDirs[iDir],
+                DnmAtomicLoad(&aulCounters[DNM_MET_EXCH_IN + iDir][iBrd]));
+
+    Out(pOut, "# HELP dnetmod_exchange_bytes_total I/O data bytes exchanged.\n");
+    Out(pOut, "# TYPE dnetmod_exchange_bytes_total counter\n");
+    for ( int iBrd = 0; iBrd < DNETMOD_METRICS_BOARDS; iBrd++ )
+        for ( int iDir = 0; iDir < 2; iDir++ )
+            Out(pOut, "dnetmod_exchange_bytes_total{board=\"%d\",dir=\"%s\"} %lu\n", iBrd, astrDirs[iDir],
+                DnmAtomicLoad(&aulCounters[DNM_MET_BYTES_IN + iDir][iBrd]));
+
+#if defined(DNETMOD_DRV_METRICS)
+    Out(pOut, "# HELP dnetmod_driver_calls_total Driver calls by function.\n");
+    Out(pOut, "# TYPE dnetmod_driver_calls_total counter\n");
+    for ( int iBrd = 0; iBrd < DNETMOD_METRICS_BOARDS; iBrd++ )
+        for ( int iOp = 0; iOp < DNM_HOP_COUNT; iOp++ )
+            Out(pOut, "dnetmod_driver_calls_total{board=\"%d\",call=\"%s\"} %lu\n", iBrd,
+                DnmHistOpName(static_cast<DNM_HIST_OP>(iOp)), DnmAtomicLoad(&aulDrvCalls[iOp][iBrd]));
+
+    Out(pOut, "# HELP dnetmod_driver_status_total Driver calls by status other than success.\n");
+    Out(pOut, "# TYPE dnetmod_driver_status_total counter\n");
+    for ( int iBrd = 0; iBrd < DNETMOD_METRICS_BOARDS; iBrd++ )
+        for ( int i = 0; i < DNETMOD_METRICS_STATUSES; i++ ) {
+            unsigned long ulKey = DnmAtomicLoad(&aStatuses[iBrd][i].ulKey);
+
+            if ( ulKey != 0 )
+                Out(pOut, "dnetmod_driver_status_total{board=\"%d\",status=\"%d\"} %lu\n", iBrd,
+                    static_cast<short>(ulKey & 0xFFFFUL), DnmAtomicLoad(&aStatuses[iBrd][i].ulCount));
+        }
+#endif
+
+    Out(pOut, "# HELP dnetmod_timeouts_total Driver timeouts.\n");
+    Out(pOut, "# TYPE dnetmod_timeouts_total counter\n");
+    for ( int iBrd = 0; iBrd < DNETMOD_METRICS_BOARDS; iBrd++ )
+        Out(pOut, "dnetmod_timeouts_total{board=\"%d\"} %lu\n", iBrd,
+            DnmAtomicLoad(&aulCounters[DNM_MET_TIMEOUTS][iBrd]));
+
+    Out(pOut, "# HELP dnetmod_errors_total Errors returned by the module by code (ERR_*).\n");
+    Out(pOut, "# TYPE dnetmod_errors_total counter\n");
+    for ( int iErr = 1; iErr < DNETMOD_METRICS_ERRORS; iErr++ ) {
+        unsigned long ulCnt = DnmAtomicLoad(&aulErrors[iErr]);
+
+        if ( ulCnt != 0 )
+            Out(pOut, "dnetmod_errors_total{code=\"%d\"} %lu\n", iErr, ulCnt);
+    }
+
+    Out(pOut, "# HELP dnetmod_device_state State of allocated devices.\n");
+    Out(pOut, "# TYPE dnetmod_device_state gauge\n");
+    for ( int iBrd = 0; iBrd < DNETMOD_METRICS_BOARDS; iBrd++ )
+        for ( int iMac = 0; iMac < DEVICENET_MAX_DEVICES; iMac++ ) {
+            unsigned char ucState = aucDevStates[iBrd][iMac];
+
+            if ( ucState != DNM_DEVST_NONE && ucState <= DNM_DEVST_FAULTED )
+                for ( int iSt = DNM_DEVST_CONNECTED; iSt <= DNM_DEVST_FAULTED; iSt++ )
+                    Out(pOut, "dnetmod_device_state{board=\"%d\",mac=\"%d\",state=\"%s\"} %d\n",
+                        iBrd, iMac, astrStates[iSt], iSt == ucState);
+        }
+
+#if defined(DNETMOD_HISTOGRAMS)
+    Out(pOut, "# HELP dnetmod_driver_call_seconds Latency of driver calls.\n");
+    Out(pOut, "# TYPE dnetmod_driver_call_seconds summary\n");
+    for ( int iOp = 0; iOp < DNM_HOP_COUNT; iOp++ )
+        for ( int iBrd = 0; iBrd < DNETMOD_HIST_BOARDS; iBrd++ )
+            for ( int iMac = 0; iMac < DEVICENET_MAX_DEVICES; iMac++ ) {
+                DNM_HIST_STATS Stats;
+                const char     *strOp = DnmHistOpName(static_cast<DNM_HIST_OP>(iOp));
+
+                DnmHistGetStats(static_cast<DNM_HIST_OP>(iOp), static_cast<unsigned short>(iBrd),
+                                static_cast<unsigned char>(iMac), &Stats);
+                if ( Stats.ulCount == 0 )
+                    continue;
+
+                Out(pOut, "dnetmod_driver_call_seconds{board=\"%d\",mac=\"%d\",call=\"%s\",quantile=\"0.5\"} %.9f\n",
+                    iBrd, iMac, strOp, Stats.ullP50 / 1e9);
+                Out(pOut, "dnetmod_driver_call_seconds{board=\"%d\",mac=\"%d\",call=\"%s\",quantile=\"0.9\"} %.9f\n",
+                    iBrd, iMac, strOp, Stats.ullP90 / 1e9);
+                Out(pOut, "dnetmod_driver_call_seconds{board=\"%d\",mac=\"%d\",call=\"%s\",quantile=\"0.99\"} %.9f\n",
+                    iBrd, iMac, strOp, Stats.ullP99 / 1e9);
+                Out(pOut, "dnetmod_driver_call_seconds{board=\"%d\",mac=\"%d\",call=\"%s\",quantile=\"0.999\"} %.9f\n",
+                    iBrd, iMac, strOp, Stats.ullP999 / 1e9);
+                Out(pOut, "dnetmod_driver_call_seconds_count{board=\"%d\",mac=\"%d\",call=\"%s\"} %lu\n",
+                    iBrd, iMac, strOp, Stats.ulCount);
+            }
+#endif
+
+    if ( pulLen != 0 )
+        *pulLen = pOut->ulLen;
+    if ( pOut->ulLen >= ulBufSz ) {
+        char cBuf[24] = {0};
+
+        strBuf[ulBufSz - 1] = 0;
+        sprintf(cBuf, "%lu", ulBufSz);
+        return SetError(ERR_INVFPRM, "ulBufSz", cBuf, "DnmMetricsRender");
+    }
+    strBuf[pOut->ulLen] = 0;
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Clears all counters
+ *
+ * Device states are kept. Updates made concurrently may be lost.
+ */
+DNETMOD_API void DNETMOD_CC DnmMetricsReset(void) {
+    for ( int iBrd = 0; iBrd < DNETMOD_METRICS_BOARDS; iBrd++ ) {
+        for ( int iMet = 0; iMet < DNM_MET_COUNT; iMet++ )
+            DnmAtomicStore(&aulCounters[iMet][iBrd], 0);
+        for ( int iOp = 0; iOp < DNM_HOP_COUNT; iOp++ )
+            DnmAtomicStore(&aulDrvCalls[iOp][iBrd], 0);
+        for ( int i = 0; i < DNETMOD_METRICS_STATUSES; i++ )
+            DnmAtomicStore(&aStatuses[iBrd][i].ulCount, 0);
+    }
+    for ( int iErr = 0; iErr < DNETMOD_METRICS_ERRORS; iErr++ )
+        DnmAtomicStore(&aulErrors[iErr], 0);
+}
+
+#if defined(OS_LINUX)
+/** Listening socket of the metrics server */
+static int iSrvSock = -1;
+/** Metrics server thread */
+static DNM_THREAD hServer;
+/** Flag showing whether metrics server runs */
+static volatile bool bServing = false;
+
+/**
+ * @brief Answers a scrape request
+ * @param iSock Connected socket.
+ */
+static void ServeRequest(int iSock) {
+    char          strReq[1024];
+    char          strHdr[160];
+    unsigned long ulSz  = 16384;
+    unsigned long ulLen = 0;
+    char          *strBody = 0;
+
+    /* Request is not parsed, every request gets the metrics */
+    if ( recv(iSock, strReq, sizeof(strReq), 0) <= 0 )
+        return;
+
+    for ( int iTry = 0; iTry < 3; iTry++ ) {
+        char *strNew = static_cast<char *>(realloc(strBody, ulSz));
+
+        if ( strNew == 0 )
+            break;
+        strBody = strNew;
+        if ( DnmMetricsRender(ulSz, strBody, &ulLen) == ERR_NOERR )
+            break;
+        ulSz = ulLen + 1024;
+    }
+
+    if ( strBody != 0 && ulLen < ulSz ) {
+        int iHdr = sprintf(strHdr, "HTTP/1.0 200 OK\r\n"
+                                   "Content-Type: text/plain; version=0.0.4\r\n"
+                                   "Content-Length: %lu\r\n"
+                                   "Connection: close\r\n\r\n", ulLen);
+
+        if ( send(iSock, strHdr, iHdr, MSG_NOSIGNAL) == iHdr )
+            send(iSock, strBody, ulLen, MSG_NOSIGNAL);
+    }
+    else {
+        const char strErr[] = "HTTP/1.0 500 Internal Server Error\r\nConnection: close\r\n\r\n";
+
+        send(iSock, strErr, sizeof(strErr) - 1, MSG_NOSIGNAL);
+    }
+    free(strBody);
+}
+
+/**
+ * @brief Thread function of the metrics server
+ *
+ * Serves one connection at a time and checks for stop request every
+ * 200 ms.
+ * @return Nothing meaningful.
+ */
+static DNM_THREAD_RET DNM_THREAD_CC ServerProc(void *) {
+    while ( bServing ) {
+        struct pollfd Pfd;
+
+        Pfd.fd = iSrvSock;
+        Pfd.events = POLLIN;
+        Pfd.revents = 0;
+        if ( poll(&Pfd, 1, 200) <= 0 )
+            continue;
+
+        int iSock = accept(iSrvSock, 0, 0);
+
+        if ( iSock < 0 )
+            continue;
+        ServeRequest(iSock);
+        close(iSock);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Starts serving metrics over HTTP
+ *
+ * The server listens on the loopback address only and answers every
+ * request (e.g. GET /metrics) with the output of DnmMetricsRender.
+ * @param usPort TCP port.
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC DnmMetricsServe(unsigned short usPort) {
+    struct sockaddr_in Addr;
+    int                iOn = 1;
+
+    if ( bServing )
+        return SetError(ERR_SOCKET, "DnmMetricsServe", EBUSY);
+
+    iSrvSock = socket(AF_INET, SOCK_STREAM, 0);
+    if ( iSrvSock < 0 )
+        return SetError(ERR_SOCKET, "DnmMetricsServe", errno);
+
+    memset(&Addr, 0, sizeof(Addr));
+    Addr.sin_family = AF_INET;
+    Addr.sin_port = htons(usPort);
+    Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(iSrvSock, SOL_SOCKET, SO_REUSEADDR, &iOn, sizeof(iOn));
+    if ( bind(iSrvSock, reinterpret_cast<struct sockaddr *>(&Addr), sizeof(Addr)) < 0 ||
+         listen(iSrvSock, 4) < 0 ) {
+        int iErr = errno;
+
+        close(iSrvSock);
+        iSrvSock = -1;
+        return SetError(ERR_SOCKET, "DnmMetricsServe", iErr);
+    }
+
+    bServing = true;
+    if ( !DnmThreadCreate(&hServer, ServerProc, 0) ) {
+        bServing = false;
+        close(iSrvSock);
+        iSrvSock = -1;
+        return SetError(ERR_THREAD, "DnmMetricsServe");
+    }
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Stops serving metrics
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC DnmMetricsStopServing(void) {
+    if ( bServing ) {
+        bServing = false;
+        DnmThreadJoin(hServer);
+        close(iSrvSock);
+        iSrvSock = -1;
+    }
+
+    return SetError(ERR_NOERR);
+}
+#endif /* if defined(OS_LINUX) */
@@ -0,0 +1,69 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmmetrics.h              Type        : header            *
+ *  Description : Metrics in Prometheus text format.                        *
+ ****************************************************************************/
+
+/**
+ * @file dnmmetrics.h
+ * @brief Metrics in Prometheus text format.
+ *
+ * The module counts I/O exchanges and bytes, timeouts and errors returned
+ * by its functions, and keeps the state of each allocated device. Driver
+ * calls by kind and driver statuses other than success are counted only
+ * when the module is compiled with DNETMOD_DRV_METRICS, so driver calls
+ * cost nothing extra otherwise. Counters are updated with relaxed atomic
+ * additions, so they take no locks. Function DnmMetricsRender renders all
+ * of them, together with latency quantiles when the module is compiled
+ * with DNETMOD_HISTOGRAMS, in Prometheus text exposition format. On Linux DnmMetricsServe serves the metrics over HTTP
+ * on a local TCP port for scraping.
+ */
+
+#ifndef DNETMOD_METRICS_HEADER
+#define DNETMOD_METRICS_HEADER 1
+
+#include "dnmdefs.h"
+
+/** Maximum count of boards with metrics */
+#define DNETMOD_METRICS_BOARDS      4
+/** Error codes counted (ERR_* below this value) */
+#define DNETMOD_METRICS_ERRORS      128
+/** Distinct driver statuses counted per board */
+#define DNETMOD_METRICS_STATUSES    32
+
+/** Board counters */
+typedef enum DNM_METRICTag {
+    DNM_MET_EXCH_IN,    //!< Input exchanges
+    DNM_MET_EXCH_OUT,   //!< Output exchanges
+    DNM_MET_BYTES_IN,   //!< Input bytes
+    DNM_MET_BYTES_OUT,  //!< Output bytes
+    DNM_MET_TIMEOUTS,   //!< Driver timeouts
+    DNM_MET_COUNT
+} DNM_METRIC;
+
+/** Device states */
+typedef enum DNM_DEV_STATETag {
+    DNM_DEVST_NONE,         //!< Not allocated
+    DNM_DEVST_CONNECTED,    //!< I/O connection established
+    DNM_DEVST_DISCONNECTED, //!< I/O connection dropped
+    DNM_DEVST_FAULTED       //!< Isolated from the cycle
+} DNM_DEV_STATE;
+
+void DnmMetricsAdd(DNM_METRIC eMet, unsigned short usBoard, unsigned long ulVal);
+void DnmMetricsDriverCall(int iOp, unsigned short usBoard, short sStatus);
+void DnmMetricsError(long lErrCode);
+void DnmMetricsDevState(unsigned short usBoard, unsigned char ucMacID, DNM_DEV_STATE eState);
+
+DNETMOD_API int DNETMOD_CC
+DnmMetricsRender(unsigned long ulBufSz, char *strBuf, unsigned long *pulLen);
+
+DNETMOD_API void DNETMOD_CC DnmMetricsReset(void);
+
+#if defined(OS_LINUX)
+DNETMOD_API int DNETMOD_CC DnmMetricsServe(unsigned short usPort);
+DNETMOD_API int DNETMOD_CC DnmMetricsStopServing(void);
+#endif
+
+#endif /* dnmmetrics.h */
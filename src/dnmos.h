@@ -0,0 +1,462 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmos.h                   Type        : header            *
+ *  Description : Operating system and compiler abstractions.               *
+ ****************************************************************************/
+
+/**
+ * @file dnmos.h
+ * @brief Operating system and compiler abstractions.
+ *
+ * Wraps the few platform primitives the module needs (atomic operations, bit
+ * scans, memory barriers, monotonic clock, threads and mutexes) so the rest of
+ * the sources can stay free of platform specific code.
+ */
+
+#ifndef DNETMOD_OS_HEADER
+#define DNETMOD_OS_HEADER 1
+
+#include "dnmdefs.h"
+
+#if defined(OS_LINUX)
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#elif defined(OS_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#if defined(OS_LINUX)
+/** Thread handle */
+typedef pthread_t DNM_THREAD;
+/** Thread identifier */
+typedef pthread_t DNM_THREAD_ID;
+/** Mutex */
+typedef pthread_mutex_t DNM_MUTEX;
+/** Return type of thread functions */
+#define DNM_THREAD_RET  void *
+/** Calling convention of thread functions */
+#define DNM_THREAD_CC
+#elif defined(OS_WIN32)
+typedef HANDLE DNM_THREAD;
+typedef DWORD DNM_THREAD_ID;
+typedef CRITICAL_SECTION DNM_MUTEX;
+#define DNM_THREAD_RET  DWORD
+#define DNM_THREAD_CC   WINAPI
+#endif
+
+/** Unsigned 64-bit integer */
+#if defined(COMPILER_MSC)
+typedef unsigned __int64 DNM_UINT64;
+#else
+typedef unsigned long long DNM_UINT64;
+#endif
+
+/** Storage class of thread local variables */
+#if defined(COMPILER_MSC)
+#define DNM_THREAD_LOCAL __declspec(thread)
+#else
+#define DNM_THREAD_LOCAL __thread
+#endif
+
+/** Thread function */
+typedef DNM_THREAD_RET (DNM_THREAD_CC *DNM_THREAD_PROC)(void *);
+
+/** Assumed size of a CPU cache line in bytes */
+#define DNETMOD_CACHE_LINE      64
+
+/**
+ * @brief Atomically loads a value with acquire semantics
+ *
+ * Reads made after this load can not be reordered before it.
+ * @param pulVal Pointer to the value.
+ * @return The value.
+ */
+inline unsigned long DnmAtomicLoad(const volatile unsigned long *pulVal) {
+#if defined(COMPILER_GNUC)
+    return __atomic_load_n(pulVal, __ATOMIC_ACQUIRE);
+#elif defined(COMPILER_MSC)
+    unsigned long ulVal = *pulVal;
+    _ReadWriteBarrier();
+    return ulVal;
+#else
+#error "error: Atomic operations not implemented for this compiler."
+#endif
+}
+
+/**
+ * @brief Atomically stores a value with release semantics
+ *
+ * Writes made before this store can not be reordered after it.
+ * @param pulVal Pointer to the value.
+ * @param ulNew New value.
+ */
+inline void DnmAtomicStore(volatile unsigned long *pulVal, unsigned long ulNew) {
+#if defined(COMPILER_GNUC)
+    __atomic_store_n(pulVal, ulNew, __ATOMIC_RELEASE);
+#elif defined(COMPILER_MSC)
+    _ReadWriteBarrier();
+    *pulVal = ulNew;
+#endif
+}
+
+/**
+ * @brief Atomically adds to a value
+ *
+ * No ordering with other memory operations is implied.
+ * @param pulVal Pointer to the value.
+ * @param ulAdd Value to be added.
+ * @return The new value.
+ */
+inline unsigned long DnmAtomicAdd(volatile unsigned long *pulVal, unsigned long ulAdd) {
+#if defined(COMPILER_GNUC)
+    return __atomic_add_fetch(pulVal, ulAdd, __ATOMIC_RELAXED);
+#elif defined(COMPILER_MSC)
+    return static_cast<unsigned long>(InterlockedExchangeAdd(reinterpret_cast<volatile LONG *>(pulVal), static_cast<LONG>(ulAdd))) + ulAdd;
+#endif
+}
+
+/**
+ * @brief Atomically replaces a value if it has the expected value
+ * @param pulVal Pointer to the value.
+ * @param ulExp Expected value.
+ * @param ulNew New value.
+ * @return True if the value was replaced, false otherwise.
+ */
+inline bool DnmAtomicCas(volatile unsigned long *pulVal, unsigned long ulExp, unsigned long ulNew) {
+#if defined(COMPILER_GNUC)
+    return __atomic_compare_exchange_n(pulVal, &ulExp, ulNew, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#elif defined(COMPILER_MSC)
+    return static_cast<unsigned long>(InterlockedCompareExchange(reinterpret_cast<volatile LONG *>(pulVal),
+                                                                 static_cast<LONG>(ulNew),
+                                                                 static_cast<LONG>(ulExp))) == ulExp;
+#endif
+}
+
+/**
+ * @brief Atomically loads a pointer with acquire semantics
+ * @param ppvVal Pointer to the pointer.
+ * @return The pointer.
+ */
+inline void * DnmAtomicLoadPtr(void * const volatile *ppvVal) {
+#if defined(COMPILER_GNUC)
+    return __atomic_load_n(ppvVal, __ATOMIC_ACQUIRE);
+#elif defined(COMPILER_MSC)
+    void *pvVal = *ppvVal;
+    _ReadWriteBarrier();
+    return pvVal;
+#endif
+}
+
+/**
+ * @brief Atomically replaces a pointer if it has the expected value
+ * @param ppvVal Pointer to the pointer.
+ * @param pvExp Expected value.
+ * @param pvNew New value.
+ * @return True if the pointer was replaced, false otherwise.
+ */
+inline bool DnmAtomicCasPtr(void * volatile *ppvVal, void *pvExp, void *pvNew) {
+#if defined(COMPILER_GNUC)
+    return __atomic_compare_exchange_n(ppvVal, &pvExp, pvNew, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#elif defined(COMPILER_MSC)
+    return InterlockedCompareExchangePointer(const_cast<void **>(ppvVal), pvNew, pvExp) == pvExp;
+#endif
+}
+
+/**
+ * @brief Atomically loads a 64 bits value with acquire semantics
+ * @param pullVal Pointer to the value.
+ * @return The value.
+ */
+inline DNM_UINT64 DnmAtomicLoad64(const volatile DNM_UINT64 *pullVal) {
+#if defined(COMPILER_GNUC)
+    return __atomic_load_n(pullVal, __ATOMIC_ACQUIRE);
+#elif defined(COMPILER_MSC)
+    /* A 64 bits read is not atomic on x86, so read with a no-op exchange */
+    return static_cast<DNM_UINT64>(InterlockedCompareExchange64(
+        reinterpret_cast<volatile LONGLONG *>(const_cast<volatile DNM_UINT64 *>(pullVal)), 0, 0));
+#endif
+}
+
+/**
+ * @brief Atomically replaces a 64 bits value if it has the expected value
+ * @param pullVal Pointer to the value.
+ * @param ullExp Expected value.
+ * @param ullNew New value.
+ * @return True if the value was replaced, false otherwise.
+ */
+inline bool DnmAtomicCas64(volatile DNM_UINT64 *pullVal, DNM_UINT64 ullExp, DNM_UINT64 ullNew) {
+#if defined(COMPILER_GNUC)
+    return __atomic_compare_exchange_n(pullVal, &ullExp, ullNew, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#elif defined(COMPILER_MSC)
+    return static_cast<DNM_UINT64>(InterlockedCompareExchange64(reinterpret_cast<volatile LONGLONG *>(pullVal),
+                                                                static_cast<LONGLONG>(ullNew),
+                                                                static_cast<LONGLONG>(ullExp))) == ullExp;
+#endif
+}
+
+/**
+ * @brief Atomically sets and clears bits of a 64 bits value
+ *
+ * Writes made before can not be reordered after the update.
+ * @param pullVal Pointer to the value.
+ * @param ullSet Bits to be set.
+ * @param ullClear Bits to be cleared (applied before setting).
+ * @return The value before the update.
+ */
+inline DNM_UINT64 DnmAtomicUpdate64(volatile DNM_UINT64 *pullVal, DNM_UINT64 ullSet, DNM_UINT64 ullClear) {
+    DNM_UINT64 ullOld = DnmAtomicLoad64(pullVal);
+
+    while ( !DnmAtomicCas64(pullVal, ullOld, (ullOld & ~ullClear) | ullSet) )
+        ullOld = DnmAtomicLoad64(pullVal);
+
+    return ullOld;
+}
+
+/**
+ * @brief Counts the set bits of a 64 bits value
+ * @param ullVal The value.
+ * @return Count of set bits.
+ */
+inline unsigned int DnmBitCount64(DNM_UINT64 ullVal) {
+#if defined(COMPILER_GNUC)
+    return static_cast<unsigned int>(__builtin_popcountll(ullVal));
+#else
+    unsigned int uiCnt = 0;
+
+    for ( ; ullVal != 0; ullVal &= ullVal - 1 )
+        uiCnt++;
+
+    return uiCnt;
+#endif
+}
+
+/**
+ * @brief Retrieves the number of the lowest set bit of a 64 bits value
+ * @param ullVal The value. Must not be zero.
+ * @return Bit number (0 to 63).
+ */
+inline unsigned int DnmBitLowest64(DNM_UINT64 ullVal) {
+#if defined(COMPILER_GNUC)
+    return static_cast<unsigned int>(__builtin_ctzll(ullVal));
+#else
+    unsigned int uiBit = 0;
+
+    while ( (ullVal & 1) == 0 ) {
+        ullVal >>= 1;
+        uiBit++;
+    }
+
+    return uiBit;
+#endif
+}
+
+/**
+ * @brief Takes the lowest set bit of a 64 bits mask
+ *
+ * Used to iterate the bits of a mask (e.g. MAC IDs of devices):
+ * @code
+ * while ( ullMask != 0 ) {
+ *     unsigned char ucMacID = DnmBitTake64(&ullMask);
+ *     ...
+ * }
+ * @endcode
+ * @param pullMask Pointer to the mask. Must not be zero. The bit is cleared.
+ * @return Bit number (0 to 63).
+ */
+inline unsigned char DnmBitTake64(DNM_UINT64 *pullMask) {
+    unsigned int uiBit = DnmBitLowest64(*pullMask);
+
+    *pullMask &= *pullMask - 1;
+
+    return static_cast<unsigned char>(uiBit);
+}
+
+/**
+ * @brief Retrieves monotonic time in milliseconds
+ *
+ * The value has no defined origin and wraps around. Use DnmTimeReached to
+ * compare points in time.
+ * @return Milliseconds elapsed since an arbitrary point in time.
+ */
+inline unsigned long DnmTimeMs(void) {
+#if defined(OS_LINUX)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long>(ts.tv_sec) * 1000UL + static_cast<unsigned long>(ts.tv_nsec / 1000000L);
+#elif defined(OS_WIN32)
+    return GetTickCount();
+#endif
+}
+
+/**
+ * @brief Retrieves monotonic time in nanoseconds
+ *
+ * Intended for measuring short durations.
+ * @return Nanoseconds elapsed since an arbitrary point in time.
+ */
+inline DNM_UINT64 DnmTimeNs(void) {
+#if defined(OS_LINUX)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<DNM_UINT64>(ts.tv_sec) * 1000000000ULL + static_cast<DNM_UINT64>(ts.tv_nsec);
+#elif defined(OS_WIN32)
+    LARGE_INTEGER liCnt;
+    LARGE_INTEGER liFreq;
+
+    QueryPerformanceCounter(&liCnt);
+    QueryPerformanceFrequency(&liFreq);
+    return static_cast<DNM_UINT64>(liCnt.QuadPart / liFreq.QuadPart) * 1000000000ULL +
+           static_cast<DNM_UINT64>(liCnt.QuadPart % liFreq.QuadPart) * 1000000000ULL / static_cast<DNM_UINT64>(liFreq.QuadPart);
+#endif
+}
+
+/**
+ * @brief Checks whether a point in time has been reached
+ *
+ * Comparison is safe when the clock wraps around.
+ * @param ulNow Current time from DnmTimeMs.
+ * @param ulWhen Point in time to be checked.
+ * @return True if ulNow is at or after ulWhen.
+ */
+inline bool DnmTimeReached(unsigned long ulNow, unsigned long ulWhen) {
+    return static_cast<long>(ulNow - ulWhen) >= 0;
+}
+
+/**
+ * @brief Suspends calling thread
+ * @param ulMs Milliseconds to sleep.
+ */
+inline void DnmSleepMs(unsigned long ulMs) {
+#if defined(OS_LINUX)
+    usleep(ulMs * 1000);
+#elif defined(OS_WIN32)
+    Sleep(ulMs);
+#endif
+}
+
+/**
+ * @brief Suspends calling thread for a short time
+ *
+ * On Win32 the time is rounded up to milliseconds.
+ * @param ulUs Microseconds to sleep.
+ */
+inline void DnmSleepUs(unsigned long ulUs) {
+#if defined(OS_LINUX)
+    usleep(ulUs);
+#elif defined(OS_WIN32)
+    Sleep((ulUs + 999) / 1000);
+#endif
+}
+
+/**
+ * @brief Starts a new thread
+ * @param phThread Receives the thread handle.
+ * @param pfnProc Thread function.
+ * @param pvArg Argument passed to the thread function.
+ * @return True on success, false otherwise.
+ */
+inline bool DnmThreadCreate(DNM_THREAD *phThread, DNM_THREAD_PROC pfnProc, void *pvArg) {
+#if defined(OS_LINUX)
+    return pthread_create(phThread, 0, pfnProc, pvArg) == 0;
+#elif defined(OS_WIN32)
+    *phThread = CreateThread(0, 0, pfnProc, pvArg, 0, 0);
+    return *phThread != 0;
+#endif
+}
+
+/**
+ * @brief Waits for a thread to finish and releases its handle
+ * @param hThread Thread handle.
+ */
+inline void DnmThreadJoin(DNM_THREAD hThread) {
+#if defined(OS_LINUX)
+    pthread_join(hThread, 0);
+#elif defined(OS_WIN32)
+    WaitForSingleObject(hThread, INFINITE);
+    CloseHandle(hThread);
+#endif
+}
+
+/**
+ * @brief Retrieves identifier of the calling thread
+ * @return Thread identifier.
+ */
+inline DNM_THREAD_ID DnmThreadSelf(void) {
+#if defined(OS_LINUX)
+    return pthread_self();
+#elif defined(OS_WIN32)
+    return GetCurrentThreadId();
+#endif
+}
+
+/**
+ * @brief Checks whether a thread identifier is of the calling thread
+ * @param Thread Thread identifier from DnmThreadSelf.
+ * @return True if it is the calling thread, false otherwise.
+ */
+inline bool DnmThreadIsSelf(DNM_THREAD_ID Thread) {
+#if defined(OS_LINUX)
+    return pthread_equal(Thread, pthread_self()) != 0;
+#elif defined(OS_WIN32)
+    return Thread == GetCurrentThreadId();
+#endif
+}
+
+/**
+ * @brief Initializes a mutex
+ * @param pMutex Pointer to the mutex.
+ */
+inline void DnmMutexInit(DNM_MUTEX *pMutex) {
+#if defined(OS_LINUX)
+    pthread_mutex_init(pMutex, 0);
+#elif defined(OS_WIN32)
+    InitializeCriticalSection(pMutex);
+#endif
+}
+
+/**
+ * @brief Destroys a mutex
+ * @param pMutex Pointer to the mutex.
+ */
+inline void DnmMutexDestroy(DNM_MUTEX *pMutex) {
+#if defined(OS_LINUX)
+    pthread_mutex_destroy(pMutex);
+#elif defined(OS_WIN32)
+    DeleteCriticalSection(pMutex);
+#endif
+}
+
+/**
+ * @brief Locks a mutex
+ * @param pMutex Pointer to the mutex.
+ */
+inline void DnmMutexLock(DNM_MUTEX *pMutex) {
+#if defined(OS_LINUX)
+    pthread_mutex_lock(pMutex);
+#elif defined(OS_WIN32)
+    EnterCriticalSection(pMutex);
+#endif
+}
+
+/**
+ * @brief Unlocks a mutex
+ * @param pMutex Pointer to the mutex.
+ */
+inline void DnmMutexUnlock(DNM_MUTEX *pMutex) {
+#if defined(OS_LINUX)
+    pthread_mutex_unlock(pMutex);
+#elif defined(OS_WIN32)
+    LeaveCriticalSection(pMutex);
+#endif
+}
+
+#endif /* dnmos.h */
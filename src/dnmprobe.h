@@ -0,0 +1,97 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmprobe.h                Type        : header            *
+ *  Description : Static tracepoints.                                       *
+ ****************************************************************************/
+
+/**
+ * @file dnmprobe.h
+ * @brief Static tracepoints.
+ *
+ * When the module is compiled with DNETMOD_USDT defined (Linux only, needs
+ * sys/sdt.h from SystemTap) the main operations carry USDT probes of
+ * provider dnetmod, which could be attached to with perf, bpftrace or
+ * SystemTap. A probe which is not attached costs a single nop instruction.
+ * Each operation has an entry probe (NAME__entry) and a return probe
+ * (NAME__return) with arguments:
+ *
+ *   -# board number;
+ *   -# MAC ID of the node;
+ *   -# operation specific argument (direction of exchange, class ID,
+ *      service code, reset mode, etc.);
+ *   -# data size in bytes;
+ *   -# driver status of the last driver call (zero in entry probe).
+ *
+ * For example: bpftrace -e 'usdt:./libdnetmod.so:dnetmod:exchange__return
+ * { @[arg1] = hist(arg4); }'. Without DNETMOD_USDT the macros expand to
+ * nothing.
+ */
+
+#ifndef DNETMOD_PROBE_HEADER
+#define DNETMOD_PROBE_HEADER 1
+
+#include "dnmdefs.h"
+#include "dnmtrace.h"
+
+#if defined(DNETMOD_USDT)
+#if !defined(OS_LINUX)
+#error "error: USDT probes are available only on Linux."
+#endif
+
+#include <sys/sdt.h>
+
+/**
+ * @brief Fires a probe
+ * @param name Probe name.
+ * @param brd Board number.
+ * @param mac MAC ID.
+ * @param arg Operation specific argument.
+ * @param sz Data size.
+ * @param st Driver status.
+ */
+#define DNM_PROBE(name, brd, mac, arg, sz, st) \
+    DTRACE_PROBE5(dnetmod, name, brd, mac, arg, sz, st)
+#else
+#define DNM_PROBE(name, brd, mac, arg, sz, st)
+#endif
+
+#if defined(DNETMOD_USDT) || defined(DNETMOD_TRACE)
+/**
+ * @brief Fires entry probe and arranges return probe at end of scope
+ *
+ * The return probe reports the value of the status variable at the time
+ * the scope is left, i.e. the status of the last driver call. The scope
+ * is also recorded as a trace span with the operation name (see
+ * dnmtrace.h).
+ * @param name Operation name.
+ * @param brd Board number.
+ * @param mac MAC ID.
+ * @param arg Operation specific argument.
+ * @param sz Data size.
+ * @param st Variable of type short holding driver status.
+ */
+#define DNM_PROBE_SCOPE(name, brd, mac, arg, sz, st)                    \
+    DNM_PROBE(name##__entry, (brd), (mac), (arg), (sz), 0);             \
+    struct DnmProbeScope_##name {                                       \
+        unsigned short usBrd;                                           \
+        unsigned char  ucMac;                                           \
+        unsigned long  ulArg;                                           \
+        unsigned long  ulSz;                                            \
+        const short    &sSt;                                            \
+        DNM_UINT64     ullStart;                                        \
+        ~DnmProbeScope_##name() {                                       \
+            DNM_PROBE(name##__return, usBrd, ucMac, ulArg, ulSz, sSt);  \
+            DNM_TRACE_SPAN(#name, usBrd, ucMac, ullStart, DNM_TRACE_NOW()); \
+        }                                                               \
+    } dnmProbeScope_ = { static_cast<unsigned short>(brd),             \
+                         static_cast<unsigned char>(mac),              \
+                         static_cast<unsigned long>(arg),              \
+                         static_cast<unsigned long>(sz), (st),         \
+                         DNM_TRACE_NOW() }
+#else
+#define DNM_PROBE_SCOPE(name, brd, mac, arg, sz, st)
+#endif
+
+#endif /* dnmprobe.h */
@@ -0,0 +1,410 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmrec.cpp                Type        : source            *
+ *  Description : Recorder of CIF driver traffic.                           *
+ ****************************************************************************/
+
+/**
+ * @file dnmrec.cpp
+ * @brief Recorder of CIF driver traffic.
+ *
+ * Records are appended under a lock through a buffered stream, so calls
+ * made concurrently by different threads are recorded in order of their
+ * completion.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmos.h"
+#include "dnmrec.h"
+
+#if defined(DNETMOD_RECORD)
+#include "cif_user.h"
+#endif
+
+/** Size of the stream buffer of the log in bytes */
+#define DNM_REC_BUF_SZ      65536
+/** Maximum length of the log file name */
+#define DNM_REC_NAME_LEN    260
+/** Size of the header of a mailbox telegram (rx to e) */
+#define DNM_REC_MSGHDR_SZ   8
+
+/** @brief State of the recorder */
+typedef struct DNM_REC_STATETag {
+    DNM_MUTEX     Lock;                         /**< Guards the state      */
+    FILE          *pFile;                       /**< Log or NULL           */
+    char          strFile[DNM_REC_NAME_LEN];    /**< Name of the log       */
+    DNM_UINT64    ullLast;                      /**< Start of last record  */
+    unsigned long ulCount;                      /**< Records in the log    */
+
+    DNM_REC_STATETag() {
+        DnmMutexInit(&Lock);
+        pFile = 0;
+        strFile[0] = '\0';
+        ullLast = 0;
+        ulCount = 0;
+    }
+    ~DNM_REC_STATETag() {
+        if ( pFile != 0 )
+            fclose(pFile);
+        DnmMutexDestroy(&Lock);
+    }
+} DNM_REC_STATE;
+
+/** Recorder */
+static DNM_REC_STATE RecState;
+/** Flag showing whether recording is started */
+static volatile bool bRecOn = false;
+
+/**
+ * @brief Stores an unsigned short little endian
+ * @param pucBuf Destination.
+ * @param usVal Value.
+ */
+static void PutUShort(unsigned char *pucBuf, unsigned short usVal) {
+    pucBuf[0] = static_cast<unsigned char>(usVal & 0xFF);
+    pucBuf[1] = static_cast<unsigned char>(usVal >> 8);
+}
+
+/**
+ * @brief Stores an unsigned long as 32 bits little endian
+ * @param pucBuf Destination.
+ * @param ulVal Value.
+ */
+static void PutULong(unsigned char *pucBuf, unsigned long ulVal) {
+    PutUShort(pucBuf, static_cast<unsigned short>(ulVal & 0xFFFF));
+    PutUShort(pucBuf + 2, static_cast<unsigned short>((ulVal >> 16) & 0xFFFF));
+}
+
+/**
+ * @brief Loads an unsigned short stored little endian
+ * @param pucBuf Source.
+ * @return Value.
+ */
+static unsigned short GetUShort(const unsigned char *pucBuf) {
+    return static_cast<unsigned short>(pucBuf[0] | (pucBuf[1] << 8));
+}
+
+/**
+ * @brief Encodes a record header
+ * @param pHdr Header.
+ * @param pucBuf Buffer of #DNM_REC_HDR_SZ bytes.
+ */
+void DnmRecEncodeHdr(const DNM_REC_HDR *pHdr, unsigned char *pucBuf) {
+    pucBuf[0] = pHdr->ucCall;
+    pucBuf[1] = pHdr->ucBoard;
+    PutUShort(pucBuf + 2, static_cast<unsigned short>(pHdr->sResult));
+    PutULong(pucBuf + 4, pHdr->ulDeltaUs);
+    PutULong(pucBuf + 8, pHdr->ulDurUs);
+    PutUShort(pucBuf + 12, pHdr->usParam);
+    PutUShort(pucBuf + 14, pHdr->usSentLen);
+    PutUShort(pucBuf + 16, pHdr->usRecvLen);
+}
+
+/**
+ * @brief Decodes a record header
+ * @param pucBuf Buffer of #DNM_REC_HDR_SZ bytes.
+ * @param pHdr Header.
+ */
+void DnmRecDecodeHdr(const unsigned char *pucBuf, DNM_REC_HDR *pHdr) {
+    pHdr->ucCall    = pucBuf[0];
+    pHdr->ucBoard   = pucBuf[1];
+    pHdr->sResult   = static_cast<short>(GetUShort(pucBuf + 2));
+    pHdr->ulDeltaUs = GetUShort(pucBuf + 4) | (static_cast<unsigned long>(GetUShort(pucBuf + 6)) << 16);
+    pHdr->ulDurUs   = GetUShort(pucBuf + 8) | (static_cast<unsigned long>(GetUShort(pucBuf + 10)) << 16);
+    pHdr->usParam   = GetUShort(pucBuf + 12);
+    pHdr->usSentLen = GetUShort(pucBuf + 14);
+    pHdr->usRecvLen = GetUShort(pucBuf + 16);
+}
+
+/**
+ * @brief Starts recording
+ *
+ * A log being recorded is closed first.
+ * @param strFile Log file name. The file is overwritten.
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC DnmRecStart(const char *strFile) {
+    unsigned char aucHdr[DNM_REC_FILEHDR_SZ] = { 0 };
+
+    if ( strFile == 0 )
+        return SetError(ERR_INVFPRM, "strFile", "NULL", "DnmRecStart");
+
+    DnmRecStop();
+    DnmMutexLock(&RecState.Lock);
+    RecState.pFile = fopen(strFile, "wb");
+    if ( RecState.pFile == 0 ) {
+        DnmMutexUnlock(&RecState.Lock);
+        return SetError(ERR_FILE, "DnmRecStart", strFile);
+    }
+    setvbuf(RecState.pFile, 0, _IOFBF, DNM_REC_BUF_SZ);
+    strncpy(RecState.strFile, strFile, DNM_REC_NAME_LEN - 1);
+    RecState.strFile[DNM_REC_NAME_LEN - 1] = '\0';
+    memcpy(aucHdr, DNM_REC_MAGIC, 6);
+    aucHdr[6] = DNM_REC_VERSION;
+    if ( fwrite(aucHdr, sizeof(aucHdr), 1, RecState.pFile) != 1 ) {
+        fclose(RecState.pFile);
+        RecState.pFile = 0;
+        DnmMutexUnlock(&RecState.Lock);
+        return SetError(ERR_FILE, "DnmRecStart", strFile);
+    }
+    RecState.ullLast = DnmTimeNs();
+    RecState.ulCount = 0;
+    bRecOn = true;
+    DnmMutexUnlock(&RecState.Lock);
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Stops recording and closes the log
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC DnmRecStop(void) {
+    int iErr = 0;
+
+    DnmMutexLock(&RecState.Lock);
+    bRecOn = false;
+    if ( RecState.pFile != 0 ) {
+        if ( fclose(RecState.pFile) != 0 )
+            iErr = SetError(ERR_FILE, "DnmRecStop", RecState.strFile);
+        RecState.pFile = 0;
+    }
+    DnmMutexUnlock(&RecState.Lock);
+
+    return iErr != 0 ? iErr : SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Retrieves count of records written to the current or last log
+ * @return Count of records.
+ */
+DNETMOD_API unsigned long DNETMOD_CC DnmRecGetCount(void) {
+    return RecState.ulCount;
+}
+
+#if defined(DNETMOD_RECORD)
+
+/**
+ * @brief Appends a record to the log
+ * @param eCall Recorded call.
+ * @param usBoard Board number.
+ * @param sResult Result of the call.
+ * @param ullStart Start of the call in ns.
+ * @param ullEnd End of the call in ns.
+ * @param usParam Parameter of the call.
+ * @param pvSent Data passed to the driver.
+ * @param usSentLen Count of bytes passed to the driver.
+ * @param pvRecv Data returned by the driver.
+ * @param usRecvLen Count of bytes returned by the driver.
+ */
+static void Record(
+    DNM_REC_CALL   eCall,
+    unsigned short usBoard,
+    short          sResult,
+    DNM_UINT64     ullStart,
+    DNM_UINT64     ullEnd,
+    unsigned short usParam,
+    const void     *pvSent,
+    unsigned short usSentLen,
+    const void     *pvRecv,
+    unsigned short usRecvLen)
+{
+    DNM_REC_HDR   Hdr;
+    unsigned char aucHdr[DNM_REC_HDR_SZ];
+    DNM_UINT64    ullDeltaUs = 0;
+
+    if ( pvSent == 0 )
+        usSentLen = 0;
+    if ( pvRecv == 0 || sResult != DRV_NO_ERROR )
+        usRecvLen = 0;
+
+    DnmMutexLock(&RecState.Lock);
+    if ( RecState.pFile != 0 ) {
+        if ( ullStart > RecState.ullLast ) {
+            ullDeltaUs = (ullStart - RecState.ullLast) / 1000;
+            RecState.ullLast += ullDeltaUs * 1000;
+        }
+        Hdr.ucCall    = static_cast<unsigned char>(eCall);
+        Hdr.ucBoard   = static_cast<unsigned char>(usBoard < DNM_REC_NOBOARD ? usBoard : DNM_REC_NOBOARD);
+        Hdr.sResult   = sResult;
+        Hdr.ulDeltaUs = ullDeltaUs < 0xFFFFFFFFULL ? static_cast<unsigned long>(ullDeltaUs) : 0xFFFFFFFFUL;
+        Hdr.ulDurUs   = static_cast<unsigned long>((ullEnd - ullStart) / 1000);
+        Hdr.usParam   = usParam;
+        Hdr.usSentLen = usSentLen;
+        Hdr.usRecvLen = usRecvLen;
+        DnmRecEncodeHdr(&Hdr, aucHdr);
+        fwrite(aucHdr, sizeof(aucHdr), 1, RecState.pFile);
+        if ( usSentLen > 0 )
+            fwrite(pvSent, usSentLen, 1, RecState.pFile);
+        if ( usRecvLen > 0 )
+            fwrite(pvRecv, usRecvLen, 1, RecState.pFile);
+        RecState.ulCount++;
+    }
+    DnmMutexUnlock(&RecState.Lock);
+}
+
+/**
+ * @brief Retrieves length of a mailbox telegram
+ * @param ptMessage Telegram.
+ * @param usSize Size of the buffer holding the telegram.
+ * @return Count of header and data bytes.
+ */
+static unsigned short TelegramLen(const MSG_STRUC *ptMessage, unsigned short usSize) {
+    unsigned short usLen = static_cast<unsigned short>(DNM_REC_MSGHDR_SZ + ptMessage->ln);
+
+    return usLen < usSize ? usLen : usSize;
+}
+
+/**
+ * @brief Makes a driver call and records it when recording is started
+ * @param res Variable receiving the result of the call.
+ * @param call The call.
+ * @param rec Statement recording the call (sees ullStart_ and ullEnd_).
+ */
+#define DNM_REC_CALL_DRV(res, call, rec) do {                           \
+    if ( !bRecOn ) {                                                    \
+        (res) = (call);                                                 \
+        break;                                                          \
+    }                                                                   \
+    DNM_UINT64 ullStart_ = DnmTimeNs();                                 \
+    (res) = (call);                                                     \
+    DNM_UINT64 ullEnd_ = DnmTimeNs();                                   \
+    rec;                                                                \
+} while ( 0 )
+
+short DnmRecOpenDriver(void) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevOpenDriver(),
+        Record(DNM_REC_OPENDRIVER, DNM_REC_NOBOARD, sRes, ullStart_, ullEnd_, 0, 0, 0, 0, 0));
+    return sRes;
+}
+
+short DnmRecCloseDriver(void) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevCloseDriver(),
+        Record(DNM_REC_CLOSEDRIVER, DNM_REC_NOBOARD, sRes, ullStart_, ullEnd_, 0, 0, 0, 0, 0));
+    return sRes;
+}
+
+short DnmRecInitBoard(unsigned short usDevNumber) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevInitBoard(usDevNumber),
+        Record(DNM_REC_INITBOARD, usDevNumber, sRes, ullStart_, ullEnd_, 0, 0, 0, 0, 0));
+    return sRes;
+}
+
+short DnmRecExitBoard(unsigned short usDevNumber) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevExitBoard(usDevNumber),
+        Record(DNM_REC_EXITBOARD, usDevNumber, sRes, ullStart_, ullEnd_, 0, 0, 0, 0, 0));
+    return sRes;
+}
+
+short DnmRecPutTaskParameter(unsigned short usDevNumber, unsigned short usNumber, unsigned short usSize, void *pvData) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevPutTaskParameter(usDevNumber, usNumber, usSize, pvData),
+        Record(DNM_REC_PUTTASKPARAM, usDevNumber, sRes, ullStart_, ullEnd_, usNumber, pvData, usSize, 0, 0));
+    return sRes;
+}
+
+short DnmRecReset(unsigned short usDevNumber, unsigned short usMode, unsigned long ulTimeout) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevReset(usDevNumber, usMode, ulTimeout),
+        Record(DNM_REC_RESET, usDevNumber, sRes, ullStart_, ullEnd_, usMode, 0, 0, 0, 0));
+    return sRes;
+}
+
+short DnmRecPutMessage(unsigned short usDevNumber, MSG_STRUC *ptMessage, unsigned long ulTimeout) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevPutMessage(usDevNumber, ptMessage, ulTimeout),
+        Record(DNM_REC_PUTMESSAGE, usDevNumber, sRes, ullStart_, ullEnd_, 0,
+               ptMessage, TelegramLen(ptMessage, sizeof(MSG_STRUC)), 0, 0));
+    return sRes;
+}
+
+short DnmRecGetMessage(unsigned short usDevNumber, unsigned short usSize, MSG_STRUC *ptMessage, unsigned long ulTimeout) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevGetMessage(usDevNumber, usSize, ptMessage, ulTimeout),
+        Record(DNM_REC_GETMESSAGE, usDevNumber, sRes, ullStart_, ullEnd_, 0,
+               0, 0, ptMessage, TelegramLen(ptMessage, usSize)));
+    return sRes;
+}
+
+short DnmRecGetTaskState(unsigned short usDevNumber, unsigned short usNumber, unsigned short usSize, void *pvData) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevGetTaskState(usDevNumber, usNumber, usSize, pvData),
+        Record(DNM_REC_GETTASKSTATE, usDevNumber, sRes, ullStart_, ullEnd_, usNumber, 0, 0, pvData, usSize));
+    return sRes;
+}
+
+short DnmRecGetInfo(unsigned short usDevNumber, unsigned short usInfoArea, unsigned short usSize, void *pvData) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevGetInfo(usDevNumber, usInfoArea, usSize, pvData),
+        Record(DNM_REC_GETINFO, usDevNumber, sRes, ullStart_, ullEnd_, usInfoArea, 0, 0, pvData, usSize));
+    return sRes;
+}
+
+short DnmRecExchangeIO(
+    unsigned short usDevNumber,
+    unsigned short usSendOffset,
+    unsigned short usSendSize,
+    void           *pvSendData,
+    unsigned short usReceiveOffset,
+    unsigned short usReceiveSize,
+    void           *pvReceiveData,
+    unsigned long  ulTimeout)
+{
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevExchangeIO(usDevNumber, usSendOffset, usSendSize, pvSendData,
+                                         usReceiveOffset, usReceiveSize, pvReceiveData, ulTimeout),
+        Record(DNM_REC_EXCHANGEIO, usDevNumber, sRes, ullStart_, ullEnd_, usReceiveOffset,
+               pvSendData, usSendSize, pvReceiveData, usReceiveSize));
+    return sRes;
+}
+
+short DnmRecSetHostState(unsigned short usDevNumber, unsigned short usMode, unsigned long ulTimeout) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevSetHostState(usDevNumber, usMode, ulTimeout),
+        Record(DNM_REC_SETHOSTSTATE, usDevNumber, sRes, ullStart_, ullEnd_, usMode, 0, 0, 0, 0));
+    return sRes;
+}
+
+short DnmRecReadWriteDPMRaw(unsigned short usDevNumber, unsigned short usMode, unsigned short usOffset, unsigned short usSize, void *pvData) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevReadWriteDPMRaw(usDevNumber, usMode, usOffset, usSize, pvData),
+        Record(DNM_REC_DPMRAW, usDevNumber, sRes, ullStart_, ullEnd_, usOffset,
+               usMode == PARAMETER_WRITE ? pvData : 0, usSize,
+               usMode == PARAMETER_READ ? pvData : 0, usSize));
+    return sRes;
+}
+
+short DnmRecReadWriteDPMData(unsigned short usDevNumber, unsigned short usMode, unsigned short usOffset, unsigned short usSize, void *pvData) {
+    short sRes = 0;
+
+    DNM_REC_CALL_DRV(sRes, DevReadWriteDPMData(usDevNumber, usMode, usOffset, usSize, pvData),
+        Record(DNM_REC_DPMDATA, usDevNumber, sRes, ullStart_, ullEnd_, usOffset,
+               usMode == PARAMETER_WRITE ? pvData : 0, usSize,
+               usMode == PARAMETER_READ ? pvData : 0, usSize));
+    return sRes;
+}
+
+#endif /* DNETMOD_RECORD */
@@ -0,0 +1,93 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmrec.h                  Type        : header            *
+ *  Description : Recorder of CIF driver traffic.                           *
+ ****************************************************************************/
+
+/**
+ * @file dnmrec.h
+ * @brief Recorder of CIF driver traffic.
+ *
+ * When the module is compiled with DNETMOD_RECORD defined (Linux only) every
+ * call which CCIFDriver, CCIFInterface and CCIFDevice make to the CIF device
+ * driver goes through a recording layer (see cifrec.h). While recording is
+ * started with DnmRecStart the result of each call, the data passed to the
+ * driver and the data returned by it (I/O images, mailbox telegrams, task
+ * states, DPM contents) are appended to a binary log together with the start
+ * and duration of the call. The log could be fed back to the module with the
+ * replay driver (see cifreplay.h). Without DNETMOD_RECORD nothing is recorded
+ * and DnmRecStart writes a log with the file header only.
+ *
+ * The log starts with a #DNM_REC_FILEHDR_SZ bytes file header followed by
+ * records. Each record is a #DNM_REC_HDR_SZ bytes header followed by the sent
+ * and then the received bytes. All fields are little endian:
+ *
+ * | Offset | Size | Field                                               |
+ * |--------|------|-----------------------------------------------------|
+ * | 0      | 1    | Call (see #DNM_REC_CALL)                            |
+ * | 1      | 1    | Board number (#DNM_REC_NOBOARD for driver calls)    |
+ * | 2      | 2    | Result of the call                                  |
+ * | 4      | 4    | Start of call in us since start of the previous one |
+ * | 8      | 4    | Duration of the call in us                          |
+ * | 12     | 2    | Parameter (offset, mode or area of the call)        |
+ * | 14     | 2    | Count of sent bytes                                 |
+ * | 16     | 2    | Count of received bytes                             |
+ */
+
+#ifndef DNETMOD_REC_HEADER
+#define DNETMOD_REC_HEADER 1
+
+#include "dnmdefs.h"
+
+/** Recorded driver calls */
+typedef enum DNM_REC_CALLTag {
+    DNM_REC_OPENDRIVER = 1, //!< DevOpenDriver
+    DNM_REC_CLOSEDRIVER,    //!< DevCloseDriver
+    DNM_REC_INITBOARD,      //!< DevInitBoard
+    DNM_REC_EXITBOARD,      //!< DevExitBoard
+    DNM_REC_PUTTASKPARAM,   //!< DevPutTaskParameter (sent: parameters)
+    DNM_REC_RESET,          //!< DevReset (parameter: mode)
+    DNM_REC_SETHOSTSTATE,   //!< DevSetHostState (parameter: mode)
+    DNM_REC_GETINFO,        //!< DevGetInfo (parameter: area; received: info)
+    DNM_REC_GETTASKSTATE,   //!< DevGetTaskState (parameter: task; received: state)
+    DNM_REC_EXCHANGEIO,     //!< DevExchangeIO (parameter: receive offset; sent: outputs; received: inputs)
+    DNM_REC_PUTMESSAGE,     //!< DevPutMessage (sent: telegram)
+    DNM_REC_GETMESSAGE,     //!< DevGetMessage (received: telegram)
+    DNM_REC_DPMRAW,         //!< DevReadWriteDPMRaw (parameter: offset; sent or received: DPM)
+    DNM_REC_DPMDATA,        //!< DevReadWriteDPMData (parameter: offset; sent or received: DPM)
+    DNM_REC_CALL_COUNT
+} DNM_REC_CALL;
+
+/** Magic of the log file */
+#define DNM_REC_MAGIC       "DNMREC"
+/** Version of the log format */
+#define DNM_REC_VERSION     1
+/** Size of the file header in bytes (magic, version, reserved) */
+#define DNM_REC_FILEHDR_SZ  8
+/** Size of a record header in bytes */
+#define DNM_REC_HDR_SZ      18
+/** Board number of calls not related to a board */
+#define DNM_REC_NOBOARD     0xFF
+
+/** @brief Decoded record header */
+typedef struct DNM_REC_HDRTag {
+    unsigned char  ucCall;      /**< Call (see #DNM_REC_CALL)        */
+    unsigned char  ucBoard;     /**< Board number                    */
+    short          sResult;     /**< Result of the call              */
+    unsigned long  ulDeltaUs;   /**< Start since previous call in us */
+    unsigned long  ulDurUs;     /**< Duration of the call in us      */
+    unsigned short usParam;     /**< Parameter of the call           */
+    unsigned short usSentLen;   /**< Count of sent bytes             */
+    unsigned short usRecvLen;   /**< Count of received bytes         */
+} DNM_REC_HDR;
+
+void DnmRecEncodeHdr(const DNM_REC_HDR *pHdr, unsigned char *pucBuf);
+void DnmRecDecodeHdr(const unsigned char *pucBuf, DNM_REC_HDR *pHdr);
+
+DNETMOD_API int DNETMOD_CC DnmRecStart(const char *strFile);
+DNETMOD_API int DNETMOD_CC DnmRecStop(void);
+DNETMOD_API unsigned long DNETMOD_CC DnmRecGetCount(void);
+
+#endif /* dnmrec.h */
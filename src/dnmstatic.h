@@ -0,0 +1,236 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmstatic.h               Type        : header            *
+ *  Description : Statically bound device and interface facades.            *
+ ****************************************************************************/
+
+/**
+ * @file dnmstatic.h
+ * @brief Statically bound device and interface facades.
+ *
+ * CDevice and CInterface dispatch each call virtually, which the compiler
+ * could not inline or see through. The facades here are instantiated for a
+ * concrete backend (CSimDevice, CCIFDevice, etc.) and call it directly, so
+ * a cyclic loop over devices of one backend has no virtual calls and the
+ * facade itself is inlined:
+ * @code
+ * DnmStaticDevice<CSimDevice> Dev(&SimDevice);
+ * while ( bRun ) {
+ *     Dev.Read(Input);     // DnmIOImage, see dnmiomap.h
+ *     ...
+ *     Dev.Write(Output);
+ * }
+ * @endcode
+ * For CCIFDevice the facade exchanges data through a bound CCIFIOHandle, so
+ * the device and its interface are not validated on each call either.
+ * The virtual interface of CDevice and CInterface remains for code which
+ * needs to choose the backend at run time.
+ */
+
+#ifndef DNETMOD_STATIC_HEADER
+#define DNETMOD_STATIC_HEADER 1
+
+#include <stdio.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "cintf.h"
+#include "cdevice.h"
+#include "dnmiomap.h"
+
+#if defined(OS_LINUX) || defined(OS_WIN32)
+#include "ccifintf.h"
+#include "ccifdevice.h"
+#endif
+
+#ifndef COMPILER_CPP
+#error "error: File dnmstatic.h requires c++ compiler!"
+#endif
+
+/**
+ * @brief Common part of the device facades
+ *
+ * Implements the I/O operations of a facade through the DoRead and DoWrite
+ * functions of the derived class (Derived), which are called without
+ * virtual dispatch.
+ * @param Derived Facade class deriving from this one
+ */
+template<class Derived>
+class DnmStaticIO {
+protected:
+    /** @brief Retrieves the derived facade */
+    Derived * Self(void) { return static_cast<Derived *>(this); }
+public:
+    /**
+     * @brief Reads I/O data from the device
+     * @param ulBufSz Size of the buffer
+     * @param pvBuf Pointer to the buffer
+     * @return Error from \ref SetError function
+     */
+    int ReadIOData(unsigned long ulBufSz, void *pvBuf) {
+        return Self()->DoRead(ulBufSz, pvBuf);
+    }
+
+    /**
+     * @brief Writes I/O data to the device
+     * @param ulBufSz Size of the buffer
+     * @param pvBuf Pointer to the buffer
+     * @return Error from \ref SetError function
+     */
+    int WriteIOData(unsigned long ulBufSz, void *pvBuf) {
+        return Self()->DoWrite(ulBufSz, pvBuf);
+    }
+
+    /**
+     * @brief Reads the process image of an assembly from the device
+     * @param Image Process image (see dnmiomap.h)
+     * @return Error from \ref SetError function
+     */
+    template<class Layout>
+    int Read(DnmIOImage<Layout> &Image) {
+        return Self()->DoRead(sizeof(Image.aucData), Image.aucData);
+    }
+
+    /**
+     * @brief Writes the process image of an assembly to the device
+     * @param Image Process image (see dnmiomap.h)
+     * @return Error from \ref SetError function
+     */
+    template<class Layout>
+    int Write(DnmIOImage<Layout> &Image) {
+        return Self()->DoWrite(sizeof(Image.aucData), Image.aucData);
+    }
+};
+
+/**
+ * @brief Statically bound device facade
+ *
+ * Calls the I/O functions of TDevice directly (qualified), instead of
+ * through the virtual table of CDevice.
+ * @param TDevice Concrete device class deriving from CDevice
+ */
+template<class TDevice>
+class DnmStaticDevice : public DnmStaticIO< DnmStaticDevice<TDevice> > {
+private:
+    friend class DnmStaticIO< DnmStaticDevice<TDevice> >;
+    /** The device */
+    TDevice *pDevice;
+
+    int DoRead(unsigned long ulBufSz, void *pvBuf) {
+        return pDevice->TDevice::ReadIOData(ulBufSz, pvBuf);
+    }
+    int DoWrite(unsigned long ulBufSz, void *pvBuf) {
+        return pDevice->TDevice::WriteIOData(ulBufSz, pvBuf);
+    }
+public:
+    /**
+     * @brief Constructor
+     * @param pDev The device. Compilation fails if TDevice is not a CDevice.
+     */
+    explicit DnmStaticDevice(TDevice *pDev) : pDevice(pDev) {
+        CDevice *pBase = pDev;
+        (void)pBase;
+    }
+
+    /** @brief Retrieves the device */
+    TDevice * GetDevice(void) const { return pDevice; }
+};
+
+#if defined(OS_LINUX) || defined(OS_WIN32)
+/**
+ * @brief Statically bound facade of a CIF device
+ *
+ * Exchanges the data through a CCIFIOHandle bound on the first call, so
+ * the device and its interface are validated only when their state
+ * changes. If the handle could not be bound (e.g. the device is not
+ * allocated yet), binding is tried again on the next call.
+ */
+template<>
+class DnmStaticDevice<CCIFDevice> : public DnmStaticIO< DnmStaticDevice<CCIFDevice> > {
+private:
+    friend class DnmStaticIO< DnmStaticDevice<CCIFDevice> >;
+    /** The device */
+    CCIFDevice *pDevice;
+    /** Handle bound to the device */
+    CCIFIOHandle Handle;
+
+    static int BadSize(unsigned long ulBufSz, const char *strFunc) {
+        char cBuf[24] = {0};
+
+        sprintf(cBuf, "%lu", ulBufSz);
+        return SetError(ERR_INVFPRM, "ulBufSz", cBuf, strFunc);
+    }
+    int DoRead(unsigned long ulBufSz, void *pvBuf) {
+        if ( Handle.GetDevice() == 0 ) {
+            int iErr = Handle.Bind(pDevice);
+
+            if ( iErr != ERR_NOERR )
+                return iErr;
+        }
+        if ( ulBufSz < Handle.GetInputSize() || pvBuf == 0 )
+            return BadSize(ulBufSz, "ReadIOData");
+
+        return Handle.Read(pvBuf);
+    }
+    int DoWrite(unsigned long ulBufSz, void *pvBuf) {
+        if ( Handle.GetDevice() == 0 ) {
+            int iErr = Handle.Bind(pDevice);
+
+            if ( iErr != ERR_NOERR )
+                return iErr;
+        }
+        if ( ulBufSz < Handle.GetOutputSize() || pvBuf == 0 )
+            return BadSize(ulBufSz, "WriteIOData");
+
+        return Handle.Write(pvBuf);
+    }
+public:
+    /**
+     * @brief Constructor
+     * @param pDev The device
+     */
+    explicit DnmStaticDevice(CCIFDevice *pDev) : pDevice(pDev) {}
+
+    /** @brief Retrieves the device */
+    CCIFDevice * GetDevice(void) const { return pDevice; }
+};
+#endif
+
+/**
+ * @brief Statically bound interface facade
+ *
+ * Calls the functions of TInterface directly (qualified), instead of
+ * through the virtual table of CInterface.
+ * @param TInterface Concrete interface class deriving from CInterface
+ */
+template<class TInterface>
+class DnmStaticInterface {
+private:
+    /** The interface */
+    TInterface *pInterface;
+public:
+    /**
+     * @brief Constructor
+     * @param pIntf The interface. Compilation fails if TInterface is not a
+     * CInterface.
+     */
+    explicit DnmStaticInterface(TInterface *pIntf) : pInterface(pIntf) {
+        CInterface *pBase = pIntf;
+        (void)pBase;
+    }
+
+    /** @brief Retrieves the interface */
+    TInterface * GetInterface(void) const { return pInterface; }
+    /** @brief Checks if the interface is open */
+    bool IsActive(void) const { return pInterface->IsActive(); }
+    /** @brief Opens the interface (see CInterface::Open) */
+    int Open(void) { return pInterface->TInterface::Open(); }
+    /** @brief Closes the interface (see CInterface::Close) */
+    int Close(void) { return pInterface->TInterface::Close(); }
+    /** @brief Resets the interface (see CInterface::Reset) */
+    int Reset(void *vpParam = 0) { return pInterface->TInterface::Reset(vpParam); }
+};
+
+#endif /* dnmstatic.h */
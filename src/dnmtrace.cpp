@@ -0,0 +1,186 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmtrace.cpp              Type        : source            *
+ *  Description : Timeline trace recorder.                                  *
+ ****************************************************************************/
+
+/**
+ * @file dnmtrace.cpp
+ * @brief Timeline trace recorder.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dnmdefs.h"
+#include "dnmerrs.h"
+#include "dnmtrace.h"
+
+/** @brief Recorded span */
+typedef struct DNM_TRACE_EVENTTag {
+    const char     *strName;    /**< Span name      */
+    DNM_UINT64     ullStart;    /**< Start in ns    */
+    DNM_UINT64     ullEnd;      /**< End in ns      */
+    unsigned short usBoard;     /**< Board number   */
+    unsigned char  ucMacID;     /**< MAC ID         */
+} DNM_TRACE_EVENT;
+
+/** @brief Per-thread ring buffer of spans */
+typedef struct DNM_TRACE_BUFTag {
+    struct DNM_TRACE_BUFTag *pNext;     /**< Next buffer in the list       */
+    unsigned long           ulThread;   /**< Sequence number of the thread */
+    unsigned long           ulCap;      /**< Capacity in spans             */
+    volatile unsigned long  ulCount;    /**< Spans recorded so far         */
+    DNM_TRACE_EVENT         *pEvents;   /**< Spans                         */
+} DNM_TRACE_BUF;
+
+volatile bool bDnmTraceOn = false;
+
+/** Capacity of buffers created from now on */
+static volatile unsigned long ulTraceCap = DNETMOD_TRACE_DEF_EVENTS;
+/** Sequence number of the last thread which got a buffer */
+static volatile unsigned long ulTraceThreads = 0;
+/** Origin of timestamps in the output */
+static DNM_UINT64 ullTraceOrigin = 0;
+/** List of all buffers */
+static DNM_TRACE_BUF * volatile pTraceBufs = 0;
+/** Buffer of the calling thread */
+static DNM_THREAD_LOCAL DNM_TRACE_BUF *pThreadBuf = 0;
+
+/**
+ * @brief Creates buffer of the calling thread
+ * @return Pointer to the buffer or NULL if out of memory.
+ */
+static DNM_TRACE_BUF * CreateBuffer(void) {
+    DNM_TRACE_BUF *pBuf = new DNM_TRACE_BUF;
+
+    pBuf->ulCap = DnmAtomicLoad(&ulTraceCap);
+    pBuf->pEvents = new DNM_TRACE_EVENT[pBuf->ulCap];
+    pBuf->ulCount = 0;
+    pBuf->ulThread = DnmAtomicAdd(&ulTraceThreads, 1);
+    do {
+        pBuf->pNext = static_cast<DNM_TRACE_BUF *>(DnmAtomicLoadPtr(reinterpret_cast<void * const volatile *>(&pTraceBufs)));
+    } while ( !DnmAtomicCasPtr(reinterpret_cast<void * volatile *>(&pTraceBufs), pBuf->pNext, pBuf) );
+
+    return pBuf;
+}
+
+/**
+ * @brief Records a span in the buffer of the calling thread
+ *
+ * Called through DNM_TRACE_SPAN when recording is started. The buffer is
+ * created on the first span recorded by the thread.
+ * @param strName Span name. Must be a string with static storage.
+ * @param usBoard Board number.
+ * @param ucMacID MAC ID of the node.
+ * @param ullStart Start time in ns.
+ * @param ullEnd End time in ns.
+ */
+void DnmTraceRecord(
+    const char     *strName,
+    unsigned short usBoard,
+    unsigned char  ucMacID,
+    DNM_UINT64     ullStart,
+    DNM_UINT64     ullEnd)
+{
+    DNM_TRACE_BUF *pBuf = pThreadBuf;
+
+    if ( pBuf == 0 )
+        pBuf = pThreadBuf = CreateBuffer();
+
+    unsigned long   ulCnt  = pBuf->ulCount;
+    DNM_TRACE_EVENT *pEvt  = &pBuf->pEvents[ulCnt % pBuf->ulCap];
+
+    pEvt->strName  = strName;
+    pEvt->ullStart = ullStart;
+    pEvt->ullEnd   = ullEnd;
+    pEvt->usBoard  = usBoard;
+    pEvt->ucMacID  = ucMacID;
+    DnmAtomicStore(&pBuf->ulCount, ulCnt + 1);
+}
+
+/**
+ * @brief Starts recording
+ * @param ulEvents Count of spans kept per thread. Applies to threads which
+ * record for the first time. Zero selects #DNETMOD_TRACE_DEF_EVENTS.
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC DnmTraceStart(unsigned long ulEvents) {
+    DnmAtomicStore(&ulTraceCap, ulEvents != 0 ? ulEvents : DNETMOD_TRACE_DEF_EVENTS);
+    if ( ullTraceOrigin == 0 )
+        ullTraceOrigin = DnmTimeNs();
+    bDnmTraceOn = true;
+
+    return SetError(ERR_NOERR);
+}
+
+/**
+ * @brief Stops recording
+ *
+ * Recorded spans are kept until DnmTraceClear.
+ */
+DNETMOD_API void DNETMOD_CC DnmTraceStop(void) {
+    bDnmTraceOn = false;
+}
+
+/**
+ * @brief Discards recorded spans
+ *
+ * Must not be called while recording.
+ */
+DNETMOD_API void DNETMOD_CC DnmTraceClear(void) {
+    DNM_TRACE_BUF *pBuf = static_cast<DNM_TRACE_BUF *>(DnmAtomicLoadPtr(reinterpret_cast<void * const volatile *>(&pTraceBufs)));
+
+    for ( ; pBuf != 0; pBuf = pBuf->pNext )
+        DnmAtomicStore(&pBuf->ulCount, 0);
+    ullTraceOrigin = 0;
+}
+
+/**
+ * @brief Writes recorded spans as Chrome trace-event JSON
+ *
+ * Spans are written as complete events ("ph":"X") with board number as
+ * process ID and thread sequence number as thread ID. For an exact trace
+ * stop recording first. Spans recorded meanwhile may be torn.
+ * @param strFile Output file name.
+ * @return Error from \ref SetError function.
+ */
+DNETMOD_API int DNETMOD_CC DnmTraceWrite(const char *strFile) {
+    FILE          *pFile = 0;
+    bool          bFirst = true;
+    DNM_TRACE_BUF *pBuf  = 0;
+
+    if ( strFile == 0 )
+        return SetError(ERR_INVFPRM, "strFile", "NULL", "DnmTraceWrite");
+
+    pFile = fopen(strFile, "w");
+    if ( pFile == 0 )
+        return SetError(ERR_FILE, "DnmTraceWrite", strFile);
+
+    fprintf(pFile, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    pBuf = static_cast<DNM_TRACE_BUF *>(DnmAtomicLoadPtr(reinterpret_cast<void * const volatile *>(&pTraceBufs)));
+    for ( ; pBuf != 0; pBuf = pBuf->pNext ) {
+        unsigned long ulCnt = DnmAtomicLoad(&pBuf->ulCount);
+        unsigned long ulNum = ulCnt < pBuf->ulCap ? ulCnt : pBuf->ulCap;
+
+        for ( unsigned long i = ulCnt - ulNum; i != ulCnt; i++ ) {
+            const DNM_TRACE_EVENT *pEvt = &pBuf->pEvents[i % pBuf->ulCap];
+
+            fprintf(pFile, "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                           "\"pid\": %hu, \"tid\": %lu, \"args\": {\"mac\": %d}}",
+                    bFirst ? "" : ",", pEvt->strName,
+                    static_cast<double>(pEvt->ullStart - ullTraceOrigin) / 1000.0,
+                    static_cast<double>(pEvt->ullEnd - pEvt->ullStart) / 1000.0,
+                    pEvt->usBoard, pBuf->ulThread, pEvt->ucMacID);
+            bFirst = false;
+        }
+    }
+    fprintf(pFile, "\n]}\n");
+
+    if ( fclose(pFile) != 0 )
+        return SetError(ERR_FILE, "DnmTraceWrite", strFile);
+
+    return SetError(ERR_NOERR);
+}
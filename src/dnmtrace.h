@@ -0,0 +1,83 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmtrace.h                Type        : header            *
+ *  Description : Timeline trace recorder.                                  *
+ ****************************************************************************/
+
+/**
+ * @file dnmtrace.h
+ * @brief Timeline trace recorder.
+ *
+ * When the module is compiled with DNETMOD_TRACE defined the operations of
+ * CCIFInterface and CCIFDevice, every driver call and the sleeps made by
+ * the module are recorded as spans while recording is started with
+ * DnmTraceStart. Each thread records into its own preallocated ring buffer
+ * (the oldest spans are overwritten), so recording takes no locks and costs
+ * two clock reads and a few stores per span. DnmTraceWrite writes the
+ * recorded spans as Chrome trace-event JSON, which could be opened with
+ * Perfetto (ui.perfetto.dev) or chrome://tracing. Spans are shown per board
+ * (process) and thread. Without DNETMOD_TRACE nothing is recorded and
+ * DnmTraceWrite writes an empty trace.
+ */
+
+#ifndef DNETMOD_TRACE_HEADER
+#define DNETMOD_TRACE_HEADER 1
+
+#include "dnmdefs.h"
+#include "dnmos.h"
+
+/** Default count of spans kept per thread */
+#define DNETMOD_TRACE_DEF_EVENTS    65536
+
+/** Flag showing whether recording is started */
+extern volatile bool bDnmTraceOn;
+
+void DnmTraceRecord(const char     *strName,
+                    unsigned short usBoard,
+                    unsigned char  ucMacID,
+                    DNM_UINT64     ullStart,
+                    DNM_UINT64     ullEnd);
+
+DNETMOD_API int DNETMOD_CC DnmTraceStart(unsigned long ulEvents);
+DNETMOD_API void DNETMOD_CC DnmTraceStop(void);
+DNETMOD_API void DNETMOD_CC DnmTraceClear(void);
+DNETMOD_API int DNETMOD_CC DnmTraceWrite(const char *strFile);
+
+#if defined(DNETMOD_TRACE)
+/** Retrieves timestamp for a span */
+#define DNM_TRACE_NOW() DnmTimeNs()
+/**
+ * @brief Records a span
+ * @param name Span name (string literal).
+ * @param brd Board number.
+ * @param mac MAC ID.
+ * @param start Start time from DNM_TRACE_NOW.
+ * @param end End time from DNM_TRACE_NOW.
+ */
+#define DNM_TRACE_SPAN(name, brd, mac, start, end)                      \
+    do {                                                                \
+        if ( bDnmTraceOn )                                              \
+            DnmTraceRecord((name), (brd), (mac), (start), (end));       \
+    } while ( 0 )
+/**
+ * @brief Executes a statement and records it as a span
+ * @param name Span name (string literal).
+ * @param brd Board number.
+ * @param mac MAC ID.
+ * @param stmt The statement.
+ */
+#define DNM_TRACE_STMT(name, brd, mac, stmt)                            \
+    do {                                                                \
+        DNM_UINT64 ullTrStart_ = DnmTimeNs();                           \
+        stmt;                                                           \
+        DNM_TRACE_SPAN((name), (brd), (mac), ullTrStart_, DnmTimeNs()); \
+    } while ( 0 )
+#else
+#define DNM_TRACE_NOW() 0
+#define DNM_TRACE_SPAN(name, brd, mac, start, end)
+#define DNM_TRACE_STMT(name, brd, mac, stmt) stmt
+#endif
+
+#endif /* dnmtrace.h */
@@ -0,0 +1,430 @@
+/****************************************************************************
+ *  DeviceNet Module 0.2                                                    *
+ ****************************************************************************
+ *  Copyright   : Georgi D. Sotirov, gdsotirov@gmail.com                    *
+ *  File        : dnmunit.cpp               Type        : source            *
+ *  Description : Checks of the module's computations against known values. *
+ ****************************************************************************/
+
+/**
+ * @file dnmunit.cpp
+ * @brief Checks of the module's computations against known values.
+ *
+ * Checks the parts of the module which compute values without a driver:
+ * the bus load estimation (dnmbload.h) of a fixed set of connections, the
+ * wrap and drop accounting of CIOQueue, the bucket boundaries of the latency
+ * histograms (dnmhist.h), the offsets of typed I/O maps (dnmiomap.h) and
+ * the fragmentation of CAN I/O messages (dnmcan.h).
+ * Prints each failed check and exits with non-zero status if any failed.
+ * Usage:
+ *
+ * dnmunit [-i can_interface]
+ *
+ * With -i a change of state connection is also tried with CSocketCANInterface
+ * against dnmcanslave running on the network interface, e.g. on vcan0:
+ *
+ * <pre>
+ * dnmcanslave -i vcan0 -p 20 -c 2 10 &
+ * dnmunit -i vcan0
+ * </pre>
+ *
+ * The 20 bytes inputs of the slave are fragmented in 3 frames and the check
+ * counts the frames on the bus to verify that each message is acknowledged
+ * once. Build and run it with make check (make check-can for vcan0).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "dnmdefs.h"
+#if defined(OS_LINUX)
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#endif
+
+#include "dnmerrs.h"
+#include "dnetmod.h"
+
+/** MAC ID of the master in the CAN round trip */
+#define UNIT_CAN_MASTER     0
+/** MAC ID of the slave emulated by dnmcanslave */
+#define UNIT_CAN_SLAVE      10
+/** Input (slave's produced) size of the slave, fragmented in 3 frames */
+#define UNIT_CAN_IN_SIZE    20
+/** Output (slave's consumed) size of the slave */
+#define UNIT_CAN_OUT_SIZE   2
+/** Change of state messages exchanged in the CAN round trip */
+#define UNIT_CAN_MSGS       10
+
+/** Count of failed checks */
+static int iFailed = 0;
+/** Count of all checks */
+static int iChecks = 0;
+
+/**
+ * @brief Checks a condition
+ * @param bCond The condition.
+ * @param strWhat Description printed when the condition is false.
+ * @param iLine Source line of the check.
+ */
+static void Check(bool bCond, const char *strWhat, int iLine) {
+    iChecks++;
+    if ( !bCond ) {
+        iFailed++;
+        printf("dnmunit.cpp:%d: check failed: %s\n", iLine, strWhat);
+    }
+}
+
+/** Checks a condition and reports it with its text */
+#define CHECK(cond) Check((cond), #cond, __LINE__)
+
+/**
+ * @brief Checks bus load of a fixed set of connections at 500 kbit/s
+ *
+ * Worst case frame lengths are 55 bits for 0 data bytes, 75 for 2, 95 for
+ * 4, 125 for 7 and 135 for 8. The set is:
+ *   - polled, EPR 10 ms, 4 bytes in, 2 out: 2 frames, 170 bits;
+ *   - strobed, EPR 20 ms, 2 bytes in: 1 frame, 75 bits and the strobe
+ *     request of 1 frame, 135 bits;
+ *   - change of state, EPR 50 ms, 20 bytes in (3 fragments of 8, 8 and 7
+ *     bytes) and acknowledge: 4 frames, 450 bits.
+ */
+static void CheckBusLoad(void) {
+    DNM_BUS_CONN aConns[3] = {
+        { DEVICENET_CONN_POLLED, 10, 4, 2 },
+        { DEVICENET_CONN_STRBED, 20, 2, 0 },
+        { DEVICENET_CONN_COS,    50, 20, 0 }
+    };
+    DNM_BUS_LOAD Load;
+
+    CHECK(DnmFrameBits(0) == 55);
+    CHECK(DnmFrameBits(2) == 75);
+    CHECK(DnmFrameBits(8) == 135);
+    CHECK(DnmFrameBits(9) == 135);
+    CHECK(DnmFragments(8) == 1);
+    CHECK(DnmFragments(9) == 2);
+    CHECK(DnmFragments(20) == 3);
+
+    CHECK(DnmBusLoad(DEVICENET_BAUD_500K, aConns, 3, &Load) == ERR_NOERR);
+    CHECK(Load.ulBitRate == 500000UL);
+    CHECK(Load.ulFrames == 8);
+    CHECK(Load.ulFragmented == 1);
+    CHECK(Load.ulFramesPerSec == 380);
+    CHECK(Load.ulBitsPerSec == 36500);
+    CHECK(fabs(Load.dUtilization - 7.3) < 1e-9);
+    CHECK(Load.ulMinScanUs == 1660);
+
+    CHECK(DnmBusLoad(0xFF, aConns, 3, &Load) == ERR_INVFPRM);
+    CHECK(DnmBusLoad(DEVICENET_BAUD_500K, aConns, 3, 0) == ERR_INVFPRM);
+}
+
+/**
+ * @brief Checks wrap around and drop accounting of the output update queue
+ */
+static void CheckQueue(void) {
+    CIOQueue Queue(3);
+    IOUpdate Upd;
+    unsigned char ucByte = 0;
+
+    CHECK(Queue.IsValid());
+    CHECK(Queue.GetCapacity() == 4);
+
+    /* fill the queue and overflow it */
+    for ( ucByte = 0; ucByte < 6; ucByte++ )
+        Queue.Push(1, 0, 1, &ucByte);
+    CHECK(Queue.GetSize() == 4);
+    CHECK(Queue.GetDropped() == 2);
+
+    /* free two slots and reuse them past the end of the ring */
+    CHECK(Queue.Pop(Upd) && Upd.abData[0] == 0);
+    CHECK(Queue.Pop(Upd) && Upd.abData[0] == 1);
+    for ( ucByte = 10; ucByte < 12; ucByte++ )
+        CHECK(Queue.Push(2, ucByte, 1, &ucByte));
+    CHECK(!Queue.Push(2, 0, 1, &ucByte));
+    CHECK(Queue.GetDropped() == 3);
+
+    /* updates come out in order of pushing */
+    CHECK(Queue.Pop(Upd) && Upd.ucMacID == 1 && Upd.abData[0] == 2);
+    CHECK(Queue.Pop(Upd) && Upd.ucMacID == 1 && Upd.abData[0] == 3);
+    CHECK(Queue.Pop(Upd) && Upd.ucMacID == 2 && Upd.ucOffset == 10 && Upd.abData[0] == 10);
+    CHECK(Queue.Pop(Upd) && Upd.ucMacID == 2 && Upd.ucOffset == 11 && Upd.abData[0] == 11);
+    CHECK(!Queue.Pop(Upd));
+    CHECK(Queue.GetSize() == 0);
+
+    /* updates longer than the data of an update are rejected */
+    unsigned char aucBig[DNETMOD_IOQ_MAX_DATA + 1] = {0};
+    CHECK(!Queue.Push(1, 0, sizeof(aucBig), aucBig));
+}
+
+/**
+ * @brief Checks the value reported for a single recorded latency
+ * @param ucMacID MAC ID used as key of the histogram.
+ * @param ullNs Recorded latency in ns.
+ * @param ullHigh Expected highest value of the bucket.
+ * @param iLine Source line of the check.
+ */
+static void CheckBucket(unsigned char ucMacID, DNM_UINT64 ullNs, DNM_UINT64 ullHigh, int iLine) {
+    DNM_HIST_STATS Stats;
+
+    DnmHistRecord(DNM_HOP_CONTROL, 0, ucMacID, ullNs);
+    Check(DnmHistGetStats(DNM_HOP_CONTROL, 0, ucMacID, &Stats) == ERR_NOERR &&
+          Stats.ulCount == 1 && Stats.ullMax == ullHigh && Stats.ullP50 == ullHigh,
+          "bucket high", iLine);
+}
+
+/**
+ * @brief Checks bucket boundaries of the latency histograms
+ *
+ * Values below 8 have own buckets, above that each power of two is split in
+ * 8 buckets, so e.g. 16 and 17 share a bucket and 960 to 1023 another one.
+ * Values from 2^41 on go to the last bucket.
+ */
+static void CheckHistogram(void) {
+    DnmHistReset();
+
+    CheckBucket(1, 0, 0, __LINE__);
+    CheckBucket(2, 7, 7, __LINE__);
+    CheckBucket(3, 8, 8, __LINE__);
+    CheckBucket(4, 15, 15, __LINE__);
+    CheckBucket(5, 16, 17, __LINE__);
+    CheckBucket(6, 17, 17, __LINE__);
+    CheckBucket(7, 18, 19, __LINE__);
+    CheckBucket(8, 960, 1023, __LINE__);
+    CheckBucket(9, 1023, 1023, __LINE__);
+    CheckBucket(10, 1024, 1151, __LINE__);
+    CheckBucket(11, (1ULL << 41) - 1, (1ULL << 41) - 1, __LINE__);
+    CheckBucket(12, 1ULL << 50, (1ULL << 41) - 1, __LINE__);
+
+    /* percentiles of 100 values 1 to 100 */
+    for ( DNM_UINT64 ullNs = 1; ullNs <= 100; ullNs++ )
+        DnmHistRecord(DNM_HOP_EXCHANGE, 1, 20, ullNs);
+    CHECK(DnmHistPercentile(DNM_HOP_EXCHANGE, 1, 20, 50.0) == 51);
+    CHECK(DnmHistPercentile(DNM_HOP_EXCHANGE, 1, 20, 100.0) == 103);
+
+    /* invalid keys are ignored */
+    DnmHistRecord(DNM_HOP_COUNT, 0, 1, 100);
+    DnmHistRecord(DNM_HOP_CONTROL, DNETMOD_HIST_BOARDS, 1, 100);
+    CHECK(DnmHistPercentile(DNM_HOP_CONTROL, 0, 1, 100.0) == 0);
+
+    DnmHistReset();
+    CHECK(DnmHistPercentile(DNM_HOP_EXCHANGE, 1, 20, 50.0) == 0);
+}
+
+/** @name Input assembly of a drive used by CheckIOMap
+ * @{
+ */
+typedef DnmIOField<DnmIO_USINT, DnmIOBegin> TestStatus;
+typedef DnmIOBit<TestStatus, 0>             TestRunning;
+typedef DnmIOBit<TestStatus, 7>             TestFault;
+typedef DnmIOField<DnmIO_INT, TestStatus>   TestSpeed;
+typedef DnmIOField<DnmIO_REAL, TestSpeed>   TestTorque;
+typedef DnmIOField<DnmIO_UDINT, TestTorque> TestHours;
+typedef DnmIOLayout<TestHours, 11>          TestInput;
+/** @} */
+
+/**
+ * @brief Checks offsets and encoding of typed I/O maps
+ */
+static void CheckIOMap(void) {
+    DnmIOImage<TestInput> Image;
+    CNode Node(5, 11, 4);
+
+    CHECK(TestStatus::OFFSET == 0 && TestStatus::SIZE == 1);
+    CHECK(TestRunning::OFFSET == 0 && TestRunning::MASK == 0x01);
+    CHECK(TestFault::OFFSET == 0 && TestFault::MASK == 0x80);
+    CHECK(TestSpeed::OFFSET == 1 && TestSpeed::SIZE == 2);
+    CHECK(TestTorque::OFFSET == 3 && TestTorque::SIZE == 4);
+    CHECK(TestHours::OFFSET == 7 && TestHours::END == 11);
+    CHECK(TestInput::SIZE == 11 && sizeof(Image.aucData) == 11);
+
+    Image.Set<TestFault>(true);
+    Image.Set<TestSpeed>(-2);
+    Image.Set<TestTorque>(1.5f);
+    Image.Set<TestHours>(0x01020304);
+
+    /* little endian regardless of the host */
+    const unsigned char aucExp[11] = { 0x80, 0xFE, 0xFF, 0x00, 0x00, 0xC0, 0x3F,
+                                       0x04, 0x03, 0x02, 0x01 };
+    CHECK(memcmp(Image.aucData, aucExp, sizeof(aucExp)) == 0);
+    CHECK(Image.Get<TestFault>() && !Image.Get<TestRunning>());
+    CHECK(Image.Get<TestSpeed>() == -2);
+    CHECK(Image.Get<TestTorque>() == 1.5f);
+    CHECK(Image.Get<TestHours>() == 0x01020304);
+
+    CHECK(TestInput::MatchesInput(&Node));
+    CHECK(!TestInput::MatchesOutput(&Node));
+}
+
+#if defined(OS_LINUX)
+/**
+ * @brief Checks fragmentation and assembly of an I/O message
+ *
+ * A message of UNIT_CAN_IN_SIZE bytes takes 3 frames and the assembly
+ * completes only on the last one, so CSocketCANInterface acknowledges a
+ * fragmented change of state message once.
+ */
+static void CheckCanFragments(void) {
+    unsigned char    aucMsg[UNIT_CAN_IN_SIZE];
+    struct can_frame aFrames[8];
+    DNM_CAN_ASM      Asm;
+    canid_t          Id = DnmCanGroup1Id(DNM_CAN_G1_COS_CYC, UNIT_CAN_SLAVE);
+    int              iCount = 0;
+
+    for ( int i = 0; i < UNIT_CAN_IN_SIZE; i++ )
+        aucMsg[i] = static_cast<unsigned char>(i + 1);
+    memset(&Asm, 0, sizeof(Asm));
+
+    iCount = DnmCanIOFrames(Id, aucMsg, sizeof(aucMsg), aFrames, 8);
+    CHECK(iCount == 3);
+    CHECK(iCount == 3 && aFrames[0].can_dlc == 8 && aFrames[2].can_dlc == 7);
+    CHECK(DnmCanIOAssemble(&Asm, &aFrames[0], sizeof(aucMsg)) == DNM_CAN_ASM_MORE);
+    CHECK(DnmCanIOAssemble(&Asm, &aFrames[1], sizeof(aucMsg)) == DNM_CAN_ASM_MORE);
+    CHECK(DnmCanIOAssemble(&Asm, &aFrames[2], sizeof(aucMsg)) == DNM_CAN_ASM_DONE);
+    CHECK(Asm.usLen == sizeof(aucMsg) && memcmp(Asm.aucBuf, aucMsg, sizeof(aucMsg)) == 0);
+
+    /* a fragment out of sequence drops the message */
+    CHECK(DnmCanIOAssemble(&Asm, &aFrames[0], sizeof(aucMsg)) == DNM_CAN_ASM_MORE);
+    CHECK(DnmCanIOAssemble(&Asm, &aFrames[2], sizeof(aucMsg)) != DNM_CAN_ASM_DONE);
+}
+
+/**
+ * @brief Opens socket receiving change of state messages of the slave and
+ * their acknowledges
+ * @param strIf Name of the network interface.
+ * @return The socket or -1 on error.
+ */
+static int OpenSniffer(const char *strIf) {
+    struct can_filter   aFilter[2];
+    struct ifreq        Ifr;
+    struct sockaddr_can Addr;
+    struct timeval      Tmo = { 0, 100000 };
+    int                 iSock = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+
+    if ( iSock < 0 )
+        return -1;
+
+    aFilter[0].can_id   = DnmCanGroup1Id(DNM_CAN_G1_COS_CYC, UNIT_CAN_SLAVE);
+    aFilter[0].can_mask = CAN_SFF_MASK;
+    aFilter[1].can_id   = DnmCanGroup2Id(UNIT_CAN_SLAVE, DNM_CAN_G2_COS_ACK);
+    aFilter[1].can_mask = CAN_SFF_MASK;
+    memset(&Ifr, 0, sizeof(Ifr));
+    strncpy(Ifr.ifr_name, strIf, IFNAMSIZ - 1);
+    memset(&Addr, 0, sizeof(Addr));
+    Addr.can_family = AF_CAN;
+    if ( setsockopt(iSock, SOL_CAN_RAW, CAN_RAW_FILTER, aFilter, sizeof(aFilter)) < 0 ||
+         setsockopt(iSock, SOL_SOCKET, SO_RCVTIMEO, &Tmo, sizeof(Tmo)) < 0 ||
+         ioctl(iSock, SIOCGIFINDEX, &Ifr) < 0 ) {
+        close(iSock);
+        return -1;
+    }
+    Addr.can_ifindex = Ifr.ifr_ifindex;
+    if ( bind(iSock, reinterpret_cast<struct sockaddr *>(&Addr), sizeof(Addr)) < 0 ) {
+        close(iSock);
+        return -1;
+    }
+
+    return iSock;
+}
+
+/**
+ * @brief Counts frames received by the sniffer until the bus is quiet
+ * @param iSock The sniffer.
+ * @param pulFrags Incremented for each frame of change of state messages.
+ * @param pulAcks Incremented for each acknowledge of the master.
+ */
+static void CountFrames(int iSock, unsigned long *pulFrags, unsigned long *pulAcks) {
+    struct can_frame Frame;
+
+    while ( read(iSock, &Frame, sizeof(Frame)) == sizeof(Frame) ) {
+        if ( (Frame.can_id & CAN_SFF_MASK) == DnmCanGroup2Id(UNIT_CAN_SLAVE, DNM_CAN_G2_COS_ACK) )
+            (*pulAcks)++;
+        else (*pulFrags)++;
+    }
+}
+
+/**
+ * @brief Checks change of state round trip with dnmcanslave
+ *
+ * Each output of the master makes the slave produce its fragmented input,
+ * which the master must acknowledge once, after the last fragment.
+ * @param strIf Name of the network interface.
+ */
+static void CheckCanRoundTrip(const char *strIf) {
+    CSocketCANInterface Intf(strIf, UNIT_CAN_MASTER, 0, 0, DEVICENET_BAUD_125K);
+    CSocketCANDevice    Dev(UNIT_CAN_SLAVE, UNIT_CAN_IN_SIZE, UNIT_CAN_OUT_SIZE, DEVICENET_CONN_COS, 100, &Intf);
+    unsigned char       aucOut[UNIT_CAN_OUT_SIZE] = {0};
+    unsigned long       ulFrags = 0;
+    unsigned long       ulAcks  = 0;
+    unsigned long       ulIn    = 0;
+    int                 iSniff  = -1;
+
+    CHECK(Intf.Open() == ERR_NOERR);
+    CHECK(Dev.Allocate() == ERR_NOERR);
+    if ( !Dev.IsActive() ) {
+        char strMsg[256] = {0};
+
+        GetErrMsg(sizeof(strMsg), strMsg);
+        printf("%s\n", strMsg);
+        Intf.Close();
+        return;
+    }
+
+    iSniff = OpenSniffer(strIf);
+    CHECK(iSniff >= 0);
+    if ( iSniff >= 0 ) {
+        /* skip traffic of the allocation */
+        CountFrames(iSniff, &ulFrags, &ulAcks);
+        ulFrags = ulAcks = 0;
+        ulIn = Dev.GetInputCount();
+
+        for ( int i = 0; i < UNIT_CAN_MSGS; i++ ) {
+            aucOut[0] = static_cast<unsigned char>(i + 1);
+            CHECK(Dev.WriteIOData(sizeof(aucOut), aucOut) == ERR_NOERR);
+            DnmSleepMs(20);
+        }
+        CountFrames(iSniff, &ulFrags, &ulAcks);
+        close(iSniff);
+
+        CHECK(Dev.GetInputCount() - ulIn == UNIT_CAN_MSGS);
+        CHECK(ulFrags == 3 * UNIT_CAN_MSGS);
+        CHECK(ulAcks == UNIT_CAN_MSGS);
+    }
+
+    Dev.Unallocate();
+    Intf.Close();
+}
+#endif
+
+/**
+ * @brief Program's entry point
+ * @return Zero if all checks passed, one otherwise, two on wrong usage.
+ */
+int main(int argc, char *argv[]) {
+    const char *strCanIf = 0;
+
+    if ( argc == 3 && !strcmp(argv[1], "-i") )
+        strCanIf = argv[2];
+    else if ( argc != 1 ) {
+        fprintf(stderr, "Usage: %s [-i can_interface]\n", argv[0]);
+        return 2;
+    }
+
+    CheckBusLoad();
+    CheckQueue();
+    CheckHistogram();
+    CheckIOMap();
+#if defined(OS_LINUX)
+    CheckCanFragments();
+    if ( strCanIf != 0 )
+        CheckCanRoundTrip(strCanIf);
+#endif
+
+    printf("%d of %d checks failed\n", iFailed, iChecks);
+
+    return iFailed != 0 ? 1 : 0;
+}